@@ -83,6 +83,18 @@
  */
 #define ERROR_RETRY_TIME 1
 
+/**
+ * \brief the delay between two initialisation or freeing retries is
+ * doubled after each retry, up to ERROR_RETRY_TIME << RETRY_BACKOFF_MAX_SHIFT
+ * (0 for a constant delay).
+ */
+#define RETRY_BACKOFF_MAX_SHIFT 0
+
+/**
+ * \brief Number of states of the main state machine (see stateMachine.cpp).
+ */
+#define NB_MAIN_STATES 7
+
 /**
  * \brief CAN device name in the Linux device management system.
  */
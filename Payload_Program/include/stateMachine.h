@@ -0,0 +1,264 @@
+/**
+ * \file stateMachine.h
+ * \brief main state machine function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the main state machine definitions. The states (with the
+ * handler run at each loop) and the transitions (state x event ->
+ * telemetry and action, next state) are constant tables of
+ * stateMachine.cpp, checked at compile time and expanded at compile
+ * time to a dense matrix indexed by state and event. The main loop runs
+ * the handler of the current state through the state table, a signal or
+ * a state telecommand replaces the event returned by the handler.
+ */
+
+#ifndef STATEMACHINE_H
+#define STATEMACHINE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \brief function run at each loop in a state, returns what happened.
+ */
+typedef eventDef (*stateHandlerDef)();
+
+/**
+ * \brief function run on a transition.
+ */
+typedef void (*transitionActionDef)();
+
+/**
+ * \struct stateStruct
+ * \brief one state of the main state machine
+ *
+ */
+struct stateStruct {
+    stateDef state;                         /**< State value (telecommands and telemetry) */
+    const char *name;                       /**< State name for the logs */
+    stateHandlerDef handler;                /**< Function run at each loop, NULL for the final state */
+    bool periodic;                          /**< True to wait MAIN_LOOP_TIME after the handler */
+    eventDef stateTCEvent;                  /**< Event of the telecommand requesting this state */
+};
+
+/**
+ * \struct transitionStruct
+ * \brief transition from one state on one event
+ *
+ */
+struct transitionStruct {
+    stateDef state;                         /**< Current state */
+    eventDef event;                         /**< Event returned by the state handler */
+    stateDef next;                          /**< Next state */
+    statusErrDef telemetry;                 /**< Telemetry sent on the transition, noError for none */
+    transitionActionDef action;             /**< Function run on the transition, NULL for none */
+};
+
+/**
+ * \struct globalTransitionStruct
+ * \brief transition from every state on one event, used when
+ * the state has no transition on this event
+ *
+ */
+struct globalTransitionStruct {
+    eventDef event;                         /**< Event */
+    stateDef next;                          /**< Next state */
+    statusErrDef telemetry;                 /**< Telemetry sent on the transition, noError for none */
+    transitionActionDef action;             /**< Function run on the transition, NULL for none */
+};
+
+/**
+ * \struct transitionCellStruct
+ * \brief one cell of the state x event matrix, an event without
+ * transition stays in the state without telemetry
+ *
+ */
+struct transitionCellStruct {
+    uint8_t next;                           /**< Next state index in the state table */
+    statusErrDef telemetry;                 /**< Telemetry sent on the transition, noError for none */
+    transitionActionDef action;             /**< Function run on the transition, NULL for none */
+};
+
+/**
+ * \struct transitionMatrixStruct
+ * \brief the state x event matrix, the cell of the state index s
+ * and the event e is cell[s * nbEvents + e]
+ *
+ */
+template<int NB_STATES>
+struct transitionMatrixStruct {
+    transitionCellStruct cell[NB_STATES * nbEvents];    /**< Cells, state major */
+};
+
+/**
+ * \struct retryStepStruct
+ * \brief one initialisation or freeing step retried NB_RETRIES times
+ *
+ */
+struct retryStepStruct {
+    const char *name;                       /**< Subsystem name for the logs */
+    statusErrDef (*function)();             /**< Initialisation or freeing function */
+    statusErrDef successTelemetry;          /**< Telemetry sent on success, noError for none */
+    bool sendErrorTelemetry;                /**< False when the telemetry link is not available */
+};
+
+/**
+ * \struct stateLatencyStruct
+ * \brief handler and transition durations of one state in nanoseconds
+ *
+ */
+struct stateLatencyStruct {
+    uint64_t nbRuns;                        /**< Number of handler runs */
+    uint64_t handlerTotal;                  /**< Sum of the handler durations */
+    uint64_t handlerMax;                    /**< Longest handler duration */
+    uint64_t nbTransitions;                 /**< Number of transitions leaving the state */
+    uint64_t transitionTotal;               /**< Sum of the transition durations (telemetry and action) */
+    uint64_t transitionMax;                 /**< Longest transition duration */
+};
+
+//------------------------------------------------------------------------------
+// Compile time table checks and expansion
+//------------------------------------------------------------------------------
+/**
+ * \brief index sequence 0 .. N - 1 (std::index_sequence is C++14).
+ */
+template<int... I> struct indexList {};
+template<int N, int... I> struct makeIndexList : makeIndexList<N - 1, N - 1, I...> {};
+template<int... I> struct makeIndexList<0, I...> { typedef indexList<I...> type; };
+
+/**
+ * \brief index of a state in the state table, -1 when missing.
+ */
+template<int NS>
+constexpr int findStateIndex(const stateStruct (&states)[NS], stateDef state, int i = 0) {
+    return i == NS ? -1 : states[i].state == state ? i : findStateIndex(states, state, i + 1);
+}
+
+/**
+ * \brief index of the transition of a state on an event, -1 when missing.
+ */
+template<int NT>
+constexpr int findTransition(const transitionStruct (&transitions)[NT], stateDef state, int event, int i = 0) {
+    return i == NT ? -1 :
+           (transitions[i].state == state && transitions[i].event == event) ? i :
+           findTransition(transitions, state, event, i + 1);
+}
+
+/**
+ * \brief index of the global transition on an event, -1 when missing.
+ */
+template<int NG>
+constexpr int findGlobalTransition(const globalTransitionStruct (&transitions)[NG], int event, int i = 0) {
+    return i == NG ? -1 : transitions[i].event == event ? i : findGlobalTransition(transitions, event, i + 1);
+}
+
+/**
+ * \brief true when no two states have the same value.
+ */
+template<int NS>
+constexpr bool checkStatesUnique(const stateStruct (&states)[NS], int i = 0) {
+    return i == NS || (findStateIndex(states, states[i].state) == i && checkStatesUnique(states, i + 1));
+}
+
+/**
+ * \brief true when every transition goes between two states of the state
+ * table, on a real event, and is the only one of its state and event.
+ */
+template<int NS, int NT>
+constexpr bool checkTransitions(const stateStruct (&states)[NS], const transitionStruct (&transitions)[NT],
+                                int i = 0) {
+    return i == NT ||
+           (findStateIndex(states, transitions[i].state) >= 0 &&
+            findStateIndex(states, transitions[i].next) >= 0 &&
+            transitions[i].event != eventNone && transitions[i].event < nbEvents &&
+            findTransition(transitions, transitions[i].state, transitions[i].event) == i &&
+            checkTransitions(states, transitions, i + 1));
+}
+
+/**
+ * \brief true when every global transition goes to a state of the state
+ * table, on a real event, and is the only one of its event.
+ */
+template<int NS, int NG>
+constexpr bool checkGlobalTransitions(const stateStruct (&states)[NS], const globalTransitionStruct (&transitions)[NG],
+                                      int i = 0) {
+    return i == NG ||
+           (findStateIndex(states, transitions[i].next) >= 0 &&
+            transitions[i].event != eventNone && transitions[i].event < nbEvents &&
+            findGlobalTransition(transitions, transitions[i].event) == i &&
+            checkGlobalTransitions(states, transitions, i + 1));
+}
+
+/**
+ * \brief true when the telecommand event of every state is a
+ * global transition to this state.
+ */
+template<int NS, int NG>
+constexpr bool checkStateTCEvents(const stateStruct (&states)[NS], const globalTransitionStruct (&transitions)[NG],
+                                  int i = 0) {
+    return i == NS ||
+           ((states[i].stateTCEvent == eventNone ||
+             (findGlobalTransition(transitions, states[i].stateTCEvent) >= 0 &&
+              transitions[findGlobalTransition(transitions, states[i].stateTCEvent)].next == states[i].state)) &&
+            checkStateTCEvents(states, transitions, i + 1));
+}
+
+/**
+ * \brief the matrix cell of a state index and an event: the transition
+ * of the state, else the global transition, else stay in the state.
+ */
+template<int NS, int NT, int NG>
+constexpr transitionCellStruct makeTransitionCell(const stateStruct (&states)[NS],
+                                                  const transitionStruct (&transitions)[NT],
+                                                  const globalTransitionStruct (&globalTransitions)[NG],
+                                                  int cell) {
+    return findTransition(transitions, states[cell / nbEvents].state, cell % nbEvents) >= 0 ?
+               transitionCellStruct{
+                   (uint8_t)findStateIndex(states, transitions[findTransition(transitions,
+                       states[cell / nbEvents].state, cell % nbEvents)].next),
+                   transitions[findTransition(transitions, states[cell / nbEvents].state, cell % nbEvents)].telemetry,
+                   transitions[findTransition(transitions, states[cell / nbEvents].state, cell % nbEvents)].action} :
+           findGlobalTransition(globalTransitions, cell % nbEvents) >= 0 ?
+               transitionCellStruct{
+                   (uint8_t)findStateIndex(states, globalTransitions[findGlobalTransition(globalTransitions,
+                       cell % nbEvents)].next),
+                   globalTransitions[findGlobalTransition(globalTransitions, cell % nbEvents)].telemetry,
+                   globalTransitions[findGlobalTransition(globalTransitions, cell % nbEvents)].action} :
+               transitionCellStruct{(uint8_t)(cell / nbEvents), noError, NULL};
+}
+
+/**
+ * \brief the state x event matrix of the state and transition tables.
+ */
+template<int NS, int NT, int NG, int... I>
+constexpr transitionMatrixStruct<NS> buildTransitionMatrix(const stateStruct (&states)[NS],
+                                                           const transitionStruct (&transitions)[NT],
+                                                           const globalTransitionStruct (&globalTransitions)[NG],
+                                                           indexList<I...>) {
+    return transitionMatrixStruct<NS>{{makeTransitionCell(states, transitions, globalTransitions, I)...}};
+}
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef runRetryStep(const struct retryStepStruct *step, const char *operation);
+void runRetrySteps(const struct retryStepStruct *steps, int nbSteps, const char *operation);
+void requestStateMachineStop();
+void printStateLatency();
+int runStateMachine();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern struct stateLatencyStruct stateLatency[NB_MAIN_STATES];
+
+#endif
@@ -123,6 +123,28 @@ const std::unordered_set<uint16_t> validStates = {
     init, payloadMode, processMsg, idleMode, processNav, restart, ending
 };
 
+/**
+ * \enum eventDef
+ * \brief list of events of the main state machine (see stateMachine.cpp)
+ */
+typedef enum
+{
+	eventNone = 0,							/**< Nothing happened, stay in the current state. */
+	eventDone,								/**< The state procedure has completed. */
+	eventPacketReceived,					/**< At least one 5G packet has been recieved. */
+	eventPacketTimeout,						/**< No 5G packet has been recieved for MSG_TIMEOUT. */
+	eventNavRequest,						/**< A navigation request has been recieved. */
+	eventStopSignal,						/**< SIGINT or SIGTERM has been caught. */
+	eventTCInit,							/**< Telecommand to the initialisation state. */
+	eventTCPayloadMode,						/**< Telecommand to the payload mode. */
+	eventTCProcessMsg,						/**< Telecommand to the 5G packets processing state. */
+	eventTCIdleMode,						/**< Telecommand to the idle mode. */
+	eventTCProcessNav,						/**< Telecommand to the navigation request processing state. */
+	eventTCRestart,							/**< Telecommand to the restart state. */
+	eventTCEnding,							/**< Telecommand to stop the program. */
+	nbEvents								/**< Number of events. */
+} eventDef;
+
 /**
  * \enum sensorDef
  * \brief list of the payload sensors
@@ -212,12 +212,6 @@ statusErrDef recieveTCFromOBDH() {
 		std::vector<uint8_t> *userData = ccsdsPacket.getUserDataField();
 		mainStateTC = ((*userData)[0] << 8) | (*userData)[1];
 
-		if(mainStateTC == 0x1701) {
-			resetMsgTimer();
-            printf("State has been changed to control mode\n");
-            sendTelemToOBDH(infoStateToPayloadMode);
-		}
-
 		//get APID
 		std::cout << ccsdsPacket.getPrimaryHeader()->getAPIDAsInteger() << std::endl;
 		//dump packet content
@@ -0,0 +1,450 @@
+/**
+ * \file stateMachine.cpp
+ * \brief main state machine functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Main state machine of the Payload subsystem: the state handlers, the
+ * state and transition tables and the main loop. The tables are
+ * checked by static_assert and expanded at compile time to the state x
+ * event matrix, a transition is one matrix lookup. The handlers are
+ * called through the state table (an indexed jump), the handler and
+ * transition durations of every state are kept in stateLatency.
+ *
+ */
+#include "stateMachine.h"
+#include "init.h"
+#include "payloadMode.h"
+#include "processMsg.h"
+#include "idleMode.h"
+#include "processNav.h"
+#include "restart.h"
+
+#include <signal.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static eventDef runInitState();
+static eventDef runPayloadModeState();
+static eventDef runProcessMsgState();
+static eventDef runIdleModeState();
+static eventDef runProcessNavState();
+static eventDef runRestartState();
+static void checkTCAndSensors();
+static uint64_t getMonotonicTime();
+static eventDef getStateTCEvent();
+
+//------------------------------------------------------------------------------
+// State machine tables
+//------------------------------------------------------------------------------
+/**
+ * \brief states of the main state machine, the first one is the
+ * initial state and the last one the final state.
+ */
+static constexpr stateStruct mainStates[] = {
+    {init,          "init",                 runInitState,           false,  eventTCInit},
+    {payloadMode,   "payload mode",         runPayloadModeState,    true,   eventTCPayloadMode},
+    {processMsg,    "process message",      runProcessMsgState,     false,  eventTCProcessMsg},
+    {idleMode,      "idle mode",            runIdleModeState,       true,   eventTCIdleMode},
+    {processNav,    "process navigation",   runProcessNavState,     false,  eventTCProcessNav},
+    {restart,       "restart",              runRestartState,        false,  eventTCRestart},
+    {ending,        "ending",               NULL,                   false,  eventTCEnding},
+};
+
+/**
+ * \brief transitions of the main state machine, the message timer
+ * restarts each time the payload mode is entered.
+ */
+static constexpr transitionStruct mainTransitions[] = {
+    {init,          eventDone,              payloadMode,    infoStateToPayloadMode, resetMsgTimer},
+    {payloadMode,   eventPacketReceived,    processMsg,     infoStateToProcessMsg,  NULL},
+    {payloadMode,   eventPacketTimeout,     idleMode,       infoStateToIdleMode,    NULL},
+    {payloadMode,   eventNavRequest,        processNav,     infoStateToProcessNav,  NULL},
+    {idleMode,      eventPacketReceived,    processMsg,     infoStateToProcessMsg,  NULL},
+    {processMsg,    eventDone,              payloadMode,    infoStateToPayloadMode, resetMsgTimer},
+    {processNav,    eventDone,              payloadMode,    infoStateToPayloadMode, resetMsgTimer},
+    {restart,       eventDone,              ending,         noError,                NULL},
+    {restart,       eventStopSignal,        ending,         noError,                NULL},
+};
+
+/**
+ * \brief transitions from every state, the state telecommands are
+ * accepted in every state. The payload mode telecommand restarts the
+ * message timer, the restart state is announced on entry.
+ */
+static constexpr globalTransitionStruct mainGlobalTransitions[] = {
+    {eventStopSignal,       restart,        infoStateToRestart,     NULL},
+    {eventTCInit,           init,           noError,                NULL},
+    {eventTCPayloadMode,    payloadMode,    infoStateToPayloadMode, resetMsgTimer},
+    {eventTCProcessMsg,     processMsg,     noError,                NULL},
+    {eventTCIdleMode,       idleMode,       noError,                NULL},
+    {eventTCProcessNav,     processNav,     noError,                NULL},
+    {eventTCRestart,        restart,        infoStateToRestart,     NULL},
+    {eventTCEnding,         ending,         noError,                NULL},
+};
+
+static_assert(sizeof(mainStates) / sizeof(mainStates[0]) == NB_MAIN_STATES,
+              "NB_MAIN_STATES must be the number of states of mainStates");
+static_assert(checkStatesUnique(mainStates), "a state is declared twice in mainStates");
+static_assert(checkTransitions(mainStates, mainTransitions),
+              "a transition has an unknown state or event, or is declared twice");
+static_assert(checkGlobalTransitions(mainStates, mainGlobalTransitions),
+              "a global transition has an unknown state or event, or is declared twice");
+static_assert(checkStateTCEvents(mainStates, mainGlobalTransitions),
+              "the telecommand event of a state must be a global transition to this state");
+
+/**
+ * \brief state x event matrix of the main state machine.
+ */
+static constexpr transitionMatrixStruct<NB_MAIN_STATES> mainTransitionMatrix =
+    buildTransitionMatrix(mainStates, mainTransitions, mainGlobalTransitions,
+                          makeIndexList<NB_MAIN_STATES * nbEvents>::type());
+
+static_assert(mainStates[NB_MAIN_STATES - 1].state == ending && mainStates[NB_MAIN_STATES - 1].handler == NULL,
+              "the last state must be the final state, without handler");
+static_assert(mainTransitionMatrix.cell[findStateIndex(mainStates, payloadMode) * nbEvents + eventStopSignal].next ==
+              findStateIndex(mainStates, restart), "a signal must free the subsystems before ending");
+
+/**
+ * \brief initialisation steps of the init state.
+ */
+static const retryStepStruct initSteps[] = {
+    {"OBDH",        initOBDH,       infoInitOBDHSuccess,        true},
+    {"Payload",     initPayload,    infoInitPayloadSuccess,     true},
+    {"Intersat",    initIntersat,   infoInitIntersatSuccess,    true},
+};
+
+/**
+ * \brief freeing steps of the restart state, the OBDH link is
+ * freed last, without telemetry.
+ */
+static const retryStepStruct freeSteps[] = {
+    {"Intersat",    freeIntersat,   infoFreeIntersatSuccess,    true},
+    {"Payload",     freePayload,    infoFreePayloadSuccess,     true},
+    {"OBDH",        freeOBDH,       noError,                    false},
+};
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief handler and transition durations of every state.
+ */
+struct stateLatencyStruct stateLatency[NB_MAIN_STATES];
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief set by the signal handler, taken by the main loop.
+ */
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * \brief latest state telecommand taken by the main loop.
+ */
+static uint16_t lastStateTC = 0xFFFF;
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief init state: Payload and subsystem connection initialisation.
+ *
+ * \return eventDone.
+ */
+static eventDef runInitState() {
+    runRetrySteps(initSteps, sizeof(initSteps) / sizeof(initSteps[0]), "init");
+    return eventDone;
+}
+
+/**
+ * \brief function to check the telecommands from and the sensors
+ * of the OBDH subsystem, in the payload and idle modes.
+ */
+static void checkTCAndSensors() {
+    statusErrDef ret = checkTC();
+    if (ret != noError && ret != infoNoDataInCANBuffer) {
+        printf("Error check TC! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+
+    ret = checkSensors();
+    if (ret != noError) {
+        printf("Error check sensors! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+}
+
+/**
+ * \brief payload mode state: 5G packets and navigation requests
+ * reception.
+ *
+ * \return eventNavRequest, eventPacketReceived or eventPacketTimeout
+ * (the navigation request first), eventNone otherwise.
+ */
+static eventDef runPayloadModeState() {
+    eventDef event = eventNone;
+    checkTCAndSensors();
+
+    statusErrDef ret = recieve5GPackets();
+    if (ret == info5GPacketReceived)
+        event = eventPacketReceived;
+    else if (ret == infoRecieve5GPacketsTimeout)
+        event = eventPacketTimeout;
+    else if (ret != noError) {
+        printf("Error recieving 5G packets! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+
+    ret = recieveNavReq();
+    if (ret == infoNavReqReceived)
+        event = eventNavRequest;
+    else if (ret != noError) {
+        printf("Error recieving navigation request! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+    return event;
+}
+
+/**
+ * \brief process message state: the 5G packet is sent to the ground
+ * station or to the next node through the Intersat subsystem.
+ *
+ * \return eventDone.
+ */
+static eventDef runProcessMsgState() {
+    statusErrDef ret = aStarPathAlgorithm();
+    if (ret == infoDirectPathToGS) {
+        ret = transmitToGS();
+        if (ret != noError) {
+            printf("Error transmitting 5G packet to the ground station! 0x%04X \n", ret);
+            sendTelemToOBDH(ret);
+        }
+    }
+    else if (ret == infoPathToNextNode) {
+        ret = transmitToIntersat({0x11, 0x22});
+        if (ret != noError) {
+            printf("Error transmitting 5G packet to the intersatellite subsystem! 0x%04X \n", ret);
+            sendTelemToOBDH(ret);
+        }
+    }
+    else {
+        printf("Error in A star path algorithm! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+    return eventDone;
+}
+
+/**
+ * \brief idle mode state: low power reception of the 5G packets.
+ *
+ * \return eventPacketReceived when a 5G packet has been recieved,
+ * eventNone otherwise.
+ */
+static eventDef runIdleModeState() {
+    checkTCAndSensors();
+
+    statusErrDef ret = recieve5GPacketsIdle();
+    if (ret == info5GPacketReceived)
+        return eventPacketReceived;
+    if (ret != noError) {
+        printf("Error in Idle loop! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+    return eventNone;
+}
+
+/**
+ * \brief process navigation state: the user position is computed
+ * from the doppler shift and sent to the user.
+ *
+ * \return eventDone.
+ */
+static eventDef runProcessNavState() {
+    statusErrDef ret = calcNavFromDopplerShift();
+    if (ret != noError) {
+        printf("Error calculating user position from doppler shift! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+
+    ret = sendNavToUser();
+    if (ret != noError) {
+        printf("Error sending navigation data to the user! 0x%04X \n", ret);
+        sendTelemToOBDH(ret);
+    }
+    return eventDone;
+}
+
+/**
+ * \brief restart state: every subsystem is freed, systemd restarts
+ * the program when it ends.
+ *
+ * \return eventDone.
+ */
+static eventDef runRestartState() {
+    runRetrySteps(freeSteps, sizeof(freeSteps) / sizeof(freeSteps[0]), "free");
+    printStateLatency();
+    return eventDone;
+}
+
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getMonotonicTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to convert a new state telecommand (see
+ * checkTC()) to the telecommand event of the state.
+ *
+ * \return the telecommand event, eventNone when there is
+ * no new state telecommand.
+ */
+static eventDef getStateTCEvent() {
+    uint16_t stateTC = mainStateTC;
+    if (stateTC == 0xFFFF || stateTC == lastStateTC)
+        return eventNone;
+    for (int s = 0; s < NB_MAIN_STATES; s++) {
+        if (mainStates[s].state == stateTC) {
+            lastStateTC = stateTC;
+            return mainStates[s].stateTCEvent;
+        }
+    }
+    return eventNone;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to run an initialisation or freeing step up to
+ * NB_RETRIES times, the delay between two retries starts at
+ * ERROR_RETRY_TIME and is doubled up to RETRY_BACKOFF_MAX_SHIFT times.
+ *
+ * \param step the step
+ * \param operation "init" or "free", for the logs
+ *
+ * \return the status of the last try.
+ */
+statusErrDef runRetryStep(const struct retryStepStruct *step, const char *operation) {
+    statusErrDef ret = noError;
+    for (int retry = 0; retry < NB_RETRIES; retry++) {
+        ret = step->function();
+        if (ret == noError) {
+            printf("%s %s OK\n", operation, step->name);
+            if (step->successTelemetry != noError)
+                sendTelemToOBDH(step->successTelemetry);
+            return ret;
+        }
+        printf("Error %s %s! 0x%04X \n", operation, step->name, ret);
+        if (step->sendErrorTelemetry)
+            sendTelemToOBDH(ret);
+        int shift = (retry < RETRY_BACKOFF_MAX_SHIFT) ? retry : RETRY_BACKOFF_MAX_SHIFT;
+        sleep(ERROR_RETRY_TIME << shift);
+    }
+    return ret;
+}
+
+/**
+ * \brief function to run initialisation or freeing steps in order,
+ * a step that still fails after its retries doesn't stop the next ones.
+ *
+ * \param steps the steps
+ * \param nbSteps the number of steps
+ * \param operation "init" or "free", for the logs
+ */
+void runRetrySteps(const struct retryStepStruct *steps, int nbSteps, const char *operation) {
+    for (int i = 0; i < nbSteps; i++)
+        runRetryStep(&steps[i], operation);
+}
+
+/**
+ * \brief function to stop the program gracefully (freeing every
+ * subsystem), safe to call from a signal handler.
+ */
+void requestStateMachineStop() {
+    stopRequested = 1;
+}
+
+/**
+ * \brief function to print the handler and transition durations
+ * of every state.
+ */
+void printStateLatency() {
+    for (int s = 0; s < NB_MAIN_STATES; s++) {
+        const struct stateLatencyStruct *latency = &stateLatency[s];
+        if (latency->nbRuns == 0)
+            continue;
+        printf("state %s: %llu runs, handler mean %llu us max %llu us, "
+               "%llu transitions, transition mean %llu us max %llu us\n",
+               mainStates[s].name, (unsigned long long)latency->nbRuns,
+               (unsigned long long)(latency->handlerTotal / latency->nbRuns / 1000),
+               (unsigned long long)(latency->handlerMax / 1000),
+               (unsigned long long)latency->nbTransitions,
+               (unsigned long long)(latency->nbTransitions ? latency->transitionTotal / latency->nbTransitions / 1000 : 0),
+               (unsigned long long)(latency->transitionMax / 1000));
+    }
+}
+
+/**
+ * \brief function to run the main state machine from the initial
+ * state until the final state. A signal, then a new state telecommand,
+ * replace the event returned by the state handler.
+ *
+ * \return 0 when the final state is reached.
+ */
+int runStateMachine() {
+    struct timespec mainSleep = {0, MAIN_LOOP_TIME};
+    int current = 0;
+    memset(stateLatency, 0, sizeof(stateLatency));
+
+    while (mainStates[current].handler != NULL) {
+        struct stateLatencyStruct *latency = &stateLatency[current];
+        uint64_t handlerStart = getMonotonicTime();
+        eventDef event = mainStates[current].handler();
+        uint64_t handlerEnd = getMonotonicTime();
+        latency->nbRuns++;
+        latency->handlerTotal += handlerEnd - handlerStart;
+        if (handlerEnd - handlerStart > latency->handlerMax)
+            latency->handlerMax = handlerEnd - handlerStart;
+
+        if (stopRequested) {
+            stopRequested = 0;
+            event = eventStopSignal;
+        }
+        else {
+            eventDef stateTCEvent = getStateTCEvent();
+            if (stateTCEvent != eventNone)
+                event = stateTCEvent;
+        }
+
+        const struct transitionCellStruct *cell = &mainTransitionMatrix.cell[current * nbEvents + event];
+        if (cell->next != current || cell->telemetry != noError || cell->action != NULL) {
+            if (cell->next != current)
+                printf("State has been changed to %s\n", mainStates[cell->next].name);
+            if (cell->telemetry != noError)
+                sendTelemToOBDH(cell->telemetry);
+            if (cell->action != NULL)
+                cell->action();
+            uint64_t transitionEnd = getMonotonicTime();
+            latency->nbTransitions++;
+            latency->transitionTotal += transitionEnd - handlerEnd;
+            if (transitionEnd - handlerEnd > latency->transitionMax)
+                latency->transitionMax = transitionEnd - handlerEnd;
+        }
+
+        if (mainStates[current].periodic)
+            nanosleep(&mainSleep, NULL);
+        current = cell->next;
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * \file canFilter.h
+ * \brief CAN bus kernel filter table definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the CAN filter table definitions mapping CAN ID ranges
+ * to the subsystem frame handlers, and the per-filter statistics.
+ * The CAN error frames, the frames matching no filter and the sensor
+ * data frames from an unknown sensor ID are counted,
+ * not reported one by one. The counters are sent to the TT&C subsystem
+ * at the end of every sensor statistics window and reset.
+ *
+ * HKCANFilterStats packet user data (big endian):
+ * - packet ID (2 bytes, HKCANFilterStats)
+ * - number of filters (1 byte)
+ * - frames recieved per filter, in the filter table order (4 bytes each)
+ * - CAN error frames (4 bytes)
+ * - frames matching no filter (4 bytes)
+ * - sensor data frames from a sensor ID not in paramSensors.csv (4 bytes)
+ */
+
+#ifndef CANFILTER_H
+#define CANFILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/can/error.h>
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \brief subsystem CAN frame handler, called for every frame
+ * accepted by its filter.
+ */
+typedef statusErrDef (*canFrameHandler)(struct can_frame *frame, ssize_t sizeReceived);
+
+/**
+ * \struct canFilterStruct
+ * \brief one entry of the CAN filter table, a CAN ID range
+ * (id and mask as in the kernel can_filter) and the subsystem
+ * that owns it.
+ *
+ */
+struct canFilterStruct {
+    const char *name;                       /**< Subsystem name used in the statistics printout */
+    canid_t id;                             /**< CAN ID of the range (bits outside the mask are ignored) */
+    canid_t mask;                           /**< CAN ID mask, CAN_SFF_MASK for a single ID */
+    subsystemDef subsystem;                 /**< Subsystem that sends the frames of this range */
+    canFrameHandler handler;                /**< Function handling the frames of this range */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef installCANFilters(int socketCan);
+statusErrDef dispatchCANFrame(struct can_frame *frame, ssize_t sizeReceived);
+void fillCANFilterStatsPacket(std::vector<uint8_t> *telemOut);
+void resetCANFilterStats();
+void printCANFilterStats();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern const struct canFilterStruct canFilterTable[];
+extern const int nbCANFilters;
+extern uint32_t canFilterHits[];
+extern uint32_t canErrorFrameCount;
+extern uint32_t canUnmatchedFrameCount;
+extern uint32_t canUnknownSensorFrameCount;
+
+#endif
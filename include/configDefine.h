@@ -73,16 +73,155 @@
 // Global define program parameters (change as you wish)
 //------------------------------------------------------------------------------
 /**
- * \brief State machine main loop delay in nanoseconds.
+ * \brief State machine main loop period (minor frame) in nanoseconds,
+ * the periodic states start on absolute deadlines (see cyclicExec.h).
  */
 #define MAIN_LOOP_TIME 20000000L
 
+/**
+ * \brief Number of minor frames per major frame, the period of every
+ * cyclic task divides it.
+ */
+#define MAJOR_FRAME_MINOR_FRAMES 50
+
+/**
+ * \brief Period of the housekeeping task (sensor log, stale sensors,
+ * sensor statistics) in minor frames.
+ */
+#define HOUSEKEEPING_FRAME_PERIOD 5
+
+/**
+ * \brief Number of linear sub-buckets per power of two of the
+ * latency histograms (log2), 3 keeps the bucket error under 12.5 %.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 3
+
+/**
+ * \brief loop latency reporting window in microseconds, the phase
+ * latency histograms are sent to the TT&C subsystem then reset at its end.
+ */
+#define LOOP_LATENCY_REPORT_PERIOD 60000000ULL
+
+/**
+ * \brief number of events of every thread trace ring (power of two),
+ * 16 bytes each.
+ */
+#define TRACE_RING_EVENTS 2048
+
+/**
+ * \brief number of trace rings, a thread takes a free one on its first
+ * event and gives it back when it ends.
+ */
+#define TRACE_MAX_THREADS 32
+
+/**
+ * \brief 1 to run the control mode sensor acquisition as a pipeline
+ * of threads (ingest, processing and limits, logging, downlink, see
+ * obdhPipeline.h), 0 to run it in the state machine minor frames.
+ */
+#define OBDH_PIPELINE 0
+
+/**
+ * \brief number of message slots of the pipeline queues (powers of two):
+ * CAN frames to the processing stage, readings to the logging stage
+ * and telemetry packets to the downlink stage.
+ */
+#define PIPELINE_FRAME_SLOTS 1024
+#define PIPELINE_LOG_SLOTS 1024
+#define PIPELINE_TELEM_SLOTS 256
+
+/**
+ * \brief number of CAN frames processed by the processing stage
+ * between two sensor limit checks.
+ */
+#define PIPELINE_BATCH_SIZE 64
+
+/**
+ * \brief number of times a pipeline stage yields the CPU when its input
+ * queue is empty (or its output queue full) before sleeping
+ * PIPELINE_IDLE_SLEEP microseconds between the next tries.
+ */
+#define PIPELINE_SPIN_COUNT 64
+#define PIPELINE_IDLE_SLEEP 200
+
+/**
+ * \brief CAN socket poll timeout of the ingest stage in milliseconds
+ * (stop request latency).
+ */
+#define PIPELINE_POLL_TIMEOUT 100
+
+/**
+ * \brief 1 to start with the real-time profile (see rtProfile.h):
+ * SCHED_FIFO threads pinned to RT_CONTROL_CPU and RT_IO_CPU, memory
+ * locked and prefaulted, allocations checked after init. Needs
+ * CAP_SYS_NICE and CAP_IPC_LOCK (or matching RLIMIT_RTPRIO and
+ * RLIMIT_MEMLOCK), 0 for a normal SCHED_OTHER process.
+ */
+#define RT_PROFILE 0
+
+/**
+ * \brief SCHED_FIFO priority of the state machine (control) thread.
+ */
+#define RT_CONTROL_PRIORITY 80
+
+/**
+ * \brief SCHED_FIFO priority of the I/O threads (sensor log, parameters
+ * reload, init steps), below the control thread.
+ */
+#define RT_IO_PRIORITY 60
+
+/**
+ * \brief CPU of the control thread and CPU of the I/O threads,
+ * -1 to leave a thread on every CPU.
+ */
+#define RT_CONTROL_CPU 1
+#define RT_IO_CPU 0
+
+/**
+ * \brief SCHED_FIFO priority and CPU (-1 for every CPU) of the OBDH
+ * pipeline ingest and processing threads (see obdhPipeline.h), the
+ * logging and downlink threads are I/O threads.
+ */
+#define RT_PIPELINE_PRIORITY 70
+#define RT_PIPELINE_CPU -1
+
+/**
+ * \brief stack bytes prefaulted by every real-time thread, and heap
+ * bytes prefaulted (and kept by malloc) by the real-time profile.
+ */
+#define RT_PREFAULT_STACK_SIZE (256 * 1024)
+#define RT_PREFAULT_HEAP_SIZE (16 * 1024 * 1024)
+
 /**
  * \brief delay between each initialisation or freeing
  * error retries in seconds.
  */
 #define ERROR_RETRY_TIME 1
 
+/**
+ * \brief the delay between two initialisation or freeing retries is
+ * doubled after each retry, up to ERROR_RETRY_TIME << RETRY_BACKOFF_MAX_SHIFT
+ * (0 for a constant delay).
+ */
+#define RETRY_BACKOFF_MAX_SHIFT 3
+
+/**
+ * \brief the retry delay is randomly changed by up to plus or minus
+ * this percentage, so the subsystems failing together retry apart.
+ */
+#define RETRY_JITTER_PERCENT 20
+
+/**
+ * \brief Number of threads running the initialisation and freeing
+ * steps whose dependencies have ended (see stepGraph.h).
+ */
+#define STEP_GRAPH_THREADS 4
+
+/**
+ * \brief Number of states of the main state machine (see stateMachine.cpp).
+ */
+#define NB_MAIN_STATES 6
+
 /**
  * \brief CAN device name in the Linux device management system.
  */
@@ -121,6 +260,31 @@
  */
 #define CAN_ID_BROADCAST 0xFFF
 
+/**
+ * \brief EPS CAN ID range base in 12 bits, the EPS
+ * boards (MPPT and BMS) send from 0x300 to 0x3FF.
+ */
+#define CAN_ID_EPS 0x300
+
+/**
+ * \brief CAN mask of a 256 IDs range (0xN00 to 0xNFF)
+ * in the CAN filter table.
+ */
+#define CAN_ID_RANGE_MASK 0x700
+
+/**
+ * \brief Maximum number of entries in the CAN filter table.
+ */
+#define MAX_CAN_FILTERS 16
+
+/**
+ * \brief CAN error classes delivered to the OBDH as error
+ * frames (see linux/can/error.h), every other error class
+ * is discarded by the kernel.
+ */
+#define CAN_ERR_FILTER_MASK (CAN_ERR_TX_TIMEOUT | CAN_ERR_CRTL | CAN_ERR_PROT | \
+                             CAN_ERR_TRX | CAN_ERR_BUSOFF | CAN_ERR_BUSERROR | CAN_ERR_RESTARTED)
+
 /**
  * \brief UDP socket buffer size in bytes
  * (fills up when frame are received but not read).
@@ -154,6 +318,11 @@
  */
 #define UDP_MAX_BUFFER_SIZE 1024
 
+/**
+ * \brief CCSDS space packet primary header size in bytes.
+ */
+#define CCSDS_PRIMARY_HEADER_SIZE 6
+
 /**
  * \brief TT&C subsytem IP address for telemetry and
  * telecommands with the OBDH subsystem.
@@ -168,18 +337,59 @@
 #define MAX_SENSORS 3840
 
 /**
- * \brief Number of readings per sensor. When there
- * are more readings done than this number, the oldest
+ * \brief Lowest sensor ID in the sensor ID encoding.
+ */
+#define SENSOR_ID_MIN 0x0900
+
+/**
+ * \brief Highest sensor ID in the sensor ID encoding.
+ */
+#define SENSOR_ID_MAX 0xE9FF
+
+/**
+ * \brief Number of entries of the sensor ID to sensor index
+ * lookup table (one per 16 bits ID so that any recieved ID
+ * is looked up with a single load, without range check).
+ */
+#define SENSOR_INDEX_LUT_SIZE 0x10000
+
+/**
+ * \brief Number of 64 bits words of a sensor mask
+ * (one bit per sensor, see limitCheck.h).
+ */
+#define SENSOR_MASK_WORDS ((MAX_SENSORS + 63) / 64)
+
+/**
+ * \brief Default number of readings kept per sensor when the
+ * historyDepth column of paramSensors.csv is empty or 0.
+ * When there are more readings done than the depth, the oldest
  * reading is replaced by the newest and so on.
- *
+ * Depths are rounded up to a power of two.
  */
-#define READINGS_PER_SENSOR 5
+#define SENSOR_HISTORY_DEFAULT_DEPTH 8
 
 /**
- * \brief Maximum number of characters per column in
- * the paramSensors.csv file.
+ * \brief Maximum number of readings kept per sensor.
  */
-#define MAX_CSV_LINE_SIZE 256
+#define SENSOR_HISTORY_MAX_DEPTH 4096
+
+/**
+ * \brief Number of sensors allocated at the first paramSensors.csv
+ * line, the arrays are doubled when full (up to MAX_SENSORS).
+ */
+#define PARAM_SENSORS_INITIAL_CAPACITY 64
+
+/**
+ * \brief Number of columns of a paramSensors.csv line
+ * (Name;Id;minCriticalValue;minWarnValue;currentValue;maxWarnValue;maxCriticalValue;historyDepth;expectedPeriod;calibration).
+ */
+#define PARAM_SENSORS_CSV_COLUMNS 10
+
+/**
+ * \brief Number of columns required on a paramSensors.csv line (up to
+ * maxCriticalValue), the missing trailing columns are read as empty.
+ */
+#define PARAM_SENSORS_CSV_REQUIRED_COLUMNS 7
 
 /**
  * \brief paramSensors.csv file path
@@ -187,8 +397,296 @@
  */
 #define PARAM_SENSORS_CSV_FILENAME "paramSensors.csv"
 
+/**
+ * \brief 1 to take the sensors parameters from the table generated
+ * from paramSensors.csv at build time (paramSensorsTable.h), the lines
+ * of PARAM_SENSORS_CSV_FILENAME edited since the build replace the
+ * built-in sensors at init and on a reload, 0 to parse
+ * PARAM_SENSORS_CSV_FILENAME at init.
+ */
+#define PARAM_SENSORS_BUILTIN 1
+
+/**
+ * \brief optional CSV file in OUTPUT_FILES_DIR, same format as
+ * paramSensors.csv, whose lines replace the built-in sensors
+ * with the same IDs after paramSensors.csv (PARAM_SENSORS_BUILTIN only).
+ */
+#define PARAM_SENSORS_OVERLAY_FILENAME "paramSensorsOverlay.csv"
+
+/**
+ * \brief period in milliseconds at which the parameters reload
+ * thread checks if a replaced table can be freed.
+ */
+#define PARAM_RELOAD_POLL_PERIOD 100
+
+/**
+ * \brief number of control loop cycles (quiescent states of the
+ * sensor limits readers) before a replaced table is freed.
+ */
+#define PARAM_RELOAD_GRACE_EPOCHS 2
+
 #define OUTPUT_FILES_DIR "../outputFiles/"
 
+/**
+ * \brief sensor readings log segment files prefix in OUTPUT_FILES_DIR,
+ * segments are named "prefix"NNNNNN".bin" while written and
+ * "prefix"NNNNNN".dz" once compressed (see tools/sensorLogExport.cpp
+ * to get one CSV file per sensor).
+ */
+#define SENSOR_LOG_SEGMENT_PREFIX "sensorLog."
+
+/**
+ * \brief sensor log segment size in bytes after which
+ * the log goes on in a new segment.
+ */
+#define SENSOR_LOG_SEGMENT_SIZE (64 * 1024 * 1024)
+
+/**
+ * \brief sensor log segment duration in microseconds after
+ * which the log goes on in a new segment.
+ */
+#define SENSOR_LOG_SEGMENT_PERIOD 3600000000ULL
+
+/**
+ * \brief maximum total size in bytes of the sensor log segments
+ * in OUTPUT_FILES_DIR, the oldest segments are removed above it.
+ */
+#define SENSOR_LOG_RETENTION_BYTES (512ULL * 1024 * 1024)
+
+/**
+ * \brief maximum number of closed segments waiting for compression.
+ */
+#define SENSOR_LOG_SEGMENT_QUEUE 16
+
+/**
+ * \brief compressed sensor log segment identifier,
+ * first 8 bytes of the file.
+ */
+#define SENSOR_LOG_COMPRESSED_MAGIC "OBDHSLDZ"
+
+/**
+ * \brief number of readings per compressed block.
+ */
+#define SENSOR_LOG_CODEC_BLOCK 4096
+
+/**
+ * \brief 1 to log the sensor readings in a preallocated memory
+ * mapped ring file (SENSOR_LOG_RING_FILENAME) kept across restarts,
+ * 0 to append them to rotating compressed segment files through
+ * buffers written by a background thread. The segments are the
+ * default: they keep up to SENSOR_LOG_RETENTION_BYTES of compressed
+ * history but lose the readings still buffered on a crash, the ring
+ * loses no committed reading but only keeps the last
+ * SENSOR_LOG_RING_CAPACITY readings.
+ */
+#define SENSOR_LOG_MAPPED_RING 0
+
+/**
+ * \brief sensor readings ring log file name in OUTPUT_FILES_DIR.
+ */
+#define SENSOR_LOG_RING_FILENAME "sensorLog.ring"
+
+/**
+ * \brief trace dump file name in OUTPUT_FILES_DIR, written on
+ * TCDumpTrace (see trace.h).
+ */
+#define TRACE_DUMP_FILENAME "traceDump.bin"
+
+/**
+ * \brief trace dump file name in OUTPUT_FILES_DIR, written when
+ * the program crashes.
+ */
+#define TRACE_CRASH_FILENAME "traceCrash.bin"
+
+/**
+ * \brief ring log file identifier, first 8 bytes of the file.
+ */
+#define SENSOR_LOG_RING_MAGIC "OBDHRING"
+
+/**
+ * \brief number of readings kept in the ring log file
+ * (a power of two, 16 bytes each).
+ */
+#define SENSOR_LOG_RING_CAPACITY (1024 * 1024)
+
+/**
+ * \brief size in bytes of the ring log file header area,
+ * the readings start on the next page.
+ */
+#define SENSOR_LOG_RING_HEADER_SIZE 4096
+
+/**
+ * \brief period in microseconds of the ring log file
+ * synchronisation to the storage (msync).
+ */
+#define SENSOR_LOG_RING_SYNC_PERIOD 500000
+
+/**
+ * \brief sensor log file identifier, first 8 bytes of the file.
+ */
+#define SENSOR_LOG_MAGIC "OBDHSLOG"
+
+/**
+ * \brief sensor log file format version.
+ */
+#define SENSOR_LOG_VERSION 1
+
+/**
+ * \brief sensor log buffer size in bytes (a multiple of the
+ * 16 bytes record size), the buffer is handed to the writer
+ * thread when full.
+ */
+#define SENSOR_LOG_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * \brief number of sensor log buffers, one is filled while the
+ * others wait for (or are being) written to the segment.
+ */
+#define SENSOR_LOG_BUFFERS 4
+
+/**
+ * \brief sensor log buffer memory alignment in bytes.
+ */
+#define SENSOR_LOG_BUFFER_ALIGN 4096
+
+/**
+ * \brief maximum time in microseconds a reading stays in the
+ * sensor log buffer before being written to the file.
+ */
+#define SENSOR_LOG_FLUSH_PERIOD 1000000
+
+/**
+ * \brief sensor readings columnar archive file name in OUTPUT_FILES_DIR.
+ */
+#define SENSOR_ARCHIVE_FILENAME "sensorArchive.dat"
+
+/**
+ * \brief sensor archive file identifier, first 8 bytes of the file.
+ */
+#define SENSOR_ARCHIVE_MAGIC "OBDHARCH"
+
+/**
+ * \brief sensor archive time slice in microseconds, the readings
+ * of a sensor are stored in one block per time slice.
+ */
+#define SENSOR_ARCHIVE_SLICE_PERIOD 600000000ULL
+
+/**
+ * \brief maximum number of readings of an archive block, a block
+ * is closed before the end of its time slice when full.
+ */
+#define SENSOR_ARCHIVE_BLOCK_READINGS 128
+
+/**
+ * \brief sensor archive file write buffer size in bytes.
+ */
+#define SENSOR_ARCHIVE_WRITE_BUFFER (1024 * 1024)
+
+/**
+ * \brief maximum total size in bytes of the sensor archive files in
+ * OUTPUT_FILES_DIR. The archive file is renamed with
+ * SENSOR_ARCHIVE_PREVIOUS_SUFFIX once it reaches half of it, which
+ * removes the previous one, and a new archive file is started.
+ */
+#define SENSOR_ARCHIVE_RETENTION_BYTES (512ULL * 1024 * 1024)
+
+/**
+ * \brief suffix of the previous sensor archive file name.
+ */
+#define SENSOR_ARCHIVE_PREVIOUS_SUFFIX ".old"
+
+/**
+ * \brief number of archive blocks indexed per sensor, the index of
+ * every sensor is allocated at init and its oldest blocks are left
+ * out of the queries when it is full.
+ */
+#define SENSOR_ARCHIVE_INDEX_BLOCKS 256
+
+/**
+ * \brief sensor statistics reporting window in microseconds, the
+ * statistics are sent to the TT&C subsystem then reset at its end.
+ */
+#define SENSOR_STATS_REPORT_PERIOD 60000000ULL
+
+/**
+ * \brief weight of a new reading in the sensor exponentially
+ * weighted moving average (between 0 and 1).
+ */
+#define SENSOR_STATS_EWMA_ALPHA 0.1
+
+/**
+ * \brief maximum number of sensors per statistics housekeeping
+ * packet (26 bytes each, the packet must fit in UDP_MAX_BUFFER_SIZE).
+ */
+#define SENSOR_STATS_PER_PACKET 32
+
+/**
+ * \brief sensor trend horizon in seconds, an early warning is raised
+ * when the trend of the sensor history predicts a warning or critical
+ * bound crossing within it.
+ */
+#define SENSOR_TREND_HORIZON 60.0
+
+/**
+ * \brief minimum number of readings in the sensor history
+ * to compute its trend.
+ */
+#define SENSOR_TREND_MIN_READINGS 4
+
+/**
+ * \brief maximum number of registers of a derived parameter
+ * expression (nesting depth of its operations).
+ */
+#define DERIVED_MAX_REGISTERS 16
+
+/**
+ * \brief maximum number of instructions of every derived
+ * parameter expressions.
+ */
+#define DERIVED_MAX_INSTRUCTIONS 4096
+
+/**
+ * \brief number of levels of a timer wheel and number of slots
+ * (bits) per level, a timer wheel covers
+ * 2^(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS) ticks.
+ */
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+
+/**
+ * \brief sensor staleness timer wheel tick in microseconds.
+ */
+#define SENSOR_STALE_TICK 1000
+
+/**
+ * \brief number of expected periods without reading
+ * after which a sensor is stale.
+ */
+#define SENSOR_STALE_MISSED_PERIODS 3
+
+/**
+ * \brief maximum expectedPeriod column value in milliseconds.
+ */
+#define SENSOR_STALE_MAX_PERIOD 3600000
+
+/**
+ * \brief maximum degree of a sensor calibration polynomial and
+ * maximum number of points of a sensor calibration lookup table.
+ */
+#define SENSOR_CALIBRATION_MAX_DEGREE 5
+#define SENSOR_CALIBRATION_MAX_POINTS 32
+
+/**
+ * \brief maximum length of the calibration column of paramSensors.csv.
+ */
+#define SENSOR_CALIBRATION_MAX_LENGTH 1024
+
+/**
+ * \brief number of raw sensor samples calibrated together at most, the
+ * queued samples are also calibrated before every limit check.
+ */
+#define SENSOR_CALIBRATION_BATCH_SIZE 64
+
 #define MAX_PATH_LENGHT 128
 
 
@@ -33,9 +33,28 @@
 // Global function definitions
 //------------------------------------------------------------------------------
 statusErrDef sendTCToSubsystem(std::vector<uint8_t> TCOut, subsystemDef subsystem);
+statusErrDef sendUserDataToTTC(const uint8_t *userData, size_t length);
 statusErrDef sendTelemToTTC(const statusErrDef statusErr);
+statusErrDef sendSensorStatusToTTC(const statusErrDef statusErr, uint16_t sensorId);
+statusErrDef sendSensorStatsToTTC(uint64_t timeStamp);
+statusErrDef sendSensorWindowToTTC(uint16_t sensorId, int32_t value, const struct sensorWindowStruct *window);
+statusErrDef sendLoopLatencyToTTC();
+statusErrDef sendCANFilterStatsToTTC();
+void reserveHousekeepingPackets();
+statusErrDef storeSensorRecord(const struct sensorLogRecordStruct *record);
+statusErrDef flushCalibratedSensors();
+statusErrDef updateDerivedSensors();
+statusErrDef checkStaleSensors(uint64_t timeStamp);
+statusErrDef updateSensorLimits();
+statusErrDef sendSensorLimitStatus(statusErrDef status);
+statusErrDef compareSensorValuesWithParam();
 statusErrDef checkSensors();
+statusErrDef runHousekeeping();
+statusErrDef runSensorHousekeeping(uint64_t timeStamp);
+statusErrDef reportLoopLatency();
 statusErrDef checkTC();
+statusErrDef checkStateTC();
+statusErrDef handleSubsystemFrame(struct can_frame *frame, ssize_t sizeReceived);
 
 //------------------------------------------------------------------------------
 // global vars
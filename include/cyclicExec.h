@@ -0,0 +1,101 @@
+/**
+ * \file cyclicExec.h
+ * \brief cyclic executive function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the cyclic executive function definitions. The periodic states
+ * run once per minor frame of MAIN_LOOP_TIME, the start of every frame is
+ * an absolute deadline (clock_nanosleep(TIMER_ABSTIME)) so the period
+ * doesn't drift with the processing time. A major frame is
+ * MAJOR_FRAME_MINOR_FRAMES minor frames, a cyclic task runs in the minor
+ * frames given by its period and offset. The start jitter (wake up after
+ * the deadline) and the execution time of every frame are recorded in
+ * histograms, a frame ending after the next deadline is an overrun: the
+ * missed frames are skipped, the deadlines stay on the same grid.
+ */
+
+#ifndef CYCLICEXEC_H
+#define CYCLICEXEC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "histogram.h"
+#include "loopLatency.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct cyclicTaskStruct
+ * \brief one task of the minor frames
+ *
+ */
+struct cyclicTaskStruct {
+    const char *name;                       /**< Task name for the logs */
+    statusErrDef (*function)();             /**< Task function */
+    int period;                             /**< Period in minor frames, divides MAJOR_FRAME_MINOR_FRAMES */
+    int offset;                             /**< First minor frame of the task in the major frame, below period */
+    loopPhaseDef phase;                     /**< Latency histogram of the task (see loopLatency.h) */
+};
+
+/**
+ * \struct cyclicExecStruct
+ * \brief deadlines and timing statistics of the minor frames
+ *
+ */
+struct cyclicExecStruct {
+    uint64_t deadline;                      /**< Start deadline of the current frame in nanoseconds (CLOCK_MONOTONIC) */
+    uint64_t frameStart;                    /**< Wake up time of the current frame in nanoseconds */
+    uint64_t nbFrames;                      /**< Number of minor frames since the start, skipped ones included */
+    uint64_t nbOverruns;                    /**< Number of frames that ended after the next deadline */
+    uint64_t nbSkippedFrames;               /**< Number of frames skipped by the overruns */
+    uint64_t lastOverrunReport;             /**< Major frame of the last overrun telemetry */
+    struct histogramStruct startJitter;     /**< Wake up delay after the deadline in nanoseconds */
+    struct histogramStruct execTime;        /**< Frame processing time in nanoseconds */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+void initCyclicExec();
+statusErrDef waitNextMinorFrame();
+void printCyclicExecStats();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern struct cyclicExecStruct cyclicExec;
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to know if a cyclic task runs in the current minor frame.
+ *
+ * \param task the task
+ *
+ * \return true when the task runs in the current minor frame.
+ */
+static inline bool isCyclicTaskDue(const struct cyclicTaskStruct *task) {
+    return (cyclicExec.nbFrames % MAJOR_FRAME_MINOR_FRAMES) % task->period == (uint64_t)task->offset;
+}
+
+/**
+ * \brief true when every task period divides the major frame and
+ * every offset is below its period.
+ */
+template<int NT>
+constexpr bool checkCyclicTasks(const cyclicTaskStruct (&tasks)[NT], int i = 0) {
+    return i == NT ||
+           (tasks[i].period > 0 && MAJOR_FRAME_MINOR_FRAMES % tasks[i].period == 0 &&
+            tasks[i].offset >= 0 && tasks[i].offset < tasks[i].period &&
+            checkCyclicTasks(tasks, i + 1));
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * \file derivedParam.h
+ * \brief derived parameters function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the derived parameters function definitions. A derived
+ * parameter is a line of paramSensors.csv whose currentValue column is
+ * an expression of other sensors, starting with '=', for example:
+ *   power;0x0A10;0;0;=0x0A01*0x0A02/1000;5000;6000;8;0;#
+ *   panelTemp;0x0A11;-40;-30;=avg(0x0B01,0x0B02,0x0B03);80;90;8;0;#
+ * - hexadecimal numbers are sensor IDs, decimal numbers are constants
+ * - operators: + - * / and parentheses, unary -
+ * - functions: min(...), max(...), avg(...), abs(x)
+ * The computation is done on 64 bits integers saturated on an overflow,
+ * the result is limited to the int32_t range. A derived parameter is evaluated again only when one
+ * of its sensors changes, its value then goes through the same limit
+ * checking and telemetry as the sensors.
+ */
+
+#ifndef DERIVEDPARAM_H
+#define DERIVEDPARAM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct derivedInstructionStruct
+ * \brief one register machine instruction of a compiled expression
+ *
+ */
+struct derivedInstructionStruct {
+    uint8_t opCode;                         /**< Operation (see derivedParam.cpp) */
+    uint8_t destination;                    /**< Result register */
+    uint8_t left;                           /**< First operand register */
+    uint8_t right;                          /**< Second operand register */
+    int32_t operand;                        /**< Sensor index or constant of the load operations */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef setDerivedExpression(int index, const char *expression, size_t length);
+char *takeDerivedExpression(int index);
+bool isSameDerivedExpression(int index, const char *expression, size_t length);
+statusErrDef compileDerivedParameters(const struct paramSensorsStruct *param, int nbSensors);
+int evaluateDerivedParameters(struct paramSensorsStruct *param, uint16_t *changed, int maxChanged);
+bool isDerivedParameter(int index);
+void freeDerivedParameters();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern int nbDerivedParameters;
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * \file histogram.h
+ * \brief log-linear latency histogram function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the latency histogram function definitions. Each power of two
+ * of the recorded values is split in 2^HISTOGRAM_SUB_BUCKET_BITS linear
+ * buckets, so the histogram covers every uint64_t value with a bounded
+ * relative error in a fixed array, and recording a value is a few
+ * integer operations without allocation or lock.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct histogramStruct
+ * \brief log-linear histogram of latencies
+ *
+ */
+struct histogramStruct {
+    uint64_t nbValues;                      /**< Number of recorded values */
+    uint64_t total;                         /**< Sum of the recorded values */
+    uint64_t max;                           /**< Largest recorded value */
+    uint32_t count[HISTOGRAM_BUCKETS];      /**< Number of values of every bucket */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+void resetHistogram(struct histogramStruct *histogram);
+uint64_t getHistogramPercentile(const struct histogramStruct *histogram, unsigned int permille);
+void printHistogram(const struct histogramStruct *histogram, const char *name, const char *unit);
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to get the bucket of a value: the values under
+ * 2 * HISTOGRAM_SUB_BUCKETS have their own bucket, the others are
+ * split by their highest bit and the HISTOGRAM_SUB_BUCKET_BITS bits
+ * after it.
+ *
+ * \param value the value
+ *
+ * \return the bucket index.
+ */
+static inline int getHistogramBucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return (int)value;
+    int shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BUCKET_BITS;
+    return shift * HISTOGRAM_SUB_BUCKETS + (int)(value >> shift);
+}
+
+/**
+ * \brief function to record a value in a histogram.
+ *
+ * \param histogram the histogram
+ * \param value the value
+ */
+static inline void recordHistogram(struct histogramStruct *histogram, uint64_t value) {
+    histogram->count[getHistogramBucket(value)]++;
+    histogram->nbValues++;
+    histogram->total += value;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+#endif
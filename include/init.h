@@ -36,12 +36,14 @@
 // Global function definitions
 //------------------------------------------------------------------------------
 statusErrDef initOBDH();
+statusErrDef buildSensorIndexLUT();
 statusErrDef initAOCS();
 statusErrDef initTTC();
 statusErrDef initPayload();
 statusErrDef initIntersat();
 statusErrDef initEPS();
 statusErrDef initPPU();
+uint64_t getTimeSinceStart();
 
 //------------------------------------------------------------------------------
 // Global structure definitions
@@ -59,23 +61,11 @@ struct paramSensorsStruct {
     int32_t *currentValue;                  /**< Current value of the sensor */
     int32_t *maxWarnValue;                  /**< Maximum warning value of the sensor */
     int32_t *maxCriticalValue;              /**< Maximum critical value of the sensor */
+    uint32_t *historyDepth;                 /**< Number of readings kept in the sensor history (0 for the default) */
+    uint32_t *expectedPeriod;               /**< Expected time between two readings in milliseconds (0 for no staleness check) */
 };
 
 
-/**
- * \struct sensorsValStruct
- * \brief struct containing values history of every
- * sensors in "paramSensors.csv"
- *
- */
-struct sensorsValStruct {
-    uint16_t id;
-    uint16_t currentFileLine;
-    FILE* sensorFile;
-    double timeStamp[READINGS_PER_SENSOR];
-    int32_t value[READINGS_PER_SENSOR];
-};
-
 
 //------------------------------------------------------------------------------
 // global vars
@@ -84,8 +74,24 @@ extern int lineCountSensorParamCSV;
 extern int socket_can;
 extern int socket_udp;
 extern struct paramSensorsStruct* paramSensors;
-extern struct sensorsValStruct* sensorsVal;
 extern struct timespec beginTimeOBDH;
 extern struct timespec endTimeOBDH;
+extern int16_t sensorIndexLUT[SENSOR_INDEX_LUT_SIZE];
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to get the index of a sensor in the
+ * paramSensors arrays from its ID.
+ *
+ * \param sensorId the sensor ID (see paramSensors.csv)
+ *
+ * \return the sensor index, or -1 when the sensor ID
+ * is not in paramSensors.csv.
+ */
+static inline int getSensorIndex(uint16_t sensorId) {
+    return sensorIndexLUT[sensorId];
+}
 
 #endif
@@ -0,0 +1,93 @@
+/**
+ * \file limitCheck.h
+ * \brief sensor limit checking function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor limit checking function definitions, every
+ * sensor current value is compared with its warning and critical
+ * bounds in one pass, the result is one bit per sensor.
+ * Afterwards only the sensors marked dirty by the sensor data
+ * reception are checked again.
+ */
+
+#ifndef LIMITCHECK_H
+#define LIMITCHECK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+void computeSensorLimitMasks(const struct paramSensorsStruct *param, int nbSensors,
+                             uint64_t *warnMask, uint64_t *criticalMask);
+int countSensorMask(const uint64_t *mask, int nbSensors);
+void resetSensorLimitState(const struct paramSensorsStruct *param, int nbSensors);
+void updateDirtySensorLimits(const struct paramSensorsStruct *param);
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern uint64_t sensorWarnMask[SENSOR_MASK_WORDS];
+extern uint64_t sensorCriticalMask[SENSOR_MASK_WORDS];
+extern uint64_t sensorDirtyMask[SENSOR_MASK_WORDS];
+extern uint16_t sensorDirtyList[MAX_SENSORS];
+extern int nbDirtySensors;
+extern int nbSensorsWarn;
+extern int nbSensorsCritical;
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to test the bit of a sensor in a sensor mask.
+ *
+ * \param mask the sensor mask (one bit per sensor index)
+ * \param index the sensor index
+ *
+ * \return true when the bit of the sensor is set.
+ */
+static inline bool isSensorInMask(const uint64_t *mask, int index) {
+    return (mask[index >> 6] >> (index & 63)) & 1;
+}
+
+/**
+ * \brief function to mark a sensor whose current value has
+ * changed, so that its bounds are checked at the next
+ * updateDirtySensorLimits() call.
+ *
+ * \param index the sensor index
+ */
+static inline void markSensorDirty(int index) {
+    uint64_t bit = (uint64_t)1 << (index & 63);
+    if (!(sensorDirtyMask[index >> 6] & bit)) {
+        sensorDirtyMask[index >> 6] |= bit;
+        sensorDirtyList[nbDirtySensors++] = (uint16_t)index;
+    }
+}
+
+/**
+ * \brief function to get the result of the last limit check,
+ * without sending it as telemetry.
+ *
+ * \return statusErrDef that values:
+ * - errSensorCriticalValue when a sensor is out of its critical bounds,
+ * - errSensorWarningValue when a sensor is out of its warning bounds,
+ * - noError otherwise.
+ */
+static inline statusErrDef getSensorLimitStatus() {
+    if (nbSensorsCritical > 0)
+        return errSensorCriticalValue;
+    if (nbSensorsWarn > 0)
+        return errSensorWarningValue;
+    return noError;
+}
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * \file loopLatency.h
+ * \brief loop phase latency definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the loop phase latency definitions. The control thread reads
+ * CLOCK_MONOTONIC_RAW around every phase of the main loop (the control
+ * mode tasks, the regulation, the safe mode and the state transitions)
+ * and records the duration in the log-linear histogram of the phase (see
+ * histogram.h), in fixed memory. The percentiles of every phase are sent
+ * to the TT&C subsystem as a housekeeping packet at the end of each
+ * reporting window, TCResetLoopLatency starts a new window.
+ *
+ * HKLoopLatency packet user data (big endian):
+ * - packet ID (2 bytes, HKLoopLatency)
+ * - window duration in milliseconds (4 bytes)
+ * - number of phases in the packet (1 byte)
+ * - for every phase that has run: phase (1), count (4), p50 (4),
+ *   p90 (4), p99 (4), max (4), durations in nanoseconds saturated
+ *   to 0xFFFFFFFF
+ */
+
+#ifndef LOOPLATENCY_H
+#define LOOPLATENCY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "histogram.h"
+#include "trace.h"
+
+/**
+ * \brief size in bytes of one phase in an HKLoopLatency packet.
+ */
+#define LOOP_LATENCY_ENTRY_SIZE 21
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \enum loopPhaseDef
+ * \brief measured phases of the main loop, the value is the
+ * phase number of the HKLoopLatency packet
+ */
+typedef enum
+{
+	phaseSensorCheck = 0,					/**< checkSensors() */
+	phaseTCCheck = 1,						/**< checkTC() */
+	phaseHousekeeping = 2,					/**< runHousekeeping() */
+	phaseRTCheck = 3,						/**< checkRTProfile() */
+	phaseLatencyReport = 4,					/**< reportLoopLatency() */
+	phaseRegulate = 5,						/**< regulateSubsystems() */
+	phaseSafeMode = 6,						/**< Safe mode state handler */
+	phaseTransition = 7,					/**< State change: telemetry, exit, action and entry */
+	NB_LOOP_PHASES = 8,						/**< Number of phases. */
+} loopPhaseDef;
+
+/**
+ * \struct loopLatencyStruct
+ * \brief phase durations of the reporting window
+ *
+ */
+struct loopLatencyStruct {
+    uint64_t windowStart;                   /**< Start of the window in nanoseconds (CLOCK_MONOTONIC_RAW) */
+    struct histogramStruct phase[NB_LOOP_PHASES]; /**< Durations of every phase in nanoseconds */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+void resetLoopLatency();
+bool isLoopLatencyWindowEnded();
+void fillLoopLatencyPacket(std::vector<uint8_t> *telemOut);
+void printLoopLatency();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern struct loopLatencyStruct loopLatency;
+extern const char *const loopPhaseNames[NB_LOOP_PHASES];
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read the clock of the phase probes, not
+ * slewed by NTP (a vDSO call, no system call).
+ *
+ * \return the time in nanoseconds.
+ */
+static inline uint64_t getLoopPhaseTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to record the duration of one run of a phase,
+ * control thread only, and to trace its start and end.
+ *
+ * \param phase the phase
+ * \param start the probe time before the phase (see getLoopPhaseTime())
+ * \param end the probe time after the phase
+ */
+static inline void recordLoopPhase(loopPhaseDef phase, uint64_t start, uint64_t end) {
+    recordHistogram(&loopLatency.phase[phase], end - start);
+    traceEventAt(tracePhaseBegin, start, phase);
+    traceEventAt(tracePhaseEnd, end, phase);
+}
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * \file obdhPipeline.h
+ * \brief OBDH acquisition pipeline function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the OBDH acquisition pipeline function definitions. With
+ * OBDH_PIPELINE, the control mode sensor acquisition runs in four
+ * threads connected by single producer single consumer rings (see
+ * spscRing.h) instead of the minor frames of the state machine:
+ * - ingest: reads the CAN frames into the frame queue,
+ * - processing: dispatches the frames (decoding, calibration, sensor
+ * history, statistics, trend and staleness), checks the sensor limits
+ * every PIPELINE_BATCH_SIZE frames and runs the sensor housekeeping,
+ * - logging: writes the readings to the sensor archive and the sensor log,
+ * - downlink: sends the telemetry of the processing stage to the TT&C
+ * subsystem.
+ * A full queue makes its producer wait (nothing is dropped, the CAN
+ * socket buffer absorbs the bursts), every wait is counted. The sensor
+ * data belongs to the processing thread while the pipeline runs, the
+ * state machine only reads the limit status and posts requests. The
+ * pipeline runs in the control mode and the regulate state (the
+ * regulation is a request), the other states find the sensor data as
+ * in the single-threaded mode.
+ */
+
+#ifndef OBDHPIPELINE_H
+#define OBDHPIPELINE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <linux/can.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "spscRing.h"
+#include "sensorLog.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \enum pipelineTaskDef
+ * \brief requests of the state machine to the processing stage
+ */
+typedef enum
+{
+	pipelineTaskHousekeeping = 0x01,		/**< Stale sensors and sensor statistics window (see runSensorHousekeeping()). */
+	pipelineTaskReportStats = 0x02,			/**< Send and reset the sensor statistics (TCReportSensorStats). */
+	pipelineTaskResetStats = 0x04,			/**< Reset the sensor statistics (TCResetSensorStats). */
+	pipelineTaskRegulate = 0x08,			/**< Regulate the sensors out of their warning bounds (see regulateWarnSensors()). */
+} pipelineTaskDef;
+
+/**
+ * \enum pipelineStageDef
+ * \brief stages of the pipeline, in the order of the data
+ */
+typedef enum
+{
+	pipelineIngest = 0,						/**< CAN socket to the frame queue. */
+	pipelineProcessing = 1,					/**< Frame queue to the log and telemetry queues. */
+	pipelineLogging = 2,					/**< Log queue to the sensor archive and sensor log. */
+	pipelineDownlink = 3,					/**< Telemetry queue to the TT&C subsystem. */
+	NB_PIPELINE_STAGES = 4,					/**< Number of stages. */
+} pipelineStageDef;
+
+/**
+ * \struct pipelineFrameStruct
+ * \brief message of the frame queue
+ *
+ */
+struct pipelineFrameStruct {
+    struct can_frame frame;                 /**< CAN frame read by the ingest stage */
+    int32_t size;                           /**< Number of bytes read from the CAN socket */
+};
+
+/**
+ * \struct pipelineTelemStruct
+ * \brief message of the telemetry queue
+ *
+ */
+struct pipelineTelemStruct {
+    uint16_t length;                        /**< Number of bytes of userData */
+    uint8_t userData[UDP_MAX_BUFFER_SIZE];  /**< Telemetry user data, wrapped in a CCSDS packet by the downlink stage */
+};
+
+/**
+ * \struct pipelineStageStruct
+ * \brief one thread of the pipeline
+ *
+ */
+struct pipelineStageStruct {
+    const char *name;                       /**< Stage name for the logs */
+    void *(*task)(void *);                  /**< Thread function */
+    pthread_t thread;                       /**< Thread, valid while running */
+    bool running;                           /**< True between start and join */
+    std::atomic<bool> stop;                 /**< Set to end the thread once its input queue is empty */
+    uint64_t nbMessages;                    /**< Number of messages handled (all the runs) */
+    uint64_t busyTime;                      /**< Thread CPU time in nanoseconds (all the runs) */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initOBDHPipeline();
+statusErrDef startOBDHPipeline();
+void stopOBDHPipeline();
+void freeOBDHPipeline();
+void requestOBDHPipelineTasks(uint32_t tasks);
+statusErrDef getOBDHPipelineLimitStatus();
+statusErrDef queuePipelineTelemetry(const uint8_t *userData, size_t length);
+void queuePipelineLogRecord(const struct sensorLogRecordStruct *record);
+void printOBDHPipelineStats();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern bool obdhPipelineRunning;
+extern __thread bool obdhPipelineProcessing;
+extern struct pipelineStageStruct pipelineStages[NB_PIPELINE_STAGES];
+extern struct spscRingStruct pipelineFrameQueue;
+extern struct spscRingStruct pipelineLogQueue;
+extern struct spscRingStruct pipelineTelemQueue;
+
+#endif
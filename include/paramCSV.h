@@ -0,0 +1,40 @@
+/**
+ * \file paramCSV.h
+ * \brief paramSensors.csv parser function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the paramSensors.csv parser function definitions, the file
+ * is memory mapped and read in a single pass, every malformed line is
+ * reported with its line number.
+ */
+
+#ifndef PARAMCSV_H
+#define PARAMCSV_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef parseParamSensorsCSV(const char *fileName, struct paramSensorsStruct *param, int *nbSensors,
+                                  bool withExpressions);
+statusErrDef growParamSensorsArrays(struct paramSensorsStruct *param, int capacity);
+void freeParamSensorsArrays(struct paramSensorsStruct *param);
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern int nbChangedCalibrations;
+extern int nbChangedExpressions;
+extern uint64_t changedCalibrationMask[SENSOR_MASK_WORDS];
+extern uint64_t changedExpressionMask[SENSOR_MASK_WORDS];
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * \file paramReload.h
+ * \brief sensor bounds hot reload function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor bounds hot reload function definitions, the
+ * parameters file (paramSensors.csv, and its overlay with the built-in
+ * table) is watched and read again by a background thread when it is
+ * modified or on TCReloadParamSensors. The new bounds are published to
+ * the control loop with a pointer swap, the replaced table is freed
+ * after a grace period. The sensor set (IDs and order), the history
+ * depths, the expected periods, the derived parameters expressions and
+ * the calibrations are not reloaded (a changed calibration is reported
+ * with errCalibrationNotReloaded, a changed expression with
+ * errExpressionNotReloaded).
+ */
+
+#ifndef PARAMRELOAD_H
+#define PARAMRELOAD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initParamSensorsReload(const char *fileName, const char *overlayFileName,
+                                    struct paramSensorsStruct *param, int nbSensors);
+void requestParamSensorsReload();
+statusErrDef applyParamSensorsReload();
+void closeParamSensorsReload();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern uint32_t nbParamSensorsReloads;
+
+#endif
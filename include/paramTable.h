@@ -0,0 +1,33 @@
+/**
+ * \file paramTable.h
+ * \brief built-in parameter database function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the built-in parameter database function definitions, the
+ * sensors of paramSensors.csv are converted at build time to constant
+ * tables (see tools/paramSensorsGen.cpp) that are copied at init, the
+ * runtime paramSensors.csv and an overlay CSV file can replace them.
+ */
+
+#ifndef PARAMTABLE_H
+#define PARAMTABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef loadParamSensorsTable(const char *fileName, const char *overlayFileName,
+                                   struct paramSensorsStruct *param, int *nbSensors, bool withExpressions);
+int findParamSensorsTableIndex(uint16_t sensorId);
+int getParamSensorsTableCount();
+
+#endif
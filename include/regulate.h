@@ -5,7 +5,16 @@
  * \version 1.0
  * \date 16/02/2025
  *
- * Contains all of the regulation function definitions
+ * Contains all of the regulation function definitions. The history
+ * window of a sensor is sent once when it enters its warning bounds,
+ * not on every regulation pass.
+ *
+ * HKSensorWindow packet user data (big endian):
+ * - packet ID (2 bytes, HKSensorWindow)
+ * - sensor ID (2 bytes)
+ * - current value (4 bytes, signed)
+ * - number of readings of the window (4 bytes, up to the sensor historyDepth)
+ * - minimum, maximum and rounded mean value of the window (4 bytes each, signed)
  */
 
 #ifndef REGULATE_H
@@ -22,5 +31,6 @@
 // Global function definitions
 //------------------------------------------------------------------------------
 statusErrDef regulateSubsystems();
+statusErrDef regulateWarnSensors();
 
 #endif
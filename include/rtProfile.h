@@ -0,0 +1,54 @@
+/**
+ * \file rtProfile.h
+ * \brief real-time execution profile function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the real-time profile function definitions. With the profile
+ * (RT_PROFILE), every page of the process is locked in memory, the heap
+ * and the thread stacks are faulted in at startup, and the threads run
+ * SCHED_FIFO on their configured CPU: the control (state machine) thread
+ * above the I/O threads. Once the init state has ended, the allocations
+ * and page faults of the control thread are counted and reported once
+ * per major frame, the control loop should have none.
+ */
+
+#ifndef RTPROFILE_H
+#define RTPROFILE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \enum rtThreadDef
+ * \brief real-time class of a thread
+ */
+typedef enum
+{
+	rtControlThread = 0,					/**< State machine thread, RT_CONTROL_PRIORITY on RT_CONTROL_CPU. */
+	rtIOThread = 1,							/**< Background I/O thread, RT_IO_PRIORITY on RT_IO_CPU. */
+	rtPipelineThread = 2,					/**< OBDH pipeline ingest and processing thread, RT_PIPELINE_PRIORITY on RT_PIPELINE_CPU. */
+} rtThreadDef;
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initRTProfile(bool enable);
+statusErrDef setRTThreadProfile(rtThreadDef thread);
+void armRTAllocationCheck();
+statusErrDef checkRTProfile();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern bool rtProfileEnabled;
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * \file sensorArchive.h
+ * \brief sensor readings columnar archive definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor readings columnar archive definitions, the
+ * readings of every sensor are stored in compressed blocks, one per
+ * time slice, with their timestamps and values in separate columns.
+ * An index of the time range and value range of every block lets the
+ * queries read only the blocks that can match. The index keeps the
+ * last SENSOR_ARCHIVE_INDEX_BLOCKS blocks of every sensor and the
+ * archive files take SENSOR_ARCHIVE_RETENTION_BYTES at most. The
+ * archive files are kept across restarts, the index is rebuilt from
+ * the block headers.
+ * The archive times are the times since program start plus
+ * sensorArchiveTimeOffset (the last archive time of the previous runs).
+ */
+
+#ifndef SENSORARCHIVE_H
+#define SENSORARCHIVE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct sensorArchiveBlockStruct
+ * \brief header of an archive block in the archive file, followed
+ * by the timestamps column then the values column
+ *
+ */
+struct sensorArchiveBlockStruct {
+    uint64_t firstTime;                     /**< First reading archive time in microseconds */
+    uint64_t lastTime;                      /**< Last reading archive time in microseconds */
+    int32_t minValue;                       /**< Minimum value of the block */
+    int32_t maxValue;                       /**< Maximum value of the block */
+    uint16_t sensorId;                      /**< Sensor ID (see paramSensors.csv) */
+    uint16_t sensorIndex;                   /**< Sensor index in paramSensors.csv */
+    uint16_t nbReadings;                    /**< Number of readings of the block */
+    uint16_t timeBytes;                     /**< Size of the encoded timestamps column */
+    uint32_t dataBytes;                     /**< Size of the encoded columns */
+    uint32_t reserved;                      /**< 0 */
+};
+
+/**
+ * \struct sensorArchiveReadingStruct
+ * \brief one reading returned by an archive query
+ *
+ */
+struct sensorArchiveReadingStruct {
+    uint64_t timeStamp;                     /**< Reading archive time in microseconds */
+    int32_t value;                          /**< Reading value */
+};
+
+static_assert(sizeof(struct sensorArchiveBlockStruct) == 40, "sensor archive block header must be 40 bytes");
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initSensorArchive(const char *fileName, const uint16_t *sensorId, int nbSensors);
+statusErrDef pushSensorArchive(int index, uint64_t timeStamp, int32_t value);
+statusErrDef closeSensorArchive();
+statusErrDef querySensorArchive(int index, uint64_t fromTime, uint64_t toTime,
+                                int32_t minValue, int32_t maxValue,
+                                std::vector<struct sensorArchiveReadingStruct> *readings);
+void printSensorArchiveStats();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern uint64_t sensorArchiveTimeOffset;
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * \file sensorCalibration.h
+ * \brief sensor calibration function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor calibration function definitions. The calibration
+ * column of paramSensors.csv converts the raw counts of a sensor to
+ * engineering units, '#' (or empty) keeps the raw counts:
+ *   poly:c0,c1,...   value = c0 + c1 * raw + ... + c5 * raw^5 (linear: poly:offset,gain)
+ *   lut:x0:y0,x1:y1,...   linear interpolation between the points, x increasing,
+ *                         the first and last y outside of the table
+ * The result is rounded to the int32_t range, so the scale of the unit
+ * goes in the coefficients (for example millidegrees). The limits,
+ * the telemetry and everything recorded for a calibrated sensor are in
+ * engineering units. Raw samples are queued and calibrated in batches.
+ */
+
+#ifndef SENSORCALIBRATION_H
+#define SENSORCALIBRATION_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef checkSensorCalibration(const char *text, size_t length);
+bool isSameSensorCalibration(int index, const char *text, size_t length);
+statusErrDef setSensorCalibration(int index, const char *text, size_t length);
+char *takeSensorCalibration(int index);
+statusErrDef compileSensorCalibrations(const struct paramSensorsStruct *param, int nbSensors);
+bool isCalibratedSensor(int index);
+bool queueSensorCalibration(int index, int32_t rawValue);
+int calibrateSensorBatch(uint16_t *index, int32_t *value);
+void freeSensorCalibrations();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern int nbCalibratedSensors;
+
+#endif
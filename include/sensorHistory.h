@@ -0,0 +1,50 @@
+/**
+ * \file sensorHistory.h
+ * \brief sensor values history function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor values history function definitions, every
+ * sensor keeps its latest readings in a ring of configurable depth
+ * (historyDepth column of paramSensors.csv).
+ */
+
+#ifndef SENSORHISTORY_H
+#define SENSORHISTORY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct sensorWindowStruct
+ * \brief statistics of the latest readings of a sensor
+ *
+ */
+struct sensorWindowStruct {
+    uint32_t nbReadings;                    /**< Number of readings in the window */
+    int32_t minValue;                       /**< Minimum value of the window */
+    int32_t maxValue;                       /**< Maximum value of the window */
+    double meanValue;                       /**< Mean value of the window */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initSensorHistory(const uint32_t *historyDepth, int nbSensors);
+void freeSensorHistory();
+void pushSensorHistory(int index, double timeStamp, int32_t value);
+uint32_t getSensorHistoryDepth(int index);
+uint32_t getSensorHistoryCount(int index);
+bool getSensorHistoryReading(int index, uint32_t age, double *timeStamp, int32_t *value);
+uint32_t getSensorHistoryCountSince(int index, double fromTime);
+bool getSensorHistoryWindow(int index, uint32_t nbReadings, struct sensorWindowStruct *window);
+
+#endif
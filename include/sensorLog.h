@@ -0,0 +1,131 @@
+/**
+ * \file sensorLog.h
+ * \brief sensor readings binary log definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor readings binary log definitions, every reading
+ * of every sensor is appended to fixed size records files, either
+ * through a buffer to rotating compressed segments or straight into a
+ * memory mapped ring file that survives a crash (see
+ * tools/sensorLogExport.cpp to convert both to CSV files).
+ */
+
+#ifndef SENSORLOG_H
+#define SENSORLOG_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct sensorLogHeaderStruct
+ * \brief header at the start of a sensor log file
+ *
+ */
+struct sensorLogHeaderStruct {
+    char magic[8];                          /**< SENSOR_LOG_MAGIC */
+    uint32_t version;                       /**< SENSOR_LOG_VERSION */
+    uint32_t recordSize;                    /**< sizeof(struct sensorLogRecordStruct) */
+};
+
+/**
+ * \struct sensorLogRecordStruct
+ * \brief one sensor reading in the sensor log file
+ *
+ */
+struct sensorLogRecordStruct {
+    uint64_t timeStamp;                     /**< Reading time in microseconds since program start */
+    int32_t value;                          /**< Reading value */
+    uint16_t sensorIndex;                   /**< Sensor index in paramSensors.csv */
+    uint16_t sensorId;                      /**< Sensor ID (see paramSensors.csv) */
+};
+
+/**
+ * \struct sensorLogRingHeaderStruct
+ * \brief header at the start of a sensor ring log file,
+ * the readings of sequence number n are in the slot
+ * n & (capacity - 1) after SENSOR_LOG_RING_HEADER_SIZE bytes
+ *
+ */
+struct sensorLogRingHeaderStruct {
+    char magic[8];                          /**< SENSOR_LOG_RING_MAGIC */
+    uint32_t version;                       /**< SENSOR_LOG_VERSION */
+    uint32_t recordSize;                    /**< sizeof(struct sensorLogRecordStruct) */
+    uint64_t capacity;                      /**< Number of readings slots (a power of two) */
+    std::atomic<uint64_t> commitIndex;      /**< Number of readings written since the file creation */
+    std::atomic<uint64_t> syncIndex;        /**< Number of readings synchronised to the storage */
+};
+
+static_assert(sizeof(struct sensorLogHeaderStruct) == 16, "sensor log header must be 16 bytes");
+static_assert(sizeof(struct sensorLogRecordStruct) == 16, "sensor log record must be 16 bytes");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && ATOMIC_LLONG_LOCK_FREE == 2,
+              "the ring log commit index must be a lock free 64 bits word");
+static_assert(sizeof(struct sensorLogRingHeaderStruct) <= SENSOR_LOG_RING_HEADER_SIZE,
+              "sensor ring log header must fit in SENSOR_LOG_RING_HEADER_SIZE");
+static_assert((SENSOR_LOG_RING_CAPACITY & (SENSOR_LOG_RING_CAPACITY - 1)) == 0,
+              "SENSOR_LOG_RING_CAPACITY must be a power of two");
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initSensorLog(const char *directory);
+statusErrDef initSensorLogRing(const char *fileName);
+statusErrDef flushSensorLog();
+statusErrDef pollSensorLog(uint64_t timeStamp);
+statusErrDef closeSensorLog();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern uint8_t *sensorLogBuffer;
+extern size_t sensorLogBufferUsed;
+extern struct sensorLogRingHeaderStruct *sensorLogRingHeader;
+extern struct sensorLogRecordStruct *sensorLogRingRecords;
+extern uint64_t sensorLogTimeOffset;
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to append a sensor reading to the sensor log.
+ * In ring mode the reading is written in the mapped file and
+ * committed by the header commit index (release ordering, so that
+ * the reading is visible before the index), otherwise it is copied
+ * in the log buffer, which is handed to the writer thread when full
+ * (or by pollSensorLog()).
+ *
+ * \param record the sensor reading
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when readings are dropped or can't be written
+ * - noError when the function exits successfully.
+ */
+static inline statusErrDef appendSensorLog(const struct sensorLogRecordStruct *record) {
+    statusErrDef ret = noError;
+    if (sensorLogRingHeader != NULL) {
+        uint64_t seq = sensorLogRingHeader->commitIndex.load(std::memory_order_relaxed);
+        struct sensorLogRecordStruct *slot = &sensorLogRingRecords[seq & (SENSOR_LOG_RING_CAPACITY - 1)];
+        memcpy(slot, record, sizeof(struct sensorLogRecordStruct));
+        slot->timeStamp += sensorLogTimeOffset;
+        sensorLogRingHeader->commitIndex.store(seq + 1, std::memory_order_release);
+        return ret;
+    }
+    if (sensorLogBuffer == NULL)
+        return ret;
+    memcpy(sensorLogBuffer + sensorLogBufferUsed, record, sizeof(struct sensorLogRecordStruct));
+    sensorLogBufferUsed += sizeof(struct sensorLogRecordStruct);
+    if (sensorLogBufferUsed == SENSOR_LOG_BUFFER_SIZE)
+        ret = flushSensorLog();
+    return ret;
+}
+
+#endif
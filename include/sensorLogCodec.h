@@ -0,0 +1,120 @@
+/**
+ * \file sensorLogCodec.h
+ * \brief sensor log compression function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor log compression function definitions, the
+ * readings of a block are stored as the difference with the previous
+ * reading (the previous reading of the same sensor for the value),
+ * zigzag encoded to keep small negative differences small and written
+ * as variable length integers (7 bits per byte).
+ */
+
+#ifndef SENSORLOGCODEC_H
+#define SENSORLOGCODEC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "sensorLog.h"
+
+/**
+ * \brief maximum size in bytes of one encoded reading
+ * (timestamp 10, value 5, index 3 and ID 3 bytes).
+ */
+#define SENSOR_LOG_CODEC_MAX_RECORD_SIZE 21
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct sensorLogBlockHeaderStruct
+ * \brief header of a compressed block, the blocks follow the
+ * sensorLogHeaderStruct of the compressed segment file
+ *
+ */
+struct sensorLogBlockHeaderStruct {
+    uint32_t nbRecords;                     /**< Number of readings of the block */
+    uint32_t nbBytes;                       /**< Size of the encoded readings */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+size_t encodeSensorLogBlock(const struct sensorLogRecordStruct *records, uint32_t nbRecords, uint8_t *data);
+bool decodeSensorLogBlock(const uint8_t *data, size_t nbBytes,
+                          struct sensorLogRecordStruct *records, uint32_t nbRecords);
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to map a signed difference to an unsigned
+ * integer, small negative differences stay small.
+ *
+ * \param value the signed difference
+ *
+ * \return the zigzag encoded difference.
+ */
+static inline uint64_t zigzagEncode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+/**
+ * \brief function to get a signed difference back from its
+ * zigzag encoding.
+ *
+ * \param value the zigzag encoded difference
+ *
+ * \return the signed difference.
+ */
+static inline int64_t zigzagDecode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * \brief function to write a variable length integer,
+ * 7 bits per byte (at most 10 bytes).
+ *
+ * \param data the output position
+ * \param value the integer
+ *
+ * \return the position after the integer.
+ */
+static inline uint8_t *writeVarint(uint8_t *data, uint64_t value) {
+    while (value >= 0x80) {
+        *data++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *data++ = (uint8_t)value;
+    return data;
+}
+
+/**
+ * \brief function to read a variable length integer.
+ *
+ * \param data the input position
+ * \param end the end of the input
+ * \param value the integer
+ *
+ * \return the position after the integer, NULL when the
+ * integer is truncated or too long.
+ */
+static inline const uint8_t *readVarint(const uint8_t *data, const uint8_t *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        uint8_t byte = *data++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return data;
+        }
+    }
+    return NULL;
+}
+
+#endif
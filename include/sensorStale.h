@@ -0,0 +1,39 @@
+/**
+ * \file sensorStale.h
+ * \brief sensor staleness detection function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor staleness detection function definitions, every
+ * sensor with an expected period has a deadline on a timer wheel, moved
+ * forward at each reading. A sensor whose deadline expires is stale
+ * until its next reading.
+ */
+
+#ifndef SENSORSTALE_H
+#define SENSORSTALE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initSensorStaleness(const uint32_t *expectedPeriod, int nbSensors, uint64_t timeStamp);
+bool touchSensorStaleness(int index, uint64_t timeStamp);
+int checkSensorStaleness(uint64_t timeStamp, uint16_t *stale, int maxStale);
+void freeSensorStaleness();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern uint64_t sensorStaleMask[SENSOR_MASK_WORDS];
+extern int nbSensorsStale;
+
+#endif
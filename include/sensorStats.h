@@ -0,0 +1,105 @@
+/**
+ * \file sensorStats.h
+ * \brief sensor streaming statistics definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor streaming statistics definitions, the count,
+ * minimum, maximum, mean, variance (Welford) and moving average of
+ * every sensor are updated on every reading and sent to the TT&C
+ * subsystem as housekeeping packets at the end of each reporting window.
+ *
+ * HKSensorStats packet user data (big endian):
+ * - packet ID (2 bytes, HKSensorStats)
+ * - window duration in milliseconds (4 bytes)
+ * - number of sensors in the packet (1 byte)
+ * - for every sensor: ID (2), count (4), minimum (4), maximum (4),
+ *   mean (float, 4), standard deviation (float, 4), moving average (float, 4)
+ */
+
+#ifndef SENSORSTATS_H
+#define SENSORSTATS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+/**
+ * \brief size in bytes of one sensor in an HKSensorStats packet.
+ */
+#define SENSOR_STATS_ENTRY_SIZE 26
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct sensorStatsStruct
+ * \brief statistics of every sensor in the reporting window,
+ * one array per statistic indexed by the sensor index
+ *
+ */
+struct sensorStatsStruct {
+    uint32_t count[MAX_SENSORS];            /**< Number of readings in the window */
+    int32_t minValue[MAX_SENSORS];          /**< Minimum reading of the window */
+    int32_t maxValue[MAX_SENSORS];          /**< Maximum reading of the window */
+    double mean[MAX_SENSORS];               /**< Mean of the readings of the window */
+    double m2[MAX_SENSORS];                 /**< Sum of the squared differences with the mean (Welford) */
+    double ewma[MAX_SENSORS];               /**< Exponentially weighted moving average, kept across windows (NaN before the first reading) */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+void initSensorStats(int nbSensors);
+void resetSensorStats(uint64_t timeStamp);
+int fillSensorStatsPacket(const uint16_t *sensorId, int firstIndex, uint64_t timeStamp,
+                          std::vector<uint8_t> *telemOut);
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern struct sensorStatsStruct sensorStats;
+extern uint64_t sensorStatsWindowStart;
+extern int nbStatsSensors;
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to add a reading to the statistics of a sensor.
+ *
+ * \param index the sensor index
+ * \param value the reading value
+ */
+static inline void updateSensorStats(int index, int32_t value) {
+    if (index < 0 || index >= nbStatsSensors)
+        return;
+
+    uint32_t count = ++sensorStats.count[index];
+    if (count == 1) {
+        sensorStats.minValue[index] = value;
+        sensorStats.maxValue[index] = value;
+    }
+    else {
+        if (value < sensorStats.minValue[index])
+            sensorStats.minValue[index] = value;
+        if (value > sensorStats.maxValue[index])
+            sensorStats.maxValue[index] = value;
+    }
+
+    double delta = value - sensorStats.mean[index];
+    sensorStats.mean[index] += delta / count;
+    sensorStats.m2[index] += delta * (value - sensorStats.mean[index]);
+    if (isnan(sensorStats.ewma[index]))
+        sensorStats.ewma[index] = value;
+    else
+        sensorStats.ewma[index] += SENSOR_STATS_EWMA_ALPHA * (value - sensorStats.ewma[index]);
+}
+
+#endif
@@ -0,0 +1,40 @@
+/**
+ * \file sensorTrend.h
+ * \brief sensor trend prediction function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the sensor trend prediction function definitions, a least
+ * squares line is fitted on the readings of the sensor history of every
+ * sensor to predict when the sensor crosses its warning and critical
+ * bounds, before it actually does.
+ */
+
+#ifndef SENSORTREND_H
+#define SENSORTREND_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+void initSensorTrend(int nbSensors);
+statusErrDef updateSensorTrend(const struct paramSensorsStruct *param, int index,
+                               double timeStamp, int32_t value);
+bool getSensorTrend(int index, double *slope, double *predictedValue);
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern uint64_t sensorTrendWarnMask[SENSOR_MASK_WORDS];
+extern uint64_t sensorTrendCriticalMask[SENSOR_MASK_WORDS];
+extern double sensorTrendCrossingTime[MAX_SENSORS];
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * \file spscRing.h
+ * \brief single producer single consumer ring function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the bounded single producer single consumer ring function
+ * definitions. The message slots are allocated once, the producer
+ * writes a message in place in a reserved slot then publishes it, the
+ * consumer reads it in place then releases the slot: no copy, no lock,
+ * one release store per side. Each side keeps a copy of the other
+ * side index and reads the shared one only when its copy says the ring
+ * is full (or empty), the two indexes are on separate cache lines.
+ * The producer side counts the backpressure: pushes that found the
+ * ring full and the time spent waiting for a free slot.
+ */
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+#define SPSC_RING_CACHE_LINE 64
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct spscRingStruct
+ * \brief bounded ring of preallocated message slots between two threads
+ *
+ */
+struct spscRingStruct {
+    uint8_t *slots;                         /**< nbSlots * slotSize bytes */
+    uint32_t slotSize;                      /**< Bytes of a slot, multiple of SPSC_RING_CACHE_LINE */
+    uint32_t mask;                          /**< nbSlots - 1, nbSlots is a power of two */
+
+    alignas(SPSC_RING_CACHE_LINE)
+    std::atomic<uint32_t> head;             /**< Next slot published by the producer */
+    uint32_t tailCopy;                      /**< Producer copy of tail */
+    uint64_t nbPushed;                      /**< Number of published messages */
+    uint64_t nbStalls;                      /**< Number of messages that waited for a free slot */
+    uint64_t stallTime;                     /**< Time spent waiting for a free slot in nanoseconds */
+    uint32_t maxDepth;                      /**< Largest number of messages seen in the ring by the producer */
+
+    alignas(SPSC_RING_CACHE_LINE)
+    std::atomic<uint32_t> tail;             /**< Next slot released by the consumer */
+    uint32_t headCopy;                      /**< Consumer copy of head */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initSPSCRing(struct spscRingStruct *ring, size_t messageSize, uint32_t nbSlots);
+void freeSPSCRing(struct spscRingStruct *ring);
+void printSPSCRingStats(const struct spscRingStruct *ring, const char *name);
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to get a free slot to write the next message,
+ * producer side.
+ *
+ * \param ring the ring
+ *
+ * \return the slot, NULL when the ring is full.
+ */
+static inline void *reserveSPSCRingSlot(struct spscRingStruct *ring) {
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tailCopy > ring->mask) {
+        ring->tailCopy = ring->tail.load(std::memory_order_acquire);
+        if (head - ring->tailCopy > ring->mask)
+            return NULL;
+    }
+    return ring->slots + (size_t)(head & ring->mask) * ring->slotSize;
+}
+
+/**
+ * \brief function to hand the message written in the reserved slot
+ * to the consumer, producer side.
+ *
+ * \param ring the ring
+ */
+static inline void publishSPSCRingSlot(struct spscRingStruct *ring) {
+    uint32_t head = ring->head.load(std::memory_order_relaxed) + 1;
+    ring->head.store(head, std::memory_order_release);
+    ring->nbPushed++;
+    if (head - ring->tailCopy > ring->maxDepth)
+        ring->maxDepth = head - ring->tailCopy;
+}
+
+/**
+ * \brief function to get the oldest message, consumer side.
+ *
+ * \param ring the ring
+ *
+ * \return the slot of the message, NULL when the ring is empty.
+ */
+static inline void *peekSPSCRingSlot(struct spscRingStruct *ring) {
+    uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail == ring->headCopy) {
+        ring->headCopy = ring->head.load(std::memory_order_acquire);
+        if (tail == ring->headCopy)
+            return NULL;
+    }
+    return ring->slots + (size_t)(tail & ring->mask) * ring->slotSize;
+}
+
+/**
+ * \brief function to give the slot of the oldest message back to the
+ * producer once it has been read, consumer side.
+ *
+ * \param ring the ring
+ */
+static inline void releaseSPSCRingSlot(struct spscRingStruct *ring) {
+    ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * \brief function to know if a ring is empty, from any thread.
+ *
+ * \param ring the ring
+ *
+ * \return true when every published message has been released.
+ */
+static inline bool isSPSCRingEmpty(const struct spscRingStruct *ring) {
+    return ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_acquire);
+}
+
+#endif
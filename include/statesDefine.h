@@ -44,6 +44,11 @@ typedef enum
 
 	// Control mode (from 0x0040 to 0x005F)
 	infoNoDataInCANBuffer = 0x0040,			/**< No data has been recieved through the CAN bus from the subsystems. */
+	infoSensorTrendWarn = 0x0041,			/**< The sensor trend predicts a warning bound crossing within SENSOR_TREND_HORIZON. */
+	infoSensorTrendCritical = 0x0042,		/**< The sensor trend predicts a critical bound crossing within SENSOR_TREND_HORIZON. */
+	infoParamSensorsReloaded = 0x0043,		/**< New sensor bounds from the modified parameters file are in use. */
+	infoSensorRefreshed = 0x0044,			/**< A stale sensor sends readings again. */
+	infoTraceDumped = 0x0045,				/**< The trace rings have been written to TRACE_DUMP_FILENAME. */
 
 	// Restart (from 0x00E0 to 0x00FF)
 	infoFreePPUSuccess = 0x00E0,			/**< PPU (propulsion system Power Processing Unit) subsystem memory freeing has succeeded. */
@@ -77,7 +82,24 @@ typedef enum
 	errAllocParamSensorStruct = 0x0E0B,		/**< paramSensors structure memory allocation failed. */
 	errOpenParamSensorsFile = 0x0E0C,		/**< paramSensors.csv file not found or unable to read. */
 	errAllocSensorsValStruct = 0x0E0D,		/**< sensorsVal structure memory allocation failed. */
-	errOpenSensorsValFile = 0x0E0E,			/**< "sensorId".csv file can't be created. */
+	errOpenSensorsValFile = 0x0E0E,			/**< sensor log segment or sensorLog.ring file can't be created. */
+	errSetCANFilter = 0x0E0F,				/**< Install the CAN filter table on the CAN socket failed. */
+	errSetCANErrFilter = 0x0E10,			/**< Install the CAN error frames mask on the CAN socket failed. */
+	errInvalidSensorId = 0x0E11,			/**< A sensor ID of paramSensors.csv is out of the 0x0900 to 0xE9FF range or duplicated. */
+	errTooManySensors = 0x0E12,				/**< paramSensors.csv declares more than MAX_SENSORS sensors. */
+	errAllocSensorHistory = 0x0E13,			/**< Sensor readings history memory allocation failed. */
+	errAllocSensorLogBuffer = 0x0E14,		/**< Sensor log buffer memory allocation failed. */
+	errMapSensorLogRing = 0x0E15,			/**< sensorLog.ring file can't be allocated or memory mapped. */
+	errStartSensorLogSync = 0x0E16,			/**< sensorLog.ring synchronisation thread can't be started. */
+	errStartSensorLogWorker = 0x0E17,		/**< Sensor log segments rotation and compression thread can't be started. */
+	errAllocSensorArchive = 0x0E18,			/**< Sensor archive memory allocation failed. */
+	errOpenSensorArchive = 0x0E19,			/**< sensorArchive.dat file can't be created. */
+	errInvalidDerivedExpression = 0x0E1A,	/**< A derived parameter expression of paramSensors.csv can't be compiled (syntax, unknown sensor ID, dependency cycle). */
+	errInvalidParamSensorsLine = 0x0E1B,	/**< A paramSensors.csv line is malformed (column count, number syntax or range, bounds order). */
+	errStartParamReload = 0x0E1C,			/**< The parameters file watch or its reload thread can't be started. */
+	errAllocTimerWheel = 0x0E1D,			/**< Timer wheel memory allocation failed. */
+	errInvalidSensorCalibration = 0x0E1E,	/**< A sensor calibration of the paramSensors.csv file can't be used. */
+	errStartStepGraph = 0x0E1F,				/**< The init or free step threads can't be started, the steps have run in order. */
 
 	// Safe mode (from 0x0E20 to 0x0E3F)
 
@@ -90,6 +112,23 @@ typedef enum
 	errSensorCriticalValue = 0x0E25,		/**< A sensor has reached a minimum or maximum critical value from the paramSensors.csv file. */
 	errTCToWrongSubsystem = 0x0E26,			/**< Trying to send a telecommand to a subsystem that should not recieve any. */
 	errCCSDSPacketUninterpretable = 0x0E27,	/**< The CCSDS packet recieved cannot be interpreted (wrong sequence or corrupted data). */
+	errUnknownSensorId = 0x0E2A,			/**< Sensor data has been recieved from a sensor ID that is not in paramSensors.csv. */
+	errWriteSensorLog = 0x0E2B,				/**< Write sensor readings to the sensor log file failed. */
+	errWriteSensorArchive = 0x0E2C,			/**< Write a sensor archive block to the sensorArchive.dat file failed. */
+	errReadSensorArchive = 0x0E2D,			/**< Read or decode a sensor archive block failed. */
+	errUnknownTC = 0x0E2E,					/**< The OBDH telecommand is neither a main state nor a TCDef telecommand. */
+	errReloadParamSensors = 0x0E2F,			/**< The modified parameters file is invalid or changes the sensor set, the previous bounds are kept. */
+	errSensorStale = 0x0E30,				/**< A sensor has sent no reading for SENSOR_STALE_MISSED_PERIODS expected periods. */
+	errFrameOverrun = 0x0E31,				/**< A minor frame has ended after the start of the next one. */
+	errRTProfile = 0x0E32,					/**< The real-time scheduling, CPU pinning or memory locking can't be applied. */
+	errRTAllocation = 0x0E33,				/**< The control thread has allocated memory since init (real-time profile). */
+	errRTPageFault = 0x0E34,				/**< The control thread has page faulted since init (real-time profile). */
+	errAllocPipelineRing = 0x0E35,			/**< The message slots of an OBDH pipeline queue can't be allocated. */
+	errStartPipeline = 0x0E36,				/**< An OBDH pipeline stage thread can't be started, the control mode stays single-threaded. */
+	errDumpTrace = 0x0E37,					/**< The trace rings can't be written to the trace dump file. */
+	errCalibrationNotReloaded = 0x0E38,		/**< The modified parameters file changes calibrations, the new bounds are in use, the calibrations at the next restart. */
+	errExpressionNotReloaded = 0x0E39,		/**< The modified parameters file changes derived parameters expressions, the new bounds are in use, the expressions at the next restart. */
+	errTCDuringOBDHInit = 0x0E3A,			/**< An OBDH telecommand that is not a main state is rejected while the OBDH initialisation runs. */
 
 	// Restart (from 0x0EE0 to 0x0EFF)
 	errCloseCANSocket = 0x0EF0,				/**< close CAN socket failed. */
@@ -115,6 +154,52 @@ const std::unordered_set<uint16_t> validStates = {
     init, safeMode, controlMode, regulate, restart, ending
 };
 
+/**
+ * \enum eventDef
+ * \brief list of events of the main state machine (see stateMachine.cpp)
+ */
+typedef enum
+{
+	eventNone = 0,							/**< Nothing happened, stay in the current state. */
+	eventDone,								/**< The state procedure has completed. */
+	eventSensorWarning,						/**< At least one sensor has reached a warning value. */
+	eventSensorCritical,					/**< At least one sensor has reached a critical value. */
+	eventStopSignal,						/**< SIGINT or SIGTERM has been caught. */
+	eventTCInit,							/**< Telecommand to the initialisation state. */
+	eventTCSafeMode,						/**< Telecommand to the safe mode. */
+	eventTCControlMode,						/**< Telecommand to the control mode. */
+	eventTCRegulate,						/**< Telecommand to the regulate state. */
+	eventTCRestart,							/**< Telecommand to the restart state. */
+	eventTCEnding,							/**< Telecommand to stop the program. */
+	nbEvents								/**< Number of events. */
+} eventDef;
+
+/**
+ * \enum TCDef
+ * \brief list of the OBDH telecommands that are not main states
+ */
+typedef enum
+{
+	TCReportSensorStats = 0x0800,			/**< Send the sensor statistics housekeeping packets now and start a new window. */
+	TCResetSensorStats = 0x0801,			/**< Start a new sensor statistics window without sending them. */
+	TCReloadParamSensors = 0x0802,			/**< Read the sensor bounds again from the parameters file. */
+	TCResetLoopLatency = 0x0803,			/**< Start a new loop latency window without sending the histograms. */
+	TCDumpTrace = 0x0804,					/**< Write the trace rings to TRACE_DUMP_FILENAME (see trace.h). */
+} TCDef;
+
+/**
+ * \enum housekeepingDef
+ * \brief list of the housekeeping packets sent to the TT&C
+ * subsystem (after the sensor IDs range)
+ */
+typedef enum
+{
+	HKSensorStats = 0xF100,					/**< Sensor statistics of the reporting window (see sensorStats.h). */
+	HKLoopLatency = 0xF101,					/**< Loop phase latency percentiles of the reporting window (see loopLatency.h). */
+	HKCANFilterStats = 0xF102,				/**< CAN frames recieved per filter of the reporting window (see canFilter.h). */
+	HKSensorWindow = 0xF103,				/**< History window of a sensor entering its warning bounds (see regulate.h). */
+} housekeepingDef;
+
 /**
  * \enum sensorDef
  * \brief list of the spacecraft sensors
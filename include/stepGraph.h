@@ -0,0 +1,38 @@
+/**
+ * \file stepGraph.h
+ * \brief initialisation and freeing step graph function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the step graph function definitions. The initialisation and
+ * freeing steps of a table (see retryStepStruct) run on STEP_GRAPH_THREADS
+ * threads, each step as soon as the steps it depends on have ended, so
+ * the startup and restart durations are the ones of the longest chain of
+ * dependencies instead of the sum of every step. The graph never blocks
+ * the main loop: pollStepGraph() is called at each loop, it logs and
+ * sends the telemetry of the tries that ended, and schedules the retry
+ * of a failed step on a timer wheel, with a per-step exponential backoff
+ * and jitter, until the step has used its NB_RETRIES tries.
+ */
+
+#ifndef STEPGRAPH_H
+#define STEPGRAPH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "stateMachine.h"
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef startStepGraph(const struct retryStepStruct *steps, int nbSteps, const char *operation);
+void pollStepGraph();
+bool isStepGraphEnded(uint32_t steps);
+void stopStepGraph();
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * \file timerWheel.h
+ * \brief hierarchical timer wheel function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the hierarchical timer wheel function definitions, a fixed
+ * number of timers (identified by their index) are armed at a tick and
+ * collected when the wheel is advanced past it. Arming, re-arming and
+ * cancelling a timer are O(1), the timers far away are kept in the
+ * coarse levels and moved down (cascaded) as the wheel turns.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_NONE 0xFFFF
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct timerWheelStruct
+ * \brief timers and slots of a timer wheel, each slot is a
+ * doubly linked list of timer indexes
+ *
+ */
+struct timerWheelStruct {
+    uint64_t currentTick;                   /**< Next tick to be processed */
+    int nbTimers;                           /**< Number of timers */
+    uint64_t *expiry;                       /**< Expiry tick of every timer */
+    uint16_t *next;                         /**< Next timer in the same slot */
+    uint16_t *prev;                         /**< Previous timer in the same slot */
+    uint16_t *slot;                         /**< Slot of every timer, TIMER_WHEEL_NONE when not armed */
+    uint16_t head[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];  /**< First timer of every slot */
+    uint64_t occupied[TIMER_WHEEL_LEVELS];  /**< One bit per non empty slot of every level */
+};
+
+static_assert(TIMER_WHEEL_SLOTS == 64, "the timer wheel slot bitmaps are 64 bits words");
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initTimerWheel(struct timerWheelStruct *wheel, int nbTimers, uint64_t tick);
+void freeTimerWheel(struct timerWheelStruct *wheel);
+void armTimer(struct timerWheelStruct *wheel, int timer, uint64_t expiry);
+void cancelTimer(struct timerWheelStruct *wheel, int timer);
+int advanceTimerWheel(struct timerWheelStruct *wheel, uint64_t tick, uint16_t *expired, int maxExpired);
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to know if a timer is armed.
+ *
+ * \param wheel the timer wheel
+ * \param timer the timer index
+ *
+ * \return true when the timer is waiting for its expiry tick.
+ */
+static inline bool isTimerArmed(const struct timerWheelStruct *wheel, int timer) {
+    return wheel->slot[timer] != TIMER_WHEEL_NONE;
+}
+
+#endif
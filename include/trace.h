@@ -0,0 +1,175 @@
+/**
+ * \file trace.h
+ * \brief trace ring function definitions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Contains the trace ring function definitions. Every thread writes
+ * fixed-size binary events (time, event ID, argument) to its own ring
+ * of TRACE_RING_EVENTS events: no lock, no allocation, no system call
+ * (the clock is read through the vDSO), the oldest events are
+ * overwritten. The rings are taken from a static pool on the first event
+ * of a thread and given back when it ends. TCDumpTrace writes every ring
+ * to TRACE_DUMP_FILENAME, a crash signal to TRACE_CRASH_FILENAME, the
+ * traceExport tool converts a dump to the Chrome trace JSON format
+ * (chrome://tracing, Perfetto).
+ *
+ * Dump file (host byte order): traceDumpHeaderStruct, then for every
+ * ring a traceDumpRingStruct, the events from first to head (oldest
+ * first) and the ring head read after them: the events older than
+ * this head - TRACE_RING_EVENTS may have been overwritten during the
+ * dump and must be skipped.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include "configDefine.h"
+#include "statesDefine.h"
+
+#define TRACE_DUMP_MAGIC "OBDHTRC1"
+#define TRACE_DUMP_VERSION 1
+#define TRACE_THREAD_NAME_SIZE 16
+
+//------------------------------------------------------------------------------
+// Global structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \enum traceEventDef
+ * \brief static IDs of the trace events
+ */
+typedef enum
+{
+	traceThreadStart = 1,					/**< A thread has taken the ring, argument: thread ID. */
+	traceStateChange = 2,					/**< Main state change, argument: previous state << 16 | next state. */
+	traceCANFrame = 3,						/**< CAN frame dispatched, argument: CAN ID. */
+	traceTCReceived = 4,					/**< Telecommand from the TT&C subsystem dispatched, argument: telecommand. */
+	traceTelemSent = 5,						/**< Telemetry sent, argument: first two bytes << 16 | user data length. */
+	tracePhaseBegin = 6,					/**< Main loop phase start, argument: loopPhaseDef. */
+	tracePhaseEnd = 7,						/**< Main loop phase end, argument: loopPhaseDef. */
+	NB_TRACE_EVENTS = 8,					/**< Number of event IDs (0 is unused). */
+} traceEventDef;
+
+/**
+ * \struct traceEventStruct
+ * \brief one event of a trace ring
+ *
+ */
+struct traceEventStruct {
+    uint64_t time;                          /**< Event time in nanoseconds (CLOCK_MONOTONIC_RAW) */
+    uint32_t arg;                           /**< Event argument, see traceEventDef */
+    uint16_t event;                         /**< Event ID (traceEventDef) */
+    uint16_t reserved;                      /**< Padding to 16 bytes */
+};
+
+/**
+ * \struct traceRingStruct
+ * \brief events of one thread, written by this thread only
+ *
+ */
+struct traceRingStruct {
+    alignas(64)
+    std::atomic<uint64_t> head;             /**< Number of events written, the next one goes to head % TRACE_RING_EVENTS */
+    std::atomic<bool> inUse;                /**< True while a thread owns the ring */
+    uint32_t tid;                           /**< Thread ID of the last owner */
+    char name[TRACE_THREAD_NAME_SIZE];      /**< Thread name of the last owner */
+    struct traceEventStruct events[TRACE_RING_EVENTS]; /**< Events, oldest overwritten first */
+};
+
+/**
+ * \struct traceDumpHeaderStruct
+ * \brief header of a trace dump file
+ *
+ */
+struct traceDumpHeaderStruct {
+    char magic[8];                          /**< TRACE_DUMP_MAGIC, without the terminating zero */
+    uint32_t version;                       /**< TRACE_DUMP_VERSION */
+    uint32_t nbRings;                       /**< Number of rings in the file */
+    uint32_t eventsPerRing;                 /**< TRACE_RING_EVENTS of the program */
+    uint32_t reserved;                      /**< Padding */
+    uint64_t dumpTime;                      /**< Dump time in nanoseconds (CLOCK_MONOTONIC_RAW) */
+};
+
+/**
+ * \struct traceDumpRingStruct
+ * \brief header of one ring in a trace dump file
+ *
+ */
+struct traceDumpRingStruct {
+    uint32_t ring;                          /**< Ring index */
+    uint32_t tid;                           /**< Thread ID of the last owner */
+    char name[TRACE_THREAD_NAME_SIZE];      /**< Thread name of the last owner */
+    uint64_t first;                         /**< Index of the first event of the file */
+    uint64_t head;                          /**< Index after the last event of the file */
+};
+
+//------------------------------------------------------------------------------
+// Global function definitions
+//------------------------------------------------------------------------------
+statusErrDef initTrace();
+struct traceRingStruct *claimTraceRing();
+statusErrDef dumpTrace();
+
+//------------------------------------------------------------------------------
+// global vars
+//------------------------------------------------------------------------------
+extern struct traceRingStruct traceRings[TRACE_MAX_THREADS];
+extern __thread struct traceRingStruct *traceThreadRing;
+extern const char *const traceEventNames[NB_TRACE_EVENTS];
+
+//------------------------------------------------------------------------------
+// Global inline functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read the clock of the trace events, the clock
+ * of the loop phase probes (see loopLatency.h).
+ *
+ * \return the time in nanoseconds.
+ */
+static inline uint64_t getTraceTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to write an event with its time to the ring of
+ * the calling thread, the event is lost when every ring is taken.
+ *
+ * \param event the event ID
+ * \param time the event time (see getTraceTime())
+ * \param arg the event argument
+ */
+static inline void traceEventAt(traceEventDef event, uint64_t time, uint32_t arg) {
+    struct traceRingStruct *ring = traceThreadRing;
+    if (ring == NULL) {
+        ring = claimTraceRing();
+        if (ring == NULL)
+            return;
+    }
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    struct traceEventStruct *slot = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+    slot->time = time;
+    slot->arg = arg;
+    slot->event = (uint16_t)event;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * \brief function to write an event to the ring of the calling thread.
+ *
+ * \param event the event ID
+ * \param arg the event argument
+ */
+static inline void traceEvent(traceEventDef event, uint32_t arg) {
+    traceEventAt(event, getTraceTime(), arg);
+}
+
+#endif
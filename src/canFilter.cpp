@@ -0,0 +1,194 @@
+/**
+ * \file canFilter.cpp
+ * \brief CAN bus kernel filter table functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Installs the CAN filter table on the CAN socket so that the kernel
+ * only wakes the OBDH for the CAN ID ranges listed in the table,
+ * dispatches the recieved frames to the subsystem handlers and
+ * counts the frames recieved per filter.
+ *
+ */
+#include "canFilter.h"
+#include "controlMode.h"
+#include "trace.h"
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief CAN filter table, every CAN ID range the OBDH listens to
+ * with the subsystem handler of the frames.
+ * Frames outside of these ranges are dropped by the kernel.
+ */
+const struct canFilterStruct canFilterTable[] = {
+    {"OBDH",    CAN_ID_OBDH,    CAN_SFF_MASK,       OBDHSubsystem,  handleSubsystemFrame},
+    {"EPS",     CAN_ID_EPS,     CAN_ID_RANGE_MASK,  EPSSubsystem,   handleSubsystemFrame},
+};
+
+/**
+ * \brief number of entries in the CAN filter table.
+ */
+const int nbCANFilters = sizeof(canFilterTable) / sizeof(canFilterTable[0]);
+
+/**
+ * \brief number of frames recieved per CAN filter table entry.
+ */
+uint32_t canFilterHits[MAX_CAN_FILTERS];
+
+/**
+ * \brief number of CAN error frames recieved.
+ */
+uint32_t canErrorFrameCount = 0;
+
+/**
+ * \brief number of CAN frames recieved that match no entry
+ * of the CAN filter table.
+ */
+uint32_t canUnmatchedFrameCount = 0;
+
+/**
+ * \brief number of sensor data frames recieved from a sensor ID
+ * that is not in paramSensors.csv (see manageSensorData()).
+ */
+uint32_t canUnknownSensorFrameCount = 0;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void pushCANFilterCount(std::vector<uint8_t> *telemOut, uint32_t value);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to append a frame count to a packet, big endian on 4 bytes.
+ *
+ * \param telemOut the packet user data
+ * \param value the count
+ */
+static void pushCANFilterCount(std::vector<uint8_t> *telemOut, uint32_t value) {
+    telemOut->push_back((value >> 24) & 0xFF);
+    telemOut->push_back((value >> 16) & 0xFF);
+    telemOut->push_back((value >> 8) & 0xFF);
+    telemOut->push_back(value & 0xFF);
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to install the CAN filter table and the
+ * error frames mask on the CAN socket.
+ *
+ * \param socketCan the bound CAN socket
+ *
+ * \return statusErrDef that values:
+ * - errSetCANFilter when the CAN filter table cannot be installed
+ * - errSetCANErrFilter when the CAN error frames mask cannot be installed
+ * - noError when the function exits successfully.
+ */
+statusErrDef installCANFilters(int socketCan) {
+	statusErrDef ret = noError;
+    struct can_filter rfilter[MAX_CAN_FILTERS];
+    can_err_mask_t errMask = CAN_ERR_FILTER_MASK;
+
+    static_assert(sizeof(canFilterTable) / sizeof(canFilterTable[0]) <= MAX_CAN_FILTERS,
+                  "CAN filter table larger than MAX_CAN_FILTERS");
+
+    for (int i = 0; i < nbCANFilters; i++) {
+        rfilter[i].can_id = canFilterTable[i].id;
+        rfilter[i].can_mask = canFilterTable[i].mask;
+    }
+
+    if (setsockopt(socketCan, SOL_CAN_RAW, CAN_RAW_FILTER, rfilter,
+                   nbCANFilters * sizeof(struct can_filter)) == -1) {
+        perror("errSetCANFilter");
+        return errSetCANFilter;
+    }
+
+    if (setsockopt(socketCan, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &errMask, sizeof(errMask)) == -1) {
+        perror("errSetCANErrFilter");
+        return errSetCANErrFilter;
+    }
+
+    resetCANFilterStats();
+	return ret;
+}
+
+/**
+ * \brief function to find the CAN filter table entry of a
+ * recieved frame, count it and call the subsystem handler.
+ * The CAN error frames and the frames matching no filter are only
+ * counted, they are sent in the HKCANFilterStats packet.
+ *
+ * \param frame the recieved frame
+ * \param sizeReceived the number of bytes read from the CAN socket
+ *
+ * \return statusErrDef that values:
+ * - the subsystem handler return value when a filter matches the frame,
+ * - noError otherwise.
+ */
+statusErrDef dispatchCANFrame(struct can_frame *frame, ssize_t sizeReceived) {
+    traceEvent(traceCANFrame, frame->can_id);
+    if (frame->can_id & CAN_ERR_FLAG) {
+        canErrorFrameCount++;
+        return noError;
+    }
+
+    canid_t canId = frame->can_id & CAN_EFF_MASK;
+    for (int i = 0; i < nbCANFilters; i++) {
+        if ((canId & canFilterTable[i].mask) == (canFilterTable[i].id & canFilterTable[i].mask)) {
+            canFilterHits[i]++;
+            return canFilterTable[i].handler(frame, sizeReceived);
+        }
+    }
+
+    canUnmatchedFrameCount++;
+    return noError;
+}
+
+/**
+ * \brief function to fill an HKCANFilterStats housekeeping packet
+ * with the frame counters of the reporting window.
+ *
+ * \param telemOut the packet user data, cleared first
+ */
+void fillCANFilterStatsPacket(std::vector<uint8_t> *telemOut) {
+    telemOut->clear();
+    telemOut->reserve(3 + nbCANFilters * 4 + 12);
+    telemOut->push_back((HKCANFilterStats >> 8) & 0xFF);
+    telemOut->push_back(HKCANFilterStats & 0xFF);
+    telemOut->push_back((uint8_t)nbCANFilters);
+    for (int i = 0; i < nbCANFilters; i++)
+        pushCANFilterCount(telemOut, canFilterHits[i]);
+    pushCANFilterCount(telemOut, canErrorFrameCount);
+    pushCANFilterCount(telemOut, canUnmatchedFrameCount);
+    pushCANFilterCount(telemOut, canUnknownSensorFrameCount);
+}
+
+/**
+ * \brief function to reset the per-filter frame counters.
+ */
+void resetCANFilterStats() {
+    memset(canFilterHits, 0, sizeof(canFilterHits));
+    canErrorFrameCount = 0;
+    canUnmatchedFrameCount = 0;
+    canUnknownSensorFrameCount = 0;
+}
+
+/**
+ * \brief function to print the number of frames recieved
+ * per CAN filter table entry.
+ */
+void printCANFilterStats() {
+    for (int i = 0; i < nbCANFilters; i++) {
+        printf("CAN filter %s (id=0x%03X, mask=0x%03X): %u frames\n",
+               canFilterTable[i].name, canFilterTable[i].id,
+               canFilterTable[i].mask, canFilterHits[i]);
+    }
+    printf("CAN error frames: %u, unmatched frames: %u, unknown sensor frames: %u\n",
+           canErrorFrameCount, canUnmatchedFrameCount, canUnknownSensorFrameCount);
+}
@@ -1,537 +1,1132 @@
-/**
- * \file controlMode.cpp
- * \brief control mode functions
- * \author Mael Parot
- * \version 1.0
- * \date 16/02/2025
- *
- * control mode functions
- *
- */
-#include "controlMode.h"
-#include "init.h"
-
-//------------------------------------------------------------------------------
-// Local function definitions
-//------------------------------------------------------------------------------
-std::vector<uint8_t> generateCCSDSPacket(std::vector<uint8_t> dataOut);
-statusErrDef sendSensorDataToTTC(const sensorDef sensor, std::vector<uint8_t> sensorValue);
-statusErrDef manageSensorData(uint8_t *frameData);
-statusErrDef recieveTelemFromSubsystems();
-statusErrDef sendTelemToTTC(std::vector<uint8_t> *telemFromSubystems);
-statusErrDef recieveTCFromTTC();
-void DumpUDPData(uint8_t *data, ssize_t length);
-
-//------------------------------------------------------------------------------
-// Global vars initialisation
-//------------------------------------------------------------------------------
-/**
- * \brief the test sensor value increment.
- */
-uint8_t counter = 0;
-
-/**
- * \brief The main state recieved through a telecommand
- * from the TT&C subsystem.
- */
-uint16_t mainStateTC = 0xFFFF;
-
-//------------------------------------------------------------------------------
-// State functions
-//------------------------------------------------------------------------------
-/**
- * \brief function to generate a CCSDS packet wrapping user data
- *
- * \param dataOut the data to recieve from a UDP or CAN frame,
- * cut in a vector of bytes
- *
- * \return packet a CCSDS packet to be sent
- */
-std::vector<uint8_t> generateCCSDSPacket(std::vector<uint8_t> dataOut) {
-	uint16_t apid = 0x1AB;
-	//uint8_t category = 0;
-	//uint8_t aduCount = 0;
-	size_t sequenceCount = 1;
-
-	//constructs an empty instance
-	CCSDSSpacePacket ccsdsPacketIN;
-	//set APID
-	ccsdsPacketIN.getPrimaryHeader()->setAPID(apid);
-	//set Packet Type (Telemetry or Command)
-	ccsdsPacketIN.getPrimaryHeader()->setPacketType(CCSDSSpacePacketPacketType::TelemetryPacket);
-	//set Secondary Header Flag (whether this packet has the Secondary Header part)
-	ccsdsPacketIN.getPrimaryHeader()->setSecondaryHeaderFlag(CCSDSSpacePacketSecondaryHeaderFlag::NotPresent);
-	//set segmentation information
-	ccsdsPacketIN.getPrimaryHeader()->setSequenceFlag(CCSDSSpacePacketSequenceFlag::UnsegmentedUserData);
-	//set counters
-	ccsdsPacketIN.getPrimaryHeader()->setSequenceCount(sequenceCount);
-	//set data
-	ccsdsPacketIN.setUserDataField(dataOut);
-	ccsdsPacketIN.setPacketDataLength();
-	//get packet as byte array
-	std::vector<uint8_t> packet = ccsdsPacketIN.getAsByteVector();
-
-	return packet;
-}
-
-/**
- * \brief function to send telemetry to the TT&C subsystem
- *
- * \param statusErr the telemetry data (see statesDefine.h)
- *
- * \return statusErrDef that values:
- * - errWriteUDPTelem when the telemetry can't be sent,
- * - noError when the function exits successfully.
- */
-statusErrDef sendTelemToTTC(const statusErrDef statusErr) {
-	statusErrDef ret = noError;
-	std::vector<uint8_t> telemOut;
-	uint8_t categoryHighByte = (statusErr >> 8) & 0xFF;  // Get the higher byte (8 most significant bits)
-    uint8_t categoryLowByte = statusErr & 0xFF; // Get the lower byte (8 least significant bits)
-
-    telemOut = {categoryHighByte,categoryLowByte};
-
-	std::vector<uint8_t> ccsdsPacket = generateCCSDSPacket(telemOut);
-
-
-	// Setup the destination address (this is where the packet will be sent)
-    struct sockaddr_in clientAddr;
-    memset(&clientAddr, 0, sizeof(clientAddr));
-    clientAddr.sin_family = AF_INET;
-    clientAddr.sin_port = htons(UDP_TELEMETRY_PORT);  // Destination port
-    clientAddr.sin_addr.s_addr = inet_addr(TTC_IP_ADDRESS);  // Destination IP address (localhost, change to actual IP)
-
-    // Send the CCSDS packet over UDP
-    ssize_t bytes_sent = sendto(socket_udp, ccsdsPacket.data(), ccsdsPacket.size(),
-                                 0, (struct sockaddr*)&clientAddr, sizeof(clientAddr));
-    if (bytes_sent < 0) {
-        perror("errWriteUDPTelem");
-        return errWriteUDPTelem;  // Error in sending packet
-    }
-
-	return ret;
-}
-
-/**
- * \brief function to send other subsystems telemetry to the TT&C subsystem
- *
- * \param telemFromSubystems the telemetry data from other subsystems
- * (see statesDefine.h of other subsystems)
- *
- * \return statusErrDef that values:
- * - errWriteUDPTelem when the telemetry can't be sent,
- * - noError when the function exits successfully.
- */
-statusErrDef sendTelemToTTC(std::vector<uint8_t> *telemFromSubystems) {
-	statusErrDef ret = noError;
-	std::vector<uint8_t> telemOut;
-
-    telemOut = {(*telemFromSubystems)[0],(*telemFromSubystems)[1]};
-
-	std::vector<uint8_t> ccsdsPacket = generateCCSDSPacket(telemOut);
-
-	// Setup the destination address (this is where the packet will be sent)
-    struct sockaddr_in clientAddr;
-    memset(&clientAddr, 0, sizeof(clientAddr));
-    clientAddr.sin_family = AF_INET;
-    clientAddr.sin_port = htons(UDP_TELEMETRY_PORT);  // Destination port
-    clientAddr.sin_addr.s_addr = inet_addr(TTC_IP_ADDRESS);  // Destination IP address (localhost, change to actual IP)
-
-    // Send the CCSDS packet over UDP
-    ssize_t bytes_sent = sendto(socket_udp, ccsdsPacket.data(), ccsdsPacket.size(),
-                                 0, (struct sockaddr*)&clientAddr, sizeof(clientAddr));
-    if (bytes_sent < 0) {
-        perror("errWriteUDPTelem");
-        return errWriteUDPTelem;  // Error in sending packet
-    }
-
-	return ret;
-}
-
-/**
- * \brief function to decode the sensor data frame and
- * copy the contents to a sensor file and to the paramSensors struct.
- *
- * \param frameData the incoming frame data array of bytes
- *
- * \return statusErrDef that values:
- * - noError when the function exits successfully.
- */
-statusErrDef manageSensorData(uint8_t *frameData) {
-	statusErrDef ret = noError;
-	uint16_t sensorId = 0x0000;
-	double currentTime = 0;
-    int32_t sensorValue = 0x00000000;
-
-	sensorId = (frameData[1] << 8) | frameData[2];
-	//printf("sensorId:0x%04X \n",(sensorDef)sensorId);
-	if(frameData[3] == 0x00 && frameData[4] == 0x00 && frameData[5] == 0x00) {
-		sensorValue = frameData[6];
-		//printf("Sensor value : 0x%02X \n", sensorValue);
-		ret = sendSensorDataToTTC((sensorDef)sensorId, {frameData[6]});
-	}
-	else if(frameData[3] == 0x00 && frameData[4] == 0x00) {
-		sensorValue = (frameData[5] << 8) | frameData[6];
-		//printf("Sensor value : 0x%04X \n", sensorValue);
-		ret = sendSensorDataToTTC((sensorDef)sensorId, {frameData[5], frameData[6]});
-	}
-	else {
-		sensorValue = (frameData[3] << 24) | (frameData[4] << 16) | (frameData[5] << 8) | frameData[6];
-		//printf("Sensor value : 0x%08X \n", sensorValue);
-		ret = sendSensorDataToTTC((sensorDef)sensorId, {frameData[3], frameData[4], frameData[5], frameData[6]});
-	}
-
-	clock_gettime(CLOCK_MONOTONIC, &endTimeOBDH);
-	currentTime = (endTimeOBDH.tv_sec - beginTimeOBDH.tv_sec) + (endTimeOBDH.tv_nsec - beginTimeOBDH.tv_nsec) / 1e9;
-	//printf("current sensor time: %f\n", currentTime);
-
-	for(int i = 0; i < lineCountSensorParamCSV; i++) {
-		if(paramSensors->id[i] == sensorId)
-			paramSensors->currentValue[i] = sensorValue;
-
-		if(sensorsVal[i].id == sensorId) {
-			//fill the sensorsVal struct
-			sensorsVal[i].timeStamp[sensorsVal[i].currentFileLine] = currentTime;
-			sensorsVal[i].value[sensorsVal[i].currentFileLine] = sensorValue;
-
-			//fill the sensor file
-			fprintf(sensorsVal[i].sensorFile, "%f;%d\n",
-				currentTime,
-				sensorValue);       // Sensor value
-			sensorsVal[i].currentFileLine++;
-			if(sensorsVal[i].currentFileLine > READINGS_PER_SENSOR)
-				sensorsVal[i].currentFileLine = 0;
-		}
-	}
-
-	return ret;
-}
-
-/**
- * \brief function to send telemetry to the TT&C subsystem
- *
- * \param sensor the sensor ID (see statesDefine.h)
- * \param sensorValue the sensor value in a series of bytes
- *
- * \return statusErrDef that values:
- * - errWriteUDPTelem when the telemetry can't be sent,
- * - noError when the function exits successfully.
- */
-statusErrDef sendSensorDataToTTC(const sensorDef sensor, std::vector<uint8_t> sensorValue) {
-	statusErrDef ret = noError;
-	std::vector<uint8_t> telemOut;
-	uint8_t categoryHighByte = (sensor >> 8) & 0xFF;  // Get the higher byte (8 most significant bits)
-    uint8_t categoryLowByte = sensor & 0xFF; // Get the lower byte (8 least significant bits)
-
-	telemOut = {categoryHighByte,categoryLowByte};
-
-	for(int i = 0; i < sensorValue.size(); i++) {
-		telemOut.push_back(sensorValue[i]);
-	}
-
-	std::vector<uint8_t> ccsdsPacket = generateCCSDSPacket(telemOut);
-
-	// Setup the destination address (this is where the packet will be sent)
-    struct sockaddr_in clientAddr;
-    memset(&clientAddr, 0, sizeof(clientAddr));
-    clientAddr.sin_family = AF_INET;
-    clientAddr.sin_port = htons(UDP_TELEMETRY_PORT);  // Destination port
-    clientAddr.sin_addr.s_addr = inet_addr(TTC_IP_ADDRESS);  // Destination IP address (localhost, change to actual IP)
-
-    // Send the CCSDS packet over UDP
-    ssize_t bytes_sent = sendto(socket_udp, ccsdsPacket.data(), ccsdsPacket.size(),
-                                 0, (struct sockaddr*)&clientAddr, sizeof(clientAddr));
-    if (bytes_sent < 0) {
-        perror("errWriteUDPTelem");
-        return errWriteUDPTelem;  // Error in sending packet
-    }
-
-	return ret;
-}
-
-/**
- * \brief function show every byte of the input frame
- *
- * \param data the frame raw bytes pointer
- * \param length the frame length
- */
-void DumpUDPData(uint8_t *data, ssize_t length) {
-    printf("Received %zd bytes of data:\n", length);
-
-    // Iterate over each byte in the received data
-    for (ssize_t i = 0; i < length; i++) {
-        // Print each byte in hexadecimal format
-        printf("0x%02X ", data[i]);
-
-        // Optionally, print a newline every 16 bytes for better readability
-        if ((i + 1) % 16 == 0) {
-            printf("\n");
-        }
-    }
-
-    // Print a final newline if the data doesn't end on a boundary of 16 bytes
-    if (length % 16 != 0) {
-        printf("\n");
-    }
-}
-
-/**
- * \brief function to recieve telecommands from the TT&C subsystem
- *
- * \return statusErrDef that values:
- * - errTCToWrongSubsystem the subsystem indicated
- * in the TC frame is not present in the function switch
- * - errCCSDSPacketUninterpretable when the CAN frame is
- * not interpretable as a CCSDS packet
- * - errReadCANTC when CAN frame can't be read,
- * - noError when the function exits successfully.
- */
-statusErrDef recieveTCFromTTC() {
-	statusErrDef ret = noError;
-	uint16_t mainStateTCRecieved;
-	uint16_t mostSigHexDigitTC;
-	struct sockaddr_in clientAddr;
-    socklen_t addrLen = sizeof(clientAddr);
-    uint8_t buffer[UDP_MAX_BUFFER_SIZE];
-
-	ssize_t sizeReceived = recvfrom(socket_udp, buffer, UDP_MAX_BUFFER_SIZE, 0,(struct sockaddr*)&clientAddr,&addrLen);
-	if (sizeReceived > 0) {
-		std::cout << "Received " << sizeReceived << " bytes from cFS\n";
-		DumpUDPData(buffer, sizeReceived);
-		//constructs an empty instance
-		CCSDSSpacePacket ccsdsPacket;
-		//interpret an input data as a CCSDS SpacePacket
-		try {
-			// Attempt to interpret the packet
-			ccsdsPacket.interpret(buffer, sizeReceived);
-		} catch (CCSDSSpacePacketException &e) {
-			// Print the exception details to help debug
-			std::cerr << "CCSDS Packet Error: " << e.toString() << std::endl;
-			std::cerr << "Failed to interpret packet of length " << sizeReceived << std::endl;
-			// Optionally, dump the buffer contents for inspection
-			for (size_t i = 0; i < sizeReceived; i++) {
-				std::cout << std::hex << (int)buffer[i] << " ";
-			}
-			std::cout << std::endl;
-
-			return errCCSDSPacketUninterpretable;
-		}
-
-		std::vector<uint8_t> *userData = ccsdsPacket.getUserDataField();
-
-		mainStateTCRecieved = ((*userData)[0] << 8) | (*userData)[1];
-		mostSigHexDigitTC = mainStateTCRecieved & 0xF000;
-
-		switch(mostSigHexDigitTC) {
-			case OBDHSubsystem:
-				mainStateTC = mainStateTCRecieved;
-				break;
-			case payloadSubsystem:
-				ret = sendTCToSubsystem(*userData, payloadSubsystem);
-				break;
-			case everySubsystems:
-				mainStateTC = mainStateTCRecieved & 0x0FFF;
-				ret = sendTCToSubsystem(*userData, everySubsystems);
-				break;
-			default:
-				return errTCToWrongSubsystem;
-				break;
-		}
-
-		//get APID
-		std::cout << ccsdsPacket.getPrimaryHeader()->getAPIDAsInteger() << std::endl;
-		//dump packet content
-		std::cout << ccsdsPacket.toString() << std::endl;
-	}
-	return ret;
-}
-
-/**
- * \brief function to recieve telemetry from all subsystems
- *
- * \return statusErrDef that values:
- * - errCCSDSPacketUninterpretable when the CAN frame is
- * not interpretable as a CCSDS packet
- * - errReadCANTelem when CAN frame can't be read from the Payload subsystem,
- * - noError when the function exits successfully.
- */
-statusErrDef recieveTelemFromSubsystems() {
-	statusErrDef ret = noError;
-	struct can_frame frame;
-
-	ssize_t sizeReceived = read(socket_can, &frame, sizeof(struct can_frame));
-    if (sizeReceived > 0) {
-		//std::cout << "Received " << sizeReceived << " bytes from a subsystem\n";
-		if(frame.data[0] == 0xFF)
-		{
-			//printf("Sensor data recieved\n");
-			manageSensorData(frame.data);
-			return ret;
-		}
-
-		CCSDSSpacePacket ccsdsPacket;
-		//interpret an input data as a CCSDS SpacePacket
-		try {
-			// Attempt to interpret the packet
-			ccsdsPacket.interpret(frame.data, sizeReceived);
-		} catch (CCSDSSpacePacketException &e) {
-			// Print the exception details to help debug
-			std::cerr << "CCSDS Packet Error: " << e.toString() << std::endl;
-			std::cerr << "Failed to interpret packet of length " << sizeReceived << std::endl;
-			std::cout << std::endl;
-
-			return errCCSDSPacketUninterpretable;
-		}
-
-		std::vector<uint8_t> *userData = ccsdsPacket.getUserDataField();
-
-		ret = sendTelemToTTC(userData);
-
-		//get APID
-		std::cout << ccsdsPacket.getPrimaryHeader()->getAPIDAsInteger() << std::endl;
-		//dump packet content
-		std::cout << ccsdsPacket.toString() << std::endl;
-
-    } else {
-		// If there's no data, just continue (EAGAIN or EWOULDBLOCK)
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            return infoNoDataInCANBuffer;
-        } else {
-            perror("errReadCANTelem");
-            return errReadCANTelem;
-        }
-	}
-
-
-	return ret;
-}
-
-/**
- * \brief function to send telecommands to the Payload subsystem.
- *
- * \param TCOut the telecommands to transmit to a CAN frame to
- * the payload subsystem, cut in a vector of bytes.
- *
- * \param subsystem the spacecraft subsystem selected in the
- * enumeration.
- *
- * \return statusErrDef that values:
- * - errCCSDSPacketTooLarge when the CCSDS packet is too large for the CAN FD frame (64 Bytes),
- * - errWriteCANPayload when write payload subsystem TCs to the CAN bus fails,
- * - noError when the function exits successfully.
- */
-statusErrDef sendTCToSubsystem(std::vector<uint8_t> TCOut, subsystemDef subsystem) {
-	statusErrDef ret = noError;
-	canid_t canId = 0x000;
-
-	switch(subsystem) {
-		case payloadSubsystem:
-				canId = CAN_ID_PAYLOAD;
-			break;
-		case everySubsystems:
-				canId = CAN_ID_BROADCAST;
-		default:
-			return errTCToWrongSubsystem;
-			break;
-	}
-
-	std::vector<uint8_t> ccsdsPacket = generateCCSDSPacket(TCOut);
-	if (ccsdsPacket.size() > DATA_OUT_CAN_MAX_LENGTH) {
-        std::cerr << "Error: CCSDS packet too large for single CAN FD frame\n";
-        return errCCSDSPacketTooLarge;
-    }
-
-    struct can_frame frame;
-    frame.can_id = canId;  // Set appropriate CAN ID
-    frame.len = ccsdsPacket.size();  // Payload length
-
-    std::memcpy(frame.data, ccsdsPacket.data(), ccsdsPacket.size());  // Copy CCSDS packet into frame
-
-    if (write(socket_can, &frame, sizeof(struct can_frame)) != sizeof(struct can_frame)) {
-        perror("errWriteCANTC");
-		return errWriteCANTC;
-    }
-    else {
-		std::cout << "Sent CCSDS packet (" << ccsdsPacket.size() << " bytes) in a single CAN FD frame\n";
-    }
-
-	return ret;
-}
-
-/**
- * \brief function to compare every sensor current values with the warning
- * and critical bounds declared in the paramSensors.csv file.
- *
- * \return statusErrDef that values:
- * - errSensorCriticalValue when a sensor has reached a minimum or maximum warning value from the paramSensors.csv file.
- * - errSensorWarningValue when a sensor has reached a minimum or maximum critical value from the paramSensors.csv file.
- * - noError when the function exits successfully.
- */
-statusErrDef compareSensorValuesWithParam() {
-	statusErrDef ret = noError;
-	for(int i = 1; i < lineCountSensorParamCSV; i++) {
-		// Check if the sensor current value is out of its warning bounds
-		if(paramSensors->currentValue[i] <= paramSensors->minWarnValue[i] ||
-			paramSensors->currentValue[i] >= paramSensors->maxWarnValue[i]) {
-				// Check if the sensor current value is out of its critical bounds
-				if(paramSensors->currentValue[i] <= paramSensors->minCriticalValue[i] ||
-				paramSensors->currentValue[i] >= paramSensors->maxCriticalValue[i]) {
-					sendTelemToTTC(errSensorCriticalValue);
-					return errSensorCriticalValue;
-				}
-				else {
-					sendTelemToTTC(errSensorWarningValue);
-					return errSensorWarningValue;
-				}
-			}
-	}
-
-	return ret;
-}
-
-/**
- * \brief function to recieve sensor telemetry data from
- * every spacecraft subsystems and check if their values
- * are out of bounds.
- *
- * \return statusErrDef that values:
- * - errReadCANEPS when CAN frame can't be read from the EPS subsystem,
- * - noError when the function exits successfully.
- */
-statusErrDef checkSensors() {
-	statusErrDef ret = noError;
-	ret = recieveTelemFromSubsystems();
-	if(ret != noError && ret != infoNoDataInCANBuffer)
-		return ret;
-	ret = compareSensorValuesWithParam();
-	return ret;
-}
-
-/**
- * \brief function to recieve telecommands from the TT&C subsystem
- * and redirect sensor data as telemetry to the TT&C subsystem.
- *
- * \return statusErrDef that values:
- * - errReadCANTC when CAN frame can't be read,
- * - errWriteUDPTelem when the telemetry can't be sent,
- * - noError when the function exits successfully.
- */
-statusErrDef checkTC() {
-	counter++;
-	if(counter >= 255)
-		counter = 0;
-	statusErrDef ret = noError;
-	ret = recieveTCFromTTC();
-	if(ret != noError)
-		return ret;
-	/*
-	ret = sendSensorDataToTTC(sensor1, {counter});
-	if(ret != noError)
-		return ret;
-	ret = sendSensorDataToTTC(sensor2, {0xF1, counter});
-	if(ret != noError)
-		return ret;
-	ret = sendSensorDataToTTC(sensor3, {0xF1, 0xF2, 0xF3, counter});
-	*/
-	return ret;
-}
+/**
+ * \file controlMode.cpp
+ * \brief control mode functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * control mode functions
+ *
+ */
+#include "controlMode.h"
+#include "canFilter.h"
+#include "init.h"
+#include "limitCheck.h"
+#include "sensorHistory.h"
+#include "sensorLog.h"
+#include "sensorArchive.h"
+#include "sensorStats.h"
+#include "sensorTrend.h"
+#include "derivedParam.h"
+#include "sensorCalibration.h"
+#include "paramReload.h"
+#include "sensorStale.h"
+#include "obdhPipeline.h"
+#include "loopLatency.h"
+#include "trace.h"
+
+#include <math.h>
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+std::vector<uint8_t> generateCCSDSPacket(std::vector<uint8_t> dataOut);
+void fillCCSDSPrimaryHeader(uint8_t *header, size_t length);
+statusErrDef sendSensorDataToTTC(const sensorDef sensor, const uint8_t *sensorValue, size_t length);
+statusErrDef manageSensorData(uint8_t *frameData);
+statusErrDef recordSensorValue(int i, uint16_t sensorId, int32_t sensorValue);
+statusErrDef recieveTelemFromSubsystems();
+statusErrDef sendTelemToTTC(std::vector<uint8_t> *telemFromSubystems);
+statusErrDef recieveTCFromTTC(bool withOBDHTC);
+statusErrDef sendTelemOut(const uint8_t *telemOut, size_t length);
+statusErrDef sendTelemOut(const std::vector<uint8_t> &telemOut);
+statusErrDef manageOBDHTC(uint16_t TC);
+void DumpUDPData(uint8_t *data, ssize_t length);
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief the test sensor value increment.
+ */
+uint8_t counter = 0;
+
+/**
+ * \brief The main state recieved through a telecommand
+ * from the TT&C subsystem.
+ */
+uint16_t mainStateTC = 0xFFFF;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief housekeeping packets user data, kept between the reports and
+ * grown at init (see reserveHousekeepingPackets()).
+ */
+static std::vector<uint8_t> sensorStatsPacket;
+static std::vector<uint8_t> loopLatencyPacket;
+static std::vector<uint8_t> canFilterStatsPacket;
+
+//------------------------------------------------------------------------------
+// State functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to generate a CCSDS packet wrapping user data
+ *
+ * \param dataOut the data to recieve from a UDP or CAN frame,
+ * cut in a vector of bytes
+ *
+ * \return packet a CCSDS packet to be sent
+ */
+std::vector<uint8_t> generateCCSDSPacket(std::vector<uint8_t> dataOut) {
+	uint16_t apid = 0x1AB;
+	//uint8_t category = 0;
+	//uint8_t aduCount = 0;
+	size_t sequenceCount = 1;
+
+	//constructs an empty instance
+	CCSDSSpacePacket ccsdsPacketIN;
+	//set APID
+	ccsdsPacketIN.getPrimaryHeader()->setAPID(apid);
+	//set Packet Type (Telemetry or Command)
+	ccsdsPacketIN.getPrimaryHeader()->setPacketType(CCSDSSpacePacketPacketType::TelemetryPacket);
+	//set Secondary Header Flag (whether this packet has the Secondary Header part)
+	ccsdsPacketIN.getPrimaryHeader()->setSecondaryHeaderFlag(CCSDSSpacePacketSecondaryHeaderFlag::NotPresent);
+	//set segmentation information
+	ccsdsPacketIN.getPrimaryHeader()->setSequenceFlag(CCSDSSpacePacketSequenceFlag::UnsegmentedUserData);
+	//set counters
+	ccsdsPacketIN.getPrimaryHeader()->setSequenceCount(sequenceCount);
+	//set data
+	ccsdsPacketIN.setUserDataField(dataOut);
+	ccsdsPacketIN.setPacketDataLength();
+	//get packet as byte array
+	std::vector<uint8_t> packet = ccsdsPacketIN.getAsByteVector();
+
+	return packet;
+}
+
+/**
+ * \brief function to write the CCSDS primary header of a telemetry
+ * packet, the same header as generateCCSDSPacket() without building
+ * the packet objects.
+ *
+ * \param header the CCSDS_PRIMARY_HEADER_SIZE bytes of the header
+ * \param length the number of bytes of user data
+ */
+void fillCCSDSPrimaryHeader(uint8_t *header, size_t length) {
+	uint16_t apid = 0x1AB;
+	size_t sequenceCount = 1;
+	uint16_t dataLength = (length > 0) ? (uint16_t)(length - 1) : 0;
+
+	// version 0, telemetry packet, no secondary header
+	header[0] = (apid >> 8) & 0x07;
+	header[1] = apid & 0xFF;
+	// unsegmented user data
+	header[2] = 0xC0 | ((sequenceCount >> 8) & 0x3F);
+	header[3] = sequenceCount & 0xFF;
+	header[4] = (dataLength >> 8) & 0xFF;
+	header[5] = dataLength & 0xFF;
+}
+
+/**
+ * \brief function to wrap telemetry user data in a CCSDS packet
+ * and send it to the TT&C subsystem. The packet is built on the
+ * stack, nothing is allocated.
+ *
+ * \param userData the telemetry user data
+ * \param length the number of bytes of userData (UDP_MAX_BUFFER_SIZE at most)
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the telemetry is too large or can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendUserDataToTTC(const uint8_t *userData, size_t length) {
+	statusErrDef ret = noError;
+	uint8_t ccsdsPacket[CCSDS_PRIMARY_HEADER_SIZE + UDP_MAX_BUFFER_SIZE];
+	traceEvent(traceTelemSent, (length >= 2 ? (uint32_t)userData[0] << 24 | (uint32_t)userData[1] << 16 : 0) | (uint32_t)(length & 0xFFFF));
+	if(length > UDP_MAX_BUFFER_SIZE) {
+		printf("errWriteUDPTelem: %zu bytes of telemetry, %d at most\n", length, UDP_MAX_BUFFER_SIZE);
+		return errWriteUDPTelem;
+	}
+	fillCCSDSPrimaryHeader(ccsdsPacket, length);
+	memcpy(ccsdsPacket + CCSDS_PRIMARY_HEADER_SIZE, userData, length);
+
+	// Setup the destination address (this is where the packet will be sent)
+    struct sockaddr_in clientAddr;
+    memset(&clientAddr, 0, sizeof(clientAddr));
+    clientAddr.sin_family = AF_INET;
+    clientAddr.sin_port = htons(UDP_TELEMETRY_PORT);  // Destination port
+    clientAddr.sin_addr.s_addr = inet_addr(TTC_IP_ADDRESS);  // Destination IP address (localhost, change to actual IP)
+
+    // Send the CCSDS packet over UDP
+    ssize_t bytes_sent = sendto(socket_udp, ccsdsPacket, CCSDS_PRIMARY_HEADER_SIZE + length,
+                                 0, (struct sockaddr*)&clientAddr, sizeof(clientAddr));
+    if (bytes_sent < 0) {
+        perror("errWriteUDPTelem");
+        return errWriteUDPTelem;  // Error in sending packet
+    }
+
+	return ret;
+}
+
+/**
+ * \brief function to send telemetry user data to the TT&C subsystem,
+ * the processing stage of the OBDH pipeline hands it to the downlink
+ * stage (see obdhPipeline.h).
+ *
+ * \param telemOut the telemetry user data
+ * \param length the number of bytes of telemOut
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendTelemOut(const uint8_t *telemOut, size_t length) {
+	if(obdhPipelineProcessing)
+		return queuePipelineTelemetry(telemOut, length);
+	return sendUserDataToTTC(telemOut, length);
+}
+
+/**
+ * \brief function to send telemetry user data to the TT&C subsystem
+ * (see sendTelemOut(const uint8_t*, size_t)).
+ *
+ * \param telemOut the telemetry user data
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendTelemOut(const std::vector<uint8_t> &telemOut) {
+	return sendTelemOut(telemOut.data(), telemOut.size());
+}
+
+/**
+ * \brief function to send telemetry to the TT&C subsystem
+ *
+ * \param statusErr the telemetry data (see statesDefine.h)
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendTelemToTTC(const statusErrDef statusErr) {
+	statusErrDef ret = noError;
+	uint8_t categoryHighByte = (statusErr >> 8) & 0xFF;  // Get the higher byte (8 most significant bits)
+    uint8_t categoryLowByte = statusErr & 0xFF; // Get the lower byte (8 least significant bits)
+
+    uint8_t telemOut[2] = {categoryHighByte,categoryLowByte};
+
+	ret = sendTelemOut(telemOut, sizeof(telemOut));
+	return ret;
+}
+
+/**
+ * \brief function to send other subsystems telemetry to the TT&C subsystem
+ *
+ * \param telemFromSubystems the telemetry data from other subsystems
+ * (see statesDefine.h of other subsystems)
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendTelemToTTC(std::vector<uint8_t> *telemFromSubystems) {
+	statusErrDef ret = noError;
+
+    uint8_t telemOut[2] = {(*telemFromSubystems)[0],(*telemFromSubystems)[1]};
+
+	ret = sendTelemOut(telemOut, sizeof(telemOut));
+	return ret;
+}
+
+/**
+ * \brief function to decode the sensor data frame and
+ * copy the contents to the sensor log, the sensor statistics, the sensor archive
+ * and to the paramSensors struct. The raw value of a calibrated sensor is
+ * queued, it is sent and recorded once its batch is calibrated.
+ * The data of a sensor ID that is not in paramSensors.csv is only sent
+ * and counted (see canUnknownSensorFrameCount).
+ *
+ * \param frameData the incoming frame data array of bytes
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the sensor log buffer can't be written to the file
+ * - errWriteSensorArchive when a sensor archive block can't be written
+ * - errWriteUDPTelem when the sensor telemetry or the early warning can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef manageSensorData(uint8_t *frameData) {
+	statusErrDef ret = noError;
+	uint16_t sensorId = 0x0000;
+    int32_t sensorValue = 0x00000000;
+
+	int nbBytes = 0;
+
+	sensorId = (frameData[1] << 8) | frameData[2];
+	//printf("sensorId:0x%04X \n",(sensorDef)sensorId);
+	if(frameData[3] == 0x00 && frameData[4] == 0x00 && frameData[5] == 0x00) {
+		sensorValue = frameData[6];
+		//printf("Sensor value : 0x%02X \n", sensorValue);
+		nbBytes = 1;
+	}
+	else if(frameData[3] == 0x00 && frameData[4] == 0x00) {
+		sensorValue = (frameData[5] << 8) | frameData[6];
+		//printf("Sensor value : 0x%04X \n", sensorValue);
+		nbBytes = 2;
+	}
+	else {
+		sensorValue = (frameData[3] << 24) | (frameData[4] << 16) | (frameData[5] << 8) | frameData[6];
+		//printf("Sensor value : 0x%08X \n", sensorValue);
+		nbBytes = 4;
+	}
+
+	int i = getSensorIndex(sensorId);
+	if(i >= 0 && isCalibratedSensor(i)) {
+		if(queueSensorCalibration(i, sensorValue))
+			ret = flushCalibratedSensors();
+		return ret;
+	}
+	ret = sendSensorDataToTTC((sensorDef)sensorId, frameData + 7 - nbBytes, nbBytes);
+	if(i < 0) {
+		canUnknownSensorFrameCount++;
+		return ret;
+	}
+	//a derived parameter value is only computed from its expression
+	if(isDerivedParameter(i))
+		return ret;
+
+	statusErrDef recordRet = recordSensorValue(i, sensorId, sensorValue);
+	if(ret == noError)
+		ret = recordRet;
+	return ret;
+}
+
+/**
+ * \brief function to store a new sensor or derived parameter value
+ * in the paramSensors struct, the sensor trend, the sensor history,
+ * the sensor statistics, the sensor archive and the sensor log.
+ *
+ * \param i the sensor index
+ * \param sensorId the sensor ID (see paramSensors.csv)
+ * \param sensorValue the new sensor value
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the sensor log buffer can't be written to the file
+ * - errWriteSensorArchive when a sensor archive block can't be written
+ * - errWriteUDPTelem when the early warning can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef recordSensorValue(int i, uint16_t sensorId, int32_t sensorValue) {
+	statusErrDef ret = noError;
+	double currentTime = 0;
+	struct sensorLogRecordStruct record;
+
+	record.timeStamp = getTimeSinceStart();
+	currentTime = record.timeStamp / 1e6;
+	//printf("current sensor time: %f\n", currentTime);
+
+	if(paramSensors->currentValue[i] != sensorValue) {
+		paramSensors->currentValue[i] = sensorValue;
+		markSensorDirty(i);
+	}
+
+	//move the sensor deadline, a stale sensor is reported fresh again
+	if(touchSensorStaleness(i, record.timeStamp)) {
+		statusErrDef sendRet = sendSensorStatusToTTC(infoSensorRefreshed, sensorId);
+		if(ret == noError)
+			ret = sendRet;
+	}
+
+	//predict the bound crossings before the reading enters the sensor history
+	statusErrDef trendRet = updateSensorTrend(paramSensors, i, currentTime, sensorValue);
+	if(trendRet != noError) {
+		statusErrDef sendRet = sendSensorStatusToTTC(trendRet, sensorId);
+		if(ret == noError)
+			ret = sendRet;
+	}
+
+	//fill the sensor history and the sensor statistics
+	pushSensorHistory(i, currentTime, sensorValue);
+	updateSensorStats(i, sensorValue);
+
+	//fill the sensor archive and the sensor log, in the logging stage of the pipeline
+	record.value = sensorValue;
+	record.sensorIndex = (uint16_t)i;
+	record.sensorId = sensorId;
+	if(obdhPipelineProcessing) {
+		queuePipelineLogRecord(&record);
+		return ret;
+	}
+	statusErrDef storeRet = storeSensorRecord(&record);
+	if(ret == noError)
+		ret = storeRet;
+
+	return ret;
+}
+
+/**
+ * \brief function to write a sensor reading to the sensor
+ * archive and the sensor log.
+ *
+ * \param record the sensor reading
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the sensor log buffer can't be written to the file
+ * - errWriteSensorArchive when a sensor archive block can't be written
+ * - noError when the function exits successfully.
+ */
+statusErrDef storeSensorRecord(const struct sensorLogRecordStruct *record) {
+	statusErrDef ret = pushSensorArchive(record->sensorIndex, record->timeStamp, record->value);
+	statusErrDef logRet = appendSensorLog(record);
+	if(ret == noError)
+		ret = logRet;
+	return ret;
+}
+
+/**
+ * \brief function to calibrate the queued raw samples of the calibrated
+ * sensors, every engineering value is sent as telemetry (4 bytes) and
+ * recorded like a sensor reading.
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the sensor log buffer can't be written to the file
+ * - errWriteSensorArchive when a sensor archive block can't be written
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef flushCalibratedSensors() {
+	statusErrDef ret = noError;
+	static uint16_t index[SENSOR_CALIBRATION_BATCH_SIZE];
+	static int32_t value[SENSOR_CALIBRATION_BATCH_SIZE];
+
+	int nbSamples = calibrateSensorBatch(index, value);
+	for(int s = 0; s < nbSamples; s++) {
+		int i = index[s];
+		uint16_t sensorId = paramSensors->id[i];
+		uint32_t engineeringValue = (uint32_t)value[s];
+		uint8_t valueBytes[4] = {(uint8_t)(engineeringValue >> 24), (uint8_t)(engineeringValue >> 16),
+								 (uint8_t)(engineeringValue >> 8), (uint8_t)engineeringValue};
+		statusErrDef sendRet = sendSensorDataToTTC((sensorDef)sensorId, valueBytes, sizeof(valueBytes));
+		statusErrDef recordRet = recordSensorValue(i, sensorId, value[s]);
+		if(ret == noError)
+			ret = (sendRet != noError) ? sendRet : recordRet;
+	}
+	return ret;
+}
+
+/**
+ * \brief function to evaluate the derived parameters reading a
+ * sensor whose value changed, every new derived value is sent as
+ * telemetry and recorded like a sensor reading. Must be called
+ * before updateDirtySensorLimits() so that the derived parameters
+ * bounds are checked in the same pass.
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the sensor log buffer can't be written to the file
+ * - errWriteSensorArchive when a sensor archive block can't be written
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef updateDerivedSensors() {
+	statusErrDef ret = noError;
+	static uint16_t changed[MAX_SENSORS];
+	if(paramSensors == NULL || nbDerivedParameters == 0)
+		return ret;
+
+	int nbChanged = evaluateDerivedParameters(paramSensors, changed, MAX_SENSORS);
+	for(int c = 0; c < nbChanged; c++) {
+		int i = changed[c];
+		uint16_t sensorId = paramSensors->id[i];
+		uint32_t value = (uint32_t)paramSensors->currentValue[i];
+		uint8_t valueBytes[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+		statusErrDef sendRet = sendSensorDataToTTC((sensorDef)sensorId, valueBytes, sizeof(valueBytes));
+		statusErrDef recordRet = recordSensorValue(i, sensorId, (int32_t)value);
+		if(ret == noError)
+			ret = (sendRet != noError) ? sendRet : recordRet;
+	}
+	return ret;
+}
+
+/**
+ * \brief function to send telemetry to the TT&C subsystem
+ *
+ * \param sensor the sensor ID (see statesDefine.h)
+ * \param sensorValue the sensor value in a series of bytes
+ * \param length the number of bytes of sensorValue (4 at most)
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendSensorDataToTTC(const sensorDef sensor, const uint8_t *sensorValue, size_t length) {
+	statusErrDef ret = noError;
+	uint8_t telemOut[2 + sizeof(uint32_t)];
+	uint8_t categoryHighByte = (sensor >> 8) & 0xFF;  // Get the higher byte (8 most significant bits)
+    uint8_t categoryLowByte = sensor & 0xFF; // Get the lower byte (8 least significant bits)
+
+	if(length > sizeof(uint32_t))
+		length = sizeof(uint32_t);
+	telemOut[0] = categoryHighByte;
+	telemOut[1] = categoryLowByte;
+	memcpy(telemOut + 2, sensorValue, length);
+
+	ret = sendTelemOut(telemOut, 2 + length);
+	return ret;
+}
+
+/**
+ * \brief function show every byte of the input frame
+ *
+ * \param data the frame raw bytes pointer
+ * \param length the frame length
+ */
+void DumpUDPData(uint8_t *data, ssize_t length) {
+    printf("Received %zd bytes of data:\n", length);
+
+    // Iterate over each byte in the received data
+    for (ssize_t i = 0; i < length; i++) {
+        // Print each byte in hexadecimal format
+        printf("0x%02X ", data[i]);
+
+        // Optionally, print a newline every 16 bytes for better readability
+        if ((i + 1) % 16 == 0) {
+            printf("\n");
+        }
+    }
+
+    // Print a final newline if the data doesn't end on a boundary of 16 bytes
+    if (length % 16 != 0) {
+        printf("\n");
+    }
+}
+
+/**
+ * \brief function to send a status concerning one sensor
+ * to the TT&C subsystem (status code followed by the sensor ID).
+ *
+ * \param statusErr the status code
+ * \param sensorId the sensor ID (see paramSensors.csv)
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the packet can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendSensorStatusToTTC(const statusErrDef statusErr, uint16_t sensorId) {
+	uint8_t telemOut[4] = {(uint8_t)((statusErr >> 8) & 0xFF), (uint8_t)(statusErr & 0xFF),
+						   (uint8_t)((sensorId >> 8) & 0xFF), (uint8_t)(sensorId & 0xFF)};
+
+	return sendTelemOut(telemOut, sizeof(telemOut));
+}
+
+/**
+ * \brief function to send the history window of a sensor to the
+ * TT&C subsystem, as an HKSensorWindow housekeeping packet
+ * (see regulate.h).
+ *
+ * \param sensorId the sensor ID (see paramSensors.csv)
+ * \param value the sensor current value
+ * \param window the statistics of the sensor latest readings
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the packet can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendSensorWindowToTTC(uint16_t sensorId, int32_t value, const struct sensorWindowStruct *window) {
+	int32_t meanValue = (int32_t)lrint(window->meanValue);
+	uint32_t fields[5] = {(uint32_t)value, window->nbReadings, (uint32_t)window->minValue,
+						  (uint32_t)window->maxValue, (uint32_t)meanValue};
+	uint8_t telemOut[4 + sizeof(fields)] = {(uint8_t)((HKSensorWindow >> 8) & 0xFF), (uint8_t)(HKSensorWindow & 0xFF),
+											(uint8_t)((sensorId >> 8) & 0xFF), (uint8_t)(sensorId & 0xFF)};
+	for(int f = 0; f < 5; f++) {
+		telemOut[4 + 4 * f] = (uint8_t)(fields[f] >> 24);
+		telemOut[5 + 4 * f] = (uint8_t)(fields[f] >> 16);
+		telemOut[6 + 4 * f] = (uint8_t)(fields[f] >> 8);
+		telemOut[7 + 4 * f] = (uint8_t)fields[f];
+	}
+	return sendTelemOut(telemOut, sizeof(telemOut));
+}
+
+/**
+ * \brief function to send the statistics of every sensor having
+ * readings in the reporting window to the TT&C subsystem, as
+ * HKSensorStats housekeeping packets (see sensorStats.h).
+ *
+ * \param timeStamp the current time in microseconds since program start
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when a packet can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendSensorStatsToTTC(uint64_t timeStamp) {
+	int index = 0;
+
+	while(index < nbStatsSensors) {
+		index = fillSensorStatsPacket(paramSensors->id, index, timeStamp, &sensorStatsPacket);
+		if(sensorStatsPacket[6] == 0)
+			break;
+		statusErrDef ret = sendTelemOut(sensorStatsPacket);
+		if(ret != noError)
+			return ret;
+	}
+	return noError;
+}
+
+/**
+ * \brief function to send the latency percentiles of the main loop
+ * phases to the TT&C subsystem, as an HKLoopLatency housekeeping
+ * packet (see loopLatency.h).
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the packet can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendLoopLatencyToTTC() {
+	fillLoopLatencyPacket(&loopLatencyPacket);
+	if(loopLatencyPacket[6] == 0)
+		return noError;
+	return sendTelemOut(loopLatencyPacket);
+}
+
+/**
+ * \brief function to send the CAN frame counters of the reporting
+ * window to the TT&C subsystem, as an HKCANFilterStats housekeeping
+ * packet (see canFilter.h).
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the packet can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendCANFilterStatsToTTC() {
+	fillCANFilterStatsPacket(&canFilterStatsPacket);
+	return sendTelemOut(canFilterStatsPacket);
+}
+
+/**
+ * \brief function to grow the housekeeping packets to their size at
+ * init, the first reports of the control mode then don't allocate
+ * (see checkRTProfile()). The packets are filled once and not sent.
+ */
+void reserveHousekeepingPackets() {
+	// No sensor entry from the last index, only the packet buffer is reserved
+	fillSensorStatsPacket(NULL, nbStatsSensors, getTimeSinceStart(), &sensorStatsPacket);
+	fillLoopLatencyPacket(&loopLatencyPacket);
+	fillCANFilterStatsPacket(&canFilterStatsPacket);
+}
+
+/**
+ * \brief function to execute an OBDH telecommand that is
+ * not a main state (see TCDef).
+ *
+ * \param TC the telecommand
+ *
+ * \return statusErrDef that values:
+ * - errUnknownTC when the telecommand is not in TCDef
+ * - errWriteUDPTelem when the housekeeping packets can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef manageOBDHTC(uint16_t TC) {
+	statusErrDef ret = noError;
+	uint64_t timeStamp = getTimeSinceStart();
+
+	switch(TC) {
+		case TCReportSensorStats:
+			//the statistics belong to the pipeline processing stage
+			if(obdhPipelineRunning) {
+				requestOBDHPipelineTasks(pipelineTaskReportStats);
+				break;
+			}
+			ret = sendSensorStatsToTTC(timeStamp);
+			resetSensorStats(timeStamp);
+			break;
+		case TCResetSensorStats:
+			if(obdhPipelineRunning) {
+				requestOBDHPipelineTasks(pipelineTaskResetStats);
+				break;
+			}
+			resetSensorStats(timeStamp);
+			break;
+		case TCReloadParamSensors:
+			requestParamSensorsReload();
+			break;
+		case TCResetLoopLatency:
+			resetLoopLatency();
+			break;
+		case TCDumpTrace:
+			ret = dumpTrace();
+			if(ret == noError)
+				ret = sendTelemToTTC(infoTraceDumped);
+			break;
+		default:
+			ret = errUnknownTC;
+			break;
+	}
+	return ret;
+}
+
+/**
+ * \brief function to recieve telecommands from the TT&C subsystem
+ *
+ * \param withOBDHTC false to reject the OBDH telecommands that are
+ * not a main state (see manageOBDHTC())
+ *
+ * \return statusErrDef that values:
+ * - errTCToWrongSubsystem the subsystem indicated
+ * in the TC frame is not present in the function switch
+ * - errUnknownTC when an OBDH telecommand is neither a main
+ * state nor in TCDef
+ * - errTCDuringOBDHInit when an OBDH telecommand that is not
+ * a main state is rejected
+ * - errCCSDSPacketUninterpretable when the CAN frame is
+ * not interpretable as a CCSDS packet
+ * - errReadCANTC when CAN frame can't be read,
+ * - noError when the function exits successfully.
+ */
+statusErrDef recieveTCFromTTC(bool withOBDHTC) {
+	statusErrDef ret = noError;
+	uint16_t mainStateTCRecieved;
+	uint16_t mostSigHexDigitTC;
+	struct sockaddr_in clientAddr;
+    socklen_t addrLen = sizeof(clientAddr);
+    uint8_t buffer[UDP_MAX_BUFFER_SIZE];
+
+	ssize_t sizeReceived = recvfrom(socket_udp, buffer, UDP_MAX_BUFFER_SIZE, 0,(struct sockaddr*)&clientAddr,&addrLen);
+	if (sizeReceived > 0) {
+		std::cout << "Received " << sizeReceived << " bytes from cFS\n";
+		DumpUDPData(buffer, sizeReceived);
+		//constructs an empty instance
+		CCSDSSpacePacket ccsdsPacket;
+		//interpret an input data as a CCSDS SpacePacket
+		try {
+			// Attempt to interpret the packet
+			ccsdsPacket.interpret(buffer, sizeReceived);
+		} catch (CCSDSSpacePacketException &e) {
+			// Print the exception details to help debug
+			std::cerr << "CCSDS Packet Error: " << e.toString() << std::endl;
+			std::cerr << "Failed to interpret packet of length " << sizeReceived << std::endl;
+			// Optionally, dump the buffer contents for inspection
+			for (size_t i = 0; i < sizeReceived; i++) {
+				std::cout << std::hex << (int)buffer[i] << " ";
+			}
+			std::cout << std::endl;
+
+			return errCCSDSPacketUninterpretable;
+		}
+
+		std::vector<uint8_t> *userData = ccsdsPacket.getUserDataField();
+
+		mainStateTCRecieved = ((*userData)[0] << 8) | (*userData)[1];
+		mostSigHexDigitTC = mainStateTCRecieved & 0xF000;
+		traceEvent(traceTCReceived, mainStateTCRecieved);
+
+		switch(mostSigHexDigitTC) {
+			case OBDHSubsystem:
+				if(validStates.count(mainStateTCRecieved))
+					mainStateTC = mainStateTCRecieved;
+				else if(withOBDHTC)
+					ret = manageOBDHTC(mainStateTCRecieved);
+				else
+					ret = errTCDuringOBDHInit;
+				break;
+			case payloadSubsystem:
+				ret = sendTCToSubsystem(*userData, payloadSubsystem);
+				break;
+			case everySubsystems:
+				mainStateTC = mainStateTCRecieved & 0x0FFF;
+				ret = sendTCToSubsystem(*userData, everySubsystems);
+				break;
+			default:
+				return errTCToWrongSubsystem;
+				break;
+		}
+
+		//get APID
+		std::cout << ccsdsPacket.getPrimaryHeader()->getAPIDAsInteger() << std::endl;
+		//dump packet content
+		std::cout << ccsdsPacket.toString() << std::endl;
+	}
+	return ret;
+}
+
+/**
+ * \brief function to handle a frame sent by a subsystem, either
+ * sensor data or a CCSDS telemetry packet to forward to the
+ * TT&C subsystem.
+ *
+ * \param frame the frame accepted by the subsystem CAN filter
+ * \param sizeReceived the number of bytes read from the CAN socket
+ *
+ * \return statusErrDef that values:
+ * - errCCSDSPacketUninterpretable when the CAN frame is
+ * not interpretable as a CCSDS packet
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef handleSubsystemFrame(struct can_frame *frame, ssize_t sizeReceived) {
+	statusErrDef ret = noError;
+
+	//std::cout << "Received " << sizeReceived << " bytes from a subsystem\n";
+	if(frame->data[0] == 0xFF)
+	{
+		//printf("Sensor data recieved\n");
+		return manageSensorData(frame->data);
+	}
+
+	CCSDSSpacePacket ccsdsPacket;
+	//interpret an input data as a CCSDS SpacePacket
+	try {
+		// Attempt to interpret the packet
+		ccsdsPacket.interpret(frame->data, sizeReceived);
+	} catch (CCSDSSpacePacketException &e) {
+		// Print the exception details to help debug
+		std::cerr << "CCSDS Packet Error: " << e.toString() << std::endl;
+		std::cerr << "Failed to interpret packet of length " << sizeReceived << std::endl;
+		std::cout << std::endl;
+
+		return errCCSDSPacketUninterpretable;
+	}
+
+	std::vector<uint8_t> *userData = ccsdsPacket.getUserDataField();
+
+	ret = sendTelemToTTC(userData);
+
+	//get APID
+	std::cout << ccsdsPacket.getPrimaryHeader()->getAPIDAsInteger() << std::endl;
+	//dump packet content
+	std::cout << ccsdsPacket.toString() << std::endl;
+
+	return ret;
+}
+
+/**
+ * \brief function to recieve telemetry from all subsystems,
+ * the frame is dispatched to its subsystem handler through
+ * the CAN filter table.
+ *
+ * \return statusErrDef that values:
+ * - errCCSDSPacketUninterpretable when the CAN frame is
+ * not interpretable as a CCSDS packet
+ * - errReadCANTelem when CAN frame can't be read from the Payload subsystem,
+ * - noError when the function exits successfully.
+ */
+statusErrDef recieveTelemFromSubsystems() {
+	statusErrDef ret = noError;
+	struct can_frame frame;
+
+	ssize_t sizeReceived = read(socket_can, &frame, sizeof(struct can_frame));
+    if (sizeReceived > 0) {
+		ret = dispatchCANFrame(&frame, sizeReceived);
+    } else {
+		// If there's no data, just continue (EAGAIN or EWOULDBLOCK)
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return infoNoDataInCANBuffer;
+        } else {
+            perror("errReadCANTelem");
+            return errReadCANTelem;
+        }
+	}
+
+
+	return ret;
+}
+
+/**
+ * \brief function to send telecommands to the Payload subsystem.
+ *
+ * \param TCOut the telecommands to transmit to a CAN frame to
+ * the payload subsystem, cut in a vector of bytes.
+ *
+ * \param subsystem the spacecraft subsystem selected in the
+ * enumeration.
+ *
+ * \return statusErrDef that values:
+ * - errCCSDSPacketTooLarge when the CCSDS packet is too large for the CAN FD frame (64 Bytes),
+ * - errWriteCANPayload when write payload subsystem TCs to the CAN bus fails,
+ * - noError when the function exits successfully.
+ */
+statusErrDef sendTCToSubsystem(std::vector<uint8_t> TCOut, subsystemDef subsystem) {
+	statusErrDef ret = noError;
+	canid_t canId = 0x000;
+
+	switch(subsystem) {
+		case payloadSubsystem:
+				canId = CAN_ID_PAYLOAD;
+			break;
+		case everySubsystems:
+				canId = CAN_ID_BROADCAST;
+		default:
+			return errTCToWrongSubsystem;
+			break;
+	}
+
+	std::vector<uint8_t> ccsdsPacket = generateCCSDSPacket(TCOut);
+	if (ccsdsPacket.size() > DATA_OUT_CAN_MAX_LENGTH) {
+        std::cerr << "Error: CCSDS packet too large for single CAN FD frame\n";
+        return errCCSDSPacketTooLarge;
+    }
+
+    struct can_frame frame;
+    frame.can_id = canId;  // Set appropriate CAN ID
+    frame.len = ccsdsPacket.size();  // Payload length
+
+    std::memcpy(frame.data, ccsdsPacket.data(), ccsdsPacket.size());  // Copy CCSDS packet into frame
+
+    if (write(socket_can, &frame, sizeof(struct can_frame)) != sizeof(struct can_frame)) {
+        perror("errWriteCANTC");
+		return errWriteCANTC;
+    }
+    else {
+		std::cout << "Sent CCSDS packet (" << ccsdsPacket.size() << " bytes) in a single CAN FD frame\n";
+    }
+
+	return ret;
+}
+
+/**
+ * \brief function to compare the sensor current values with the warning
+ * and critical bounds declared in the paramSensors.csv file, without
+ * telemetry. Only the sensors whose value changed are checked again,
+ * sensorWarnMask and sensorCriticalMask hold every sensor out of its
+ * bounds afterwards (see getSensorLimitStatus()).
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog, errWriteSensorArchive or errWriteUDPTelem when
+ * a derived parameter value can't be recorded or sent (see updateDerivedSensors()),
+ * - noError when the function exits successfully.
+ */
+statusErrDef updateSensorLimits() {
+	statusErrDef ret = noError;
+	if(paramSensors == NULL)
+		return ret;
+
+	// Derived parameters join the dirty sensors before the check
+	ret = updateDerivedSensors();
+	// Only the sensors whose value changed since the last check
+	updateDirtySensorLimits(paramSensors);
+	return ret;
+}
+
+/**
+ * \brief function to send the result of a limit check to the TT&C
+ * subsystem, once per minor frame.
+ *
+ * \param status the limit check result (see getSensorLimitStatus())
+ *
+ * \return status.
+ */
+statusErrDef sendSensorLimitStatus(statusErrDef status) {
+	if(status == errSensorCriticalValue || status == errSensorWarningValue)
+		sendTelemToTTC(status);
+	return status;
+}
+
+/**
+ * \brief function to compare every sensor current values with the warning
+ * and critical bounds declared in the paramSensors.csv file, a sensor
+ * out of its bounds is sent as telemetry (see updateSensorLimits()).
+ *
+ * \return statusErrDef that values:
+ * - errSensorCriticalValue when at least one sensor has reached a minimum or maximum critical value from the paramSensors.csv file.
+ * - errSensorWarningValue when at least one sensor has reached a minimum or maximum warning value from the paramSensors.csv file.
+ * - errWriteSensorLog, errWriteSensorArchive or errWriteUDPTelem when
+ * a derived parameter value can't be recorded or sent (see updateDerivedSensors()),
+ * - noError when the function exits successfully.
+ */
+statusErrDef compareSensorValuesWithParam() {
+	statusErrDef ret = updateSensorLimits();
+	statusErrDef limitRet = getSensorLimitStatus();
+	if(limitRet == noError)
+		return ret;
+
+	// A sensor out of its bounds is returned, a derived parameter error is then only sent
+	if(ret != noError)
+		sendTelemToTTC(ret);
+	return sendSensorLimitStatus(limitRet);
+}
+
+/**
+ * \brief function to report the sensors that have sent no reading
+ * for SENSOR_STALE_MISSED_PERIODS expected periods, each newly stale
+ * sensor is sent once to the TT&C subsystem until its next reading.
+ *
+ * \param timeStamp the time since start in microseconds
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the stale sensor status can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef checkStaleSensors(uint64_t timeStamp) {
+	statusErrDef ret = noError;
+	static uint16_t stale[MAX_SENSORS];
+	if(paramSensors == NULL)
+		return ret;
+
+	int nbStale = checkSensorStaleness(timeStamp, stale, MAX_SENSORS);
+	for(int s = 0; s < nbStale; s++) {
+		statusErrDef sendRet = sendSensorStatusToTTC(errSensorStale, paramSensors->id[stale[s]]);
+		if(ret == noError)
+			ret = sendRet;
+	}
+	return ret;
+}
+
+/**
+ * \brief function to recieve sensor telemetry data from
+ * every spacecraft subsystems and check if their values
+ * are out of bounds, run in every minor frame. Sensor bounds
+ * reloaded from the parameters file are taken at the start
+ * of the cycle. The queued raw samples are calibrated before
+ * every limit check. While the OBDH pipeline runs, its
+ * processing stage does this and the last limit check is sent
+ * and returned.
+ *
+ * \return statusErrDef that values:
+ * - errSensorWarningValue or errSensorCriticalValue when a sensor
+ * is out of bounds,
+ * - errReadCANTelem when CAN frame can't be read,
+ * - errWriteSensorLog, errWriteSensorArchive or errWriteUDPTelem when
+ * a calibrated sample can't be recorded or sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef checkSensors() {
+	statusErrDef ret = noError;
+	// The processing stage only computes the limit status, it is sent once per frame
+	if(obdhPipelineRunning)
+		return sendSensorLimitStatus(getOBDHPipelineLimitStatus());
+	// New sensor bounds are taken between two limit checks
+	statusErrDef reloadRet = applyParamSensorsReload();
+	if(reloadRet != noError)
+		sendTelemToTTC(reloadRet);
+	ret = recieveTelemFromSubsystems();
+	if(ret == infoNoDataInCANBuffer)
+		ret = noError;
+	// The samples are calibrated in every cycle, even after a read error
+	statusErrDef flushRet = flushCalibratedSensors();
+	statusErrDef limitRet = compareSensorValuesWithParam();
+	if(limitRet == errSensorWarningValue || limitRet == errSensorCriticalValue)
+		return limitRet;
+	if(ret == noError)
+		ret = flushRet;
+	if(ret == noError)
+		ret = limitRet;
+	return ret;
+}
+
+/**
+ * \brief function to run the sensor housekeeping, every
+ * HOUSEKEEPING_FRAME_PERIOD minor frames: the sensor log is
+ * synchronised and the sensor housekeeping is run (see
+ * runSensorHousekeeping()). While the OBDH pipeline runs, the
+ * logging stage synchronises the sensor log and the processing
+ * stage is asked to run the sensor housekeeping.
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the sensor log buffer can't be written to the file
+ * - errWriteUDPTelem when the stale sensors or the sensor
+ * statistics can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef runHousekeeping() {
+	statusErrDef ret = noError;
+	uint64_t timeStamp = getTimeSinceStart();
+	if(obdhPipelineRunning) {
+		requestOBDHPipelineTasks(pipelineTaskHousekeeping);
+		return ret;
+	}
+	ret = pollSensorLog(timeStamp);
+	if(ret != noError)
+		return ret;
+	ret = runSensorHousekeeping(timeStamp);
+	return ret;
+}
+
+/**
+ * \brief function to report the sensors without reading as stale
+ * and to send the sensor statistics and the CAN frame counters at
+ * the end of every reporting window.
+ *
+ * \param timeStamp the time since start in microseconds
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the stale sensors, the sensor
+ * statistics or the CAN frame counters can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef runSensorHousekeeping(uint64_t timeStamp) {
+	statusErrDef ret = noError;
+	ret = checkStaleSensors(timeStamp);
+	if(ret != noError)
+		return ret;
+	if(timeStamp - sensorStatsWindowStart >= SENSOR_STATS_REPORT_PERIOD) {
+		ret = sendSensorStatsToTTC(timeStamp);
+		resetSensorStats(timeStamp);
+		statusErrDef canRet = sendCANFilterStatsToTTC();
+		resetCANFilterStats();
+		if(ret == noError)
+			ret = canRet;
+	}
+	return ret;
+}
+
+/**
+ * \brief function to send the loop latency housekeeping packet and
+ * to start a new window every LOOP_LATENCY_REPORT_PERIOD, a cyclic
+ * task of the control mode.
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the packet can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef reportLoopLatency() {
+	statusErrDef ret = noError;
+	if(!isLoopLatencyWindowEnded())
+		return ret;
+	ret = sendLoopLatencyToTTC();
+	resetLoopLatency();
+	return ret;
+}
+
+/**
+ * \brief function to recieve telecommands from the TT&C subsystem
+ * and redirect sensor data as telemetry to the TT&C subsystem.
+ *
+ * \return statusErrDef that values:
+ * - errReadCANTC when CAN frame can't be read,
+ * - errWriteUDPTelem when the telemetry can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef checkTC() {
+	counter++;
+	if(counter >= 255)
+		counter = 0;
+	statusErrDef ret = noError;
+	ret = recieveTCFromTTC(true);
+	if(ret != noError)
+		return ret;
+	/*
+	ret = sendSensorDataToTTC(sensor1, {counter});
+	if(ret != noError)
+		return ret;
+	ret = sendSensorDataToTTC(sensor2, {0xF1, counter});
+	if(ret != noError)
+		return ret;
+	ret = sendSensorDataToTTC(sensor3, {0xF1, 0xF2, 0xF3, counter});
+	*/
+	return ret;
+}
+
+/**
+ * \brief function to recieve telecommands from the TT&C subsystem
+ * while the OBDH initialisation runs: the sensor tables may still be
+ * freed and allocated again, so only the main state telecommands
+ * are accepted.
+ *
+ * \return statusErrDef that values:
+ * - errTCDuringOBDHInit when another OBDH telecommand is rejected,
+ * - errReadCANTC when CAN frame can't be read,
+ * - noError when the function exits successfully.
+ */
+statusErrDef checkStateTC() {
+	return recieveTCFromTTC(false);
+}
@@ -0,0 +1,110 @@
+/**
+ * \file cyclicExec.cpp
+ * \brief cyclic executive functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Cyclic executive functions, the deadlines are kept in nanoseconds of
+ * CLOCK_MONOTONIC and the frames sleep until them with
+ * clock_nanosleep(TIMER_ABSTIME).
+ *
+ */
+#include "cyclicExec.h"
+
+#include <errno.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief deadlines and timing statistics of the minor frames.
+ */
+struct cyclicExecStruct cyclicExec;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static uint64_t getCyclicExecTime();
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getCyclicExecTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to start the first minor frame now and to
+ * reset the timing statistics.
+ */
+void initCyclicExec() {
+    memset(&cyclicExec, 0, sizeof(cyclicExec));
+    cyclicExec.deadline = getCyclicExecTime();
+    cyclicExec.frameStart = cyclicExec.deadline;
+    cyclicExec.lastOverrunReport = UINT64_MAX;
+}
+
+/**
+ * \brief function to end the current minor frame and to sleep until
+ * the start of the next one. After an overrun, the frames whose start
+ * has passed are skipped.
+ *
+ * \return statusErrDef that values:
+ * - errFrameOverrun when the frame has ended after the next deadline,
+ * once per major frame (every overrun is counted),
+ * - noError when the function exits successfully.
+ */
+statusErrDef waitNextMinorFrame() {
+    statusErrDef ret = noError;
+    uint64_t now = getCyclicExecTime();
+    recordHistogram(&cyclicExec.execTime, now - cyclicExec.frameStart);
+
+    cyclicExec.deadline += MAIN_LOOP_TIME;
+    cyclicExec.nbFrames++;
+    if (now > cyclicExec.deadline) {
+        uint64_t skipped = (now - cyclicExec.deadline) / MAIN_LOOP_TIME + 1;
+        cyclicExec.deadline += skipped * MAIN_LOOP_TIME;
+        cyclicExec.nbFrames += skipped;
+        cyclicExec.nbSkippedFrames += skipped;
+        cyclicExec.nbOverruns++;
+        uint64_t majorFrame = cyclicExec.nbFrames / MAJOR_FRAME_MINOR_FRAMES;
+        if (majorFrame != cyclicExec.lastOverrunReport) {
+            cyclicExec.lastOverrunReport = majorFrame;
+            ret = errFrameOverrun;
+        }
+    }
+
+    struct timespec deadline;
+    deadline.tv_sec = (time_t)(cyclicExec.deadline / 1000000000ULL);
+    deadline.tv_nsec = (long)(cyclicExec.deadline % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        ;
+
+    cyclicExec.frameStart = getCyclicExecTime();
+    recordHistogram(&cyclicExec.startJitter, cyclicExec.frameStart - cyclicExec.deadline);
+    return ret;
+}
+
+/**
+ * \brief function to print the number of frames and overruns, the
+ * start jitter and the execution time of the minor frames.
+ */
+void printCyclicExecStats() {
+    printf("minor frames: %llu, overruns %llu, skipped frames %llu\n",
+           (unsigned long long)cyclicExec.nbFrames, (unsigned long long)cyclicExec.nbOverruns,
+           (unsigned long long)cyclicExec.nbSkippedFrames);
+    printHistogram(&cyclicExec.startJitter, "frame start jitter", "ns");
+    printHistogram(&cyclicExec.execTime, "frame execution time", "ns");
+}
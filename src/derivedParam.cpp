@@ -0,0 +1,789 @@
+/**
+ * \file derivedParam.cpp
+ * \brief derived parameters functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Derived parameters functions, the expressions of paramSensors.csv are
+ * compiled once at load time into register machine instructions, the
+ * derived parameters are ordered so that a derived parameter is always
+ * evaluated after the derived parameters it depends on.
+ *
+ */
+#include "derivedParam.h"
+#include "limitCheck.h"
+
+//------------------------------------------------------------------------------
+// Local structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \enum derivedOpCodeDef
+ * \brief the register machine operations
+ *
+ */
+enum derivedOpCodeDef {
+    derivedLoadSensor,                      /**< destination = currentValue[operand] */
+    derivedLoadConstant,                    /**< destination = operand */
+    derivedAdd,                             /**< destination = left + right */
+    derivedSub,                             /**< destination = left - right */
+    derivedMul,                             /**< destination = left * right */
+    derivedDiv,                             /**< destination = left / right */
+    derivedNeg,                             /**< destination = -left */
+    derivedMin,                             /**< destination = min(left, right) */
+    derivedMax,                             /**< destination = max(left, right) */
+    derivedAbs                              /**< destination = |left| */
+};
+
+/**
+ * \struct derivedParserStruct
+ * \brief state of the compilation of one expression
+ *
+ */
+struct derivedParserStruct {
+    const char *cursor;                     /**< Next character to read */
+    int sensorIndex;                        /**< Index of the derived parameter being compiled */
+    struct derivedInstructionStruct *code;  /**< Instructions buffer */
+    int nbInstructions;                     /**< Number of instructions in the buffer */
+    uint16_t *references;                   /**< Sensors read by the expressions */
+    int nbReferences;                       /**< Number of sensors in references */
+    int firstReference;                     /**< First reference of the expression being compiled */
+};
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static statusErrDef compileDerivedExpression(struct derivedParserStruct *parser, const char *source);
+static bool parseDerivedSum(struct derivedParserStruct *parser, int reg);
+static bool parseDerivedProduct(struct derivedParserStruct *parser, int reg);
+static bool parseDerivedUnary(struct derivedParserStruct *parser, int reg);
+static bool parseDerivedPrimary(struct derivedParserStruct *parser, int reg);
+static bool parseDerivedFunction(struct derivedParserStruct *parser, int reg, const char *name, size_t length);
+static bool emitDerivedInstruction(struct derivedParserStruct *parser, uint8_t opCode, int destination,
+                                   int left, int right, int32_t operand);
+static bool failDerivedExpression(struct derivedParserStruct *parser, const char *message);
+static void skipDerivedBlanks(struct derivedParserStruct *parser);
+static int64_t addDerivedSaturated(int64_t left, int64_t right);
+static int64_t subDerivedSaturated(int64_t left, int64_t right);
+static int64_t mulDerivedSaturated(int64_t left, int64_t right);
+static void freeDerivedCode();
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief number of derived parameters in paramSensors.csv.
+ */
+int nbDerivedParameters = 0;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief expression text of every derived parameter read from
+ * paramSensors.csv, NULL for the sensors.
+ */
+static char *derivedSources[MAX_SENSORS];
+
+/**
+ * \brief position of every sensor in the evaluation order,
+ * -1 for the sensors that are not derived parameters.
+ */
+static int16_t derivedPosition[MAX_SENSORS];
+
+/**
+ * \brief sensor index of the derived parameters, in evaluation order.
+ */
+static uint16_t *derivedSensor = NULL;
+
+/**
+ * \brief first instruction of the derived parameters, in evaluation
+ * order (nbDerivedParameters + 1 entries).
+ */
+static uint32_t *derivedCodeStart = NULL;
+
+/**
+ * \brief compiled instructions of every derived parameter.
+ */
+static struct derivedInstructionStruct *derivedCode = NULL;
+
+/**
+ * \brief first dependent of every sensor in derivedDependents
+ * (nbSensors + 1 entries).
+ */
+static uint32_t *derivedDependentStart = NULL;
+
+/**
+ * \brief positions of the derived parameters reading each sensor.
+ */
+static uint16_t *derivedDependents = NULL;
+
+/**
+ * \brief one bit per derived parameter position that has to be evaluated.
+ */
+static uint64_t derivedPendingMask[SENSOR_MASK_WORDS];
+
+/**
+ * \brief number of sensors given to compileDerivedParameters().
+ */
+static int nbDerivedSensors = 0;
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to add two registers, saturated to the int64 range.
+ *
+ * \param left the first operand
+ * \param right the second operand
+ *
+ * \return left + right, INT64_MIN or INT64_MAX on an overflow.
+ */
+static int64_t addDerivedSaturated(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_add_overflow(left, right, &result))
+        return (left < 0) ? INT64_MIN : INT64_MAX;
+    return result;
+}
+
+/**
+ * \brief function to subtract two registers, saturated to the int64 range.
+ *
+ * \param left the first operand
+ * \param right the second operand
+ *
+ * \return left - right, INT64_MIN or INT64_MAX on an overflow.
+ */
+static int64_t subDerivedSaturated(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_sub_overflow(left, right, &result))
+        return (left < 0) ? INT64_MIN : INT64_MAX;
+    return result;
+}
+
+/**
+ * \brief function to multiply two registers, saturated to the int64 range.
+ *
+ * \param left the first operand
+ * \param right the second operand
+ *
+ * \return left * right, INT64_MIN or INT64_MAX on an overflow.
+ */
+static int64_t mulDerivedSaturated(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_mul_overflow(left, right, &result))
+        return ((left < 0) != (right < 0)) ? INT64_MIN : INT64_MAX;
+    return result;
+}
+
+/**
+ * \brief function to print a compilation error with the
+ * expression position.
+ *
+ * \param parser the compilation state
+ * \param message the error description
+ *
+ * \return false, to be returned by the parsing functions.
+ */
+static bool failDerivedExpression(struct derivedParserStruct *parser, const char *message) {
+    printf("Sensor %d: derived expression \"%s\": %s at \"%s\"\n", parser->sensorIndex,
+           derivedSources[parser->sensorIndex], message, parser->cursor);
+    return false;
+}
+
+/**
+ * \brief function to skip the blanks of an expression.
+ *
+ * \param parser the compilation state
+ */
+static void skipDerivedBlanks(struct derivedParserStruct *parser) {
+    while (*parser->cursor == ' ' || *parser->cursor == '\t' || *parser->cursor == '\r')
+        parser->cursor++;
+}
+
+/**
+ * \brief function to append an instruction to the compiled code.
+ *
+ * \param parser the compilation state
+ * \param opCode the operation (see derivedOpCodeDef)
+ * \param destination the result register
+ * \param left the first operand register
+ * \param right the second operand register
+ * \param operand the sensor index or the constant of the load operations
+ *
+ * \return false when a register or the instructions buffer is exhausted.
+ */
+static bool emitDerivedInstruction(struct derivedParserStruct *parser, uint8_t opCode, int destination,
+                                   int left, int right, int32_t operand) {
+    if (destination >= DERIVED_MAX_REGISTERS || right >= DERIVED_MAX_REGISTERS)
+        return failDerivedExpression(parser, "expression nested too deeply");
+    if (parser->nbInstructions >= DERIVED_MAX_INSTRUCTIONS)
+        return failDerivedExpression(parser, "too many instructions");
+    struct derivedInstructionStruct *instruction = &parser->code[parser->nbInstructions++];
+    instruction->opCode = opCode;
+    instruction->destination = (uint8_t)destination;
+    instruction->left = (uint8_t)left;
+    instruction->right = (uint8_t)right;
+    instruction->operand = operand;
+    return true;
+}
+
+/**
+ * \brief function to compile a sum: product {(+|-) product}.
+ * The result is left in the register reg, the registers
+ * above reg are free for the operands.
+ *
+ * \param parser the compilation state
+ * \param reg the result register
+ *
+ * \return false on a compilation error.
+ */
+static bool parseDerivedSum(struct derivedParserStruct *parser, int reg) {
+    if (!parseDerivedProduct(parser, reg))
+        return false;
+    skipDerivedBlanks(parser);
+    while (*parser->cursor == '+' || *parser->cursor == '-') {
+        uint8_t opCode = (*parser->cursor == '+') ? derivedAdd : derivedSub;
+        parser->cursor++;
+        if (!parseDerivedProduct(parser, reg + 1) ||
+            !emitDerivedInstruction(parser, opCode, reg, reg, reg + 1, 0))
+            return false;
+        skipDerivedBlanks(parser);
+    }
+    return true;
+}
+
+/**
+ * \brief function to compile a product: unary {(*|/) unary}.
+ *
+ * \param parser the compilation state
+ * \param reg the result register
+ *
+ * \return false on a compilation error.
+ */
+static bool parseDerivedProduct(struct derivedParserStruct *parser, int reg) {
+    if (!parseDerivedUnary(parser, reg))
+        return false;
+    skipDerivedBlanks(parser);
+    while (*parser->cursor == '*' || *parser->cursor == '/') {
+        uint8_t opCode = (*parser->cursor == '*') ? derivedMul : derivedDiv;
+        parser->cursor++;
+        if (!parseDerivedUnary(parser, reg + 1) ||
+            !emitDerivedInstruction(parser, opCode, reg, reg, reg + 1, 0))
+            return false;
+        skipDerivedBlanks(parser);
+    }
+    return true;
+}
+
+/**
+ * \brief function to compile a unary expression: -unary or primary.
+ *
+ * \param parser the compilation state
+ * \param reg the result register
+ *
+ * \return false on a compilation error.
+ */
+static bool parseDerivedUnary(struct derivedParserStruct *parser, int reg) {
+    skipDerivedBlanks(parser);
+    if (*parser->cursor == '-') {
+        parser->cursor++;
+        return parseDerivedUnary(parser, reg) &&
+               emitDerivedInstruction(parser, derivedNeg, reg, reg, 0, 0);
+    }
+    return parseDerivedPrimary(parser, reg);
+}
+
+/**
+ * \brief function to compile a primary expression: (sum), a sensor
+ * ID in hexadecimal, a decimal constant or a function call.
+ *
+ * \param parser the compilation state
+ * \param reg the result register
+ *
+ * \return false on a compilation error.
+ */
+static bool parseDerivedPrimary(struct derivedParserStruct *parser, int reg) {
+    skipDerivedBlanks(parser);
+    const char *start = parser->cursor;
+
+    if (*start == '(') {
+        parser->cursor++;
+        if (!parseDerivedSum(parser, reg))
+            return false;
+        skipDerivedBlanks(parser);
+        if (*parser->cursor != ')')
+            return failDerivedExpression(parser, "')' expected");
+        parser->cursor++;
+        return true;
+    }
+
+    if (start[0] == '0' && (start[1] == 'x' || start[1] == 'X')) {
+        char *end;
+        unsigned long sensorId = strtoul(start, &end, 16);
+        if (end == start + 2 || sensorId >= SENSOR_INDEX_LUT_SIZE || getSensorIndex((uint16_t)sensorId) < 0)
+            return failDerivedExpression(parser, "unknown sensor ID");
+        int index = getSensorIndex((uint16_t)sensorId);
+        parser->cursor = end;
+        // Each sensor is referenced once per expression
+        bool known = false;
+        for (int r = parser->firstReference; r < parser->nbReferences; r++)
+            known |= (parser->references[r] == index);
+        if (!known)
+            parser->references[parser->nbReferences++] = (uint16_t)index;
+        return emitDerivedInstruction(parser, derivedLoadSensor, reg, 0, 0, index);
+    }
+
+    if (*start >= '0' && *start <= '9') {
+        char *end;
+        long long constant = strtoll(start, &end, 10);
+        if (constant > INT32_MAX)
+            return failDerivedExpression(parser, "constant out of the int32 range");
+        parser->cursor = end;
+        return emitDerivedInstruction(parser, derivedLoadConstant, reg, 0, 0, (int32_t)constant);
+    }
+
+    size_t length = 0;
+    while ((start[length] >= 'a' && start[length] <= 'z') || (start[length] >= 'A' && start[length] <= 'Z'))
+        length++;
+    if (length == 0)
+        return failDerivedExpression(parser, "operand expected");
+    parser->cursor += length;
+    return parseDerivedFunction(parser, reg, start, length);
+}
+
+/**
+ * \brief function to compile a function call: min, max and avg of
+ * one or more arguments, abs of one argument.
+ *
+ * \param parser the compilation state
+ * \param reg the result register
+ * \param name the function name (not null terminated)
+ * \param length the function name length
+ *
+ * \return false on a compilation error.
+ */
+static bool parseDerivedFunction(struct derivedParserStruct *parser, int reg, const char *name, size_t length) {
+    uint8_t opCode;
+    if (length == 3 && strncmp(name, "min", 3) == 0)
+        opCode = derivedMin;
+    else if (length == 3 && strncmp(name, "max", 3) == 0)
+        opCode = derivedMax;
+    else if (length == 3 && strncmp(name, "avg", 3) == 0)
+        opCode = derivedAdd;
+    else if (length == 3 && strncmp(name, "abs", 3) == 0)
+        opCode = derivedAbs;
+    else {
+        parser->cursor = name;
+        return failDerivedExpression(parser, "unknown function");
+    }
+
+    skipDerivedBlanks(parser);
+    if (*parser->cursor != '(')
+        return failDerivedExpression(parser, "'(' expected");
+    parser->cursor++;
+    if (!parseDerivedSum(parser, reg))
+        return false;
+    int nbArguments = 1;
+    skipDerivedBlanks(parser);
+    while (*parser->cursor == ',') {
+        parser->cursor++;
+        if (opCode == derivedAbs)
+            return failDerivedExpression(parser, "abs takes one argument");
+        if (!parseDerivedSum(parser, reg + 1) ||
+            !emitDerivedInstruction(parser, opCode, reg, reg, reg + 1, 0))
+            return false;
+        nbArguments++;
+        skipDerivedBlanks(parser);
+    }
+    if (*parser->cursor != ')')
+        return failDerivedExpression(parser, "')' expected");
+    parser->cursor++;
+
+    if (opCode == derivedAbs)
+        return emitDerivedInstruction(parser, derivedAbs, reg, reg, 0, 0);
+    if (name[1] == 'v') // avg: sum of the arguments divided by their count
+        return emitDerivedInstruction(parser, derivedLoadConstant, reg + 1, 0, 0, nbArguments) &&
+               emitDerivedInstruction(parser, derivedDiv, reg, reg, reg + 1, 0);
+    return true;
+}
+
+/**
+ * \brief function to compile one derived parameter expression
+ * at the end of the instructions buffer.
+ *
+ * \param parser the compilation state
+ * \param source the expression text, without the leading '='
+ *
+ * \return statusErrDef that values:
+ * - errInvalidDerivedExpression when the expression can't be compiled
+ * - noError when the function exits successfully.
+ */
+static statusErrDef compileDerivedExpression(struct derivedParserStruct *parser, const char *source) {
+    parser->cursor = source;
+    parser->firstReference = parser->nbReferences;
+    if (!parseDerivedSum(parser, 0))
+        return errInvalidDerivedExpression;
+    skipDerivedBlanks(parser);
+    if (*parser->cursor != '\0') {
+        failDerivedExpression(parser, "unexpected character");
+        return errInvalidDerivedExpression;
+    }
+    return noError;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to keep the expression of a derived parameter
+ * read from paramSensors.csv until compileDerivedParameters().
+ *
+ * \param index the sensor index
+ * \param expression the expression text, without the leading '='
+ * \param length the expression length
+ *
+ * \return statusErrDef that values:
+ * - errInvalidDerivedExpression when the expression can't be copied
+ * - noError when the function exits successfully.
+ */
+statusErrDef setDerivedExpression(int index, const char *expression, size_t length) {
+    if (index < 0 || index >= MAX_SENSORS)
+        return errInvalidDerivedExpression;
+    free(derivedSources[index]);
+    derivedSources[index] = strndup(expression, length);
+    if (derivedSources[index] == NULL)
+        return errInvalidDerivedExpression;
+    return noError;
+}
+
+/**
+ * \brief function to take back the expression of a sensor before it
+ * is compiled, the sensor is no longer a derived parameter.
+ *
+ * \param index the sensor index
+ *
+ * \return the expression text, to be freed by the caller,
+ * or NULL when the sensor has no expression.
+ */
+char *takeDerivedExpression(int index) {
+    if (index < 0 || index >= MAX_SENSORS)
+        return NULL;
+    char *expression = derivedSources[index];
+    derivedSources[index] = NULL;
+    return expression;
+}
+
+/**
+ * \brief function to compare an expression of paramSensors.csv with
+ * the expression of a sensor, to find the expressions changed in a
+ * reloaded file.
+ *
+ * \param index the sensor index
+ * \param expression the expression text without the leading '=',
+ * NULL when the sensor is not a derived parameter in the file
+ * \param length the expression length
+ *
+ * \return true when the text is the expression in use.
+ */
+bool isSameDerivedExpression(int index, const char *expression, size_t length) {
+    if (index < 0 || index >= MAX_SENSORS)
+        return false;
+    if (expression == NULL || derivedSources[index] == NULL)
+        return expression == NULL && derivedSources[index] == NULL;
+    return strlen(derivedSources[index]) == length && memcmp(derivedSources[index], expression, length) == 0;
+}
+
+/**
+ * \brief function to compile every derived parameter expression and
+ * to sort the derived parameters in evaluation order. Every derived
+ * parameter is evaluated at the first evaluateDerivedParameters() call.
+ *
+ * \param param the sensors parameters, with the sensor index lookup table filled
+ * \param nbSensors the number of sensors
+ *
+ * \return statusErrDef that values:
+ * - errInvalidDerivedExpression when an expression can't be compiled, reads
+ * an unknown sensor or when derived parameters depend on each other in a cycle
+ * - errAllocParamSensorStruct when the compiled code cannot be allocated
+ * - noError when the function exits successfully.
+ */
+statusErrDef compileDerivedParameters(const struct paramSensorsStruct *param, int nbSensors) {
+    statusErrDef ret = noError;
+    (void)param;
+
+    // A retried init compiles the expressions again
+    freeDerivedCode();
+    nbDerivedSensors = nbSensors;
+    for (int i = 0; i < nbSensors; i++)
+        if (derivedSources[i] != NULL)
+            derivedPosition[i] = (int16_t)nbDerivedParameters++;
+    if (nbDerivedParameters == 0)
+        return ret;
+
+    // Expressions are compiled in file order in scratch buffers
+    struct derivedParserStruct parser;
+    parser.code = (struct derivedInstructionStruct*)malloc(DERIVED_MAX_INSTRUCTIONS * sizeof(struct derivedInstructionStruct));
+    parser.references = (uint16_t*)malloc(DERIVED_MAX_INSTRUCTIONS * sizeof(uint16_t));
+    uint32_t *fileCodeStart = (uint32_t*)malloc((nbDerivedParameters + 1) * sizeof(uint32_t));
+    uint32_t *fileReferenceStart = (uint32_t*)malloc((nbDerivedParameters + 1) * sizeof(uint32_t));
+    uint16_t *fileSensor = (uint16_t*)malloc(nbDerivedParameters * sizeof(uint16_t));
+    int *nbInputs = (int*)calloc(nbDerivedParameters, sizeof(int));
+    int *order = (int*)malloc(nbDerivedParameters * sizeof(int));
+    derivedSensor = (uint16_t*)malloc(nbDerivedParameters * sizeof(uint16_t));
+    derivedCodeStart = (uint32_t*)malloc((nbDerivedParameters + 1) * sizeof(uint32_t));
+    derivedCode = (struct derivedInstructionStruct*)malloc(DERIVED_MAX_INSTRUCTIONS * sizeof(struct derivedInstructionStruct));
+    derivedDependentStart = (uint32_t*)calloc(nbSensors + 1, sizeof(uint32_t));
+    derivedDependents = (uint16_t*)malloc(DERIVED_MAX_INSTRUCTIONS * sizeof(uint16_t));
+    if (parser.code == NULL || parser.references == NULL || fileCodeStart == NULL ||
+        fileReferenceStart == NULL || fileSensor == NULL || nbInputs == NULL || order == NULL ||
+        derivedSensor == NULL || derivedCodeStart == NULL || derivedCode == NULL ||
+        derivedDependentStart == NULL || derivedDependents == NULL) {
+        perror("errAllocParamSensorStruct");
+        ret = errAllocParamSensorStruct;
+        goto cleanup;
+    }
+
+    parser.nbInstructions = 0;
+    parser.nbReferences = 0;
+    for (int i = 0, k = 0; i < nbSensors; i++) {
+        if (derivedSources[i] == NULL)
+            continue;
+        fileCodeStart[k] = parser.nbInstructions;
+        fileReferenceStart[k] = parser.nbReferences;
+        fileSensor[k] = (uint16_t)i;
+        parser.sensorIndex = i;
+        ret = compileDerivedExpression(&parser, derivedSources[i]);
+        if (ret != noError)
+            goto cleanup;
+        k++;
+    }
+    fileCodeStart[nbDerivedParameters] = parser.nbInstructions;
+    fileReferenceStart[nbDerivedParameters] = parser.nbReferences;
+
+    // Kahn's algorithm: a derived parameter is ready once every
+    // derived parameter it reads has been ordered
+    for (int k = 0; k < nbDerivedParameters; k++)
+        for (uint32_t r = fileReferenceStart[k]; r < fileReferenceStart[k + 1]; r++)
+            if (derivedPosition[parser.references[r]] >= 0)
+                nbInputs[k]++;
+    {
+        int nbOrdered = 0;
+        for (int k = 0; k < nbDerivedParameters; k++)
+            if (nbInputs[k] == 0)
+                order[nbOrdered++] = k;
+        for (int head = 0; head < nbOrdered; head++) {
+            uint16_t sensor = fileSensor[order[head]];
+            for (int k = 0; k < nbDerivedParameters; k++)
+                for (uint32_t r = fileReferenceStart[k]; r < fileReferenceStart[k + 1]; r++)
+                    if (parser.references[r] == sensor && --nbInputs[k] == 0)
+                        order[nbOrdered++] = k;
+        }
+        if (nbOrdered < nbDerivedParameters) {
+            for (int k = 0; k < nbDerivedParameters; k++)
+                if (nbInputs[k] > 0)
+                    printf("Sensor %d: derived expression \"%s\" is part of a dependency cycle\n",
+                           fileSensor[k], derivedSources[fileSensor[k]]);
+            ret = errInvalidDerivedExpression;
+            goto cleanup;
+        }
+    }
+
+    // Copy the code in evaluation order
+    {
+        uint32_t nbInstructions = 0;
+        for (int p = 0; p < nbDerivedParameters; p++) {
+            int k = order[p];
+            derivedSensor[p] = fileSensor[k];
+            derivedPosition[fileSensor[k]] = (int16_t)p;
+            derivedCodeStart[p] = nbInstructions;
+            uint32_t length = fileCodeStart[k + 1] - fileCodeStart[k];
+            memcpy(&derivedCode[nbInstructions], &parser.code[fileCodeStart[k]],
+                   length * sizeof(struct derivedInstructionStruct));
+            nbInstructions += length;
+        }
+        derivedCodeStart[nbDerivedParameters] = nbInstructions;
+    }
+
+    // Dependents of every sensor, in compressed rows
+    for (int r = 0; r < parser.nbReferences; r++)
+        derivedDependentStart[parser.references[r] + 1]++;
+    for (int i = 0; i < nbSensors; i++)
+        derivedDependentStart[i + 1] += derivedDependentStart[i];
+    {
+        // Fill each row with a running cursor
+        uint32_t *cursor = (uint32_t*)malloc(nbSensors * sizeof(uint32_t));
+        if (cursor == NULL) {
+            ret = errAllocParamSensorStruct;
+            goto cleanup;
+        }
+        memcpy(cursor, derivedDependentStart, nbSensors * sizeof(uint32_t));
+        for (int k = 0; k < nbDerivedParameters; k++)
+            for (uint32_t r = fileReferenceStart[k]; r < fileReferenceStart[k + 1]; r++)
+                derivedDependents[cursor[parser.references[r]]++] = (uint16_t)derivedPosition[fileSensor[k]];
+        free(cursor);
+    }
+
+    // Every derived parameter is computed once at start
+    for (int p = 0; p < nbDerivedParameters; p++)
+        derivedPendingMask[p >> 6] |= (uint64_t)1 << (p & 63);
+    printf("%d derived parameters, %u instructions\n", nbDerivedParameters,
+           derivedCodeStart[nbDerivedParameters]);
+
+cleanup:
+    free(parser.code);
+    free(parser.references);
+    free(fileCodeStart);
+    free(fileReferenceStart);
+    free(fileSensor);
+    free(nbInputs);
+    free(order);
+    if (ret != noError) {
+        freeDerivedParameters();
+    }
+    return ret;
+}
+
+/**
+ * \brief function to evaluate the derived parameters that read a sensor
+ * marked dirty since the last call (see markSensorDirty()). A derived
+ * parameter whose value changes is marked dirty too, so that its bounds
+ * are checked and the derived parameters reading it are evaluated.
+ * No memory is allocated.
+ *
+ * \param param the sensors parameters
+ * \param changed the array filled with the index of the derived parameters whose value changed
+ * \param maxChanged the size of the changed array
+ *
+ * \return the number of derived parameters whose value changed.
+ */
+int evaluateDerivedParameters(struct paramSensorsStruct *param, uint16_t *changed, int maxChanged) {
+    int nbChanged = 0;
+    if (nbDerivedParameters == 0)
+        return nbChanged;
+
+    for (int d = 0; d < nbDirtySensors; d++) {
+        uint16_t sensor = sensorDirtyList[d];
+        for (uint32_t r = derivedDependentStart[sensor]; r < derivedDependentStart[sensor + 1]; r++)
+            derivedPendingMask[derivedDependents[r] >> 6] |= (uint64_t)1 << (derivedDependents[r] & 63);
+    }
+
+    // Dependents always come later in the evaluation order,
+    // so a single ascending pass reaches them
+    int64_t reg[DERIVED_MAX_REGISTERS];
+    for (int w = 0; w < SENSOR_MASK_WORDS; w++) {
+        while (derivedPendingMask[w] != 0) {
+            int p = (w << 6) + __builtin_ctzll(derivedPendingMask[w]);
+            derivedPendingMask[w] &= derivedPendingMask[w] - 1;
+
+            bool valid = true;
+            const struct derivedInstructionStruct *instruction = &derivedCode[derivedCodeStart[p]];
+            const struct derivedInstructionStruct *end = &derivedCode[derivedCodeStart[p + 1]];
+            for (; instruction < end; instruction++) {
+                int64_t left = reg[instruction->left];
+                int64_t right = reg[instruction->right];
+                int64_t *destination = &reg[instruction->destination];
+                switch (instruction->opCode) {
+                    case derivedLoadSensor:
+                        *destination = param->currentValue[instruction->operand];
+                        break;
+                    case derivedLoadConstant:
+                        *destination = instruction->operand;
+                        break;
+                    case derivedAdd:
+                        *destination = addDerivedSaturated(left, right);
+                        break;
+                    case derivedSub:
+                        *destination = subDerivedSaturated(left, right);
+                        break;
+                    case derivedMul:
+                        *destination = mulDerivedSaturated(left, right);
+                        break;
+                    case derivedDiv:
+                        if (right == 0)
+                            valid = false;
+                        else if (left == INT64_MIN && right == -1)
+                            *destination = INT64_MAX;
+                        else
+                            *destination = left / right;
+                        break;
+                    case derivedNeg:
+                        *destination = (left == INT64_MIN) ? INT64_MAX : -left;
+                        break;
+                    case derivedMin:
+                        *destination = left < right ? left : right;
+                        break;
+                    case derivedMax:
+                        *destination = left > right ? left : right;
+                        break;
+                    case derivedAbs:
+                        *destination = (left == INT64_MIN) ? INT64_MAX : (left < 0 ? -left : left);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            // A division by zero keeps the previous value
+            if (!valid)
+                continue;
+
+            int64_t result = reg[0];
+            if (result > INT32_MAX)
+                result = INT32_MAX;
+            else if (result < INT32_MIN)
+                result = INT32_MIN;
+            int i = derivedSensor[p];
+            if (param->currentValue[i] == (int32_t)result)
+                continue;
+            param->currentValue[i] = (int32_t)result;
+            markSensorDirty(i);
+            for (uint32_t r = derivedDependentStart[i]; r < derivedDependentStart[i + 1]; r++)
+                derivedPendingMask[derivedDependents[r] >> 6] |= (uint64_t)1 << (derivedDependents[r] & 63);
+            if (nbChanged < maxChanged)
+                changed[nbChanged++] = (uint16_t)i;
+        }
+    }
+    return nbChanged;
+}
+
+/**
+ * \brief function to know if a sensor is a derived parameter.
+ *
+ * \param index the sensor index
+ *
+ * \return true when the sensor value is computed from an expression.
+ */
+bool isDerivedParameter(int index) {
+    return index >= 0 && index < MAX_SENSORS && derivedPosition[index] >= 0 && derivedSensor != NULL;
+}
+
+/**
+ * \brief function to free the derived parameters expressions and code.
+ */
+void freeDerivedParameters() {
+    for (int i = 0; i < MAX_SENSORS; i++) {
+        free(derivedSources[i]);
+        derivedSources[i] = NULL;
+    }
+    freeDerivedCode();
+}
+
+/**
+ * \brief function to free the compiled code of the derived parameters,
+ * the expressions are kept.
+ */
+static void freeDerivedCode() {
+    free(derivedSensor);
+    free(derivedCodeStart);
+    free(derivedCode);
+    free(derivedDependentStart);
+    free(derivedDependents);
+    derivedSensor = NULL;
+    derivedCodeStart = NULL;
+    derivedCode = NULL;
+    derivedDependentStart = NULL;
+    derivedDependents = NULL;
+    memset(derivedPosition, 0xFF, sizeof(derivedPosition));
+    memset(derivedPendingMask, 0, sizeof(derivedPendingMask));
+    nbDerivedParameters = 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * \file histogram.cpp
+ * \brief log-linear latency histogram functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Latency histogram functions, the percentiles are the upper bound of
+ * the bucket holding them (never above the largest recorded value).
+ *
+ */
+#include "histogram.h"
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static uint64_t getHistogramBucketMax(int bucket);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to get the largest value of a bucket.
+ *
+ * \param bucket the bucket index
+ *
+ * \return the largest value stored in the bucket.
+ */
+static uint64_t getHistogramBucketMax(int bucket) {
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKETS)
+        return (uint64_t)bucket;
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t mantissa = (uint64_t)(bucket % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to empty a histogram.
+ *
+ * \param histogram the histogram
+ */
+void resetHistogram(struct histogramStruct *histogram) {
+    memset(histogram, 0, sizeof(struct histogramStruct));
+}
+
+/**
+ * \brief function to get a percentile of the recorded values.
+ *
+ * \param histogram the histogram
+ * \param permille the percentile in thousandths (500 for the median,
+ * 990 for the 99th percentile, 1000 for the maximum)
+ *
+ * \return the percentile, 0 when the histogram is empty.
+ */
+uint64_t getHistogramPercentile(const struct histogramStruct *histogram, unsigned int permille) {
+    if (histogram->nbValues == 0)
+        return 0;
+    if (permille >= 1000)
+        return histogram->max;
+
+    // Rank of the percentile value, 1 for the smallest value
+    uint64_t rank = (histogram->nbValues * permille + 999) / 1000;
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += histogram->count[b];
+        if (seen >= rank) {
+            uint64_t value = getHistogramBucketMax(b);
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ * \brief function to print the count, mean, median, 90th and
+ * 99th percentiles and maximum of a histogram.
+ *
+ * \param histogram the histogram
+ * \param name the histogram name
+ * \param unit the unit of the values
+ */
+void printHistogram(const struct histogramStruct *histogram, const char *name, const char *unit) {
+    if (histogram->nbValues == 0) {
+        printf("%s: no value\n", name);
+        return;
+    }
+    printf("%s: %llu values, mean %llu %s, p50 %llu %s, p90 %llu %s, p99 %llu %s, max %llu %s\n", name,
+           (unsigned long long)histogram->nbValues,
+           (unsigned long long)(histogram->total / histogram->nbValues), unit,
+           (unsigned long long)getHistogramPercentile(histogram, 500), unit,
+           (unsigned long long)getHistogramPercentile(histogram, 900), unit,
+           (unsigned long long)getHistogramPercentile(histogram, 990), unit,
+           (unsigned long long)histogram->max, unit);
+}
@@ -9,17 +9,29 @@
  *
  */
 #include "init.h"
+#include "canFilter.h"
+#include "limitCheck.h"
+#include "sensorHistory.h"
+#include "sensorLog.h"
+#include "sensorArchive.h"
+#include "sensorStats.h"
+#include "sensorTrend.h"
+#include "derivedParam.h"
+#include "sensorCalibration.h"
+#include "paramCSV.h"
+#include "paramTable.h"
+#include "paramReload.h"
+#include "sensorStale.h"
+#include "obdhPipeline.h"
+#include "controlMode.h"
 
 
 //------------------------------------------------------------------------------
 // Local function definitions
 //------------------------------------------------------------------------------
 statusErrDef initSensorParamCSV();
-int countFileLines(const char *filename);
-statusErrDef readParamSensorsFile(const char* fileName);
-void fillParamSensorsStruct(char* line, int pos);
+statusErrDef buildSensorIndexLUT();
 statusErrDef initSensorValArrays();
-statusErrDef writeSensorsValFile(const char* fileName, int index);
 statusErrDef initCANSocket();
 statusErrDef initUDPSocket();
 
@@ -33,16 +45,6 @@ statusErrDef initUDPSocket();
  */
 struct paramSensorsStruct* paramSensors;
 
-/**
- * \struct sensorsVal
- * \brief array of struct containing the history of
- * sensor values of every sensors.
- * Array size determined by the number of sensors
- * defined in "paramSensors.csv".
- *
- */
-struct sensorsValStruct* sensorsVal;
-
 /**
  * \struct beginTimeOBDH
  * \brief struct of the OBDH program begin time.
@@ -72,34 +74,50 @@ int socket_udp = 0;
  */
 int lineCountSensorParamCSV = 0;
 
+/**
+ * \brief sensor ID to sensor index lookup table,
+ * -1 for the IDs that are not in "paramSensors.csv".
+ */
+int16_t sensorIndexLUT[SENSOR_INDEX_LUT_SIZE];
+
 //------------------------------------------------------------------------------
 // Local function definitions
 //------------------------------------------------------------------------------
 /**
- * \brief function to read "paramSensors.csv"
- * until the end of the file.
+ * \brief function to read the sensors parameters, from the built-in
+ * table with the edits of "paramSensors.csv" and its overlay file, or
+ * from "paramSensors.csv".
  *
  * \return statusErrDef that values:
  * - errOpenParamSensorsFile when the paramSensors.csv file fails to open
  * - errAllocParamSensorStruct when the sensorParam structure cannot be allocated to the memory
+ * - errInvalidParamSensorsLine when a line of the CSV or overlay file is malformed
+ * - errInvalidSensorId when a sensor ID is out of range or duplicated
+ * - errTooManySensors when there are more than MAX_SENSORS sensors
+ * - errInvalidDerivedExpression when a derived parameter expression can't be compiled
+ * - errInvalidSensorCalibration when a derived parameter has a calibration
  * - noError when the function exits successfully.
  */
 statusErrDef initSensorParamCSV() {
 	statusErrDef ret = noError;
     char filePath[MAX_PATH_LENGHT];
+#if PARAM_SENSORS_BUILTIN
+    char overlayPath[MAX_PATH_LENGHT];
+#endif
+    struct timespec parseStart, parseEnd;
 
-    sprintf(filePath, "%s%s",OUTPUT_FILES_DIR, PARAM_SENSORS_CSV_FILENAME);
-	lineCountSensorParamCSV = countFileLines(filePath);
-    if(lineCountSensorParamCSV == -1) {
-		return errOpenParamSensorsFile;
-    }
-    if (lineCountSensorParamCSV <= 1) {
-        printf("No sensors found in file.\n");
-        paramSensors = NULL; // Handle empty file case
-        return noError; // Or return an error if this is invalid
-    }
+    // No sensor is known until the parameters are read
+    memset(sensorIndexLUT, 0xFF, sizeof(sensorIndexLUT));
+    lineCountSensorParamCSV = 0;
 
-    lineCountSensorParamCSV--; // Adjust for header
+    // A retried init frees the table of the previous try,
+    // once the reload thread no longer reads it
+    closeParamSensorsReload();
+    if (paramSensors != NULL) {
+        freeParamSensorsArrays(paramSensors);
+        free(paramSensors);
+        paramSensors = NULL;
+    }
 
     // Allocate the struct itself
     paramSensors = (struct paramSensorsStruct*)malloc(sizeof(struct paramSensorsStruct));
@@ -108,213 +126,112 @@ statusErrDef initSensorParamCSV() {
         return errAllocParamSensorStruct;
     }
 
-    paramSensors->id = (uint16_t*)malloc(lineCountSensorParamCSV * sizeof(uint16_t));
-    paramSensors->minCriticalValue = (int32_t*)malloc(lineCountSensorParamCSV * sizeof(int32_t));
-    paramSensors->minWarnValue = (int32_t*)malloc(lineCountSensorParamCSV * sizeof(int32_t));
-    paramSensors->currentValue = (int32_t*)malloc(lineCountSensorParamCSV * sizeof(int32_t));
-    paramSensors->maxWarnValue = (int32_t*)malloc(lineCountSensorParamCSV * sizeof(int32_t));
-    paramSensors->maxCriticalValue = (int32_t*)malloc(lineCountSensorParamCSV * sizeof(int32_t));
-
-    // Check all allocations
-    if (paramSensors->id == NULL || paramSensors->minCriticalValue == NULL ||
-        paramSensors->minWarnValue == NULL || paramSensors->currentValue == NULL ||
-        paramSensors->maxWarnValue == NULL || paramSensors->maxCriticalValue == NULL) {
-        perror("errAllocParamSensorStruct");
-        // Free any successful allocations to avoid leaks
-        free(paramSensors->id);
-        free(paramSensors->minCriticalValue);
-        free(paramSensors->minWarnValue);
-        free(paramSensors->currentValue);
-        free(paramSensors->maxWarnValue);
-        free(paramSensors->maxCriticalValue);
+    clock_gettime(CLOCK_MONOTONIC, &parseStart);
+#if PARAM_SENSORS_BUILTIN
+    sprintf(filePath, "%s%s", OUTPUT_FILES_DIR, PARAM_SENSORS_CSV_FILENAME);
+    sprintf(overlayPath, "%s%s", OUTPUT_FILES_DIR, PARAM_SENSORS_OVERLAY_FILENAME);
+	ret = loadParamSensorsTable(filePath, overlayPath, paramSensors, &lineCountSensorParamCSV, true);
+#else
+    sprintf(filePath, "%s%s",OUTPUT_FILES_DIR, PARAM_SENSORS_CSV_FILENAME);
+    printf("filename: %s \n", filePath);
+	ret = parseParamSensorsCSV(filePath, paramSensors, &lineCountSensorParamCSV, true);
+#endif
+    if (ret == noError && lineCountSensorParamCSV == 0)
+        printf("No sensors found.\n");
+    if (ret != noError || lineCountSensorParamCSV == 0) {
         free(paramSensors);
-        paramSensors = NULL;
-        return errAllocParamSensorStruct;
+        paramSensors = NULL; // Handle empty file case
+        return ret;
     }
 
-    // Initialize all arrays to 0
-    memset(paramSensors->id, 0, lineCountSensorParamCSV * sizeof(uint16_t));
-    memset(paramSensors->minCriticalValue, 0, lineCountSensorParamCSV * sizeof(int32_t));
-    memset(paramSensors->minWarnValue, 0, lineCountSensorParamCSV * sizeof(int32_t));
-    memset(paramSensors->currentValue, 0, lineCountSensorParamCSV * sizeof(int32_t));
-    memset(paramSensors->maxWarnValue, 0, lineCountSensorParamCSV * sizeof(int32_t));
-    memset(paramSensors->maxCriticalValue, 0, lineCountSensorParamCSV * sizeof(int32_t));
-
-	ret = readParamSensorsFile(filePath);
+	ret = buildSensorIndexLUT();
+	if(ret != noError)
+		return ret;
 
-    if (paramSensors != NULL) {
-        printf("Number of sensors: %d\n", lineCountSensorParamCSV);
-        for (int i = 0; i < lineCountSensorParamCSV; i++) {
-            printf("Sensor %d: id=0x%04X, minCrit=%d, minWarn=%d, maxWarn=%d, maxCrit=%d\n",
-                   i, paramSensors->id[i], paramSensors->minCriticalValue[i],
-                   paramSensors->minWarnValue[i], paramSensors->maxWarnValue[i],
-                   paramSensors->maxCriticalValue[i]);
-        }
-    } else {
-        printf("paramSensors is NULL\n");
-    }
+	ret = compileDerivedParameters(paramSensors, lineCountSensorParamCSV);
+	if(ret == noError)
+		ret = compileSensorCalibrations(paramSensors, lineCountSensorParamCSV);
+    clock_gettime(CLOCK_MONOTONIC, &parseEnd);
+    printf("Number of sensors: %d (read in %ld us)\n", lineCountSensorParamCSV,
+           (long)((parseEnd.tv_sec - parseStart.tv_sec) * 1000000L +
+                  (parseEnd.tv_nsec - parseStart.tv_nsec) / 1000L));
 
 	return ret;
 }
 
 /**
- * \brief function to count the number of lines
- * in the paraSensors.csv file.
+ * \brief function to fill the sensor ID to sensor index
+ * lookup table from the paramSensors struct.
  *
- * \param filename location and name of the CSV file to read
- *
- * \return the line count.
- */
-int countFileLines(const char *filename) {
-    printf("filename: %s \n", filename);
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("File open error");
-        return -1;
-    }
-
-    int count = 0;
-    int ch;
-
-    while ((ch = fgetc(file)) != EOF) {
-        if (ch == '\n') {
-            count++;
-        }
-    }
-
-    fclose(file);
-    return count;
-}
-
-/**
- * \brief function to read "paramSensors.csv"
- * until the end of the file.
- *
- * \param fileName location and name of the CSV file to read
  * \return statusErrDef that values:
- * - errOpenParamSensorsFile when the paramSensors.csv file fails to open
+ * - errInvalidSensorId when a sensor ID is out of the
+ * SENSOR_ID_MIN to SENSOR_ID_MAX range or is duplicated
  * - noError when the function exits successfully.
  */
-statusErrDef readParamSensorsFile(const char* fileName) {
-    FILE* file = fopen(fileName, "r");
-    if (file == NULL)
-    {
-        perror("File open error");
-        return errOpenParamSensorsFile;
-    }
-    int pos = 0;
-
-    char line[MAX_CSV_LINE_SIZE];
-    // Skip the header line
-    if (fgets(line, sizeof(line), file) == NULL) {
-        fclose(file);
-        // File is empty or unreadable
-        return errOpenParamSensorsFile;
-    }
-
-    while (fgets(line, sizeof(line), file) != NULL && pos <= lineCountSensorParamCSV)
-    {
-        line[strcspn(line, "\n")] = 0;
-        fillParamSensorsStruct(line, pos);
-        pos++;
-    }
-
-    fclose(file);
-    return noError;
-}
-
-/**
- * \brief function to fill in the sensors parameters structure.
- *
- * \param line the CSV line to read.
- * \param pos the position of the line in the CSV file.
- */
-void fillParamSensorsStruct(char* line, int pos) {
-    char* token = strtok(line, ";");
-    int column = 0;
-
-    while (token != NULL)
-    {
-        switch (column) {
-            case 1:
-                paramSensors->id[pos] = (uint16_t)strtol(token, NULL, 0);
-                break;
-            case 2:
-                paramSensors->minCriticalValue[pos] = atoi(token);
-                break;
-            case 3:
-                paramSensors->minWarnValue[pos] = atoi(token);
-                break;
-            case 5:
-                paramSensors->maxWarnValue[pos] = atoi(token);
-                break;
-            case 6:
-                paramSensors->maxCriticalValue[pos] = atoi(token);
-                break;
-            default:
-                break;
+statusErrDef buildSensorIndexLUT() {
+    for (int i = 0; i < lineCountSensorParamCSV; i++) {
+        uint16_t sensorId = paramSensors->id[i];
+        if (sensorId < SENSOR_ID_MIN || sensorId > SENSOR_ID_MAX) {
+            printf("Sensor %d: id=0x%04X out of range\n", i, sensorId);
+            return errInvalidSensorId;
+        }
+        if (sensorIndexLUT[sensorId] != -1) {
+            printf("Sensor %d: id=0x%04X already declared by sensor %d\n",
+                   i, sensorId, sensorIndexLUT[sensorId]);
+            return errInvalidSensorId;
         }
-        column++;
-        token = strtok(NULL, ";");
+        sensorIndexLUT[sensorId] = (int16_t)i;
     }
+    return noError;
 }
 
 /**
- * \brief function to initialize the sensorVal structure
- * and the sensor values files.
+ * \brief function to initialize the sensor values history,
+ * the sensor statistics and trends, the sensor archive and the
+ * sensor log file.
  *
  * \return statusErrDef that values:
- * - errAllocSensorValStruct when the sensorVal structure memory allocation fails
- * - errOpenParamSensorsFile when the paramSensors.csv file fails to open
+ * - errAllocSensorHistory when the sensor history cannot be allocated
+ * - errAllocTimerWheel when the sensor deadlines cannot be allocated
+ * - errAllocSensorArchive when the sensor archive cannot be allocated
+ * - errOpenSensorArchive when the sensor archive file can't be created
+ * - errAllocSensorLogBuffer when the sensor log buffer cannot be allocated
+ * - errOpenSensorsValFile when the sensor log file can't be created
+ * - errMapSensorLogRing when the sensor ring log file can't be mapped
+ * - errStartSensorLogSync when the ring log synchronisation thread can't be started
+ * - errStartSensorLogWorker when the log segments thread can't be started
  * - noError when the function exits successfully.
  */
 statusErrDef initSensorValArrays() {
 	statusErrDef ret = noError;
-    char filePath[MAX_PATH_LENGHT];
-
-    // Allocate array of structs for lineCountSensorParamCSV sensors
-    sensorsVal = (struct sensorsValStruct*)malloc(lineCountSensorParamCSV * sizeof(struct sensorsValStruct));
-    if (sensorsVal == NULL) {
-        perror("errAllocSensorValStruct");
-        return errAllocSensorsValStruct;
-    }
-
-    // Initialize all elements to zero
-    memset(sensorsVal, 0, lineCountSensorParamCSV * sizeof(struct sensorsValStruct));
 
-    for(int i = 0; i < lineCountSensorParamCSV; i++) {
-        sprintf(filePath, "%s0x%04X.csv",OUTPUT_FILES_DIR, paramSensors->id[i]);
-        sensorsVal[i].id = paramSensors->id[i];
-        ret = writeSensorsValFile(filePath, i);
-    }
+    ret = initSensorHistory(paramSensors != NULL ? paramSensors->historyDepth : NULL,
+                            lineCountSensorParamCSV);
+    if (ret != noError)
+        return ret;
+    initSensorStats(lineCountSensorParamCSV);
+    initSensorTrend(lineCountSensorParamCSV);
+    ret = initSensorStaleness(paramSensors != NULL ? paramSensors->expectedPeriod : NULL,
+                              lineCountSensorParamCSV, getTimeSinceStart());
+    if (ret != noError)
+        return ret;
 
+    char filePath[MAX_PATH_LENGHT];
+    sprintf(filePath, "%s%s", OUTPUT_FILES_DIR, SENSOR_ARCHIVE_FILENAME);
+    ret = initSensorArchive(filePath, paramSensors != NULL ? paramSensors->id : NULL,
+                            lineCountSensorParamCSV);
+    if (ret != noError)
+        return ret;
+
+#if SENSOR_LOG_MAPPED_RING
+    sprintf(filePath, "%s%s", OUTPUT_FILES_DIR, SENSOR_LOG_RING_FILENAME);
+    ret = initSensorLogRing(filePath);
+#else
+    ret = initSensorLog(OUTPUT_FILES_DIR);
+#endif
     return ret;
 }
 
-/**
- * \brief function to read "paramSensors.csv"
- * until the end of the file.
- *
- * \param fileName location and name of the CSV file to read
- * \return statusErrDef that values:
- * - errOpenParamSensorsFile when the paramSensors.csv file fails to open
- * - noError when the function exits successfully.
- */
-statusErrDef writeSensorsValFile(const char* fileName, int index) {
-    printf("filename: %s\n", fileName);
-    sensorsVal[index].sensorFile = fopen(fileName, "w");
-    if (sensorsVal[index].sensorFile == NULL) {
-        perror("File open error");
-        return errOpenSensorsValFile;
-    }
-
-    // Write CSV header
-    fprintf(sensorsVal[index].sensorFile, "Timestamp since program start (sec);Value\n");
-
-    // Don’t close here if you want to write more later
-    return noError;
-}
-
 /**
  * \brief function to initialize the CAN socket
  *
@@ -324,6 +241,8 @@ statusErrDef writeSensorsValFile(const char* fileName, int index) {
  * - errGetCANSocketFlags CAN socket flags cannot be read
  * - errSetCANSocketNonBlocking when the CAN socket non blocking flag cannot be set
  * - errBindCANAddr when the CAN address cannot be bound to the CAN socket
+ * - errSetCANFilter when the CAN filter table cannot be installed
+ * - errSetCANErrFilter when the CAN error frames mask cannot be installed
  * - noError when the function exits successfully.
  */
 statusErrDef initCANSocket() {
@@ -375,11 +294,7 @@ statusErrDef initCANSocket() {
 		return errBindCANAddr;
 	}
 
-    struct can_filter rfilter[1];
-    rfilter[0].can_id = CAN_ID_OBDH;
-    rfilter[0].can_mask = CAN_SFF_MASK;
-    setsockopt(socket_can, SOL_CAN_RAW, CAN_RAW_FILTER, &rfilter, sizeof(rfilter));
-
+	ret = installCANFilters(socket_can);
 	return ret;
 }
 
@@ -443,6 +358,8 @@ statusErrDef initUDPSocket() {
  * \return statusErrDef that values:
  * - errCreateCANSocket when CAN socket can't be created,
  * - errBindCANAddr when CAN address can't be bind,
+ * - errStartParamReload when the parameters file watch can't be started,
+ * - errAllocPipelineRing when the OBDH pipeline queues can't be allocated,
  * - noError when the function exits successfully.
  */
 statusErrDef initOBDH() {
@@ -455,10 +372,48 @@ statusErrDef initOBDH() {
 	if(ret != noError)
 		return ret;
 
+	if(paramSensors != NULL)
+		resetSensorLimitState(paramSensors, lineCountSensorParamCSV);
+
+	char filePath[MAX_PATH_LENGHT];
+	sprintf(filePath, "%s%s", OUTPUT_FILES_DIR, PARAM_SENSORS_CSV_FILENAME);
+#if PARAM_SENSORS_BUILTIN
+	char overlayPath[MAX_PATH_LENGHT];
+	sprintf(overlayPath, "%s%s", OUTPUT_FILES_DIR, PARAM_SENSORS_OVERLAY_FILENAME);
+	ret = initParamSensorsReload(filePath, overlayPath, paramSensors, lineCountSensorParamCSV);
+#else
+	ret = initParamSensorsReload(filePath, NULL, paramSensors, lineCountSensorParamCSV);
+#endif
+	if(ret != noError)
+		return ret;
+
+	// The housekeeping packets are grown before the control mode (see rtProfile.h)
+	reserveHousekeepingPackets();
+
+#if OBDH_PIPELINE
+	// The queues are allocated before the control mode (see rtProfile.h)
+	ret = initOBDHPipeline();
+	if(ret != noError)
+		return ret;
+#endif
+
 	ret = initCANSocket();
 	return ret;
 }
 
+/**
+ * \brief function to get the time elapsed since the
+ * TT&C subsystem initialisation (program start).
+ *
+ * \return the time in microseconds.
+ */
+uint64_t getTimeSinceStart() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)(now.tv_sec - beginTimeOBDH.tv_sec) * 1000000 +
+		(now.tv_nsec - beginTimeOBDH.tv_nsec) / 1000;
+}
+
 /**
  * \brief function to initialize the AOCS subsystem
  *
@@ -0,0 +1,208 @@
+/**
+ * \file limitCheck.cpp
+ * \brief sensor limit checking functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Compares every sensor current value with its warning and critical
+ * bounds of the paramSensors structure of arrays. The comparisons are
+ * done 8 sensors at a time with AVX2, 4 at a time with SSE2 or NEON,
+ * and one at a time otherwise (and for the last sensors).
+ * The full pass is only done when the sensor parameters are loaded,
+ * then the sensors whose value changed are marked dirty and only
+ * those are checked again, the number of sensors out of their
+ * warning and critical bounds is kept up to date on the way.
+ *
+ */
+#include "limitCheck.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief one bit per sensor index, set when the sensor current
+ * value is out of its warning bounds.
+ */
+uint64_t sensorWarnMask[SENSOR_MASK_WORDS];
+
+/**
+ * \brief one bit per sensor index, set when the sensor current
+ * value is out of its critical bounds.
+ */
+uint64_t sensorCriticalMask[SENSOR_MASK_WORDS];
+
+/**
+ * \brief one bit per sensor index, set when the sensor current
+ * value has changed since the last check.
+ */
+uint64_t sensorDirtyMask[SENSOR_MASK_WORDS];
+
+/**
+ * \brief index of every sensor set in sensorDirtyMask,
+ * in the order they were marked.
+ */
+uint16_t sensorDirtyList[MAX_SENSORS];
+
+/**
+ * \brief number of sensors in sensorDirtyList.
+ */
+int nbDirtySensors = 0;
+
+/**
+ * \brief number of sensors out of their warning bounds
+ * (critical ones included).
+ */
+int nbSensorsWarn = 0;
+
+/**
+ * \brief number of sensors out of their critical bounds.
+ */
+int nbSensorsCritical = 0;
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to compare the current value of every sensor
+ * with its warning and critical bounds.
+ * A sensor is out of its bounds when its current value is lower
+ * or equal to the minimum, or greater or equal to the maximum.
+ *
+ * \param param the sensors parameters (structure of arrays)
+ * \param nbSensors the number of sensors in param (at most MAX_SENSORS)
+ * \param warnMask filled with one bit per sensor out of its warning bounds
+ * \param criticalMask filled with one bit per sensor out of its critical bounds
+ */
+void computeSensorLimitMasks(const struct paramSensorsStruct *param, int nbSensors,
+                             uint64_t *warnMask, uint64_t *criticalMask) {
+    const int32_t *value = param->currentValue;
+    const int32_t *minWarn = param->minWarnValue;
+    const int32_t *maxWarn = param->maxWarnValue;
+    const int32_t *minCrit = param->minCriticalValue;
+    const int32_t *maxCrit = param->maxCriticalValue;
+    int i = 0;
+
+    memset(warnMask, 0, SENSOR_MASK_WORDS * sizeof(uint64_t));
+    memset(criticalMask, 0, SENSOR_MASK_WORDS * sizeof(uint64_t));
+
+#if defined(__AVX2__)
+    for (; i + 8 <= nbSensors; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(value + i));
+        // in bounds when min < value < max
+        __m256i inWarn = _mm256_and_si256(
+            _mm256_cmpgt_epi32(v, _mm256_loadu_si256((const __m256i*)(minWarn + i))),
+            _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(maxWarn + i)), v));
+        __m256i inCrit = _mm256_and_si256(
+            _mm256_cmpgt_epi32(v, _mm256_loadu_si256((const __m256i*)(minCrit + i))),
+            _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(maxCrit + i)), v));
+        uint64_t warnBits = ~_mm256_movemask_ps(_mm256_castsi256_ps(inWarn)) & 0xFF;
+        uint64_t critBits = ~_mm256_movemask_ps(_mm256_castsi256_ps(inCrit)) & 0xFF;
+        warnMask[i >> 6] |= warnBits << (i & 63);
+        criticalMask[i >> 6] |= critBits << (i & 63);
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= nbSensors; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(value + i));
+        // in bounds when min < value < max
+        __m128i inWarn = _mm_and_si128(
+            _mm_cmpgt_epi32(v, _mm_loadu_si128((const __m128i*)(minWarn + i))),
+            _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(maxWarn + i)), v));
+        __m128i inCrit = _mm_and_si128(
+            _mm_cmpgt_epi32(v, _mm_loadu_si128((const __m128i*)(minCrit + i))),
+            _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(maxCrit + i)), v));
+        uint64_t warnBits = ~_mm_movemask_ps(_mm_castsi128_ps(inWarn)) & 0xF;
+        uint64_t critBits = ~_mm_movemask_ps(_mm_castsi128_ps(inCrit)) & 0xF;
+        warnMask[i >> 6] |= warnBits << (i & 63);
+        criticalMask[i >> 6] |= critBits << (i & 63);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint32_t laneBitsInit[4] = {1, 2, 4, 8};
+    const uint32x4_t laneBits = vld1q_u32(laneBitsInit);
+    for (; i + 4 <= nbSensors; i += 4) {
+        int32x4_t v = vld1q_s32(value + i);
+        // in bounds when min < value < max
+        uint32x4_t inWarn = vandq_u32(vcgtq_s32(v, vld1q_s32(minWarn + i)),
+                                      vcgtq_s32(vld1q_s32(maxWarn + i), v));
+        uint32x4_t inCrit = vandq_u32(vcgtq_s32(v, vld1q_s32(minCrit + i)),
+                                      vcgtq_s32(vld1q_s32(maxCrit + i), v));
+        uint64_t warnBits = vaddvq_u32(vandq_u32(vmvnq_u32(inWarn), laneBits));
+        uint64_t critBits = vaddvq_u32(vandq_u32(vmvnq_u32(inCrit), laneBits));
+        warnMask[i >> 6] |= warnBits << (i & 63);
+        criticalMask[i >> 6] |= critBits << (i & 63);
+    }
+#endif
+
+    // Scalar fallback and last sensors
+    for (; i < nbSensors; i++) {
+        uint64_t warnBit = (value[i] <= minWarn[i] || value[i] >= maxWarn[i]);
+        uint64_t critBit = (value[i] <= minCrit[i] || value[i] >= maxCrit[i]);
+        warnMask[i >> 6] |= warnBit << (i & 63);
+        criticalMask[i >> 6] |= critBit << (i & 63);
+    }
+}
+
+/**
+ * \brief function to count the sensors set in a sensor mask.
+ *
+ * \param mask the sensor mask (one bit per sensor index)
+ * \param nbSensors the number of sensors
+ *
+ * \return the number of bits set.
+ */
+int countSensorMask(const uint64_t *mask, int nbSensors) {
+    int count = 0;
+    for (int w = 0; w < (nbSensors + 63) / 64; w++)
+        count += __builtin_popcountll(mask[w]);
+    return count;
+}
+
+/**
+ * \brief function to check every sensor bounds and restart
+ * the incremental checking from there (to call when the sensor
+ * parameters are loaded).
+ *
+ * \param param the sensors parameters (structure of arrays)
+ * \param nbSensors the number of sensors in param (at most MAX_SENSORS)
+ */
+void resetSensorLimitState(const struct paramSensorsStruct *param, int nbSensors) {
+    computeSensorLimitMasks(param, nbSensors, sensorWarnMask, sensorCriticalMask);
+    nbSensorsWarn = countSensorMask(sensorWarnMask, nbSensors);
+    nbSensorsCritical = countSensorMask(sensorCriticalMask, nbSensors);
+    memset(sensorDirtyMask, 0, sizeof(sensorDirtyMask));
+    nbDirtySensors = 0;
+}
+
+/**
+ * \brief function to check the bounds of the sensors marked
+ * dirty and update the warning and critical masks and counters.
+ * The cost is proportional to the number of dirty sensors.
+ *
+ * \param param the sensors parameters (structure of arrays)
+ */
+void updateDirtySensorLimits(const struct paramSensorsStruct *param) {
+    for (int d = 0; d < nbDirtySensors; d++) {
+        int i = sensorDirtyList[d];
+        int32_t value = param->currentValue[i];
+        uint64_t bit = (uint64_t)1 << (i & 63);
+        bool warn = (value <= param->minWarnValue[i] || value >= param->maxWarnValue[i]);
+        bool crit = (value <= param->minCriticalValue[i] || value >= param->maxCriticalValue[i]);
+
+        if (warn != ((sensorWarnMask[i >> 6] & bit) != 0)) {
+            sensorWarnMask[i >> 6] ^= bit;
+            nbSensorsWarn += warn ? 1 : -1;
+        }
+        if (crit != ((sensorCriticalMask[i >> 6] & bit) != 0)) {
+            sensorCriticalMask[i >> 6] ^= bit;
+            nbSensorsCritical += crit ? 1 : -1;
+        }
+        sensorDirtyMask[i >> 6] &= ~bit;
+    }
+    nbDirtySensors = 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * \file loopLatency.cpp
+ * \brief loop phase latency functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Loop phase latency functions, the histograms are written by the
+ * probes of the control thread (see recordLoopPhase()) and read by the
+ * same thread when the housekeeping packet is built, without lock.
+ *
+ */
+#include "loopLatency.h"
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief phase durations of the reporting window.
+ */
+struct loopLatencyStruct loopLatency;
+
+/**
+ * \brief phase names for the logs, indexed by loopPhaseDef.
+ */
+const char *const loopPhaseNames[NB_LOOP_PHASES] = {
+    "sensor check",
+    "check TC backlog",
+    "housekeeping",
+    "real-time check",
+    "loop latency report",
+    "regulate",
+    "safe mode",
+    "state transition",
+};
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void pushLatency(std::vector<uint8_t> *telemOut, uint64_t value);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to append a count or a duration to a packet,
+ * big endian on 4 bytes, saturated to 0xFFFFFFFF.
+ *
+ * \param telemOut the packet user data
+ * \param value the value
+ */
+static void pushLatency(std::vector<uint8_t> *telemOut, uint64_t value) {
+    uint32_t saturated = value > 0xFFFFFFFFULL ? 0xFFFFFFFFu : (uint32_t)value;
+    telemOut->push_back((saturated >> 24) & 0xFF);
+    telemOut->push_back((saturated >> 16) & 0xFF);
+    telemOut->push_back((saturated >> 8) & 0xFF);
+    telemOut->push_back(saturated & 0xFF);
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to clear the histogram of every phase
+ * and to start a new reporting window.
+ */
+void resetLoopLatency() {
+    for (int p = 0; p < NB_LOOP_PHASES; p++)
+        resetHistogram(&loopLatency.phase[p]);
+    loopLatency.windowStart = getLoopPhaseTime();
+}
+
+/**
+ * \brief function to know if the reporting window has ended.
+ *
+ * \return true after LOOP_LATENCY_REPORT_PERIOD since the last reset.
+ */
+bool isLoopLatencyWindowEnded() {
+    return getLoopPhaseTime() - loopLatency.windowStart >= LOOP_LATENCY_REPORT_PERIOD * 1000;
+}
+
+/**
+ * \brief function to fill an HKLoopLatency housekeeping packet
+ * with the phases that have run in the window.
+ *
+ * \param telemOut the packet user data, cleared first
+ */
+void fillLoopLatencyPacket(std::vector<uint8_t> *telemOut) {
+    uint8_t nbEntries = 0;
+
+    telemOut->clear();
+    telemOut->reserve(7 + NB_LOOP_PHASES * LOOP_LATENCY_ENTRY_SIZE);
+    telemOut->push_back((HKLoopLatency >> 8) & 0xFF);
+    telemOut->push_back(HKLoopLatency & 0xFF);
+    pushLatency(telemOut, (getLoopPhaseTime() - loopLatency.windowStart) / 1000000);
+    telemOut->push_back(0);
+
+    for (int p = 0; p < NB_LOOP_PHASES; p++) {
+        const struct histogramStruct *histogram = &loopLatency.phase[p];
+        if (histogram->nbValues == 0)
+            continue;
+        telemOut->push_back((uint8_t)p);
+        pushLatency(telemOut, histogram->nbValues);
+        pushLatency(telemOut, getHistogramPercentile(histogram, 500));
+        pushLatency(telemOut, getHistogramPercentile(histogram, 900));
+        pushLatency(telemOut, getHistogramPercentile(histogram, 990));
+        pushLatency(telemOut, histogram->max);
+        nbEntries++;
+    }
+    (*telemOut)[6] = nbEntries;
+}
+
+/**
+ * \brief function to print the histogram summary of every phase
+ * that has run in the window.
+ */
+void printLoopLatency() {
+    for (int p = 0; p < NB_LOOP_PHASES; p++) {
+        if (loopLatency.phase[p].nbValues > 0)
+            printHistogram(&loopLatency.phase[p], loopPhaseNames[p], "ns");
+    }
+}
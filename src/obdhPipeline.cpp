@@ -0,0 +1,556 @@
+/**
+ * \file obdhPipeline.cpp
+ * \brief OBDH acquisition pipeline functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * OBDH acquisition pipeline functions. The queues are allocated by
+ * the OBDH initialisation, the threads are started when the control
+ * mode is entered and stopped on entering the safe mode, init or
+ * restart state (they keep running in regulate): the producers first,
+ * each consumer ends once its producer has ended and its queue is
+ * empty, so no message is lost. A stage without message yields the CPU
+ * PIPELINE_SPIN_COUNT times then sleeps PIPELINE_IDLE_SLEEP between
+ * the next tries, the ingest stage waits in poll() on the CAN socket.
+ *
+ */
+#include "obdhPipeline.h"
+#include "controlMode.h"
+#include "canFilter.h"
+#include "limitCheck.h"
+#include "init.h"
+#include "paramReload.h"
+#include "sensorStats.h"
+#include "rtProfile.h"
+#include "regulate.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static uint64_t getPipelineTime();
+static void waitPipelineStage(uint32_t *nbWaits);
+static void *reservePipelineSlot(struct spscRingStruct *ring);
+static void reportPipelineError(pipelineStageDef stage, statusErrDef status);
+static void endPipelineStage(pipelineStageDef stage);
+static void runPipelineTasks(uint32_t tasks);
+static void *pipelineIngestTask(void *arg);
+static void *pipelineProcessingTask(void *arg);
+static void *pipelineLoggingTask(void *arg);
+static void *pipelineDownlinkTask(void *arg);
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief true while the pipeline threads run, the control mode tasks
+ * then leave the sensor data to the processing stage.
+ */
+bool obdhPipelineRunning = false;
+
+/**
+ * \brief true in the processing stage thread, its telemetry and sensor
+ * readings go to the downlink and logging queues.
+ */
+__thread bool obdhPipelineProcessing = false;
+
+/**
+ * \brief threads of the pipeline, in the order of the data.
+ */
+struct pipelineStageStruct pipelineStages[NB_PIPELINE_STAGES] = {
+    {"ingest",      pipelineIngestTask,     0,  false,  {false},    0,  0},
+    {"processing",  pipelineProcessingTask, 0,  false,  {false},    0,  0},
+    {"logging",     pipelineLoggingTask,    0,  false,  {false},    0,  0},
+    {"downlink",    pipelineDownlinkTask,   0,  false,  {false},    0,  0},
+};
+
+/**
+ * \brief queues between the stages: CAN frames (ingest to processing),
+ * sensor readings (processing to logging) and telemetry user data
+ * (processing to downlink).
+ */
+struct spscRingStruct pipelineFrameQueue;
+struct spscRingStruct pipelineLogQueue;
+struct spscRingStruct pipelineTelemQueue;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief requests of the state machine (pipelineTaskDef bits)
+ * taken by the processing stage.
+ */
+static std::atomic<uint32_t> pipelineTasks(0);
+
+/**
+ * \brief result of the last sensor limit check of the processing stage.
+ */
+static std::atomic<int> pipelineLimitStatus(noError);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getPipelineTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to wait before the next try of a stage without
+ * message (or without free slot).
+ *
+ * \param nbWaits number of waits since the last message, reset by the caller
+ */
+static void waitPipelineStage(uint32_t *nbWaits) {
+    if ((*nbWaits)++ < PIPELINE_SPIN_COUNT) {
+        sched_yield();
+        return;
+    }
+    struct timespec idle;
+    idle.tv_sec = 0;
+    idle.tv_nsec = PIPELINE_IDLE_SLEEP * 1000L;
+    nanosleep(&idle, NULL);
+}
+
+/**
+ * \brief function to get a free slot of a queue, waiting for the
+ * consumer when the queue is full (the consumer ends after its
+ * producer, the wait always ends). The wait is counted in the
+ * backpressure counters of the queue.
+ *
+ * \param ring the queue
+ *
+ * \return the slot.
+ */
+static void *reservePipelineSlot(struct spscRingStruct *ring) {
+    void *slot = reserveSPSCRingSlot(ring);
+    if (slot != NULL)
+        return slot;
+
+    uint64_t stallStart = getPipelineTime();
+    uint32_t nbWaits = 0;
+    ring->nbStalls++;
+    do {
+        waitPipelineStage(&nbWaits);
+        slot = reserveSPSCRingSlot(ring);
+    } while (slot == NULL);
+    ring->stallTime += getPipelineTime() - stallStart;
+    return slot;
+}
+
+/**
+ * \brief function to log an error of a stage and send its telemetry,
+ * as the state machine does for the control mode tasks.
+ *
+ * \param stage the stage
+ * \param status the error
+ */
+static void reportPipelineError(pipelineStageDef stage, statusErrDef status) {
+    printf("Error pipeline %s! 0x%04X \n", pipelineStages[stage].name, status);
+    sendTelemToTTC(status);
+}
+
+/**
+ * \brief function to add the CPU time of the calling stage
+ * thread to its statistics, called when the thread ends.
+ *
+ * \param stage the stage
+ */
+static void endPipelineStage(pipelineStageDef stage) {
+    struct timespec cpuTime;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuTime) == 0)
+        pipelineStages[stage].busyTime += (uint64_t)cpuTime.tv_sec * 1000000000ULL + cpuTime.tv_nsec;
+}
+
+/**
+ * \brief function to run the requests of the state machine
+ * in the processing stage.
+ *
+ * \param tasks the requests (pipelineTaskDef bits)
+ */
+static void runPipelineTasks(uint32_t tasks) {
+    statusErrDef ret = noError;
+    uint64_t timeStamp = getTimeSinceStart();
+    if (tasks & pipelineTaskHousekeeping) {
+        ret = runSensorHousekeeping(timeStamp);
+        if (ret != noError)
+            reportPipelineError(pipelineProcessing, ret);
+    }
+    if (tasks & pipelineTaskReportStats) {
+        ret = sendSensorStatsToTTC(timeStamp);
+        resetSensorStats(timeStamp);
+        if (ret != noError)
+            reportPipelineError(pipelineProcessing, ret);
+    }
+    else if (tasks & pipelineTaskResetStats) {
+        resetSensorStats(timeStamp);
+    }
+    if (tasks & pipelineTaskRegulate) {
+        ret = regulateWarnSensors();
+        if (ret != noError)
+            reportPipelineError(pipelineProcessing, ret);
+    }
+}
+
+/**
+ * \brief ingest stage thread, reads the CAN frames in the
+ * slots of the frame queue.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *pipelineIngestTask(void *arg) {
+    struct pipelineStageStruct *stage = &pipelineStages[pipelineIngest];
+    struct pollfd socketPoll;
+    (void)arg;
+    setRTThreadProfile(rtPipelineThread);
+    socketPoll.fd = socket_can;
+    socketPoll.events = POLLIN;
+
+    while (!stage->stop.load(std::memory_order_acquire)) {
+        if (poll(&socketPoll, 1, PIPELINE_POLL_TIMEOUT) <= 0)
+            continue;
+        // Every frame already in the socket buffer
+        while (true) {
+            struct pipelineFrameStruct *message = (struct pipelineFrameStruct*)reservePipelineSlot(&pipelineFrameQueue);
+            ssize_t sizeReceived = read(socket_can, &message->frame, sizeof(struct can_frame));
+            if (sizeReceived > 0) {
+                message->size = (int32_t)sizeReceived;
+                publishSPSCRingSlot(&pipelineFrameQueue);
+                stage->nbMessages++;
+                continue;
+            }
+            if (sizeReceived < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("errReadCANTelem");
+                reportPipelineError(pipelineIngest, errReadCANTelem);
+                // A broken socket stays readable, don't spin on it
+                struct timespec retry;
+                retry.tv_sec = PIPELINE_POLL_TIMEOUT / 1000;
+                retry.tv_nsec = (PIPELINE_POLL_TIMEOUT % 1000) * 1000000L;
+                nanosleep(&retry, NULL);
+            }
+            break;
+        }
+    }
+    endPipelineStage(pipelineIngest);
+    return NULL;
+}
+
+/**
+ * \brief processing stage thread, dispatches the frames of the frame
+ * queue to the subsystem handlers, calibrates the queued samples and
+ * checks the sensor limits after every batch, as checkSensors() does
+ * in every cycle. The limit status is only stored, checkSensors() sends it. The new sensor bounds and the state machine requests
+ * are taken between two batches.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *pipelineProcessingTask(void *arg) {
+    struct pipelineStageStruct *stage = &pipelineStages[pipelineProcessing];
+    bool checkPending = true;
+    uint32_t nbWaits = 0;
+    (void)arg;
+    setRTThreadProfile(rtPipelineThread);
+    obdhPipelineProcessing = true;
+
+    while (true) {
+        statusErrDef ret = noError;
+        uint32_t tasks = pipelineTasks.exchange(0, std::memory_order_acquire);
+        if (tasks != 0)
+            runPipelineTasks(tasks);
+        ret = applyParamSensorsReload();
+        if (ret != noError)
+            sendTelemToTTC(ret);
+
+        int nbFrames = 0;
+        struct pipelineFrameStruct *message;
+        while (nbFrames < PIPELINE_BATCH_SIZE &&
+               (message = (struct pipelineFrameStruct*)peekSPSCRingSlot(&pipelineFrameQueue)) != NULL) {
+            ret = dispatchCANFrame(&message->frame, message->size);
+            releaseSPSCRingSlot(&pipelineFrameQueue);
+            if (ret != noError)
+                reportPipelineError(pipelineProcessing, ret);
+            nbFrames++;
+        }
+        stage->nbMessages += nbFrames;
+
+        // After every batch, and once more when the queue gets empty
+        if (nbFrames > 0 || checkPending) {
+            ret = flushCalibratedSensors();
+            if (ret != noError)
+                reportPipelineError(pipelineProcessing, ret);
+            // The state machine sends the limit status once per frame (see checkSensors())
+            ret = updateSensorLimits();
+            pipelineLimitStatus.store(getSensorLimitStatus(), std::memory_order_release);
+            if (ret != noError)
+                reportPipelineError(pipelineProcessing, ret);
+        }
+        checkPending = nbFrames > 0;
+
+        if (nbFrames > 0) {
+            nbWaits = 0;
+            continue;
+        }
+        if (stage->stop.load(std::memory_order_acquire) && isSPSCRingEmpty(&pipelineFrameQueue))
+            break;
+        waitPipelineStage(&nbWaits);
+    }
+    obdhPipelineProcessing = false;
+    endPipelineStage(pipelineProcessing);
+    return NULL;
+}
+
+/**
+ * \brief logging stage thread, writes the readings of the log queue
+ * to the sensor archive and the sensor log, and polls the sensor log
+ * (see pollSensorLog()) after every batch.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *pipelineLoggingTask(void *arg) {
+    struct pipelineStageStruct *stage = &pipelineStages[pipelineLogging];
+    uint32_t nbWaits = 0;
+    (void)arg;
+    setRTThreadProfile(rtIOThread);
+
+    while (true) {
+        statusErrDef ret = noError;
+        int nbRecords = 0;
+        struct sensorLogRecordStruct *record;
+        while (nbRecords < PIPELINE_BATCH_SIZE &&
+               (record = (struct sensorLogRecordStruct*)peekSPSCRingSlot(&pipelineLogQueue)) != NULL) {
+            ret = storeSensorRecord(record);
+            releaseSPSCRingSlot(&pipelineLogQueue);
+            if (ret != noError)
+                reportPipelineError(pipelineLogging, ret);
+            nbRecords++;
+        }
+        stage->nbMessages += nbRecords;
+        ret = pollSensorLog(getTimeSinceStart());
+        if (ret != noError)
+            reportPipelineError(pipelineLogging, ret);
+
+        if (nbRecords > 0) {
+            nbWaits = 0;
+            continue;
+        }
+        if (stage->stop.load(std::memory_order_acquire) && isSPSCRingEmpty(&pipelineLogQueue))
+            break;
+        waitPipelineStage(&nbWaits);
+    }
+    endPipelineStage(pipelineLogging);
+    return NULL;
+}
+
+/**
+ * \brief downlink stage thread, sends the telemetry of the
+ * telemetry queue to the TT&C subsystem.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *pipelineDownlinkTask(void *arg) {
+    struct pipelineStageStruct *stage = &pipelineStages[pipelineDownlink];
+    uint32_t nbWaits = 0;
+    (void)arg;
+    setRTThreadProfile(rtIOThread);
+
+    while (true) {
+        int nbPackets = 0;
+        struct pipelineTelemStruct *telem;
+        while (nbPackets < PIPELINE_BATCH_SIZE &&
+               (telem = (struct pipelineTelemStruct*)peekSPSCRingSlot(&pipelineTelemQueue)) != NULL) {
+            // The error is printed, it can't be sent
+            sendUserDataToTTC(telem->userData, telem->length);
+            releaseSPSCRingSlot(&pipelineTelemQueue);
+            nbPackets++;
+        }
+        stage->nbMessages += nbPackets;
+
+        if (nbPackets > 0) {
+            nbWaits = 0;
+            continue;
+        }
+        if (stage->stop.load(std::memory_order_acquire) && isSPSCRingEmpty(&pipelineTelemQueue))
+            break;
+        waitPipelineStage(&nbWaits);
+    }
+    endPipelineStage(pipelineDownlink);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to allocate the pipeline queues, called by the
+ * OBDH initialisation so that the control mode doesn't allocate.
+ *
+ * \return statusErrDef that values:
+ * - errAllocPipelineRing when a queue can't be allocated
+ * - noError when the function exits successfully.
+ */
+statusErrDef initOBDHPipeline() {
+    statusErrDef ret = noError;
+    // A retried OBDH init starts again from freed queues
+    freeOBDHPipeline();
+    ret = initSPSCRing(&pipelineFrameQueue, sizeof(struct pipelineFrameStruct), PIPELINE_FRAME_SLOTS);
+    if (ret == noError)
+        ret = initSPSCRing(&pipelineLogQueue, sizeof(struct sensorLogRecordStruct), PIPELINE_LOG_SLOTS);
+    if (ret == noError)
+        ret = initSPSCRing(&pipelineTelemQueue, sizeof(struct pipelineTelemStruct), PIPELINE_TELEM_SLOTS);
+    if (ret != noError)
+        freeOBDHPipeline();
+    return ret;
+}
+
+/**
+ * \brief function to start the pipeline threads, the consumers first.
+ * Does nothing when the pipeline runs.
+ *
+ * \return statusErrDef that values:
+ * - errStartPipeline when the queues are not allocated or a thread
+ * can't be started (the started ones are stopped)
+ * - noError when the function exits successfully.
+ */
+statusErrDef startOBDHPipeline() {
+    if (obdhPipelineRunning)
+        return noError;
+    if (pipelineFrameQueue.slots == NULL || pipelineLogQueue.slots == NULL || pipelineTelemQueue.slots == NULL)
+        return errStartPipeline;
+
+    pipelineTasks.store(0);
+    pipelineLimitStatus.store(noError);
+    for (int s = NB_PIPELINE_STAGES - 1; s >= 0; s--) {
+        struct pipelineStageStruct *stage = &pipelineStages[s];
+        stage->stop.store(false);
+        if (pthread_create(&stage->thread, NULL, stage->task, NULL) != 0) {
+            perror("errStartPipeline");
+            obdhPipelineRunning = true;
+            stopOBDHPipeline();
+            return errStartPipeline;
+        }
+        stage->running = true;
+    }
+    obdhPipelineRunning = true;
+    return noError;
+}
+
+/**
+ * \brief function to stop the pipeline threads, the producers first:
+ * every queue is emptied by its consumer before it ends. Does nothing
+ * when the pipeline doesn't run.
+ */
+void stopOBDHPipeline() {
+    if (!obdhPipelineRunning)
+        return;
+    for (int s = 0; s < NB_PIPELINE_STAGES; s++) {
+        struct pipelineStageStruct *stage = &pipelineStages[s];
+        if (!stage->running)
+            continue;
+        stage->stop.store(true, std::memory_order_release);
+        pthread_join(stage->thread, NULL);
+        stage->running = false;
+    }
+    obdhPipelineRunning = false;
+}
+
+/**
+ * \brief function to stop the pipeline and free its queues.
+ */
+void freeOBDHPipeline() {
+    stopOBDHPipeline();
+    freeSPSCRing(&pipelineFrameQueue);
+    freeSPSCRing(&pipelineLogQueue);
+    freeSPSCRing(&pipelineTelemQueue);
+}
+
+/**
+ * \brief function to post requests to the processing stage,
+ * they are run before its next batch.
+ *
+ * \param tasks the requests (pipelineTaskDef bits)
+ */
+void requestOBDHPipelineTasks(uint32_t tasks) {
+    pipelineTasks.fetch_or(tasks, std::memory_order_release);
+}
+
+/**
+ * \brief function to get the result of the last sensor limit
+ * check of the processing stage.
+ *
+ * \return statusErrDef that values:
+ * - errSensorCriticalValue when a sensor is out of its critical bounds,
+ * - errSensorWarningValue when a sensor is out of its warning bounds,
+ * - noError otherwise.
+ */
+statusErrDef getOBDHPipelineLimitStatus() {
+    return (statusErrDef)pipelineLimitStatus.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief function to hand telemetry user data to the downlink
+ * stage, processing stage only.
+ *
+ * \param userData the telemetry user data
+ * \param length the number of bytes of userData
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when the telemetry is larger than UDP_MAX_BUFFER_SIZE,
+ * - noError when the function exits successfully.
+ */
+statusErrDef queuePipelineTelemetry(const uint8_t *userData, size_t length) {
+    if (length > UDP_MAX_BUFFER_SIZE)
+        return errWriteUDPTelem;
+    struct pipelineTelemStruct *telem = (struct pipelineTelemStruct*)reservePipelineSlot(&pipelineTelemQueue);
+    telem->length = (uint16_t)length;
+    memcpy(telem->userData, userData, length);
+    publishSPSCRingSlot(&pipelineTelemQueue);
+    return noError;
+}
+
+/**
+ * \brief function to hand a sensor reading to the logging
+ * stage, processing stage only.
+ *
+ * \param record the sensor reading
+ */
+void queuePipelineLogRecord(const struct sensorLogRecordStruct *record) {
+    struct sensorLogRecordStruct *slot = (struct sensorLogRecordStruct*)reservePipelineSlot(&pipelineLogQueue);
+    memcpy(slot, record, sizeof(struct sensorLogRecordStruct));
+    publishSPSCRingSlot(&pipelineLogQueue);
+}
+
+/**
+ * \brief function to print the messages and CPU time of every stage
+ * and the backpressure counters of every queue.
+ */
+void printOBDHPipelineStats() {
+    if (pipelineFrameQueue.slots == NULL)
+        return;
+    for (int s = 0; s < NB_PIPELINE_STAGES; s++) {
+        const struct pipelineStageStruct *stage = &pipelineStages[s];
+        printf("pipeline %s: %llu messages, %llu us CPU\n", stage->name,
+               (unsigned long long)stage->nbMessages, (unsigned long long)(stage->busyTime / 1000));
+    }
+    printSPSCRingStats(&pipelineFrameQueue, "pipeline frame");
+    printSPSCRingStats(&pipelineLogQueue, "pipeline log");
+    printSPSCRingStats(&pipelineTelemQueue, "pipeline telemetry");
+}
@@ -0,0 +1,399 @@
+/**
+ * \file paramCSV.cpp
+ * \brief paramSensors.csv parser functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * paramSensors.csv parser functions, the whole file is memory mapped,
+ * the line and column delimiters are found with memchr() (vectorised
+ * by the C library) and the numbers are converted in place, without
+ * copying the lines. The sensor arrays grow geometrically so that the
+ * file is read only once.
+ *
+ */
+#include "paramCSV.h"
+#include "derivedParam.h"
+#include "sensorCalibration.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+bool parseCSVInteger(const char *first, const char *last, int64_t minValue, int64_t maxValue, int64_t *value);
+statusErrDef parseParamSensorsLine(const char *fileName, int lineNumber, const char *line,
+                                   const char *lineEnd, struct paramSensorsStruct *param, int pos,
+                                   bool withExpressions);
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief number of calibrations different from the calibrations in use
+ * read by the last parseParamSensorsCSV() call without the expressions
+ * (a reload, the calibrations are not reloaded).
+ */
+int nbChangedCalibrations = 0;
+
+/**
+ * \brief number of derived parameters expressions different from the
+ * expressions in use read by the last parseParamSensorsCSV() call
+ * without the expressions (a sensor gaining or losing its expression
+ * is counted too).
+ */
+int nbChangedExpressions = 0;
+
+/**
+ * \brief sensors counted in nbChangedCalibrations and nbChangedExpressions
+ * (one bit per sensor index).
+ */
+uint64_t changedCalibrationMask[SENSOR_MASK_WORDS];
+uint64_t changedExpressionMask[SENSOR_MASK_WORDS];
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to convert a CSV field to an integer, the field
+ * must hold only the number (blanks around it are allowed),
+ * in decimal or in hexadecimal with the 0x prefix.
+ *
+ * \param first the first character of the field
+ * \param last the character after the field
+ * \param minValue the minimum accepted value
+ * \param maxValue the maximum accepted value
+ * \param value the converted value
+ *
+ * \return false when the field is not a number or is out of range.
+ */
+bool parseCSVInteger(const char *first, const char *last, int64_t minValue, int64_t maxValue, int64_t *value) {
+    while (first < last && (*first == ' ' || *first == '\t'))
+        first++;
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t'))
+        last--;
+
+    bool negative = false;
+    if (first < last && (*first == '-' || *first == '+')) {
+        negative = (*first == '-');
+        first++;
+    }
+    int base = 10;
+    if (last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X')) {
+        base = 16;
+        first += 2;
+    }
+    if (first == last || last - first > 16)
+        return false;
+
+    uint64_t magnitude = 0;
+    for (; first < last; first++) {
+        unsigned digit;
+        if (*first >= '0' && *first <= '9')
+            digit = *first - '0';
+        else if (base == 16 && (*first | 0x20) >= 'a' && (*first | 0x20) <= 'f')
+            digit = (*first | 0x20) - 'a' + 10;
+        else
+            return false;
+        magnitude = magnitude * base + digit;
+    }
+    // 16 digits at most, the magnitude fits in 64 bits
+    if (magnitude > (uint64_t)INT64_MAX)
+        return false;
+    int64_t result = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+    if (result < minValue || result > maxValue)
+        return false;
+    *value = result;
+    return true;
+}
+
+/**
+ * \brief function to fill the sensor pos from a paramSensors.csv line:
+ * Name;Id;minCriticalValue;minWarnValue;currentValue;maxWarnValue;maxCriticalValue;historyDepth;expectedPeriod;calibration
+ * The currentValue column is '#' (or empty), an initial value or
+ * '=' followed by a derived parameter expression (see derivedParam.h).
+ * The calibration column is '#' (or empty) or a calibration (see
+ * sensorCalibration.h). The historyDepth, expectedPeriod and calibration
+ * columns may be empty or missing, they then take their default (the
+ * default history depth, no staleness check and no calibration).
+ *
+ * \param fileName the file name, for the error messages
+ * \param lineNumber the line number, for the error messages
+ * \param line the first character of the line
+ * \param lineEnd the character after the line (carriage return excluded)
+ * \param param the sensors parameters
+ * \param pos the sensor index
+ * \param withExpressions false to check the derived parameters expressions
+ * and the calibrations without keeping them (see setDerivedExpression()
+ * and setSensorCalibration()), the calibrations different from the ones
+ * in use are counted in nbChangedCalibrations and the expressions in
+ * nbChangedExpressions
+ *
+ * \return statusErrDef that values:
+ * - errInvalidParamSensorsLine when the line is malformed
+ * - errInvalidDerivedExpression when the expression can't be copied
+ * - noError when the function exits successfully.
+ */
+statusErrDef parseParamSensorsLine(const char *fileName, int lineNumber, const char *line,
+                                   const char *lineEnd, struct paramSensorsStruct *param, int pos,
+                                   bool withExpressions) {
+    const char *field[PARAM_SENSORS_CSV_COLUMNS];
+    int nbColumns = 0;
+    const char *cursor = line;
+    for (;;) {
+        if (nbColumns == PARAM_SENSORS_CSV_COLUMNS) {
+            printf("%s:%d: more than %d columns\n", fileName, lineNumber, PARAM_SENSORS_CSV_COLUMNS);
+            return errInvalidParamSensorsLine;
+        }
+        field[nbColumns++] = cursor;
+        const char *separator = (const char*)memchr(cursor, ';', lineEnd - cursor);
+        if (separator == NULL)
+            break;
+        cursor = separator + 1;
+    }
+    if (nbColumns < PARAM_SENSORS_CSV_REQUIRED_COLUMNS) {
+        printf("%s:%d: %d columns, %d expected at least\n", fileName, lineNumber, nbColumns,
+               PARAM_SENSORS_CSV_REQUIRED_COLUMNS);
+        return errInvalidParamSensorsLine;
+    }
+    static const char *const columnName[PARAM_SENSORS_CSV_COLUMNS] = {
+        "Name", "Id", "minCriticalValue", "minWarnValue", "currentValue",
+        "maxWarnValue", "maxCriticalValue", "historyDepth", "expectedPeriod", "calibration"
+    };
+    int64_t value[PARAM_SENSORS_CSV_COLUMNS] = {0};
+    for (int c = 1; c < PARAM_SENSORS_CSV_COLUMNS; c++) {
+        // A missing trailing column is an empty field
+        const char *first = (c < nbColumns) ? field[c] : lineEnd;
+        const char *last = (c + 1 < nbColumns) ? field[c + 1] - 1 : lineEnd;
+        bool valid;
+        if (c == 1)
+            valid = parseCSVInteger(first, last, SENSOR_ID_MIN, SENSOR_ID_MAX, &value[c]);
+        else if ((c == 7 || c == 8) && first == last)
+            valid = true;
+        else if (c == 7)
+            valid = parseCSVInteger(first, last, 0, SENSOR_HISTORY_MAX_DEPTH, &value[c]);
+        else if (c == 8)
+            valid = parseCSVInteger(first, last, 0, SENSOR_STALE_MAX_PERIOD, &value[c]);
+        else if (c == 9 && !withExpressions) {
+            if (first == last || *first == '#')
+                valid = (last - first <= 1);
+            else
+                valid = (checkSensorCalibration(first, last - first) == noError);
+            int index = getSensorIndex((uint16_t)value[1]);
+            if (valid && index >= 0 && !isSameSensorCalibration(index, first, last - first)) {
+                changedCalibrationMask[index >> 6] |= 1ULL << (index & 63);
+                nbChangedCalibrations++;
+            }
+        }
+        else if ((c == 4 || c == 9) && (first == last || *first == '#'))
+            valid = (last - first <= 1);
+        else if (c == 9)
+            valid = (setSensorCalibration(pos, first, last - first) == noError);
+        else if (c == 4 && *first == '=') {
+            if (withExpressions && setDerivedExpression(pos, first + 1, last - first - 1) != noError)
+                return errInvalidDerivedExpression;
+            valid = (last - first > 1);
+        }
+        else
+            valid = parseCSVInteger(first, last, INT32_MIN, INT32_MAX, &value[c]);
+        if (!valid) {
+            printf("%s:%d: invalid %s \"%.*s\"\n", fileName, lineNumber, columnName[c],
+                   (int)(last - first), first);
+            return errInvalidParamSensorsLine;
+        }
+    }
+    if (value[2] > value[3] || value[3] > value[5] || value[5] > value[6]) {
+        printf("%s:%d: bounds must be minCritical <= minWarn <= maxWarn <= maxCritical\n",
+               fileName, lineNumber);
+        return errInvalidParamSensorsLine;
+    }
+    if (!withExpressions) {
+        const char *expression = field[4];
+        size_t length = field[5] - 1 - field[4];
+        bool derived = (length > 0 && *expression == '=');
+        int index = getSensorIndex((uint16_t)value[1]);
+        if (index >= 0 && !isSameDerivedExpression(index, derived ? expression + 1 : NULL, derived ? length - 1 : 0)) {
+            changedExpressionMask[index >> 6] |= 1ULL << (index & 63);
+            nbChangedExpressions++;
+        }
+    }
+
+    param->id[pos] = (uint16_t)value[1];
+    param->minCriticalValue[pos] = (int32_t)value[2];
+    param->minWarnValue[pos] = (int32_t)value[3];
+    param->currentValue[pos] = (int32_t)value[4];
+    param->maxWarnValue[pos] = (int32_t)value[5];
+    param->maxCriticalValue[pos] = (int32_t)value[6];
+    param->historyDepth[pos] = (uint32_t)value[7];
+    param->expectedPeriod[pos] = (uint32_t)value[8];
+    return noError;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read every sensor of "paramSensors.csv" in
+ * a single pass. The first line is the header, blank lines are
+ * skipped. The sensor arrays of param are allocated here, param
+ * arrays are set to NULL when the file declares no sensor.
+ *
+ * \param fileName location and name of the CSV file to read
+ * \param param the sensors parameters to fill
+ * \param nbSensors the number of sensors read
+ * \param withExpressions true to keep the derived parameters expressions
+ * and the calibrations for compileDerivedParameters() and
+ * compileSensorCalibrations()
+ *
+ * \return statusErrDef that values:
+ * - errOpenParamSensorsFile when the paramSensors.csv file fails to open or to be mapped
+ * - errAllocParamSensorStruct when the sensor arrays cannot be allocated
+ * - errTooManySensors when the file declares more than MAX_SENSORS sensors
+ * - errInvalidParamSensorsLine when a line is malformed (the line number is printed)
+ * - errInvalidDerivedExpression when a derived parameter expression can't be copied
+ * - noError when the function exits successfully.
+ */
+statusErrDef parseParamSensorsCSV(const char *fileName, struct paramSensorsStruct *param, int *nbSensors,
+                                  bool withExpressions) {
+    statusErrDef ret = noError;
+    memset(param, 0, sizeof(struct paramSensorsStruct));
+    *nbSensors = 0;
+    if (!withExpressions) {
+        nbChangedCalibrations = 0;
+        nbChangedExpressions = 0;
+        memset(changedCalibrationMask, 0, sizeof(changedCalibrationMask));
+        memset(changedExpressionMask, 0, sizeof(changedExpressionMask));
+    }
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        perror("errOpenParamSensorsFile");
+        return errOpenParamSensorsFile;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0) {
+        perror("errOpenParamSensorsFile");
+        close(fd);
+        return errOpenParamSensorsFile;
+    }
+    if (fileStat.st_size == 0) {
+        close(fd);
+        return ret;
+    }
+    const char *data = (const char*)mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("errOpenParamSensorsFile");
+        return errOpenParamSensorsFile;
+    }
+    madvise((void*)data, fileStat.st_size, MADV_SEQUENTIAL);
+
+    const char *cursor = data;
+    const char *end = data + fileStat.st_size;
+    int lineNumber = 0;
+    int capacity = 0;
+    while (cursor < end) {
+        const char *lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+        const char *next = (lineEnd != NULL) ? lineEnd + 1 : end;
+        if (lineEnd == NULL)
+            lineEnd = end;
+        if (lineEnd > cursor && lineEnd[-1] == '\r')
+            lineEnd--;
+        lineNumber++;
+
+        // The header and the blank lines hold no sensor
+        if (lineNumber == 1 || lineEnd == cursor) {
+            cursor = next;
+            continue;
+        }
+
+        if (*nbSensors == capacity) {
+            if (capacity == MAX_SENSORS) {
+                printf("%s:%d: more than %d sensors\n", fileName, lineNumber, MAX_SENSORS);
+                ret = errTooManySensors;
+                break;
+            }
+            capacity = (capacity == 0) ? PARAM_SENSORS_INITIAL_CAPACITY : capacity * 2;
+            if (capacity > MAX_SENSORS)
+                capacity = MAX_SENSORS;
+            ret = growParamSensorsArrays(param, capacity);
+            if (ret != noError) {
+                perror("errAllocParamSensorStruct");
+                break;
+            }
+        }
+
+        ret = parseParamSensorsLine(fileName, lineNumber, cursor, lineEnd, param, *nbSensors, withExpressions);
+        if (ret != noError)
+            break;
+        (*nbSensors)++;
+        cursor = next;
+    }
+    munmap((void*)data, fileStat.st_size);
+
+    if (ret != noError || *nbSensors == 0) {
+        freeParamSensorsArrays(param);
+        *nbSensors = 0;
+    }
+    return ret;
+}
+
+/**
+ * \brief function to reallocate the sensor arrays.
+ *
+ * \param param the sensors parameters
+ * \param capacity the new number of sensors
+ *
+ * \return statusErrDef that values:
+ * - errAllocParamSensorStruct when an array cannot be reallocated
+ * (the arrays already reallocated are kept in param)
+ * - noError when the function exits successfully.
+ */
+statusErrDef growParamSensorsArrays(struct paramSensorsStruct *param, int capacity) {
+    void *array;
+    if ((array = realloc(param->id, capacity * sizeof(uint16_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->id = (uint16_t*)array;
+    if ((array = realloc(param->minCriticalValue, capacity * sizeof(int32_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->minCriticalValue = (int32_t*)array;
+    if ((array = realloc(param->minWarnValue, capacity * sizeof(int32_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->minWarnValue = (int32_t*)array;
+    if ((array = realloc(param->currentValue, capacity * sizeof(int32_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->currentValue = (int32_t*)array;
+    if ((array = realloc(param->maxWarnValue, capacity * sizeof(int32_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->maxWarnValue = (int32_t*)array;
+    if ((array = realloc(param->maxCriticalValue, capacity * sizeof(int32_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->maxCriticalValue = (int32_t*)array;
+    if ((array = realloc(param->historyDepth, capacity * sizeof(uint32_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->historyDepth = (uint32_t*)array;
+    if ((array = realloc(param->expectedPeriod, capacity * sizeof(uint32_t))) == NULL)
+        return errAllocParamSensorStruct;
+    param->expectedPeriod = (uint32_t*)array;
+    return noError;
+}
+
+/**
+ * \brief function to free the sensor arrays of the sensors parameters.
+ *
+ * \param param the sensors parameters
+ */
+void freeParamSensorsArrays(struct paramSensorsStruct *param) {
+    free(param->id);
+    free(param->minCriticalValue);
+    free(param->minWarnValue);
+    free(param->currentValue);
+    free(param->maxWarnValue);
+    free(param->maxCriticalValue);
+    free(param->historyDepth);
+    free(param->expectedPeriod);
+    memset(param, 0, sizeof(struct paramSensorsStruct));
+}
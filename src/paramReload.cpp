@@ -0,0 +1,407 @@
+/**
+ * \file paramReload.cpp
+ * \brief sensor bounds hot reload functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Sensor bounds hot reload functions, the reload thread reads the
+ * parameters file into a fresh table whose id, currentValue, historyDepth
+ * and expectedPeriod arrays are the ones of the table in use (only the bounds
+ * arrays are new), and hands it over through an atomic pointer. The
+ * calibrations are not reloaded, a file that changes them is reported.
+ * The control loop takes it at the start of a cycle, between two limit
+ * checks, so the readers never wait for a lock. The replaced table is
+ * freed by the reload thread once the control loop has gone through
+ * PARAM_RELOAD_GRACE_EPOCHS more cycles (RCU like grace period).
+ *
+ */
+#include "paramReload.h"
+#include "paramCSV.h"
+#include "paramTable.h"
+#include "limitCheck.h"
+#include "rtProfile.h"
+
+#include <atomic>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void *paramReloadTask(void *arg);
+void reloadParamSensors();
+void reclaimParamSensorsTable();
+void freeParamSensorsBounds(struct paramSensorsStruct *table);
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief number of sensor bounds reloads taken by the control loop.
+ */
+uint32_t nbParamSensorsReloads = 0;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief reload thread and its stop request.
+ */
+static pthread_t paramReloadThread;
+static std::atomic<bool> paramReloadStop(false);
+static bool paramReloadRunning = false;
+
+/**
+ * \brief inotify descriptor watching the parameters file directory and
+ * event descriptor waking the reload thread (TC or stop request).
+ */
+static int paramReloadInotifyFd = -1;
+static int paramReloadEventFd = -1;
+
+/**
+ * \brief watched parameters file, its name in the directory and its
+ * number of sensors.
+ */
+static char paramReloadPath[MAX_PATH_LENGHT];
+static char paramReloadName[MAX_PATH_LENGHT];
+
+/**
+ * \brief watched overlay file and its name in the directory, empty
+ * without the built-in table.
+ */
+static char paramReloadOverlayPath[MAX_PATH_LENGHT];
+static char paramReloadOverlayName[MAX_PATH_LENGHT];
+static int paramReloadNbSensors = 0;
+
+/**
+ * \brief arrays shared by every table, they are never reloaded.
+ */
+static uint16_t *sharedId = NULL;
+static int32_t *sharedCurrentValue = NULL;
+static uint32_t *sharedHistoryDepth = NULL;
+static uint32_t *sharedExpectedPeriod = NULL;
+
+/**
+ * \brief table read by the reload thread, waiting for the control loop.
+ */
+static std::atomic<struct paramSensorsStruct*> pendingTable(NULL);
+
+/**
+ * \brief table replaced by the control loop, waiting for its grace
+ * period, and the control loop cycle at which it was replaced.
+ */
+static std::atomic<struct paramSensorsStruct*> retiredTable(NULL);
+static uint64_t retiredEpoch = 0;
+
+/**
+ * \brief control loop cycles, one quiescent state of the readers each.
+ */
+static std::atomic<uint64_t> readerEpoch(0);
+
+/**
+ * \brief result of the last failed reload, for the control loop.
+ */
+static std::atomic<int> reloadFailure(noError);
+
+/**
+ * \brief the last file read changes calibrations, they are not reloaded.
+ */
+static std::atomic<bool> calibrationsChanged(false);
+
+/**
+ * \brief the last file read changes derived parameters expressions,
+ * they are not reloaded.
+ */
+static std::atomic<bool> expressionsChanged(false);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to free the bounds arrays of a table and the
+ * table itself, the shared arrays are kept.
+ *
+ * \param table the table to free
+ */
+void freeParamSensorsBounds(struct paramSensorsStruct *table) {
+    free(table->minCriticalValue);
+    free(table->minWarnValue);
+    free(table->maxWarnValue);
+    free(table->maxCriticalValue);
+    free(table);
+}
+
+/**
+ * \brief function to read the parameters file into a new table and
+ * to publish it, the file must declare the same sensors in the same
+ * order. Runs in the reload thread.
+ */
+void reloadParamSensors() {
+    struct paramSensorsStruct fresh;
+    int nbSensors = 0;
+    statusErrDef ret;
+#if PARAM_SENSORS_BUILTIN
+    ret = loadParamSensorsTable(paramReloadPath, paramReloadOverlayPath, &fresh, &nbSensors, false);
+#else
+    ret = parseParamSensorsCSV(paramReloadPath, &fresh, &nbSensors, false);
+#endif
+    if (ret != noError) {
+        printf("%s: reload failed (0x%04X), previous bounds kept\n", paramReloadPath, ret);
+        reloadFailure.store(errReloadParamSensors);
+        return;
+    }
+    if (nbSensors != paramReloadNbSensors ||
+        memcmp(fresh.id, sharedId, nbSensors * sizeof(uint16_t)) != 0) {
+        printf("%s: the sensor set changed (%d sensors instead of %d), restart to apply it\n",
+               paramReloadPath, nbSensors, paramReloadNbSensors);
+        freeParamSensorsArrays(&fresh);
+        reloadFailure.store(errReloadParamSensors);
+        return;
+    }
+
+    struct paramSensorsStruct *table = (struct paramSensorsStruct*)malloc(sizeof(struct paramSensorsStruct));
+    if (table == NULL) {
+        freeParamSensorsArrays(&fresh);
+        reloadFailure.store(errReloadParamSensors);
+        return;
+    }
+    table->id = sharedId;
+    table->currentValue = sharedCurrentValue;
+    table->historyDepth = sharedHistoryDepth;
+    table->expectedPeriod = sharedExpectedPeriod;
+    table->minCriticalValue = fresh.minCriticalValue;
+    table->minWarnValue = fresh.minWarnValue;
+    table->maxWarnValue = fresh.maxWarnValue;
+    table->maxCriticalValue = fresh.maxCriticalValue;
+    free(fresh.id);
+    free(fresh.currentValue);
+    free(fresh.historyDepth);
+    free(fresh.expectedPeriod);
+
+    if (nbChangedCalibrations > 0)
+        printf("%s: %d calibrations changed, restart to apply them\n", paramReloadPath, nbChangedCalibrations);
+    calibrationsChanged.store(nbChangedCalibrations > 0, std::memory_order_relaxed);
+    if (nbChangedExpressions > 0)
+        printf("%s: %d derived parameters expressions changed, restart to apply them\n", paramReloadPath,
+               nbChangedExpressions);
+    expressionsChanged.store(nbChangedExpressions > 0, std::memory_order_relaxed);
+
+    // A table the control loop has not taken yet is replaced
+    struct paramSensorsStruct *previous = pendingTable.exchange(table, std::memory_order_acq_rel);
+    if (previous != NULL)
+        freeParamSensorsBounds(previous);
+    printf("%s: new sensor bounds read\n", paramReloadPath);
+}
+
+/**
+ * \brief function to free the replaced table once the control loop
+ * has gone through its grace period. Runs in the reload thread.
+ */
+void reclaimParamSensorsTable() {
+    struct paramSensorsStruct *table = retiredTable.load(std::memory_order_acquire);
+    if (table == NULL)
+        return;
+    if (readerEpoch.load(std::memory_order_acquire) - retiredEpoch < PARAM_RELOAD_GRACE_EPOCHS)
+        return;
+    freeParamSensorsBounds(table);
+    retiredTable.store(NULL, std::memory_order_release);
+}
+
+/**
+ * \brief parameters reload thread, waits for a modification of the
+ * parameters file or for a reload request.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *paramReloadTask(void *arg) {
+    (void)arg;
+    setRTThreadProfile(rtIOThread);
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2];
+    fds[0].fd = paramReloadInotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = paramReloadEventFd;
+    fds[1].events = POLLIN;
+
+    while (!paramReloadStop.load()) {
+        bool reload = false;
+        if (poll(fds, 2, PARAM_RELOAD_POLL_PERIOD) > 0) {
+            if (fds[0].revents & POLLIN) {
+                ssize_t length = read(paramReloadInotifyFd, events, sizeof(events));
+                for (ssize_t offset = 0; offset < length; ) {
+                    const struct inotify_event *event = (const struct inotify_event*)(events + offset);
+                    if (event->len > 0 && (strcmp(event->name, paramReloadName) == 0 ||
+                                           strcmp(event->name, paramReloadOverlayName) == 0))
+                        reload = true;
+                    offset += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                uint64_t requests;
+                if (read(paramReloadEventFd, &requests, sizeof(requests)) == sizeof(requests))
+                    reload = true;
+            }
+        }
+        if (paramReloadStop.load())
+            break;
+        reclaimParamSensorsTable();
+        if (reload)
+            reloadParamSensors();
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to start watching the parameters file.
+ *
+ * \param fileName location and name of the parameters file
+ * (it may not exist yet, its directory is watched)
+ * \param overlayFileName location and name of the overlay file watched
+ * with the built-in table, NULL without it
+ * \param param the sensors parameters in use
+ * \param nbSensors the number of sensors
+ *
+ * \return statusErrDef that values:
+ * - errStartParamReload when the file watch or the reload thread can't be started
+ * - noError when the function exits successfully.
+ */
+statusErrDef initParamSensorsReload(const char *fileName, const char *overlayFileName,
+                                    struct paramSensorsStruct *param, int nbSensors) {
+    if (param == NULL || nbSensors == 0)
+        return noError;
+    // A retried OBDH init must not leave a thread polling the closed files
+    closeParamSensorsReload();
+
+    char directory[MAX_PATH_LENGHT];
+    char name[MAX_PATH_LENGHT];
+    snprintf(paramReloadPath, sizeof(paramReloadPath), "%s", fileName);
+    snprintf(directory, sizeof(directory), "%s", fileName);
+    snprintf(name, sizeof(name), "%s", fileName);
+    snprintf(paramReloadName, sizeof(paramReloadName), "%s", basename(name));
+    paramReloadOverlayPath[0] = '\0';
+    paramReloadOverlayName[0] = '\0';
+    if (overlayFileName != NULL) {
+        snprintf(paramReloadOverlayPath, sizeof(paramReloadOverlayPath), "%s", overlayFileName);
+        snprintf(name, sizeof(name), "%s", overlayFileName);
+        snprintf(paramReloadOverlayName, sizeof(paramReloadOverlayName), "%s", basename(name));
+    }
+    sharedId = param->id;
+    sharedCurrentValue = param->currentValue;
+    sharedHistoryDepth = param->historyDepth;
+    sharedExpectedPeriod = param->expectedPeriod;
+    paramReloadNbSensors = nbSensors;
+    reloadFailure.store(noError);
+
+    paramReloadInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    paramReloadEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // Editors replace the file (rename) as often as they rewrite it
+    bool watched = (paramReloadInotifyFd >= 0 && paramReloadEventFd >= 0 &&
+                    inotify_add_watch(paramReloadInotifyFd, dirname(directory), IN_CLOSE_WRITE | IN_MOVED_TO) >= 0);
+    if (watched && overlayFileName != NULL) {
+        snprintf(directory, sizeof(directory), "%s", overlayFileName);
+        watched = (inotify_add_watch(paramReloadInotifyFd, dirname(directory), IN_CLOSE_WRITE | IN_MOVED_TO) >= 0);
+    }
+    if (!watched) {
+        perror("errStartParamReload");
+        closeParamSensorsReload();
+        return errStartParamReload;
+    }
+
+    paramReloadStop.store(false);
+    if (pthread_create(&paramReloadThread, NULL, paramReloadTask, NULL) != 0) {
+        perror("errStartParamReload");
+        closeParamSensorsReload();
+        return errStartParamReload;
+    }
+    paramReloadRunning = true;
+    return noError;
+}
+
+/**
+ * \brief function to ask the reload thread to read the
+ * parameters file again (TCReloadParamSensors).
+ */
+void requestParamSensorsReload() {
+    uint64_t request = 1;
+    if (paramReloadEventFd >= 0 && write(paramReloadEventFd, &request, sizeof(request)) < 0)
+        perror("requestParamSensorsReload");
+}
+
+/**
+ * \brief function to take the table published by the reload thread,
+ * called by the control loop at the start of a cycle (a quiescent
+ * state: no pointer to the sensor bounds is held). The sensor limit
+ * masks are computed again with the new bounds. A new table is taken
+ * only once the previous replaced table has been freed.
+ *
+ * \return statusErrDef that values:
+ * - infoParamSensorsReloaded when new bounds are in use
+ * - errCalibrationNotReloaded when new bounds are in use but the file
+ *   changes calibrations, the previous calibrations are kept
+ * - errExpressionNotReloaded when new bounds are in use but the file
+ *   changes derived parameters expressions (and no calibration), the
+ *   previous expressions are kept
+ * - errReloadParamSensors when the last reload failed (reported once)
+ * - noError when there is no new table.
+ */
+statusErrDef applyParamSensorsReload() {
+    readerEpoch.fetch_add(1, std::memory_order_release);
+    statusErrDef failure = (statusErrDef)reloadFailure.exchange(noError);
+    if (failure != noError)
+        return failure;
+    if (retiredTable.load(std::memory_order_acquire) != NULL)
+        return noError;
+
+    struct paramSensorsStruct *table = pendingTable.exchange(NULL, std::memory_order_acq_rel);
+    if (table == NULL)
+        return noError;
+    struct paramSensorsStruct *previous = paramSensors;
+    paramSensors = table;
+    resetSensorLimitState(paramSensors, lineCountSensorParamCSV);
+    retiredEpoch = readerEpoch.load(std::memory_order_relaxed);
+    retiredTable.store(previous, std::memory_order_release);
+    nbParamSensorsReloads++;
+    printf("Sensor bounds reloaded (%u), %d sensors warn, %d critical\n",
+           nbParamSensorsReloads, nbSensorsWarn, nbSensorsCritical);
+    if (calibrationsChanged.load(std::memory_order_relaxed))
+        return errCalibrationNotReloaded;
+    if (expressionsChanged.load(std::memory_order_relaxed))
+        return errExpressionNotReloaded;
+    return infoParamSensorsReloaded;
+}
+
+/**
+ * \brief function to stop watching the parameters file and to free
+ * the tables that are not in use.
+ */
+void closeParamSensorsReload() {
+    if (paramReloadRunning) {
+        paramReloadStop.store(true);
+        requestParamSensorsReload();
+        pthread_join(paramReloadThread, NULL);
+        paramReloadRunning = false;
+    }
+    if (paramReloadInotifyFd >= 0)
+        close(paramReloadInotifyFd);
+    if (paramReloadEventFd >= 0)
+        close(paramReloadEventFd);
+    paramReloadInotifyFd = -1;
+    paramReloadEventFd = -1;
+
+    struct paramSensorsStruct *table = pendingTable.exchange(NULL);
+    if (table != NULL)
+        freeParamSensorsBounds(table);
+    table = retiredTable.exchange(NULL);
+    if (table != NULL)
+        freeParamSensorsBounds(table);
+}
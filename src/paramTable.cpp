@@ -0,0 +1,320 @@
+/**
+ * \file paramTable.cpp
+ * \brief built-in parameter database functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Built-in parameter database functions, the tables of the generated
+ * paramSensorsTable.h are copied to the runtime sensor arrays (the
+ * current values change and paramSensors.csv or the overlay may replace
+ * any column), their lines are matched to the built-in sensors by a
+ * binary search of the sorted ID index.
+ *
+ */
+#include "paramTable.h"
+#include "paramCSV.h"
+#include "derivedParam.h"
+#include "sensorCalibration.h"
+#include "paramSensorsTable.h"
+
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static statusErrDef readParamSensorsLayer(const char *fileName, struct paramSensorsStruct *layer, int *nbLayer,
+                                          bool withExpressions, char ***expression, char ***calibration);
+static statusErrDef applyParamSensorsLayer(const char *fileName, struct paramSensorsStruct *param, int *nbSensors,
+                                           int capacity, const struct paramSensorsStruct *layer, int nbLayer,
+                                           char **expression, char **calibration, bool withExpressions);
+static void freeParamSensorsLayer(struct paramSensorsStruct *layer, int nbLayer, char **expression,
+                                  char **calibration);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read a CSV file applied over the built-in table,
+ * the expressions and the calibrations it sets are taken back (they are
+ * set by sensor index once the built-in ones are set).
+ *
+ * \param fileName location and name of the CSV file, that may not exist
+ * \param layer the sensors parameters read
+ * \param nbLayer the number of sensors read
+ * \param withExpressions true to keep the expressions and the calibrations
+ * \param expression the expressions taken back, NULL without them
+ * \param calibration the calibrations taken back, NULL without them
+ *
+ * \return statusErrDef that values:
+ * - errAllocParamSensorStruct when the arrays cannot be allocated
+ * - the parseParamSensorsCSV() errors
+ * - noError when the function exits successfully.
+ */
+static statusErrDef readParamSensorsLayer(const char *fileName, struct paramSensorsStruct *layer, int *nbLayer,
+                                          bool withExpressions, char ***expression, char ***calibration) {
+    memset(layer, 0, sizeof(struct paramSensorsStruct));
+    *nbLayer = 0;
+    *expression = NULL;
+    *calibration = NULL;
+    if (!withExpressions) {
+        memset(changedCalibrationMask, 0, sizeof(changedCalibrationMask));
+        memset(changedExpressionMask, 0, sizeof(changedExpressionMask));
+    }
+    if (access(fileName, F_OK) != 0)
+        return noError;
+    statusErrDef ret = parseParamSensorsCSV(fileName, layer, nbLayer, withExpressions);
+    if (ret != noError || !withExpressions || *nbLayer == 0)
+        return ret;
+
+    *expression = (char**)calloc(*nbLayer, sizeof(char*));
+    *calibration = (char**)calloc(*nbLayer, sizeof(char*));
+    if (*expression == NULL || *calibration == NULL) {
+        freeParamSensorsLayer(layer, 0, *expression, *calibration);
+        *nbLayer = 0;
+        *expression = NULL;
+        *calibration = NULL;
+        return errAllocParamSensorStruct;
+    }
+    for (int j = 0; j < *nbLayer; j++) {
+        (*expression)[j] = takeDerivedExpression(j);
+        (*calibration)[j] = takeSensorCalibration(j);
+    }
+    return noError;
+}
+
+/**
+ * \brief function to replace the sensors of a CSV file in the sensor
+ * arrays, a sensor ID that is not in the arrays yet is appended.
+ *
+ * \param fileName location and name of the CSV file, for the error messages
+ * \param param the sensors parameters
+ * \param nbSensors the number of sensors
+ * \param capacity the size of the sensor arrays
+ * \param layer the sensors parameters read from the CSV file
+ * \param nbLayer the number of sensors read
+ * \param expression the expressions taken back, NULL without them
+ * \param calibration the calibrations taken back, NULL without them
+ * \param withExpressions true to set the expressions and the calibrations
+ *
+ * \return statusErrDef that values:
+ * - errTooManySensors when the file brings the sensors above capacity
+ * - errInvalidDerivedExpression when an expression can't be copied
+ * - errInvalidSensorCalibration when a calibration can't be copied
+ * - noError when the function exits successfully.
+ */
+static statusErrDef applyParamSensorsLayer(const char *fileName, struct paramSensorsStruct *param, int *nbSensors,
+                                           int capacity, const struct paramSensorsStruct *layer, int nbLayer,
+                                           char **expression, char **calibration, bool withExpressions) {
+    statusErrDef ret = noError;
+    for (int j = 0; j < nbLayer; j++) {
+        int i = findParamSensorsTableIndex(layer->id[j]);
+        for (int k = PARAM_SENSORS_TABLE_COUNT; i < 0 && k < *nbSensors; k++)
+            if (param->id[k] == layer->id[j])
+                i = k;
+        if (i < 0) {
+            if (*nbSensors == capacity) {
+                printf("%s: more than %d sensors with the built-in table\n", fileName, MAX_SENSORS);
+                return errTooManySensors;
+            }
+            i = (*nbSensors)++;
+        }
+        param->id[i] = layer->id[j];
+        param->minCriticalValue[i] = layer->minCriticalValue[j];
+        param->minWarnValue[i] = layer->minWarnValue[j];
+        param->currentValue[i] = layer->currentValue[j];
+        param->maxWarnValue[i] = layer->maxWarnValue[j];
+        param->maxCriticalValue[i] = layer->maxCriticalValue[j];
+        param->historyDepth[i] = layer->historyDepth[j];
+        param->expectedPeriod[i] = layer->expectedPeriod[j];
+        if (!withExpressions)
+            continue;
+        free(takeDerivedExpression(i));
+        if (expression[j] != NULL) {
+            ret = setDerivedExpression(i, expression[j], strlen(expression[j]));
+            if (ret != noError)
+                return ret;
+        }
+        free(takeSensorCalibration(i));
+        if (calibration[j] != NULL) {
+            ret = setSensorCalibration(i, calibration[j], strlen(calibration[j]));
+            if (ret != noError)
+                return ret;
+        }
+    }
+    return ret;
+}
+
+/**
+ * \brief function to free a CSV file read by readParamSensorsLayer().
+ *
+ * \param layer the sensors parameters read
+ * \param nbLayer the number of sensors read
+ * \param expression the expressions taken back, or NULL
+ * \param calibration the calibrations taken back, or NULL
+ */
+static void freeParamSensorsLayer(struct paramSensorsStruct *layer, int nbLayer, char **expression,
+                                  char **calibration) {
+    for (int j = 0; j < nbLayer && expression != NULL; j++)
+        free(expression[j]);
+    for (int j = 0; j < nbLayer && calibration != NULL; j++)
+        free(calibration[j]);
+    free(expression);
+    free(calibration);
+    freeParamSensorsArrays(layer);
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to get the number of sensors of the built-in table.
+ *
+ * \return the number of sensors of paramSensors.csv at build time.
+ */
+int getParamSensorsTableCount() {
+    return PARAM_SENSORS_TABLE_COUNT;
+}
+
+/**
+ * \brief function to find a sensor in the built-in table.
+ *
+ * \param sensorId the sensor ID
+ *
+ * \return the sensor index in the built-in table,
+ * or -1 when the sensor ID is not in the table.
+ */
+int findParamSensorsTableIndex(uint16_t sensorId) {
+    int low = 0;
+    int high = PARAM_SENSORS_TABLE_COUNT;
+    while (low < high) {
+        int middle = (low + high) >> 1;
+        if (paramSensorsTableSortedId[middle] < sensorId)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low < PARAM_SENSORS_TABLE_COUNT && paramSensorsTableSortedId[low] == sensorId)
+        return paramSensorsTableSortedIndex[low];
+    return -1;
+}
+
+/**
+ * \brief function to fill the sensor arrays from the built-in table, from
+ * paramSensors.csv and from the overlay CSV file when they exist. A line
+ * of paramSensors.csv or of the overlay (same format) replaces every
+ * column of the sensor with the same ID, so only the lines of
+ * paramSensors.csv edited since the build change the built-in sensors,
+ * the overlay lines are applied last. A sensor ID that is not built in
+ * is appended, a built-in sensor missing from paramSensors.csv is kept.
+ *
+ * \param fileName location and name of paramSensors.csv
+ * \param overlayFileName location and name of the overlay CSV file
+ * \param param the sensors parameters to fill
+ * \param nbSensors the number of sensors
+ * \param withExpressions true to keep the derived parameters expressions
+ * and the calibrations for compileDerivedParameters() and
+ * compileSensorCalibrations()
+ *
+ * \return statusErrDef that values:
+ * - errAllocParamSensorStruct when the sensor arrays cannot be allocated
+ * - errTooManySensors when the CSV files bring the sensors above MAX_SENSORS
+ * - errInvalidParamSensorsLine when a CSV line is malformed
+ * - errInvalidDerivedExpression when an expression can't be copied
+ * - errInvalidSensorCalibration when a calibration can't be copied
+ * - noError when the function exits successfully.
+ */
+statusErrDef loadParamSensorsTable(const char *fileName, const char *overlayFileName,
+                                   struct paramSensorsStruct *param, int *nbSensors, bool withExpressions) {
+    statusErrDef ret = noError;
+    struct paramSensorsStruct edited;
+    struct paramSensorsStruct overlay;
+    int nbEdited = 0;
+    int nbOverlay = 0;
+    char **editedExpression = NULL;
+    char **editedCalibration = NULL;
+    char **overlayExpression = NULL;
+    char **overlayCalibration = NULL;
+    uint64_t editedCalibrationMask[SENSOR_MASK_WORDS];
+    uint64_t editedExpressionMask[SENSOR_MASK_WORDS];
+    memset(param, 0, sizeof(struct paramSensorsStruct));
+    memset(&overlay, 0, sizeof(struct paramSensorsStruct));
+    *nbSensors = 0;
+
+    // The CSV expressions and calibrations are taken back before the built-in ones are set
+    ret = readParamSensorsLayer(fileName, &edited, &nbEdited, withExpressions, &editedExpression,
+                                &editedCalibration);
+    if (ret != noError)
+        return ret;
+    memcpy(editedCalibrationMask, changedCalibrationMask, sizeof(editedCalibrationMask));
+    memcpy(editedExpressionMask, changedExpressionMask, sizeof(editedExpressionMask));
+    ret = readParamSensorsLayer(overlayFileName, &overlay, &nbOverlay, withExpressions, &overlayExpression,
+                                &overlayCalibration);
+    if (ret != noError)
+        goto cleanup;
+    if (!withExpressions) {
+        // The overlaid sensors take the overlay calibrations and expressions
+        for (int j = 0; j < nbOverlay; j++) {
+            int index = getSensorIndex(overlay.id[j]);
+            if (index < 0)
+                continue;
+            editedCalibrationMask[index >> 6] &= ~(1ULL << (index & 63));
+            editedExpressionMask[index >> 6] &= ~(1ULL << (index & 63));
+        }
+        nbChangedCalibrations = 0;
+        nbChangedExpressions = 0;
+        for (int w = 0; w < SENSOR_MASK_WORDS; w++) {
+            changedCalibrationMask[w] |= editedCalibrationMask[w];
+            changedExpressionMask[w] |= editedExpressionMask[w];
+            nbChangedCalibrations += __builtin_popcountll(changedCalibrationMask[w]);
+            nbChangedExpressions += __builtin_popcountll(changedExpressionMask[w]);
+        }
+    }
+
+    {
+        int capacity = PARAM_SENSORS_TABLE_COUNT + nbEdited + nbOverlay;
+        if (capacity > MAX_SENSORS)
+            capacity = MAX_SENSORS;
+        if (capacity > 0) {
+            ret = growParamSensorsArrays(param, capacity);
+            if (ret != noError) {
+                perror("errAllocParamSensorStruct");
+                goto cleanup;
+            }
+        }
+
+        memcpy(param->id, paramSensorsTableId, PARAM_SENSORS_TABLE_COUNT * sizeof(uint16_t));
+        memcpy(param->minCriticalValue, paramSensorsTableMinCritical, PARAM_SENSORS_TABLE_COUNT * sizeof(int32_t));
+        memcpy(param->minWarnValue, paramSensorsTableMinWarn, PARAM_SENSORS_TABLE_COUNT * sizeof(int32_t));
+        memcpy(param->currentValue, paramSensorsTableCurrentValue, PARAM_SENSORS_TABLE_COUNT * sizeof(int32_t));
+        memcpy(param->maxWarnValue, paramSensorsTableMaxWarn, PARAM_SENSORS_TABLE_COUNT * sizeof(int32_t));
+        memcpy(param->maxCriticalValue, paramSensorsTableMaxCritical, PARAM_SENSORS_TABLE_COUNT * sizeof(int32_t));
+        memcpy(param->historyDepth, paramSensorsTableHistoryDepth, PARAM_SENSORS_TABLE_COUNT * sizeof(uint32_t));
+        memcpy(param->expectedPeriod, paramSensorsTableExpectedPeriod, PARAM_SENSORS_TABLE_COUNT * sizeof(uint32_t));
+        *nbSensors = PARAM_SENSORS_TABLE_COUNT;
+        for (int i = 0; i < PARAM_SENSORS_TABLE_COUNT && withExpressions && ret == noError; i++)
+            if (paramSensorsTableExpression[i] != NULL)
+                ret = setDerivedExpression(i, paramSensorsTableExpression[i], strlen(paramSensorsTableExpression[i]));
+        for (int i = 0; i < PARAM_SENSORS_TABLE_COUNT && withExpressions && ret == noError; i++)
+            if (paramSensorsTableCalibration[i] != NULL)
+                ret = setSensorCalibration(i, paramSensorsTableCalibration[i], strlen(paramSensorsTableCalibration[i]));
+        if (ret == noError)
+            ret = applyParamSensorsLayer(fileName, param, nbSensors, capacity, &edited, nbEdited,
+                                         editedExpression, editedCalibration, withExpressions);
+        if (ret == noError)
+            ret = applyParamSensorsLayer(overlayFileName, param, nbSensors, capacity, &overlay, nbOverlay,
+                                         overlayExpression, overlayCalibration, withExpressions);
+    }
+    if (ret == noError && (nbEdited > 0 || nbOverlay > 0))
+        printf("%d built-in sensors, %d read from %s, %d overlaid by %s\n", PARAM_SENSORS_TABLE_COUNT,
+               nbEdited, fileName, nbOverlay, overlayFileName);
+
+cleanup:
+    freeParamSensorsLayer(&edited, nbEdited, editedExpression, editedCalibration);
+    freeParamSensorsLayer(&overlay, nbOverlay, overlayExpression, overlayCalibration);
+    if (ret != noError) {
+        freeParamSensorsArrays(param);
+        *nbSensors = 0;
+    }
+    return ret;
+}
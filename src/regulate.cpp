@@ -11,6 +11,18 @@
 #include "regulate.h"
 #include "controlMode.h"
 #include "init.h"
+#include "limitCheck.h"
+#include "sensorHistory.h"
+#include "obdhPipeline.h"
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief one bit per sensor out of its warning bounds at the previous
+ * regulation pass, its history window has been sent.
+ */
+static uint64_t regulatedSensorMask[SENSOR_MASK_WORDS];
 
 //------------------------------------------------------------------------------
 // Local function definitions
@@ -18,28 +30,75 @@
 /**
  * \brief function to trigger regulation procedures
  * in the spacecraft sensor(s) location(s).
+ * Every sensor out of its warning bounds is regulated. While the OBDH
+ * pipeline runs, the processing stage owns the sensor values: its last
+ * limit check is used and it is asked to regulate the sensors.
  *
  * \return statusErrDef that values:
- * - errSensorCriticalValue when a sensor has reached a minimum or maximum warning value from the paramSensors.csv file.
+ * - errSensorCriticalValue when a sensor has reached a minimum or maximum critical value from the paramSensors.csv file.
+ * - errWriteSensorLog, errWriteSensorArchive or errWriteUDPTelem when
+ * a derived parameter value can't be recorded or sent, or a sensor
+ * history window can't be sent,
  * - noError when the function exits successfully.
  */
 statusErrDef regulateSubsystems() {
     statusErrDef ret = noError;
-    for(int i = 1; i < lineCountSensorParamCSV; i++) {
-		// Check if the sensor current value is out of its warning bounds
-		if(paramSensors->currentValue[i] <= paramSensors->minWarnValue[i] ||
-			paramSensors->currentValue[i] >= paramSensors->maxWarnValue[i]) {
-				// Check if the sensor current value is out of its critical bounds
-				if(paramSensors->currentValue[i] <= paramSensors->minCriticalValue[i] ||
-				paramSensors->currentValue[i] >= paramSensors->maxCriticalValue[i]) {
-					sendTelemToTTC(errSensorCriticalValue);
-					return errSensorCriticalValue;
-				}
-				else {
-                    //TODO
-				}
-			}
-	}
+    if (paramSensors == NULL)
+        return ret;
+
+    if (obdhPipelineRunning) {
+        if (getOBDHPipelineLimitStatus() == errSensorCriticalValue) {
+            sendTelemToTTC(errSensorCriticalValue);
+            return errSensorCriticalValue;
+        }
+        requestOBDHPipelineTasks(pipelineTaskRegulate);
+        return ret;
+    }
+
+    ret = updateSensorLimits();
+
+    // Check if a sensor current value is out of its critical bounds
+    if (getSensorLimitStatus() == errSensorCriticalValue) {
+        if (ret != noError)
+            sendTelemToTTC(ret);
+        sendTelemToTTC(errSensorCriticalValue);
+        return errSensorCriticalValue;
+    }
 
-	return ret;
+    statusErrDef regulateRet = regulateWarnSensors();
+    if (ret == noError)
+        ret = regulateRet;
+    return ret;
+}
+
+/**
+ * \brief function to regulate every sensor out of its warning bounds
+ * (see sensorWarnMask), in the thread that checks the sensor limits.
+ * The history window of a sensor entering its warning bounds since
+ * the previous pass is sent as an HKSensorWindow packet.
+ *
+ * \return statusErrDef that values:
+ * - errWriteUDPTelem when a packet can't be sent,
+ * - noError when the function exits successfully.
+ */
+statusErrDef regulateWarnSensors() {
+    statusErrDef ret = noError;
+    if (paramSensors == NULL)
+        return ret;
+    for (int w = 0; w < SENSOR_MASK_WORDS; w++) {
+        uint64_t bits = sensorWarnMask[w] & ~regulatedSensorMask[w];
+        regulatedSensorMask[w] = sensorWarnMask[w];
+        while (bits != 0) {
+            int i = (w << 6) + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            struct sensorWindowStruct window;
+            if (getSensorHistoryWindow(i, paramSensors->historyDepth[i], &window)) {
+                statusErrDef sendRet = sendSensorWindowToTTC(paramSensors->id[i], paramSensors->currentValue[i], &window);
+                if (ret == noError)
+                    ret = sendRet;
+            }
+            //TODO
+        }
+    }
+    return ret;
 }
@@ -10,6 +10,15 @@
  */
 #include "init.h"
 #include "restart.h"
+#include "canFilter.h"
+#include "sensorHistory.h"
+#include "sensorLog.h"
+#include "sensorArchive.h"
+#include "derivedParam.h"
+#include "sensorCalibration.h"
+#include "paramReload.h"
+#include "sensorStale.h"
+#include "obdhPipeline.h"
 
 //------------------------------------------------------------------------------
 // Local function definitions
@@ -68,23 +77,31 @@ statusErrDef closeUDPSocket() {
  */
 statusErrDef freeOBDH() {
 	statusErrDef ret = noError;
+	printOBDHPipelineStats();
+	freeOBDHPipeline();
+	printCANFilterStats();
 	ret = closeCANSocket();
-	free(paramSensors->id);
-	free(paramSensors->minCriticalValue);
-	free(paramSensors->minWarnValue);
-	free(paramSensors->currentValue);
-	free(paramSensors->maxWarnValue);
-	free(paramSensors->maxCriticalValue);
-	free(paramSensors);
-	paramSensors = NULL;
-	for(int i = 0; i < lineCountSensorParamCSV; i++) {
-		fclose(sensorsVal[i].sensorFile);
-		sensorsVal[i].sensorFile = NULL; // Prevent dangling pointer
+	closeParamSensorsReload();
+	// Already freed when the step is retried
+	if (paramSensors != NULL) {
+		free(paramSensors->id);
+		free(paramSensors->minCriticalValue);
+		free(paramSensors->minWarnValue);
+		free(paramSensors->currentValue);
+		free(paramSensors->maxWarnValue);
+		free(paramSensors->maxCriticalValue);
+		free(paramSensors->historyDepth);
+		free(paramSensors->expectedPeriod);
+		free(paramSensors);
+		paramSensors = NULL;
 	}
-	if (sensorsVal != NULL) {
-        free(sensorsVal);
-        sensorsVal = NULL;
-    }
+	printSensorArchiveStats();
+	closeSensorArchive();
+	closeSensorLog();
+	freeSensorHistory();
+	freeSensorStaleness();
+	freeDerivedParameters();
+	freeSensorCalibrations();
 	return ret;
 }
 
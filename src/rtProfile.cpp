@@ -0,0 +1,246 @@
+/**
+ * \file rtProfile.cpp
+ * \brief real-time execution profile functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Real-time profile functions. The heap is prefaulted then kept by
+ * malloc (no trimming, no mmap chunks), so the allocations after init
+ * don't fault, and mlockall(MCL_FUTURE) keeps the new pages resident.
+ * With RT_PROFILE, malloc, calloc and realloc are wrapped to count the
+ * allocations of the control thread, the glibc functions do the work.
+ *
+ */
+#include "rtProfile.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief true once the real-time profile has been applied (see initRTProfile()).
+ */
+bool rtProfileEnabled = false;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief true in the control thread once init has ended, its
+ * allocations are then counted (control thread only).
+ */
+static __thread bool rtCheckedThread = false;
+static uint64_t nbRTAllocations = 0;
+static uint64_t rtPageFaults = 0;
+
+/**
+ * \brief SCHED_FIFO priority and CPU of every real-time class,
+ * indexed by rtThreadDef.
+ */
+static const struct {
+    int priority;
+    int cpu;
+} rtThreadClasses[] = {
+    {RT_CONTROL_PRIORITY,   RT_CONTROL_CPU},
+    {RT_IO_PRIORITY,        RT_IO_CPU},
+    {RT_PIPELINE_PRIORITY,  RT_PIPELINE_CPU},
+};
+
+//------------------------------------------------------------------------------
+// Allocation counting
+//------------------------------------------------------------------------------
+#if RT_PROFILE
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t nbMembers, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+extern "C" void *malloc(size_t size) {
+    if (rtCheckedThread)
+        nbRTAllocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t nbMembers, size_t size) {
+    if (rtCheckedThread)
+        nbRTAllocations++;
+    return __libc_calloc(nbMembers, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+    if (rtCheckedThread)
+        nbRTAllocations++;
+    return __libc_realloc(pointer, size);
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void prefaultStack();
+static uint64_t getThreadPageFaults();
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to fault in RT_PREFAULT_STACK_SIZE bytes of
+ * the calling thread stack.
+ */
+static void __attribute__((noinline)) prefaultStack() {
+    volatile char stack[RT_PREFAULT_STACK_SIZE];
+    long pageSize = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < sizeof(stack); i += pageSize)
+        stack[i] = 0;
+}
+
+/**
+ * \brief function to get the number of page faults of the calling thread.
+ *
+ * \return the minor and major page faults since the thread start.
+ */
+static uint64_t getThreadPageFaults() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0)
+        return 0;
+    return (uint64_t)usage.ru_minflt + (uint64_t)usage.ru_majflt;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to apply the real-time profile to the process and
+ * to the calling (control) thread: memory locking, heap and stack
+ * prefaulting, SCHED_FIFO and CPU pinning. A part that can't be applied
+ * doesn't stop the others.
+ *
+ * \param enable false to keep the normal profile (the other rtProfile
+ * functions then do nothing)
+ *
+ * \return statusErrDef that values:
+ * - errRTProfile when the memory can't be locked or the thread
+ * scheduling can't be set,
+ * - noError when the function exits successfully.
+ */
+statusErrDef initRTProfile(bool enable) {
+    statusErrDef ret = noError;
+    rtProfileEnabled = enable;
+    if (!enable)
+        return ret;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        perror("errRTProfile mlockall");
+        ret = errRTProfile;
+    }
+    // Freed memory stays in the heap, new allocations reuse faulted pages
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    char *heap = (char*)malloc(RT_PREFAULT_HEAP_SIZE);
+    if (heap != NULL) {
+        long pageSize = sysconf(_SC_PAGESIZE);
+        for (size_t i = 0; i < RT_PREFAULT_HEAP_SIZE; i += pageSize)
+            heap[i] = 0;
+        free(heap);
+    }
+
+    statusErrDef threadRet = setRTThreadProfile(rtControlThread);
+    if (ret == noError)
+        ret = threadRet;
+    return ret;
+}
+
+/**
+ * \brief function to apply the real-time scheduling and CPU of its class
+ * to the calling thread and to prefault its stack, called at the start
+ * of every thread. Does nothing without the real-time profile.
+ *
+ * \param thread the real-time class of the calling thread
+ *
+ * \return statusErrDef that values:
+ * - errRTProfile when the CPU or the scheduling can't be set,
+ * - noError when the function exits successfully.
+ */
+statusErrDef setRTThreadProfile(rtThreadDef thread) {
+    statusErrDef ret = noError;
+    if (!rtProfileEnabled)
+        return ret;
+
+    int cpu = rtThreadClasses[thread].cpu;
+    if (cpu >= 0 && cpu < sysconf(_SC_NPROCESSORS_ONLN)) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0) {
+            errno = err;
+            perror("errRTProfile affinity");
+            ret = errRTProfile;
+        }
+    }
+    else if (cpu >= 0) {
+        printf("CPU %d not available, thread not pinned\n", cpu);
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = rtThreadClasses[thread].priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err != 0) {
+        errno = err;
+        perror("errRTProfile SCHED_FIFO");
+        ret = errRTProfile;
+    }
+
+    prefaultStack();
+    return ret;
+}
+
+/**
+ * \brief function to start counting the allocations and page faults
+ * of the calling (control) thread, called when init has ended.
+ */
+void armRTAllocationCheck() {
+    if (!rtProfileEnabled)
+        return;
+    nbRTAllocations = 0;
+    rtPageFaults = getThreadPageFaults();
+    rtCheckedThread = true;
+}
+
+/**
+ * \brief function to report the allocations and page faults of the
+ * control thread since the last call, a cyclic task of the control mode.
+ *
+ * \return statusErrDef that values:
+ * - errRTAllocation when the control thread has allocated memory,
+ * - errRTPageFault when the control thread has page faulted,
+ * - noError when the function exits successfully.
+ */
+statusErrDef checkRTProfile() {
+    statusErrDef ret = noError;
+    if (!rtProfileEnabled || !rtCheckedThread)
+        return ret;
+
+    uint64_t allocations = nbRTAllocations;
+    uint64_t faults = getThreadPageFaults() - rtPageFaults;
+    if (allocations > 0) {
+        printf("control thread: %llu allocations since the last check\n", (unsigned long long)allocations);
+        ret = errRTAllocation;
+    }
+    if (faults > 0) {
+        printf("control thread: %llu page faults since the last check\n", (unsigned long long)faults);
+        if (ret == noError)
+            ret = errRTPageFault;
+    }
+    nbRTAllocations = 0;
+    rtPageFaults = getThreadPageFaults();
+    return ret;
+}
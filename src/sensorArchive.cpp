@@ -0,0 +1,763 @@
+/**
+ * \file sensorArchive.cpp
+ * \brief sensor readings columnar archive functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * The readings of every sensor are staged in memory until the end of
+ * their time slice (or SENSOR_ARCHIVE_BLOCK_READINGS readings), then
+ * written as one block: a header with the time range and value range
+ * of the block, the timestamps column (differences with the previous
+ * timestamp) and the values column (zigzag encoded differences with
+ * the previous value), both as variable length integers.
+ * The block headers are kept in a per sensor index sorted by time, so
+ * that a query finds its first block by binary search and skips the
+ * blocks whose value range can't match without reading them. The index
+ * of a sensor is a ring of SENSOR_ARCHIVE_INDEX_BLOCKS entries allocated
+ * at init, a new block replaces the oldest one when it is full.
+ * The archive file is renamed with SENSOR_ARCHIVE_PREVIOUS_SUFFIX (which
+ * removes the previous one) once it reaches half of
+ * SENSOR_ARCHIVE_RETENTION_BYTES and a new archive file is started, the
+ * blocks of the previous file stay in the queries.
+ * The archive is kept across restarts: at the next start the index is
+ * rebuilt from the block headers of the previous file and of the file
+ * (a block cut by a crash is dropped), the blocks of a sensor no longer
+ * in the parameters are left out of the index, and the new readings are
+ * appended after the last archived reading time (see
+ * sensorArchiveTimeOffset).
+ *
+ */
+#include "sensorArchive.h"
+#include "sensorLog.h"
+#include "sensorLogCodec.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief time in microseconds added to the reading timestamps, the
+ * last reading time of the previous runs, so that the readings of a
+ * new run stay in time order with the archived ones.
+ */
+uint64_t sensorArchiveTimeOffset = 0;
+
+//------------------------------------------------------------------------------
+// Local structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct archiveIndexStruct
+ * \brief index entry of an archive block
+ *
+ */
+struct archiveIndexStruct {
+    struct sensorArchiveBlockStruct block;  /**< Block header */
+    uint64_t dataOffset;                    /**< Position of the block columns in the archive file */
+    uint32_t generation;                    /**< Archive file of the block (see archiveGeneration) */
+};
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief archive file, its write buffer and its size in bytes.
+ */
+static FILE *archiveFile = NULL;
+static char *archiveWriteBuffer = NULL;
+static uint64_t archiveFileSize = 0;
+
+/**
+ * \brief previous archive file (-1 when there is none) and its
+ * size in bytes.
+ */
+static int archivePreviousFile = -1;
+static uint64_t archivePreviousSize = 0;
+
+/**
+ * \brief size in bytes of the archive files removed since init.
+ */
+static uint64_t archiveRemovedSize = 0;
+
+/**
+ * \brief archive file and previous archive file names.
+ */
+static char archiveFileName[MAX_PATH_LENGHT];
+static char archivePreviousName[MAX_PATH_LENGHT];
+
+/**
+ * \brief generation of the archive file, incremented when it is
+ * renamed, the blocks of the generation before are in the previous file.
+ */
+static uint32_t archiveGeneration = 0;
+
+/**
+ * \brief true when blocks have been written since the last
+ * write buffer flush.
+ */
+static bool archiveUnflushed = false;
+
+/**
+ * \brief staged readings of the open block of every sensor
+ * (SENSOR_ARCHIVE_BLOCK_READINGS per sensor).
+ */
+static uint64_t *stagingTime = NULL;
+static int32_t *stagingValue = NULL;
+
+/**
+ * \brief number of staged readings and time slice of the
+ * open block of every sensor.
+ */
+static uint16_t stagingCount[MAX_SENSORS];
+static uint64_t stagingSlice[MAX_SENSORS];
+
+/**
+ * \brief sensor ID of every sensor index.
+ */
+static uint16_t archiveSensorId[MAX_SENSORS];
+
+/**
+ * \brief block index of every sensor (SENSOR_ARCHIVE_INDEX_BLOCKS
+ * per sensor), a ring in time order from indexHead.
+ */
+static struct archiveIndexStruct *archiveIndex = NULL;
+static uint16_t indexHead[MAX_SENSORS];
+static uint16_t indexCount[MAX_SENSORS];
+
+static_assert(SENSOR_ARCHIVE_INDEX_BLOCKS <= UINT16_MAX, "the sensor archive index positions are 16 bits");
+
+/**
+ * \brief number of sensors of the archive.
+ */
+static int nbArchiveSensors = 0;
+
+/**
+ * \brief archive statistics.
+ */
+static uint64_t nbArchivedReadings = 0;
+static uint64_t nbArchiveBlocks = 0;
+static uint64_t nbBlocksRead = 0;
+static uint64_t nbBlocksSkipped = 0;
+static uint64_t nbBlocksUnindexed = 0;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static statusErrDef writeArchiveBlock(int index);
+static statusErrDef writeArchiveHeader();
+static statusErrDef createArchiveFile();
+static statusErrDef rotateArchiveFile();
+static void openPreviousArchiveFile();
+static void addArchiveIndex(int index, const struct archiveIndexStruct *entry);
+static uint64_t indexArchiveFile(int file, uint64_t fileSize, uint32_t generation, uint64_t *lastTime);
+static statusErrDef rebuildArchiveIndex();
+static bool readArchiveBlock(const struct archiveIndexStruct *entry, uint64_t *timeStamp, int32_t *value);
+static uint32_t findArchiveBlock(int index, uint64_t time);
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to write the header of an empty archive file.
+ *
+ * \return statusErrDef that values:
+ * - errOpenSensorArchive when the header can't be written
+ * - noError when the function exits successfully.
+ */
+static statusErrDef writeArchiveHeader() {
+    struct sensorLogHeaderStruct header;
+
+    setvbuf(archiveFile, archiveWriteBuffer, _IOFBF, SENSOR_ARCHIVE_WRITE_BUFFER);
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SENSOR_ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = SENSOR_LOG_VERSION;
+    header.recordSize = sizeof(struct sensorArchiveBlockStruct);
+    if (fwrite(&header, sizeof(header), 1, archiveFile) != 1) {
+        perror("File write error");
+        return errOpenSensorArchive;
+    }
+    archiveFileSize = sizeof(header);
+    archiveUnflushed = true;
+    return noError;
+}
+
+/**
+ * \brief function to create an empty archive file (archiveFileName)
+ * and write its header.
+ *
+ * \return statusErrDef that values:
+ * - errOpenSensorArchive when the archive file can't be created
+ * - noError when the function exits successfully.
+ */
+static statusErrDef createArchiveFile() {
+    archiveFile = fopen(archiveFileName, "w+b");
+    if (archiveFile == NULL) {
+        perror("File open error");
+        return errOpenSensorArchive;
+    }
+    if (archivePreviousFile < 0)
+        sensorArchiveTimeOffset = 0;
+    return writeArchiveHeader();
+}
+
+/**
+ * \brief function to rename the archive file with
+ * SENSOR_ARCHIVE_PREVIOUS_SUFFIX, which removes the previous archive
+ * file and its blocks from the index, and start a new archive file.
+ * The stream and its write buffer are reused, nothing is allocated.
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorArchive when the archive file can't be renamed or created
+ * - noError when the function exits successfully.
+ */
+static statusErrDef rotateArchiveFile() {
+    if (fflush(archiveFile) != 0) {
+        perror("errWriteSensorArchive");
+        return errWriteSensorArchive;
+    }
+    archiveUnflushed = false;
+    int previous = dup(fileno(archiveFile));
+    if (previous < 0 || rename(archiveFileName, archivePreviousName) != 0) {
+        perror("errWriteSensorArchive");
+        if (previous >= 0)
+            close(previous);
+        return errWriteSensorArchive;
+    }
+    if (archivePreviousFile >= 0)
+        close(archivePreviousFile);
+    archiveRemovedSize += archivePreviousSize;
+    archivePreviousFile = previous;
+    archivePreviousSize = archiveFileSize;
+    archiveGeneration++;
+
+    // The blocks of the removed file are the oldest of every index
+    for (int i = 0; i < nbArchiveSensors; i++) {
+        while (indexCount[i] > 0 &&
+               archiveIndex[(size_t)i * SENSOR_ARCHIVE_INDEX_BLOCKS + indexHead[i]].generation + 1 < archiveGeneration) {
+            indexHead[i] = (uint16_t)((indexHead[i] + 1) % SENSOR_ARCHIVE_INDEX_BLOCKS);
+            indexCount[i]--;
+        }
+    }
+
+    if (freopen(archiveFileName, "w+b", archiveFile) == NULL) {
+        perror("errWriteSensorArchive");
+        archiveFile = NULL;
+        return errWriteSensorArchive;
+    }
+    if (writeArchiveHeader() != noError)
+        return errWriteSensorArchive;
+    return noError;
+}
+
+/**
+ * \brief function to open the previous archive file
+ * (archivePreviousName) when it is an archive of this version.
+ */
+static void openPreviousArchiveFile() {
+    struct sensorLogHeaderStruct header;
+    struct stat fileStat;
+
+    archivePreviousFile = open(archivePreviousName, O_RDONLY);
+    if (archivePreviousFile < 0)
+        return;
+    if (pread(archivePreviousFile, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, SENSOR_ARCHIVE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SENSOR_LOG_VERSION ||
+        header.recordSize != sizeof(struct sensorArchiveBlockStruct) ||
+        fstat(archivePreviousFile, &fileStat) != 0) {
+        close(archivePreviousFile);
+        archivePreviousFile = -1;
+        return;
+    }
+    archivePreviousSize = fileStat.st_size;
+}
+
+/**
+ * \brief function to add a block to the index of a sensor, the
+ * oldest block is left out of the index when it is full.
+ *
+ * \param index the sensor index
+ * \param entry the block index entry
+ */
+static void addArchiveIndex(int index, const struct archiveIndexStruct *entry) {
+    uint32_t position = (indexHead[index] + indexCount[index]) % SENSOR_ARCHIVE_INDEX_BLOCKS;
+    if (indexCount[index] == SENSOR_ARCHIVE_INDEX_BLOCKS) {
+        indexHead[index] = (uint16_t)((indexHead[index] + 1) % SENSOR_ARCHIVE_INDEX_BLOCKS);
+        nbBlocksUnindexed++;
+    }
+    else {
+        indexCount[index]++;
+    }
+    archiveIndex[(size_t)index * SENSOR_ARCHIVE_INDEX_BLOCKS + position] = *entry;
+}
+
+/**
+ * \brief function to add the blocks of an archive file to the index
+ * of every sensor, up to the first damaged or incomplete block.
+ *
+ * \param file the archive file descriptor
+ * \param fileSize the archive file size in bytes
+ * \param generation the archive file generation
+ * \param lastTime the latest reading time, updated
+ *
+ * \return the position after the last complete block.
+ */
+static uint64_t indexArchiveFile(int file, uint64_t fileSize, uint32_t generation, uint64_t *lastTime) {
+    struct archiveIndexStruct entry;
+    std::vector<int16_t> indexOfId(SENSOR_INDEX_LUT_SIZE, -1);
+    uint64_t nbDropped = 0;
+    uint64_t nbBlocks = 0;
+
+    for (int i = 0; i < nbArchiveSensors; i++)
+        indexOfId[archiveSensorId[i]] = (int16_t)i;
+
+    uint64_t position = sizeof(struct sensorLogHeaderStruct);
+    memset(&entry, 0, sizeof(entry));
+    entry.generation = generation;
+    while (position + sizeof(entry.block) <= fileSize) {
+        if (pread(file, &entry.block, sizeof(entry.block), position) != (ssize_t)sizeof(entry.block))
+            break;
+        const struct sensorArchiveBlockStruct *block = &entry.block;
+        if (block->nbReadings == 0 || block->nbReadings > SENSOR_ARCHIVE_BLOCK_READINGS ||
+            block->timeBytes > block->dataBytes ||
+            block->dataBytes > SENSOR_ARCHIVE_BLOCK_READINGS * (10 + 5) ||
+            block->firstTime > block->lastTime || block->minValue > block->maxValue ||
+            position + sizeof(entry.block) + block->dataBytes > fileSize)
+            break;
+        entry.dataOffset = position + sizeof(entry.block);
+        position = entry.dataOffset + block->dataBytes;
+        *lastTime = std::max(*lastTime, block->lastTime);
+        nbBlocks++;
+        nbArchiveBlocks++;
+        nbArchivedReadings += block->nbReadings;
+
+        int index = indexOfId[block->sensorId];
+        if (index < 0) {
+            nbDropped++;
+            continue;
+        }
+        entry.block.sensorIndex = (uint16_t)index;
+        addArchiveIndex(index, &entry);
+    }
+    printf("Sensor archive: %llu blocks reopened, %llu dropped (sensors not in the parameters)\n",
+           (unsigned long long)nbBlocks, (unsigned long long)nbDropped);
+    return position;
+}
+
+/**
+ * \brief function to rebuild the index of every sensor from the block
+ * headers of the previous archive file and of an existing archive file,
+ * the file position is left at the end of the last complete block, the
+ * following bytes are removed.
+ *
+ * \return statusErrDef that values:
+ * - errReadSensorArchive when the file can't be read or truncated
+ * - noError when the function exits successfully.
+ */
+static statusErrDef rebuildArchiveIndex() {
+    struct stat fileStat;
+    uint64_t lastTime = 0;
+
+    if (fstat(fileno(archiveFile), &fileStat) != 0) {
+        perror("errReadSensorArchive");
+        return errReadSensorArchive;
+    }
+    if (archivePreviousFile >= 0)
+        indexArchiveFile(archivePreviousFile, archivePreviousSize, archiveGeneration - 1, &lastTime);
+    uint64_t position = indexArchiveFile(fileno(archiveFile), fileStat.st_size, archiveGeneration, &lastTime);
+
+    if (position < (uint64_t)fileStat.st_size) {
+        printf("Sensor archive: %llu bytes after the last complete block removed\n",
+               (unsigned long long)(fileStat.st_size - position));
+        if (ftruncate(fileno(archiveFile), position) != 0) {
+            perror("errReadSensorArchive");
+            return errReadSensorArchive;
+        }
+    }
+    if (fseek(archiveFile, position, SEEK_SET) != 0) {
+        perror("errReadSensorArchive");
+        return errReadSensorArchive;
+    }
+    archiveFileSize = position;
+    sensorArchiveTimeOffset = (nbArchiveBlocks > 0) ? lastTime + 1 : 0;
+    return noError;
+}
+
+/**
+ * \brief function to open the archive file, or create it when it
+ * doesn't exist or is not an archive, and allocate the staging memory
+ * and the index of every sensor. The index of an existing archive is
+ * rebuilt from the block headers of the previous archive file and of
+ * the archive file.
+ *
+ * \param fileName location and name of the archive file
+ * \param sensorId the ID of every sensor index
+ * \param nbSensors the number of sensors (at most MAX_SENSORS)
+ *
+ * \return statusErrDef that values:
+ * - errAllocSensorArchive when the staging memory or the index cannot be allocated
+ * - errOpenSensorArchive when the archive file can't be created or its name is too long
+ * - errReadSensorArchive when the existing archive file can't be read
+ * - noError when the function exits successfully.
+ */
+statusErrDef initSensorArchive(const char *fileName, const uint16_t *sensorId, int nbSensors) {
+    struct sensorLogHeaderStruct header;
+    statusErrDef ret = noError;
+
+    closeSensorArchive();
+    if (nbSensors > MAX_SENSORS)
+        nbSensors = MAX_SENSORS;
+
+    stagingTime = (uint64_t*)malloc((size_t)nbSensors * SENSOR_ARCHIVE_BLOCK_READINGS * sizeof(uint64_t));
+    stagingValue = (int32_t*)malloc((size_t)nbSensors * SENSOR_ARCHIVE_BLOCK_READINGS * sizeof(int32_t));
+    archiveIndex = (struct archiveIndexStruct*)malloc((size_t)nbSensors * SENSOR_ARCHIVE_INDEX_BLOCKS *
+                                                      sizeof(struct archiveIndexStruct));
+    archiveWriteBuffer = (char*)malloc(SENSOR_ARCHIVE_WRITE_BUFFER);
+    if ((nbSensors > 0 && (stagingTime == NULL || stagingValue == NULL || archiveIndex == NULL)) ||
+        archiveWriteBuffer == NULL) {
+        perror("errAllocSensorArchive");
+        closeSensorArchive();
+        return errAllocSensorArchive;
+    }
+    if (snprintf(archiveFileName, sizeof(archiveFileName), "%s", fileName) >= (int)sizeof(archiveFileName) ||
+        snprintf(archivePreviousName, sizeof(archivePreviousName), "%s%s", fileName,
+                 SENSOR_ARCHIVE_PREVIOUS_SUFFIX) >= (int)sizeof(archivePreviousName)) {
+        printf("errOpenSensorArchive: archive file name longer than %d bytes\n", MAX_PATH_LENGHT);
+        closeSensorArchive();
+        return errOpenSensorArchive;
+    }
+
+    for (int i = 0; i < nbSensors; i++) {
+        stagingCount[i] = 0;
+        stagingSlice[i] = 0;
+        archiveSensorId[i] = (sensorId != NULL) ? sensorId[i] : 0;
+        indexHead[i] = 0;
+        indexCount[i] = 0;
+    }
+    nbArchiveSensors = nbSensors;
+    nbArchivedReadings = 0;
+    nbArchiveBlocks = 0;
+    nbBlocksRead = 0;
+    nbBlocksSkipped = 0;
+    nbBlocksUnindexed = 0;
+    archiveGeneration = 1;
+    archivePreviousSize = 0;
+    archiveRemovedSize = 0;
+
+    printf("filename: %s\n", fileName);
+    openPreviousArchiveFile();
+    archiveFile = fopen(fileName, "r+b");
+    if (archiveFile != NULL) {
+        setvbuf(archiveFile, archiveWriteBuffer, _IOFBF, SENSOR_ARCHIVE_WRITE_BUFFER);
+        if (fread(&header, sizeof(header), 1, archiveFile) == 1 &&
+            memcmp(header.magic, SENSOR_ARCHIVE_MAGIC, sizeof(header.magic)) == 0 &&
+            header.version == SENSOR_LOG_VERSION &&
+            header.recordSize == sizeof(struct sensorArchiveBlockStruct)) {
+            ret = rebuildArchiveIndex();
+            if (ret != noError)
+                closeSensorArchive();
+            return ret;
+        }
+        // Not an archive of this version, it is replaced
+        fclose(archiveFile);
+        archiveFile = NULL;
+    }
+    ret = createArchiveFile();
+    if (ret == noError && archivePreviousFile >= 0) {
+        ret = rebuildArchiveIndex();
+    }
+    if (ret != noError)
+        closeSensorArchive();
+    return ret;
+}
+
+/**
+ * \brief function to add a reading to the open block of a sensor,
+ * the block is written to the archive file first when the reading
+ * starts a new time slice or the block is full.
+ *
+ * \param index the sensor index
+ * \param timeStamp the reading time in microseconds since program start
+ * (not lower than the previous reading time of the sensor), archived
+ * plus sensorArchiveTimeOffset
+ * \param value the reading value
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorArchive when the block can't be written
+ * - noError when the function exits successfully.
+ */
+statusErrDef pushSensorArchive(int index, uint64_t timeStamp, int32_t value) {
+    statusErrDef ret = noError;
+    if (archiveFile == NULL || index < 0 || index >= nbArchiveSensors)
+        return ret;
+    timeStamp += sensorArchiveTimeOffset;
+
+    uint64_t slice = timeStamp / SENSOR_ARCHIVE_SLICE_PERIOD;
+    uint32_t count = stagingCount[index];
+    if (count > 0 && (slice != stagingSlice[index] || count == SENSOR_ARCHIVE_BLOCK_READINGS)) {
+        ret = writeArchiveBlock(index);
+        count = 0;
+    }
+    if (count == 0)
+        stagingSlice[index] = slice;
+
+    stagingTime[(size_t)index * SENSOR_ARCHIVE_BLOCK_READINGS + count] = timeStamp;
+    stagingValue[(size_t)index * SENSOR_ARCHIVE_BLOCK_READINGS + count] = value;
+    stagingCount[index] = (uint16_t)(count + 1);
+    nbArchivedReadings++;
+    return ret;
+}
+
+/**
+ * \brief function to encode the open block of a sensor, write it to
+ * the archive file and add it to the sensor index.
+ *
+ * \param index the sensor index
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorArchive when the block can't be written
+ * - noError when the function exits successfully.
+ */
+static statusErrDef writeArchiveBlock(int index) {
+    static uint8_t data[SENSOR_ARCHIVE_BLOCK_READINGS * (10 + 5)];
+    struct archiveIndexStruct entry;
+    const uint64_t *timeStamp = &stagingTime[(size_t)index * SENSOR_ARCHIVE_BLOCK_READINGS];
+    const int32_t *value = &stagingValue[(size_t)index * SENSOR_ARCHIVE_BLOCK_READINGS];
+    uint32_t count = stagingCount[index];
+    uint8_t *position = data;
+    int32_t minValue = value[0];
+    int32_t maxValue = value[0];
+
+    uint64_t previousTime = timeStamp[0];
+    for (uint32_t i = 0; i < count; i++) {
+        position = writeVarint(position, timeStamp[i] - previousTime);
+        previousTime = timeStamp[i];
+    }
+    size_t timeBytes = position - data;
+    int32_t previousValue = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        position = writeVarint(position, zigzagEncode((int64_t)value[i] - previousValue));
+        previousValue = value[i];
+        minValue = std::min(minValue, value[i]);
+        maxValue = std::max(maxValue, value[i]);
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.block.firstTime = timeStamp[0];
+    entry.block.lastTime = timeStamp[count - 1];
+    entry.block.minValue = minValue;
+    entry.block.maxValue = maxValue;
+    entry.block.sensorId = archiveSensorId[index];
+    entry.block.sensorIndex = (uint16_t)index;
+    entry.block.nbReadings = (uint16_t)count;
+    entry.block.timeBytes = (uint16_t)timeBytes;
+    entry.block.dataBytes = (uint32_t)(position - data);
+    entry.dataOffset = archiveFileSize + sizeof(entry.block);
+    stagingCount[index] = 0;
+
+    if (fwrite(&entry.block, sizeof(entry.block), 1, archiveFile) != 1 ||
+        fwrite(data, 1, entry.block.dataBytes, archiveFile) != entry.block.dataBytes) {
+        perror("errWriteSensorArchive");
+        return errWriteSensorArchive;
+    }
+    archiveFileSize += sizeof(entry.block) + entry.block.dataBytes;
+    archiveUnflushed = true;
+    entry.generation = archiveGeneration;
+    addArchiveIndex(index, &entry);
+    nbArchiveBlocks++;
+    if (archiveFileSize >= SENSOR_ARCHIVE_RETENTION_BYTES / 2)
+        return rotateArchiveFile();
+    return noError;
+}
+
+/**
+ * \brief function to read and decode the columns of an archive block.
+ *
+ * \param entry the block index entry
+ * \param timeStamp the block timestamps (SENSOR_ARCHIVE_BLOCK_READINGS)
+ * \param value the block values (SENSOR_ARCHIVE_BLOCK_READINGS)
+ *
+ * \return false when the block can't be read or is damaged.
+ */
+static bool readArchiveBlock(const struct archiveIndexStruct *entry, uint64_t *timeStamp, int32_t *value) {
+    static uint8_t data[SENSOR_ARCHIVE_BLOCK_READINGS * (10 + 5)];
+    uint32_t count = entry->block.nbReadings;
+    uint64_t delta = 0;
+
+    if (entry->block.dataBytes > sizeof(data) || count > SENSOR_ARCHIVE_BLOCK_READINGS)
+        return false;
+    int file = fileno(archiveFile);
+    if (entry->generation != archiveGeneration) {
+        file = archivePreviousFile;
+    }
+    else if (archiveUnflushed) {
+        fflush(archiveFile);
+        archiveUnflushed = false;
+    }
+    if (pread(file, data, entry->block.dataBytes, entry->dataOffset) != (ssize_t)entry->block.dataBytes)
+        return false;
+
+    const uint8_t *position = data;
+    const uint8_t *timeEnd = data + entry->block.timeBytes;
+    const uint8_t *end = data + entry->block.dataBytes;
+    uint64_t previousTime = entry->block.firstTime;
+    for (uint32_t i = 0; i < count; i++) {
+        if ((position = readVarint(position, timeEnd, &delta)) == NULL)
+            return false;
+        previousTime += delta;
+        timeStamp[i] = previousTime;
+    }
+    int32_t previousValue = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if ((position = readVarint(position, end, &delta)) == NULL)
+            return false;
+        previousValue = (int32_t)(previousValue + zigzagDecode(delta));
+        value[i] = previousValue;
+    }
+    return true;
+}
+
+/**
+ * \brief function to find the first indexed block of a sensor that
+ * doesn't end before a time, by binary search.
+ *
+ * \param index the sensor index
+ * \param time the query first time
+ *
+ * \return the position of the block from indexHead, indexCount
+ * when every block ends before the time.
+ */
+static uint32_t findArchiveBlock(int index, uint64_t time) {
+    const struct archiveIndexStruct *blocks = &archiveIndex[(size_t)index * SENSOR_ARCHIVE_INDEX_BLOCKS];
+    uint32_t low = 0;
+    uint32_t high = indexCount[index];
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        if (blocks[(indexHead[index] + middle) % SENSOR_ARCHIVE_INDEX_BLOCKS].block.lastTime < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/**
+ * \brief function to get the archived readings of a sensor in a time
+ * range whose value is in a value range. Only the blocks whose time
+ * range and value range overlap the query ranges are read.
+ *
+ * \param index the sensor index (see getSensorIndex())
+ * \param fromTime the first archive time in microseconds (time since
+ * program start plus sensorArchiveTimeOffset)
+ * \param toTime the last archive time in microseconds
+ * \param minValue the minimum value (INT32_MIN for every value)
+ * \param maxValue the maximum value (INT32_MAX for every value)
+ * \param readings the matching readings are added to it, in time order
+ *
+ * \return statusErrDef that values:
+ * - errUnknownSensorId when the sensor index is not archived
+ * - errReadSensorArchive when a block can't be read or is damaged
+ * - noError when the function exits successfully.
+ */
+statusErrDef querySensorArchive(int index, uint64_t fromTime, uint64_t toTime,
+                                int32_t minValue, int32_t maxValue,
+                                std::vector<struct sensorArchiveReadingStruct> *readings) {
+    uint64_t timeStamp[SENSOR_ARCHIVE_BLOCK_READINGS];
+    int32_t value[SENSOR_ARCHIVE_BLOCK_READINGS];
+    struct sensorArchiveReadingStruct reading;
+
+    if (archiveFile == NULL || index < 0 || index >= nbArchiveSensors)
+        return errUnknownSensorId;
+
+    const struct archiveIndexStruct *blocks = &archiveIndex[(size_t)index * SENSOR_ARCHIVE_INDEX_BLOCKS];
+    for (uint32_t b = findArchiveBlock(index, fromTime); b < indexCount[index]; b++) {
+        const struct archiveIndexStruct *entry = &blocks[(indexHead[index] + b) % SENSOR_ARCHIVE_INDEX_BLOCKS];
+        if (entry->block.firstTime > toTime)
+            break;
+        if (entry->block.maxValue < minValue || entry->block.minValue > maxValue) {
+            nbBlocksSkipped++;
+            continue;
+        }
+        nbBlocksRead++;
+        if (!readArchiveBlock(entry, timeStamp, value))
+            return errReadSensorArchive;
+        for (uint32_t i = 0; i < entry->block.nbReadings; i++) {
+            if (timeStamp[i] < fromTime || timeStamp[i] > toTime ||
+                value[i] < minValue || value[i] > maxValue)
+                continue;
+            reading.timeStamp = timeStamp[i];
+            reading.value = value[i];
+            readings->push_back(reading);
+        }
+    }
+
+    // Readings of the open block
+    const uint64_t *stagedTime = &stagingTime[(size_t)index * SENSOR_ARCHIVE_BLOCK_READINGS];
+    const int32_t *stagedValue = &stagingValue[(size_t)index * SENSOR_ARCHIVE_BLOCK_READINGS];
+    for (uint32_t i = 0; i < stagingCount[index]; i++) {
+        if (stagedTime[i] < fromTime || stagedTime[i] > toTime ||
+            stagedValue[i] < minValue || stagedValue[i] > maxValue)
+            continue;
+        reading.timeStamp = stagedTime[i];
+        reading.value = stagedValue[i];
+        readings->push_back(reading);
+    }
+    return noError;
+}
+
+/**
+ * \brief function to print the archive size, the number of blocks
+ * left out of the index and the number of blocks read and skipped
+ * by the queries.
+ */
+void printSensorArchiveStats() {
+    uint64_t archiveBytes = archiveFileSize + archivePreviousSize;
+    printf("Sensor archive: %llu readings in %llu blocks (%.2f bytes per reading), %llu bytes with the previous file, "
+           "%llu bytes removed\n",
+           (unsigned long long)nbArchivedReadings, (unsigned long long)nbArchiveBlocks,
+           nbArchivedReadings ? (double)(archiveBytes + archiveRemovedSize) / nbArchivedReadings : 0.0,
+           (unsigned long long)archiveBytes, (unsigned long long)archiveRemovedSize);
+    printf("Sensor archive queries: %llu blocks read, %llu blocks skipped, %llu blocks out of the full indexes\n",
+           (unsigned long long)nbBlocksRead, (unsigned long long)nbBlocksSkipped,
+           (unsigned long long)nbBlocksUnindexed);
+}
+
+/**
+ * \brief function to write the open blocks, close the archive file
+ * and free the staging memory and the index.
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorArchive when a block can't be written
+ * - noError when the function exits successfully.
+ */
+statusErrDef closeSensorArchive() {
+    statusErrDef ret = noError;
+
+    // A failed rotation closes the archive file
+    for (int i = 0; i < nbArchiveSensors && archiveFile != NULL; i++) {
+        if (stagingCount[i] > 0 && writeArchiveBlock(i) != noError)
+            ret = errWriteSensorArchive;
+    }
+    if (archiveFile != NULL) {
+        fclose(archiveFile);
+        archiveFile = NULL;
+    }
+    if (archivePreviousFile >= 0) {
+        close(archivePreviousFile);
+        archivePreviousFile = -1;
+    }
+    nbArchiveSensors = 0;
+    free(archiveIndex);
+    archiveIndex = NULL;
+    free(stagingTime);
+    free(stagingValue);
+    free(archiveWriteBuffer);
+    stagingTime = NULL;
+    stagingValue = NULL;
+    archiveWriteBuffer = NULL;
+    return ret;
+}
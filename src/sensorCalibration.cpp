@@ -0,0 +1,591 @@
+/**
+ * \file sensorCalibration.cpp
+ * \brief sensor calibration functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Sensor calibration functions, every polynomial is padded with zero
+ * coefficients up to SENSOR_CALIBRATION_MAX_DEGREE so that a batch of
+ * samples of different sensors runs the same Horner steps. When the
+ * batch is calibrated, the coefficients of each queued sample are
+ * gathered next to its raw value (one array per degree), the kernel
+ * then evaluates 4 samples at a time
+ * with AVX2, 2 at a time with SSE2 or NEON, and one at a time otherwise
+ * (and for the last samples). Lookup tables are interpolated one sample
+ * at a time after a binary search of the raw value.
+ *
+ */
+#include "sensorCalibration.h"
+#include "derivedParam.h"
+
+#include <math.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define CALIBRATION_NONE 0
+#define CALIBRATION_POLYNOMIAL 1
+#define CALIBRATION_TABLE 2
+
+#define CALIBRATION_COEFFICIENTS (SENSOR_CALIBRATION_MAX_DEGREE + 1)
+
+//------------------------------------------------------------------------------
+// Local structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct calibrationDefinitionStruct
+ * \brief a calibration read from paramSensors.csv
+ *
+ */
+struct calibrationDefinitionStruct {
+    int kind;                                       /**< CALIBRATION_POLYNOMIAL or CALIBRATION_TABLE */
+    int nbPoints;                                   /**< Number of coefficients or of table points */
+    double x[SENSOR_CALIBRATION_MAX_POINTS];        /**< Raw values of the table points */
+    double y[SENSOR_CALIBRATION_MAX_POINTS];        /**< Coefficients, or values of the table points */
+};
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief number of sensors with a calibration.
+ */
+int nbCalibratedSensors = 0;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief calibration text of every sensor, until compileSensorCalibrations().
+ */
+static char *calibrationSources[MAX_SENSORS];
+
+/**
+ * \brief calibration kind of every sensor and its index in the
+ * polynomial coefficients or in the lookup tables.
+ */
+static uint8_t calibrationKind[MAX_SENSORS];
+static uint16_t calibrationSlot[MAX_SENSORS];
+
+/**
+ * \brief coefficients of every calibration polynomial, from degree 0.
+ */
+static double (*polynomialCoefficients)[CALIBRATION_COEFFICIENTS] = NULL;
+
+/**
+ * \brief points of every lookup table: the table t holds tableCount[t]
+ * points from tableFirst[t] in tableX and tableY.
+ */
+static uint32_t *tableFirst = NULL;
+static uint32_t *tableCount = NULL;
+static double *tableX = NULL;
+static double *tableY = NULL;
+
+/**
+ * \brief queued polynomial samples: raw value and sensor index, then
+ * the gathered coefficients (one array per degree).
+ */
+static int32_t batchPolynomialRaw[SENSOR_CALIBRATION_BATCH_SIZE];
+static uint16_t batchPolynomialSensor[SENSOR_CALIBRATION_BATCH_SIZE];
+static double batchRaw[SENSOR_CALIBRATION_BATCH_SIZE];
+static double batchCoefficients[CALIBRATION_COEFFICIENTS][SENSOR_CALIBRATION_BATCH_SIZE];
+static int nbBatchPolynomials = 0;
+
+/**
+ * \brief queued lookup table samples: raw value and sensor index.
+ */
+static int32_t batchTableRaw[SENSOR_CALIBRATION_BATCH_SIZE];
+static uint16_t batchTableSensor[SENSOR_CALIBRATION_BATCH_SIZE];
+static int nbBatchTables = 0;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static bool parseCalibrationNumber(const char **cursor, double *value);
+static statusErrDef parseSensorCalibration(const char *text, size_t length,
+                                           struct calibrationDefinitionStruct *calibration);
+static int32_t roundCalibratedValue(double value);
+static void evaluatePolynomials(int nbSamples, int32_t *value);
+static int32_t interpolateTable(int table, int32_t rawValue);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read a finite number of a calibration text.
+ *
+ * \param cursor the text position, moved after the number
+ * \param value the number read
+ *
+ * \return false when there is no finite number at the cursor.
+ */
+static bool parseCalibrationNumber(const char **cursor, double *value) {
+    char *end = NULL;
+    while (**cursor == ' ' || **cursor == '\t')
+        (*cursor)++;
+    *value = strtod(*cursor, &end);
+    if (end == *cursor || !isfinite(*value))
+        return false;
+    *cursor = end;
+    while (**cursor == ' ' || **cursor == '\t')
+        (*cursor)++;
+    return true;
+}
+
+/**
+ * \brief function to read a calibration text, the reason of
+ * an error is printed.
+ *
+ * \param text the calibration text (not null terminated)
+ * \param length the text length
+ * \param calibration the calibration read
+ *
+ * \return statusErrDef that values:
+ * - errInvalidSensorCalibration when the text is not a calibration
+ * - noError when the function exits successfully.
+ */
+static statusErrDef parseSensorCalibration(const char *text, size_t length,
+                                           struct calibrationDefinitionStruct *calibration) {
+    char buffer[SENSOR_CALIBRATION_MAX_LENGTH + 1];
+    if (length > SENSOR_CALIBRATION_MAX_LENGTH) {
+        printf("calibration longer than %d characters\n", SENSOR_CALIBRATION_MAX_LENGTH);
+        return errInvalidSensorCalibration;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+
+    const char *cursor = buffer;
+    while (*cursor == ' ' || *cursor == '\t')
+        cursor++;
+    int maxPoints;
+    if (strncmp(cursor, "poly:", 5) == 0) {
+        calibration->kind = CALIBRATION_POLYNOMIAL;
+        maxPoints = CALIBRATION_COEFFICIENTS;
+        cursor += 5;
+    } else if (strncmp(cursor, "lut:", 4) == 0) {
+        calibration->kind = CALIBRATION_TABLE;
+        maxPoints = SENSOR_CALIBRATION_MAX_POINTS;
+        cursor += 4;
+    } else {
+        printf("calibration \"%s\" is not poly: or lut:\n", buffer);
+        return errInvalidSensorCalibration;
+    }
+
+    calibration->nbPoints = 0;
+    for (;;) {
+        int p = calibration->nbPoints;
+        if (p == maxPoints) {
+            printf("calibration \"%s\": more than %d %s\n", buffer, maxPoints,
+                   calibration->kind == CALIBRATION_POLYNOMIAL ? "coefficients" : "points");
+            return errInvalidSensorCalibration;
+        }
+        bool valid;
+        if (calibration->kind == CALIBRATION_POLYNOMIAL) {
+            valid = parseCalibrationNumber(&cursor, &calibration->y[p]);
+        } else {
+            valid = parseCalibrationNumber(&cursor, &calibration->x[p]) && *cursor++ == ':' &&
+                    parseCalibrationNumber(&cursor, &calibration->y[p]);
+            if (valid && p > 0 && calibration->x[p] <= calibration->x[p - 1]) {
+                printf("calibration \"%s\": table raw values must increase\n", buffer);
+                return errInvalidSensorCalibration;
+            }
+        }
+        if (!valid) {
+            printf("calibration \"%s\": invalid number at \"%s\"\n", buffer, cursor);
+            return errInvalidSensorCalibration;
+        }
+        calibration->nbPoints++;
+        if (*cursor == '\0')
+            break;
+        if (*cursor++ != ',') {
+            printf("calibration \"%s\": ',' expected\n", buffer);
+            return errInvalidSensorCalibration;
+        }
+    }
+    if (calibration->kind == CALIBRATION_TABLE && calibration->nbPoints < 2) {
+        printf("calibration \"%s\": at least 2 table points\n", buffer);
+        return errInvalidSensorCalibration;
+    }
+    return noError;
+}
+
+/**
+ * \brief function to round a calibrated value to the int32_t range,
+ * NaN gives INT32_MIN like the vector conversions.
+ *
+ * \param value the calibrated value
+ *
+ * \return the rounded value.
+ */
+static int32_t roundCalibratedValue(double value) {
+    if (!(value > (double)INT32_MIN))
+        return INT32_MIN;
+    if (value > (double)INT32_MAX)
+        return INT32_MAX;
+    return (int32_t)lrint(value);
+}
+
+/**
+ * \brief function to gather the coefficients of the queued polynomials
+ * and to evaluate them with the Horner scheme, from the highest degree.
+ *
+ * \param nbSamples the number of queued polynomial samples
+ * \param value filled with the calibrated values
+ */
+static void evaluatePolynomials(int nbSamples, int32_t *value) {
+    const int degree = SENSOR_CALIBRATION_MAX_DEGREE;
+    for (int s = 0; s < nbSamples; s++) {
+        const double *coefficients = polynomialCoefficients[calibrationSlot[batchPolynomialSensor[s]]];
+        batchRaw[s] = (double)batchPolynomialRaw[s];
+        for (int k = 0; k < CALIBRATION_COEFFICIENTS; k++)
+            batchCoefficients[k][s] = coefficients[k];
+    }
+
+    int s = 0;
+
+#if defined(__AVX2__)
+    const __m256d minValue = _mm256_set1_pd((double)INT32_MIN);
+    const __m256d maxValue = _mm256_set1_pd((double)INT32_MAX);
+    for (; s + 4 <= nbSamples; s += 4) {
+        __m256d x = _mm256_loadu_pd(batchRaw + s);
+        __m256d result = _mm256_loadu_pd(batchCoefficients[degree] + s);
+        for (int k = degree - 1; k >= 0; k--) {
+#if defined(__FMA__)
+            result = _mm256_fmadd_pd(result, x, _mm256_loadu_pd(batchCoefficients[k] + s));
+#else
+            result = _mm256_add_pd(_mm256_mul_pd(result, x), _mm256_loadu_pd(batchCoefficients[k] + s));
+#endif
+        }
+        // max(NaN, min) is min, then rounded to nearest
+        result = _mm256_min_pd(_mm256_max_pd(result, minValue), maxValue);
+        _mm_storeu_si128((__m128i*)(value + s), _mm256_cvtpd_epi32(result));
+    }
+#elif defined(__SSE2__)
+    const __m128d minValue = _mm_set1_pd((double)INT32_MIN);
+    const __m128d maxValue = _mm_set1_pd((double)INT32_MAX);
+    for (; s + 2 <= nbSamples; s += 2) {
+        __m128d x = _mm_loadu_pd(batchRaw + s);
+        __m128d result = _mm_loadu_pd(batchCoefficients[degree] + s);
+        for (int k = degree - 1; k >= 0; k--)
+            result = _mm_add_pd(_mm_mul_pd(result, x), _mm_loadu_pd(batchCoefficients[k] + s));
+        // max(NaN, min) is min, then rounded to nearest
+        result = _mm_min_pd(_mm_max_pd(result, minValue), maxValue);
+        _mm_storel_epi64((__m128i*)(value + s), _mm_cvtpd_epi32(result));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t minValue = vdupq_n_f64((double)INT32_MIN);
+    const float64x2_t maxValue = vdupq_n_f64((double)INT32_MAX);
+    for (; s + 2 <= nbSamples; s += 2) {
+        float64x2_t x = vld1q_f64(batchRaw + s);
+        float64x2_t result = vld1q_f64(batchCoefficients[degree] + s);
+        for (int k = degree - 1; k >= 0; k--)
+            result = vfmaq_f64(vld1q_f64(batchCoefficients[k] + s), result, x);
+        // NaN is replaced by min, then rounded to nearest
+        uint64x2_t isNumber = vceqq_f64(result, result);
+        result = vbslq_f64(isNumber, result, minValue);
+        result = vminq_f64(vmaxq_f64(result, minValue), maxValue);
+        vst1_s32(value + s, vmovn_s64(vcvtnq_s64_f64(result)));
+    }
+#endif
+
+    // Scalar fallback and last samples
+    for (; s < nbSamples; s++) {
+        double result = batchCoefficients[degree][s];
+        for (int k = degree - 1; k >= 0; k--)
+            result = result * batchRaw[s] + batchCoefficients[k][s];
+        value[s] = roundCalibratedValue(result);
+    }
+}
+
+/**
+ * \brief function to interpolate a raw value in a lookup table.
+ *
+ * \param table the lookup table index
+ * \param rawValue the raw sensor value
+ *
+ * \return the calibrated value.
+ */
+static int32_t interpolateTable(int table, int32_t rawValue) {
+    const double *x = tableX + tableFirst[table];
+    const double *y = tableY + tableFirst[table];
+    int count = (int)tableCount[table];
+    double raw = (double)rawValue;
+    if (raw <= x[0])
+        return roundCalibratedValue(y[0]);
+    if (raw >= x[count - 1])
+        return roundCalibratedValue(y[count - 1]);
+
+    // First point above the raw value
+    int low = 1;
+    int high = count - 1;
+    while (low < high) {
+        int middle = (low + high) >> 1;
+        if (x[middle] <= raw)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    double ratio = (raw - x[low - 1]) / (x[low] - x[low - 1]);
+    return roundCalibratedValue(y[low - 1] + ratio * (y[low] - y[low - 1]));
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to check a calibration text of paramSensors.csv,
+ * the reason of an error is printed.
+ *
+ * \param text the calibration text
+ * \param length the text length
+ *
+ * \return statusErrDef that values:
+ * - errInvalidSensorCalibration when the text is not a calibration
+ * - noError when the function exits successfully.
+ */
+statusErrDef checkSensorCalibration(const char *text, size_t length) {
+    struct calibrationDefinitionStruct calibration;
+    return parseSensorCalibration(text, length, &calibration);
+}
+
+/**
+ * \brief function to compare a calibration text of paramSensors.csv
+ * with the compiled calibration of a sensor, to find the calibrations
+ * changed in a reloaded file.
+ *
+ * \param index the sensor index
+ * \param text the calibration text, '#' or empty for no calibration
+ * \param length the text length
+ *
+ * \return true when the text gives the calibration in use.
+ */
+bool isSameSensorCalibration(int index, const char *text, size_t length) {
+    if (index < 0 || index >= MAX_SENSORS)
+        return false;
+    if (length == 0 || (length == 1 && *text == '#'))
+        return calibrationKind[index] == CALIBRATION_NONE;
+    struct calibrationDefinitionStruct calibration;
+    if (parseSensorCalibration(text, length, &calibration) != noError ||
+        calibration.kind != calibrationKind[index])
+        return false;
+
+    int slot = calibrationSlot[index];
+    if (calibration.kind == CALIBRATION_POLYNOMIAL) {
+        // The compiled polynomials are padded with zero coefficients
+        for (int k = 0; k < CALIBRATION_COEFFICIENTS; k++) {
+            double coefficient = (k < calibration.nbPoints) ? calibration.y[k] : 0.0;
+            if (coefficient != polynomialCoefficients[slot][k])
+                return false;
+        }
+        return true;
+    }
+    if ((uint32_t)calibration.nbPoints != tableCount[slot])
+        return false;
+    return memcmp(calibration.x, tableX + tableFirst[slot], calibration.nbPoints * sizeof(double)) == 0 &&
+           memcmp(calibration.y, tableY + tableFirst[slot], calibration.nbPoints * sizeof(double)) == 0;
+}
+
+/**
+ * \brief function to keep the calibration of a sensor read from
+ * paramSensors.csv until compileSensorCalibrations().
+ *
+ * \param index the sensor index
+ * \param text the calibration text
+ * \param length the text length
+ *
+ * \return statusErrDef that values:
+ * - errInvalidSensorCalibration when the text is not a calibration or can't be copied
+ * - noError when the function exits successfully.
+ */
+statusErrDef setSensorCalibration(int index, const char *text, size_t length) {
+    if (index < 0 || index >= MAX_SENSORS)
+        return errInvalidSensorCalibration;
+    statusErrDef ret = checkSensorCalibration(text, length);
+    if (ret != noError)
+        return ret;
+    free(calibrationSources[index]);
+    calibrationSources[index] = strndup(text, length);
+    if (calibrationSources[index] == NULL)
+        return errInvalidSensorCalibration;
+    return noError;
+}
+
+/**
+ * \brief function to take back the calibration of a sensor before
+ * it is compiled, the sensor is no longer calibrated.
+ *
+ * \param index the sensor index
+ *
+ * \return the calibration text, to be freed by the caller,
+ * or NULL when the sensor has no calibration.
+ */
+char *takeSensorCalibration(int index) {
+    if (index < 0 || index >= MAX_SENSORS)
+        return NULL;
+    char *text = calibrationSources[index];
+    calibrationSources[index] = NULL;
+    return text;
+}
+
+/**
+ * \brief function to build the polynomial coefficients and the lookup
+ * tables of every calibrated sensor, the calibration texts are freed.
+ *
+ * \param param the sensors parameters, with the derived parameters compiled
+ * \param nbSensors the number of sensors
+ *
+ * \return statusErrDef that values:
+ * - errInvalidSensorCalibration when a derived parameter has a calibration
+ * - errAllocParamSensorStruct when the calibrations cannot be allocated
+ * - noError when the function exits successfully.
+ */
+statusErrDef compileSensorCalibrations(const struct paramSensorsStruct *param, int nbSensors) {
+    statusErrDef ret = noError;
+    struct calibrationDefinitionStruct calibration;
+    int nbPolynomials = 0;
+    int nbTables = 0;
+    int nbTablePoints = 0;
+
+    freeSensorCalibrations();
+    if (nbSensors > MAX_SENSORS)
+        nbSensors = MAX_SENSORS;
+    for (int i = 0; i < nbSensors; i++) {
+        if (calibrationSources[i] == NULL)
+            continue;
+        if (isDerivedParameter(i)) {
+            printf("sensor 0x%04X: a derived parameter can't have a calibration\n", param->id[i]);
+            ret = errInvalidSensorCalibration;
+            goto cleanup;
+        }
+        parseSensorCalibration(calibrationSources[i], strlen(calibrationSources[i]), &calibration);
+        if (calibration.kind == CALIBRATION_POLYNOMIAL) {
+            nbPolynomials++;
+        } else {
+            nbTables++;
+            nbTablePoints += calibration.nbPoints;
+        }
+    }
+
+    polynomialCoefficients = (double(*)[CALIBRATION_COEFFICIENTS])calloc(nbPolynomials + 1,
+                                                                         sizeof(*polynomialCoefficients));
+    tableFirst = (uint32_t*)malloc((nbTables + 1) * sizeof(uint32_t));
+    tableCount = (uint32_t*)malloc((nbTables + 1) * sizeof(uint32_t));
+    tableX = (double*)malloc((nbTablePoints + 1) * sizeof(double));
+    tableY = (double*)malloc((nbTablePoints + 1) * sizeof(double));
+    if (polynomialCoefficients == NULL || tableFirst == NULL || tableCount == NULL ||
+        tableX == NULL || tableY == NULL) {
+        perror("errAllocParamSensorStruct");
+        ret = errAllocParamSensorStruct;
+        goto cleanup;
+    }
+
+    nbPolynomials = nbTables = nbTablePoints = 0;
+    for (int i = 0; i < nbSensors; i++) {
+        if (calibrationSources[i] == NULL)
+            continue;
+        parseSensorCalibration(calibrationSources[i], strlen(calibrationSources[i]), &calibration);
+        calibrationKind[i] = (uint8_t)calibration.kind;
+        if (calibration.kind == CALIBRATION_POLYNOMIAL) {
+            calibrationSlot[i] = (uint16_t)nbPolynomials;
+            memcpy(polynomialCoefficients[nbPolynomials++], calibration.y, calibration.nbPoints * sizeof(double));
+        } else {
+            calibrationSlot[i] = (uint16_t)nbTables;
+            tableFirst[nbTables] = nbTablePoints;
+            tableCount[nbTables++] = calibration.nbPoints;
+            memcpy(tableX + nbTablePoints, calibration.x, calibration.nbPoints * sizeof(double));
+            memcpy(tableY + nbTablePoints, calibration.y, calibration.nbPoints * sizeof(double));
+            nbTablePoints += calibration.nbPoints;
+        }
+        nbCalibratedSensors++;
+    }
+
+cleanup:
+    for (int i = 0; i < MAX_SENSORS; i++)
+        free(takeSensorCalibration(i));
+    if (ret != noError)
+        freeSensorCalibrations();
+    return ret;
+}
+
+/**
+ * \brief function to know if a sensor has a calibration.
+ *
+ * \param index the sensor index
+ *
+ * \return true when the raw sensor values must be calibrated.
+ */
+bool isCalibratedSensor(int index) {
+    return index >= 0 && index < MAX_SENSORS && calibrationKind[index] != CALIBRATION_NONE;
+}
+
+/**
+ * \brief function to queue a raw sample of a calibrated sensor
+ * until calibrateSensorBatch().
+ *
+ * \param index the calibrated sensor index
+ * \param rawValue the raw sensor value
+ *
+ * \return true when the batch is full (SENSOR_CALIBRATION_BATCH_SIZE
+ * samples), calibrateSensorBatch() must be called before the next sample.
+ */
+bool queueSensorCalibration(int index, int32_t rawValue) {
+    if (calibrationKind[index] == CALIBRATION_POLYNOMIAL) {
+        int s = nbBatchPolynomials++;
+        batchPolynomialRaw[s] = rawValue;
+        batchPolynomialSensor[s] = (uint16_t)index;
+    } else {
+        int s = nbBatchTables++;
+        batchTableRaw[s] = rawValue;
+        batchTableSensor[s] = (uint16_t)index;
+    }
+    return nbBatchPolynomials + nbBatchTables >= SENSOR_CALIBRATION_BATCH_SIZE;
+}
+
+/**
+ * \brief function to calibrate the queued samples, the queue is emptied.
+ * The samples of a sensor keep their order.
+ *
+ * \param index filled with the sensor index of every sample
+ * \param value filled with the calibrated value of every sample
+ * (both of SENSOR_CALIBRATION_BATCH_SIZE elements)
+ *
+ * \return the number of calibrated samples.
+ */
+int calibrateSensorBatch(uint16_t *index, int32_t *value) {
+    int nbSamples = nbBatchPolynomials;
+    evaluatePolynomials(nbBatchPolynomials, value);
+    memcpy(index, batchPolynomialSensor, nbBatchPolynomials * sizeof(uint16_t));
+    for (int s = 0; s < nbBatchTables; s++) {
+        int i = batchTableSensor[s];
+        index[nbSamples] = (uint16_t)i;
+        value[nbSamples++] = interpolateTable(calibrationSlot[i], batchTableRaw[s]);
+    }
+    nbBatchPolynomials = 0;
+    nbBatchTables = 0;
+    return nbSamples;
+}
+
+/**
+ * \brief function to free the compiled calibrations, every sensor
+ * gives raw values again.
+ */
+void freeSensorCalibrations() {
+    free(polynomialCoefficients);
+    free(tableFirst);
+    free(tableCount);
+    free(tableX);
+    free(tableY);
+    polynomialCoefficients = NULL;
+    tableFirst = NULL;
+    tableCount = NULL;
+    tableX = NULL;
+    tableY = NULL;
+    memset(calibrationKind, 0, sizeof(calibrationKind));
+    nbCalibratedSensors = 0;
+    nbBatchPolynomials = 0;
+    nbBatchTables = 0;
+}
@@ -0,0 +1,365 @@
+/**
+ * \file sensorHistory.cpp
+ * \brief sensor values history functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Every sensor keeps its latest readings in a power of two ring,
+ * all the rings are carved in one contiguous memory arena allocated
+ * at initialisation. Next to the readings, each ring keeps the
+ * running sum of the readings and two monotonic queues of the
+ * minimum and maximum readings, so that the mean of the latest
+ * readings is computed in O(1) and their minimum and maximum
+ * in O(log(depth)), without going through the readings.
+ *
+ */
+#include "sensorHistory.h"
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief contiguous memory arena of every sensor ring.
+ */
+static void *historyArena = NULL;
+
+/**
+ * \brief reading timestamps (seconds since program start).
+ */
+static double *historyTimeStamp = NULL;
+
+/**
+ * \brief sum of every reading of the sensor before this one.
+ */
+static int64_t *historyRunningSum = NULL;
+
+/**
+ * \brief reading values.
+ */
+static int32_t *historyValue = NULL;
+
+/**
+ * \brief monotonic queue of the reading sequence numbers whose
+ * value is the minimum of the readings that follow them.
+ */
+static uint32_t *historyMinQueue = NULL;
+
+/**
+ * \brief monotonic queue of the reading sequence numbers whose
+ * value is the maximum of the readings that follow them.
+ */
+static uint32_t *historyMaxQueue = NULL;
+
+/**
+ * \brief first arena slot of each sensor ring.
+ */
+static uint32_t historyOffset[MAX_SENSORS];
+
+/**
+ * \brief depth - 1 of each sensor ring (depth is a power of two).
+ */
+static uint32_t historyMask[MAX_SENSORS];
+
+/**
+ * \brief number of readings pushed per sensor, it is also the
+ * sequence number of the next reading.
+ */
+static uint32_t historyCount[MAX_SENSORS];
+
+/**
+ * \brief first and next positions of the minimum and maximum
+ * monotonic queues of each sensor.
+ */
+static uint32_t minQueueHead[MAX_SENSORS];
+static uint32_t minQueueTail[MAX_SENSORS];
+static uint32_t maxQueueHead[MAX_SENSORS];
+static uint32_t maxQueueTail[MAX_SENSORS];
+
+/**
+ * \brief number of sensors with a ring.
+ */
+static int nbHistorySensors = 0;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static uint32_t roundUpPowerOfTwo(uint32_t depth);
+static uint32_t findQueueElement(const uint32_t *queue, uint32_t offset, uint32_t mask,
+                                 uint32_t head, uint32_t tail, uint32_t firstSeq);
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to round a history depth up to a power of two
+ * between 1 and SENSOR_HISTORY_MAX_DEPTH, 0 selects
+ * SENSOR_HISTORY_DEFAULT_DEPTH.
+ *
+ * \param depth the depth read from paramSensors.csv
+ *
+ * \return the ring depth.
+ */
+static uint32_t roundUpPowerOfTwo(uint32_t depth) {
+    uint32_t ringDepth = 1;
+
+    if (depth == 0)
+        depth = SENSOR_HISTORY_DEFAULT_DEPTH;
+    if (depth > SENSOR_HISTORY_MAX_DEPTH)
+        depth = SENSOR_HISTORY_MAX_DEPTH;
+    while (ringDepth < depth)
+        ringDepth <<= 1;
+    return ringDepth;
+}
+
+/**
+ * \brief function to allocate the history arena and the ring
+ * of every sensor.
+ *
+ * \param historyDepth the requested number of readings per sensor
+ * (rounded up to a power of two), can be NULL for the default depth
+ * \param nbSensors the number of sensors (at most MAX_SENSORS)
+ *
+ * \return statusErrDef that values:
+ * - errAllocSensorHistory when the history arena cannot be allocated
+ * - noError when the function exits successfully.
+ */
+statusErrDef initSensorHistory(const uint32_t *historyDepth, int nbSensors) {
+    uint32_t totalSlots = 0;
+
+    freeSensorHistory();
+
+    for (int i = 0; i < nbSensors; i++) {
+        uint32_t depth = roundUpPowerOfTwo(historyDepth != NULL ? historyDepth[i] : 0);
+        historyOffset[i] = totalSlots;
+        historyMask[i] = depth - 1;
+        historyCount[i] = 0;
+        minQueueHead[i] = minQueueTail[i] = 0;
+        maxQueueHead[i] = maxQueueTail[i] = 0;
+        totalSlots += depth;
+    }
+
+    // 8 bytes arrays first so that every array stays aligned
+    size_t arenaSize = (size_t)totalSlots * (sizeof(double) + sizeof(int64_t) +
+                        sizeof(int32_t) + 2 * sizeof(uint32_t));
+    if (arenaSize == 0) {
+        nbHistorySensors = 0;
+        return noError;
+    }
+    historyArena = malloc(arenaSize);
+    if (historyArena == NULL) {
+        perror("errAllocSensorHistory");
+        return errAllocSensorHistory;
+    }
+    memset(historyArena, 0, arenaSize);
+
+    historyTimeStamp = (double*)historyArena;
+    historyRunningSum = (int64_t*)(historyTimeStamp + totalSlots);
+    historyValue = (int32_t*)(historyRunningSum + totalSlots);
+    historyMinQueue = (uint32_t*)(historyValue + totalSlots);
+    historyMaxQueue = historyMinQueue + totalSlots;
+    nbHistorySensors = nbSensors;
+
+    printf("Sensor history: %u readings for %d sensors (%zu bytes)\n",
+           totalSlots, nbSensors, arenaSize);
+    return noError;
+}
+
+/**
+ * \brief function to free the history arena.
+ */
+void freeSensorHistory() {
+    free(historyArena);
+    historyArena = NULL;
+    historyTimeStamp = NULL;
+    historyRunningSum = NULL;
+    historyValue = NULL;
+    historyMinQueue = NULL;
+    historyMaxQueue = NULL;
+    nbHistorySensors = 0;
+}
+
+/**
+ * \brief function to add a reading to a sensor ring,
+ * the oldest reading is replaced when the ring is full.
+ *
+ * \param index the sensor index
+ * \param timeStamp the reading time in seconds since program start
+ * \param value the reading value
+ */
+void pushSensorHistory(int index, double timeStamp, int32_t value) {
+    if (index < 0 || index >= nbHistorySensors)
+        return;
+
+    uint32_t offset = historyOffset[index];
+    uint32_t mask = historyMask[index];
+    uint32_t seq = historyCount[index];
+    uint32_t slot = offset + (seq & mask);
+    uint32_t previousSlot = offset + ((seq - 1) & mask);
+
+    // Drop the readings leaving the ring from the front of the queues
+    while (minQueueHead[index] != minQueueTail[index] &&
+           seq - historyMinQueue[offset + (minQueueHead[index] & mask)] > mask)
+        minQueueHead[index]++;
+    while (maxQueueHead[index] != maxQueueTail[index] &&
+           seq - historyMaxQueue[offset + (maxQueueHead[index] & mask)] > mask)
+        maxQueueHead[index]++;
+
+    // Drop the readings that can no longer be the minimum or maximum
+    while (minQueueHead[index] != minQueueTail[index] &&
+           historyValue[offset + (historyMinQueue[offset + ((minQueueTail[index] - 1) & mask)] & mask)] >= value)
+        minQueueTail[index]--;
+    while (maxQueueHead[index] != maxQueueTail[index] &&
+           historyValue[offset + (historyMaxQueue[offset + ((maxQueueTail[index] - 1) & mask)] & mask)] <= value)
+        maxQueueTail[index]--;
+
+    historyRunningSum[slot] = (seq == 0) ? 0 : historyRunningSum[previousSlot] + historyValue[previousSlot];
+    historyTimeStamp[slot] = timeStamp;
+    historyValue[slot] = value;
+
+    historyMinQueue[offset + (minQueueTail[index]++ & mask)] = seq;
+    historyMaxQueue[offset + (maxQueueTail[index]++ & mask)] = seq;
+    historyCount[index] = seq + 1;
+}
+
+/**
+ * \brief function to get the ring depth of a sensor.
+ *
+ * \param index the sensor index
+ *
+ * \return the maximum number of readings kept for the sensor.
+ */
+uint32_t getSensorHistoryDepth(int index) {
+    if (index < 0 || index >= nbHistorySensors)
+        return 0;
+    return historyMask[index] + 1;
+}
+
+/**
+ * \brief function to get the number of readings available
+ * in a sensor ring.
+ *
+ * \param index the sensor index
+ *
+ * \return the number of readings (at most the ring depth).
+ */
+uint32_t getSensorHistoryCount(int index) {
+    if (index < 0 || index >= nbHistorySensors)
+        return 0;
+    if (historyCount[index] > historyMask[index])
+        return historyMask[index] + 1;
+    return historyCount[index];
+}
+
+/**
+ * \brief function to get one of the latest readings of a sensor.
+ *
+ * \param index the sensor index
+ * \param age 0 for the latest reading, 1 for the one before...
+ * \param timeStamp the reading time in seconds since program start
+ * \param value the reading value
+ *
+ * \return false when the ring does not hold this reading.
+ */
+bool getSensorHistoryReading(int index, uint32_t age, double *timeStamp, int32_t *value) {
+    if (age >= getSensorHistoryCount(index))
+        return false;
+
+    uint32_t slot = historyOffset[index] + ((historyCount[index] - 1 - age) & historyMask[index]);
+    if (timeStamp != NULL)
+        *timeStamp = historyTimeStamp[slot];
+    if (value != NULL)
+        *value = historyValue[slot];
+    return true;
+}
+
+/**
+ * \brief function to get the number of latest readings
+ * of a sensor taken at or after a given time.
+ *
+ * \param index the sensor index
+ * \param fromTime the time in seconds since program start
+ *
+ * \return the number of readings.
+ */
+uint32_t getSensorHistoryCountSince(int index, double fromTime) {
+    uint32_t low = 0;
+    uint32_t high = getSensorHistoryCount(index);
+
+    // Readings are in time order, find the first age that is too old
+    while (low < high) {
+        uint32_t age = low + (high - low) / 2;
+        uint32_t slot = historyOffset[index] + ((historyCount[index] - 1 - age) & historyMask[index]);
+        if (historyTimeStamp[slot] >= fromTime)
+            low = age + 1;
+        else
+            high = age;
+    }
+    return low;
+}
+
+/**
+ * \brief function to find the first element of a monotonic queue
+ * whose sequence number is in the window.
+ *
+ * \param queue the monotonic queue array
+ * \param offset the first arena slot of the sensor
+ * \param mask the sensor ring depth - 1
+ * \param head the queue first position
+ * \param tail the queue next position
+ * \param firstSeq the sequence number of the oldest reading of the window
+ *
+ * \return the reading sequence number.
+ */
+static uint32_t findQueueElement(const uint32_t *queue, uint32_t offset, uint32_t mask,
+                                 uint32_t head, uint32_t tail, uint32_t firstSeq) {
+    // The queue holds increasing sequence numbers, the last one is the latest reading
+    uint32_t low = head;
+    uint32_t high = tail - 1;
+    while (low != high) {
+        uint32_t middle = low + (high - low) / 2;
+        if ((int32_t)(queue[offset + (middle & mask)] - firstSeq) >= 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return queue[offset + (low & mask)];
+}
+
+/**
+ * \brief function to get the minimum, maximum and mean of
+ * the latest readings of a sensor.
+ *
+ * \param index the sensor index
+ * \param nbReadings the number of latest readings in the window
+ * (limited to the number of readings in the ring)
+ * \param window the window statistics
+ *
+ * \return false when the ring holds no reading.
+ */
+bool getSensorHistoryWindow(int index, uint32_t nbReadings, struct sensorWindowStruct *window) {
+    uint32_t available = getSensorHistoryCount(index);
+    if (nbReadings > available)
+        nbReadings = available;
+    if (nbReadings == 0)
+        return false;
+
+    uint32_t offset = historyOffset[index];
+    uint32_t mask = historyMask[index];
+    uint32_t lastSeq = historyCount[index] - 1;
+    uint32_t firstSeq = lastSeq - (nbReadings - 1);
+    uint32_t lastSlot = offset + (lastSeq & mask);
+    uint32_t firstSlot = offset + (firstSeq & mask);
+
+    uint32_t minSeq = findQueueElement(historyMinQueue, offset, mask,
+                                       minQueueHead[index], minQueueTail[index], firstSeq);
+    uint32_t maxSeq = findQueueElement(historyMaxQueue, offset, mask,
+                                       maxQueueHead[index], maxQueueTail[index], firstSeq);
+
+    window->nbReadings = nbReadings;
+    window->minValue = historyValue[offset + (minSeq & mask)];
+    window->maxValue = historyValue[offset + (maxSeq & mask)];
+    window->meanValue = (double)(historyRunningSum[lastSlot] + historyValue[lastSlot] -
+                                 historyRunningSum[firstSlot]) / nbReadings;
+    return true;
+}
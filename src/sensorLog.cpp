@@ -0,0 +1,978 @@
+/**
+ * \file sensorLog.cpp
+ * \brief sensor readings binary log functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Every sensor reading is copied as a fixed size record in a large
+ * aligned buffer, the buffer is handed to a writer thread when it is
+ * full or when SENSOR_LOG_FLUSH_PERIOD has elapsed since the last
+ * hand over, and the reading goes on in a free buffer of the pool, so
+ * that the readings path does no write() at all. The writer thread
+ * goes on in a new segment after SENSOR_LOG_SEGMENT_SIZE bytes or
+ * SENSOR_LOG_SEGMENT_PERIOD, a background thread prepares the next
+ * segment in advance and compresses the closed ones, then removes the
+ * oldest segments above SENSOR_LOG_RETENTION_BYTES.
+ *
+ * In ring mode, the readings are written straight into a preallocated
+ * memory mapped file and committed by a header index, a background
+ * thread synchronises the written readings to the storage every
+ * SENSOR_LOG_RING_SYNC_PERIOD, so that there is no system call per
+ * reading and a crash loses no committed reading. At the next start
+ * only the readings written after the last synchronisation are checked
+ * to recover the valid tail of the ring.
+ *
+ */
+#include "sensorLog.h"
+#include "sensorLogCodec.h"
+#include "rtProfile.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief sensor log buffer (SENSOR_LOG_BUFFER_SIZE bytes,
+ * aligned on SENSOR_LOG_BUFFER_ALIGN).
+ */
+uint8_t *sensorLogBuffer = NULL;
+
+/**
+ * \brief number of bytes of the sensor log buffer not
+ * written to the file yet.
+ */
+size_t sensorLogBufferUsed = 0;
+
+/**
+ * \brief header of the mapped ring log file, NULL when
+ * the ring mode is not used.
+ */
+struct sensorLogRingHeaderStruct *sensorLogRingHeader = NULL;
+
+/**
+ * \brief readings slots of the mapped ring log file.
+ */
+struct sensorLogRecordStruct *sensorLogRingRecords = NULL;
+
+/**
+ * \brief time in microseconds added to the reading timestamps
+ * of the ring log, so that the readings recovered from a previous
+ * run stay in time order with the new ones.
+ */
+uint64_t sensorLogTimeOffset = 0;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief sensor log file descriptor (the segment being written
+ * by the writer thread in segment mode).
+ */
+static int sensorLogFile = -1;
+
+/**
+ * \brief time of the last buffer hand over in microseconds
+ * since program start.
+ */
+static uint64_t lastFlushTime = 0;
+
+/**
+ * \struct fullBufferStruct
+ * \brief sensor log buffer waiting for the writer thread
+ *
+ */
+struct fullBufferStruct {
+    uint8_t *buffer;                        /**< Buffer */
+    size_t size;                            /**< Number of bytes to write */
+};
+
+/**
+ * \brief sensor log buffers pool, the free buffers and the full
+ * buffers queue (protected by sensorLogMutex).
+ */
+static uint8_t *sensorLogBuffers[SENSOR_LOG_BUFFERS];
+static uint8_t *freeBuffers[SENSOR_LOG_BUFFERS];
+static int nbFreeBuffers = 0;
+static struct fullBufferStruct fullBuffers[SENSOR_LOG_BUFFERS];
+static int fullBuffersHead = 0;
+static int nbFullBuffers = 0;
+
+/**
+ * \brief segment rotation asked by pollSensorLog(), the writer thread
+ * write error not reported yet and the writer thread stop request
+ * (protected by sensorLogMutex).
+ */
+static bool segmentRotationRequested = false;
+static bool sensorLogWriteFailed = false;
+static bool sensorLogWriterStop = false;
+
+/**
+ * \brief writer thread of the segment mode.
+ */
+static pthread_t sensorLogWriterThread;
+static pthread_cond_t sensorLogWriterCond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * \brief ring log file mapping size in bytes.
+ */
+static size_t sensorLogRingSize = 0;
+
+/**
+ * \brief sensor log background thread (ring synchronisation or
+ * segments rotation and compression) and its stop request.
+ */
+static pthread_t sensorLogThread;
+static pthread_mutex_t sensorLogMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sensorLogCond = PTHREAD_COND_INITIALIZER;
+static bool sensorLogStop = false;
+
+/**
+ * \brief directory of the sensor log segments.
+ */
+static char sensorLogDir[MAX_PATH_LENGHT];
+
+/**
+ * \brief number of the segment being written, its size in bytes
+ * (writer thread) and its creation time in microseconds since program
+ * start (control thread).
+ */
+static uint32_t currentSegment = 0;
+static uint64_t segmentBytes = 0;
+static uint64_t segmentStartTime = 0;
+
+/**
+ * \brief number of the next segment to create (protected by
+ * sensorLogMutex).
+ */
+static uint32_t segmentCounter = 0;
+
+/**
+ * \brief next segment prepared by the background thread,
+ * -1 when not ready yet (protected by sensorLogMutex).
+ */
+static int nextSegmentFile = -1;
+static uint32_t nextSegment = 0;
+
+/**
+ * \struct closedSegmentStruct
+ * \brief closed segment waiting for compression
+ *
+ */
+struct closedSegmentStruct {
+    int file;                               /**< File descriptor to close, -1 when already closed */
+    uint32_t segment;                       /**< Segment number */
+};
+
+/**
+ * \brief closed segments queue (protected by sensorLogMutex).
+ */
+static struct closedSegmentStruct closedSegments[SENSOR_LOG_SEGMENT_QUEUE];
+static int closedSegmentsHead = 0;
+static int nbClosedSegments = 0;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static uint64_t recoverSensorLogRing(struct sensorLogRingHeaderStruct *header,
+                                     const struct sensorLogRecordStruct *records);
+static void syncSensorLogRing();
+static void *sensorLogSyncTask(void *arg);
+static int waitSensorLogThread(uint64_t period);
+static bool getSegmentPath(char *filePath, uint32_t segment, const char *extension);
+static int openSegment(uint32_t segment);
+static void rotateSensorLog();
+static void writeSensorLogBuffer(const uint8_t *buffer, size_t size);
+static void *sensorLogWriterTask(void *arg);
+static void freeSensorLogBuffers();
+static void compressSegment(uint32_t segment);
+static void applyRetentionPolicy(uint32_t firstSegmentInUse);
+static void *sensorLogWorkerTask(void *arg);
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to build the path of a sensor log segment.
+ *
+ * \param filePath the segment path (MAX_PATH_LENGHT bytes)
+ * \param segment the segment number
+ * \param extension ".bin" or ".dz"
+ *
+ * \return false when the path is longer than MAX_PATH_LENGHT.
+ */
+static bool getSegmentPath(char *filePath, uint32_t segment, const char *extension) {
+    return snprintf(filePath, MAX_PATH_LENGHT, "%s%s%06u%s",
+                    sensorLogDir, SENSOR_LOG_SEGMENT_PREFIX, segment, extension) < MAX_PATH_LENGHT;
+}
+
+/**
+ * \brief function to create a sensor log segment and write its header.
+ *
+ * \param segment the segment number
+ *
+ * \return the segment file descriptor, -1 on error.
+ */
+static int openSegment(uint32_t segment) {
+    struct sensorLogHeaderStruct header;
+    char filePath[MAX_PATH_LENGHT];
+
+    if (!getSegmentPath(filePath, segment, ".bin")) {
+        printf("errOpenSensorsValFile: sensor log path longer than %d bytes\n", MAX_PATH_LENGHT);
+        return -1;
+    }
+    int file = open(filePath, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (file < 0) {
+        perror("File open error");
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SENSOR_LOG_MAGIC, sizeof(header.magic));
+    header.version = SENSOR_LOG_VERSION;
+    header.recordSize = sizeof(struct sensorLogRecordStruct);
+    if (write(file, &header, sizeof(header)) != sizeof(header)) {
+        perror("errWriteSensorLog");
+        close(file);
+        unlink(filePath);
+        return -1;
+    }
+    return file;
+}
+
+/**
+ * \brief function to create the first sensor log segment after the
+ * segments of the previous runs, allocate the sensor log buffers and
+ * start the writer thread and the segments compression thread.
+ *
+ * \param directory location of the sensor log segments
+ *
+ * \return statusErrDef that values:
+ * - errAllocSensorLogBuffer when the log buffers cannot be allocated
+ * - errOpenSensorsValFile when the sensor log segment can't be created
+ * - errStartSensorLogWorker when the background threads can't be started
+ * - noError when the function exits successfully.
+ */
+statusErrDef initSensorLog(const char *directory) {
+    void *buffer = NULL;
+    uint32_t segment = 0;
+    char extension[4];
+    bool found = false;
+
+    // A retried OBDH init starts again from a closed log
+    closeSensorLog();
+    if (snprintf(sensorLogDir, sizeof(sensorLogDir), "%s", directory) >= (int)sizeof(sensorLogDir)) {
+        printf("errOpenSensorsValFile: sensor log directory longer than %d bytes\n", MAX_PATH_LENGHT);
+        return errOpenSensorsValFile;
+    }
+    closedSegmentsHead = 0;
+    nbClosedSegments = 0;
+    nextSegmentFile = -1;
+
+    // Keep the segments of the previous runs, the uncompressed ones are queued
+    DIR *dir = opendir(sensorLogDir);
+    if (dir != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (sscanf(entry->d_name, SENSOR_LOG_SEGMENT_PREFIX "%6u.%3s", &segment, extension) != 2)
+                continue;
+            if (!found || segment >= segmentCounter)
+                segmentCounter = segment + 1;
+            found = true;
+            if (strcmp(extension, "bin") == 0 && nbClosedSegments < SENSOR_LOG_SEGMENT_QUEUE) {
+                closedSegments[nbClosedSegments].file = -1;
+                closedSegments[nbClosedSegments].segment = segment;
+                nbClosedSegments++;
+            }
+        }
+        closedir(dir);
+    }
+
+    fullBuffersHead = 0;
+    nbFullBuffers = 0;
+    for (int b = 0; b < SENSOR_LOG_BUFFERS; b++) {
+        if (posix_memalign(&buffer, SENSOR_LOG_BUFFER_ALIGN, SENSOR_LOG_BUFFER_SIZE) != 0) {
+            perror("errAllocSensorLogBuffer");
+            freeSensorLogBuffers();
+            return errAllocSensorLogBuffer;
+        }
+        sensorLogBuffers[b] = (uint8_t*)buffer;
+        freeBuffers[nbFreeBuffers++] = sensorLogBuffers[b];
+    }
+
+    currentSegment = segmentCounter++;
+    printf("sensor log segment: %s%s%06u.bin\n", sensorLogDir, SENSOR_LOG_SEGMENT_PREFIX, currentSegment);
+    sensorLogFile = openSegment(currentSegment);
+    if (sensorLogFile < 0) {
+        freeSensorLogBuffers();
+        return errOpenSensorsValFile;
+    }
+    sensorLogBufferUsed = 0;
+    segmentBytes = sizeof(struct sensorLogHeaderStruct);
+    segmentStartTime = 0;
+    lastFlushTime = 0;
+    segmentRotationRequested = false;
+    sensorLogWriteFailed = false;
+
+    sensorLogWriterStop = false;
+    if (pthread_create(&sensorLogWriterThread, NULL, sensorLogWriterTask, NULL) != 0) {
+        perror("errStartSensorLogWorker");
+        close(sensorLogFile);
+        sensorLogFile = -1;
+        freeSensorLogBuffers();
+        return errStartSensorLogWorker;
+    }
+    sensorLogStop = false;
+    if (pthread_create(&sensorLogThread, NULL, sensorLogWorkerTask, NULL) != 0) {
+        perror("errStartSensorLogWorker");
+        pthread_mutex_lock(&sensorLogMutex);
+        sensorLogWriterStop = true;
+        pthread_cond_signal(&sensorLogWriterCond);
+        pthread_mutex_unlock(&sensorLogMutex);
+        pthread_join(sensorLogWriterThread, NULL);
+        close(sensorLogFile);
+        sensorLogFile = -1;
+        freeSensorLogBuffers();
+        return errStartSensorLogWorker;
+    }
+    sensorLogBuffer = freeBuffers[--nbFreeBuffers];
+    return noError;
+}
+
+/**
+ * \brief function to free the sensor log buffers pool.
+ */
+static void freeSensorLogBuffers() {
+    for (int b = 0; b < SENSOR_LOG_BUFFERS; b++) {
+        free(sensorLogBuffers[b]);
+        sensorLogBuffers[b] = NULL;
+    }
+    nbFreeBuffers = 0;
+    sensorLogBuffer = NULL;
+}
+
+/**
+ * \brief function to hand the sensor log buffer over to the writer
+ * thread and go on in a free buffer. When the writer thread is behind
+ * and every buffer is waiting, the readings of the buffer are dropped.
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the readings are dropped, or when the writer
+ * thread has failed to write a buffer since the last call
+ * - noError when the function exits successfully.
+ */
+statusErrDef flushSensorLog() {
+    statusErrDef ret = noError;
+
+    pthread_mutex_lock(&sensorLogMutex);
+    if (sensorLogWriteFailed) {
+        sensorLogWriteFailed = false;
+        ret = errWriteSensorLog;
+    }
+    if (sensorLogBufferUsed > 0) {
+        if (nbFreeBuffers > 0) {
+            int last = (fullBuffersHead + nbFullBuffers) % SENSOR_LOG_BUFFERS;
+            fullBuffers[last].buffer = sensorLogBuffer;
+            fullBuffers[last].size = sensorLogBufferUsed;
+            nbFullBuffers++;
+            sensorLogBuffer = freeBuffers[--nbFreeBuffers];
+            pthread_cond_signal(&sensorLogWriterCond);
+        }
+        else {
+            printf("Sensor log: writer thread behind, %zu readings dropped\n",
+                   sensorLogBufferUsed / sizeof(struct sensorLogRecordStruct));
+            ret = errWriteSensorLog;
+        }
+        sensorLogBufferUsed = 0;
+    }
+    pthread_mutex_unlock(&sensorLogMutex);
+    return ret;
+}
+
+/**
+ * \brief function to write a full buffer to the segment, writer
+ * thread only, the log goes on in the next segment when the current
+ * one is full. A buffer that cannot be written is dropped.
+ *
+ * \param buffer the buffer
+ * \param size the number of bytes to write
+ */
+static void writeSensorLogBuffer(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+
+    while (written < size) {
+        ssize_t nbWritten = write(sensorLogFile, buffer + written, size - written);
+        if (nbWritten < 0 && errno == EINTR)
+            continue;
+        if (nbWritten < 0) {
+            perror("errWriteSensorLog");
+            pthread_mutex_lock(&sensorLogMutex);
+            sensorLogWriteFailed = true;
+            pthread_mutex_unlock(&sensorLogMutex);
+            break;
+        }
+        written += nbWritten;
+    }
+    segmentBytes += written;
+
+    if (segmentBytes >= SENSOR_LOG_SEGMENT_SIZE) {
+        pthread_mutex_lock(&sensorLogMutex);
+        rotateSensorLog();
+        pthread_mutex_unlock(&sensorLogMutex);
+    }
+}
+
+/**
+ * \brief sensor log writer thread, writes the full buffers to the
+ * segment and goes on in the next segment when asked, until
+ * closeSensorLog() (the waiting buffers are written first).
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *sensorLogWriterTask(void *arg) {
+    (void)arg;
+    setRTThreadProfile(rtIOThread);
+
+    pthread_mutex_lock(&sensorLogMutex);
+    while (true) {
+        if (nbFullBuffers > 0) {
+            struct fullBufferStruct full = fullBuffers[fullBuffersHead];
+            fullBuffersHead = (fullBuffersHead + 1) % SENSOR_LOG_BUFFERS;
+            nbFullBuffers--;
+            pthread_mutex_unlock(&sensorLogMutex);
+            writeSensorLogBuffer(full.buffer, full.size);
+            pthread_mutex_lock(&sensorLogMutex);
+            freeBuffers[nbFreeBuffers++] = full.buffer;
+            continue;
+        }
+        if (segmentRotationRequested) {
+            segmentRotationRequested = false;
+            if (segmentBytes > sizeof(struct sensorLogHeaderStruct))
+                rotateSensorLog();
+            continue;
+        }
+        if (sensorLogWriterStop)
+            break;
+        pthread_cond_wait(&sensorLogWriterCond, &sensorLogMutex);
+    }
+    pthread_mutex_unlock(&sensorLogMutex);
+    return NULL;
+}
+
+/**
+ * \brief function to go on with the segment prepared by the
+ * background thread and hand over the current one for compression,
+ * writer thread only, sensorLogMutex must be locked.
+ * Nothing is done when the next segment is not ready yet, the
+ * rotation is tried again after the next buffer.
+ */
+static void rotateSensorLog() {
+    if (nextSegmentFile >= 0 && nbClosedSegments < SENSOR_LOG_SEGMENT_QUEUE) {
+        int last = (closedSegmentsHead + nbClosedSegments) % SENSOR_LOG_SEGMENT_QUEUE;
+        closedSegments[last].file = sensorLogFile;
+        closedSegments[last].segment = currentSegment;
+        nbClosedSegments++;
+
+        sensorLogFile = nextSegmentFile;
+        currentSegment = nextSegment;
+        nextSegmentFile = -1;
+        segmentBytes = sizeof(struct sensorLogHeaderStruct);
+        pthread_cond_signal(&sensorLogCond);
+    }
+}
+
+/**
+ * \brief function to hand the sensor log buffer over to the writer
+ * thread when SENSOR_LOG_FLUSH_PERIOD has elapsed since the last hand
+ * over, and ask it to go on in the next segment after
+ * SENSOR_LOG_SEGMENT_PERIOD (to call once per main loop, nothing to
+ * do in ring mode).
+ *
+ * \param timeStamp the current time in microseconds since program start
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when readings are dropped or can't be written
+ * - noError when the function exits successfully.
+ */
+statusErrDef pollSensorLog(uint64_t timeStamp) {
+    statusErrDef ret = noError;
+    if (sensorLogBuffer == NULL)
+        return ret;
+    if (timeStamp - lastFlushTime < SENSOR_LOG_FLUSH_PERIOD)
+        return ret;
+    lastFlushTime = timeStamp;
+    ret = flushSensorLog();
+    if (timeStamp - segmentStartTime >= SENSOR_LOG_SEGMENT_PERIOD) {
+        segmentStartTime = timeStamp;
+        pthread_mutex_lock(&sensorLogMutex);
+        segmentRotationRequested = true;
+        pthread_cond_signal(&sensorLogWriterCond);
+        pthread_mutex_unlock(&sensorLogMutex);
+    }
+    return ret;
+}
+
+/**
+ * \brief function to write the remaining readings, close the
+ * sensor log segment, wait for its compression and free the sensor
+ * log buffers (or stop the ring log synchronisation thread and unmap
+ * the ring log file).
+ *
+ * \return statusErrDef that values:
+ * - errWriteSensorLog when the buffer cannot be written
+ * - noError when the function exits successfully.
+ */
+statusErrDef closeSensorLog() {
+    statusErrDef ret = noError;
+    if (sensorLogRingHeader != NULL) {
+        pthread_mutex_lock(&sensorLogMutex);
+        sensorLogStop = true;
+        pthread_cond_signal(&sensorLogCond);
+        pthread_mutex_unlock(&sensorLogMutex);
+        pthread_join(sensorLogThread, NULL);
+        syncSensorLogRing();
+        munmap(sensorLogRingHeader, sensorLogRingSize);
+        close(sensorLogFile);
+        sensorLogFile = -1;
+        sensorLogRingHeader = NULL;
+        sensorLogRingRecords = NULL;
+        return ret;
+    }
+    if (sensorLogBuffer == NULL)
+        return ret;
+    ret = flushSensorLog();
+
+    // The writer thread writes the waiting buffers before it ends
+    pthread_mutex_lock(&sensorLogMutex);
+    sensorLogWriterStop = true;
+    pthread_cond_signal(&sensorLogWriterCond);
+    pthread_mutex_unlock(&sensorLogMutex);
+    pthread_join(sensorLogWriterThread, NULL);
+
+    pthread_mutex_lock(&sensorLogMutex);
+    if (sensorLogWriteFailed) {
+        sensorLogWriteFailed = false;
+        ret = errWriteSensorLog;
+    }
+    if (nbClosedSegments < SENSOR_LOG_SEGMENT_QUEUE) {
+        int last = (closedSegmentsHead + nbClosedSegments) % SENSOR_LOG_SEGMENT_QUEUE;
+        closedSegments[last].file = sensorLogFile;
+        closedSegments[last].segment = currentSegment;
+        nbClosedSegments++;
+    }
+    else {
+        // Compressed at the next start
+        close(sensorLogFile);
+    }
+    sensorLogFile = -1;
+    sensorLogStop = true;
+    pthread_cond_signal(&sensorLogCond);
+    pthread_mutex_unlock(&sensorLogMutex);
+    pthread_join(sensorLogThread, NULL);
+
+    freeSensorLogBuffers();
+    return ret;
+}
+
+/**
+ * \brief function to compress a closed sensor log segment
+ * ("NNNNNN".bin to "NNNNNN".dz), block by block.
+ *
+ * \param segment the segment number
+ */
+static void compressSegment(uint32_t segment) {
+    static struct sensorLogRecordStruct records[SENSOR_LOG_CODEC_BLOCK];
+    static uint8_t data[SENSOR_LOG_CODEC_BLOCK * SENSOR_LOG_CODEC_MAX_RECORD_SIZE];
+    struct sensorLogHeaderStruct header;
+    struct sensorLogBlockHeaderStruct block;
+    char filePath[MAX_PATH_LENGHT];
+    char compressedPath[MAX_PATH_LENGHT];
+    char tempPath[MAX_PATH_LENGHT];
+    size_t nbRead = 0;
+    bool ok = true;
+
+    // The segment stays uncompressed when a path is too long
+    if (!getSegmentPath(filePath, segment, ".bin") ||
+        !getSegmentPath(compressedPath, segment, ".dz") ||
+        snprintf(tempPath, sizeof(tempPath), "%s.tmp", compressedPath) >= (int)sizeof(tempPath))
+        return;
+
+    FILE *input = fopen(filePath, "rb");
+    if (input == NULL)
+        return;
+    if (fread(&header, sizeof(header), 1, input) != 1 ||
+        memcmp(header.magic, SENSOR_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+        header.recordSize != sizeof(struct sensorLogRecordStruct)) {
+        fclose(input);
+        return;
+    }
+    FILE *output = fopen(tempPath, "wb");
+    if (output == NULL) {
+        perror("File open error");
+        fclose(input);
+        return;
+    }
+
+    memcpy(header.magic, SENSOR_LOG_COMPRESSED_MAGIC, sizeof(header.magic));
+    ok = fwrite(&header, sizeof(header), 1, output) == 1;
+    while (ok && (nbRead = fread(records, sizeof(records[0]), SENSOR_LOG_CODEC_BLOCK, input)) > 0) {
+        block.nbRecords = (uint32_t)nbRead;
+        block.nbBytes = (uint32_t)encodeSensorLogBlock(records, block.nbRecords, data);
+        ok = fwrite(&block, sizeof(block), 1, output) == 1 &&
+             fwrite(data, 1, block.nbBytes, output) == block.nbBytes;
+    }
+    fclose(input);
+    if (fclose(output) != 0)
+        ok = false;
+
+    if (ok && rename(tempPath, compressedPath) == 0) {
+        unlink(filePath);
+    }
+    else {
+        perror("compress sensor log segment");
+        unlink(tempPath);
+    }
+}
+
+/**
+ * \brief function to remove the oldest closed segments while the
+ * segments take more than SENSOR_LOG_RETENTION_BYTES.
+ *
+ * \param firstSegmentInUse the first segment written or prepared,
+ * it and the following ones are kept
+ */
+static void applyRetentionPolicy(uint32_t firstSegmentInUse) {
+    std::vector<std::pair<uint32_t, std::string>> segments;
+    char filePath[MAX_PATH_LENGHT];
+    struct stat fileStat;
+    uint32_t segment = 0;
+    char extension[4];
+    uint64_t totalBytes = 0;
+
+    DIR *dir = opendir(sensorLogDir);
+    if (dir == NULL)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (sscanf(entry->d_name, SENSOR_LOG_SEGMENT_PREFIX "%6u.%3s", &segment, extension) != 2)
+            continue;
+        if (snprintf(filePath, sizeof(filePath), "%s%s", sensorLogDir, entry->d_name) >= (int)sizeof(filePath) ||
+            stat(filePath, &fileStat) != 0)
+            continue;
+        totalBytes += fileStat.st_size;
+        if (segment < firstSegmentInUse)
+            segments.push_back(std::make_pair(segment, std::string(filePath)));
+    }
+    closedir(dir);
+
+    std::sort(segments.begin(), segments.end());
+    for (size_t i = 0; i < segments.size() && totalBytes > SENSOR_LOG_RETENTION_BYTES; i++) {
+        if (stat(segments[i].second.c_str(), &fileStat) != 0)
+            continue;
+        if (unlink(segments[i].second.c_str()) == 0) {
+            totalBytes -= fileStat.st_size;
+            printf("sensor log segment removed: %s\n", segments[i].second.c_str());
+        }
+    }
+}
+
+/**
+ * \brief sensor log segments thread, prepares the next segment,
+ * closes and compresses the closed segments and applies the
+ * retention policy until closeSensorLog().
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *sensorLogWorkerTask(void *arg) {
+    char filePath[MAX_PATH_LENGHT];
+    bool retention = true;
+    (void)arg;
+    setRTThreadProfile(rtIOThread);
+
+    pthread_mutex_lock(&sensorLogMutex);
+    while (true) {
+        if (nbClosedSegments > 0) {
+            struct closedSegmentStruct closed = closedSegments[closedSegmentsHead];
+            closedSegmentsHead = (closedSegmentsHead + 1) % SENSOR_LOG_SEGMENT_QUEUE;
+            nbClosedSegments--;
+            pthread_mutex_unlock(&sensorLogMutex);
+            if (closed.file >= 0)
+                close(closed.file);
+            compressSegment(closed.segment);
+            retention = true;
+            pthread_mutex_lock(&sensorLogMutex);
+            continue;
+        }
+        if (retention) {
+            // Segments from the current one (or the first one of the queue) are in use
+            uint32_t firstSegmentInUse = currentSegment;
+            pthread_mutex_unlock(&sensorLogMutex);
+            applyRetentionPolicy(firstSegmentInUse);
+            retention = false;
+            pthread_mutex_lock(&sensorLogMutex);
+            continue;
+        }
+        if (sensorLogStop)
+            break;
+        if (nextSegmentFile < 0) {
+            uint32_t segment = segmentCounter++;
+            pthread_mutex_unlock(&sensorLogMutex);
+            int file = openSegment(segment);
+            pthread_mutex_lock(&sensorLogMutex);
+            if (file >= 0) {
+                nextSegmentFile = file;
+                nextSegment = segment;
+                continue;
+            }
+            // Try again later, the main loop goes on in the current segment
+            waitSensorLogThread(SENSOR_LOG_FLUSH_PERIOD);
+            continue;
+        }
+        pthread_cond_wait(&sensorLogCond, &sensorLogMutex);
+    }
+
+    // The prepared segment is empty
+    if (nextSegmentFile >= 0) {
+        close(nextSegmentFile);
+        if (getSegmentPath(filePath, nextSegment, ".bin"))
+            unlink(filePath);
+        nextSegmentFile = -1;
+    }
+    pthread_mutex_unlock(&sensorLogMutex);
+    return NULL;
+}
+
+/**
+ * \brief function to wait for a stop request or the end of a
+ * period, sensorLogMutex must be locked.
+ *
+ * \param period the period in microseconds
+ *
+ * \return ETIMEDOUT when the period has elapsed.
+ */
+static int waitSensorLogThread(uint64_t period) {
+    struct timespec wakeTime;
+
+    clock_gettime(CLOCK_REALTIME, &wakeTime);
+    wakeTime.tv_nsec += (period % 1000000) * 1000;
+    wakeTime.tv_sec += period / 1000000 + wakeTime.tv_nsec / 1000000000;
+    wakeTime.tv_nsec %= 1000000000;
+    return pthread_cond_timedwait(&sensorLogCond, &sensorLogMutex, &wakeTime);
+}
+
+/**
+ * \brief function to open (or create) the sensor ring log file,
+ * map it in memory, recover the readings of the previous runs and
+ * start the synchronisation thread.
+ *
+ * \param fileName location and name of the sensor ring log file
+ *
+ * \return statusErrDef that values:
+ * - errOpenSensorsValFile when the sensor ring log file can't be opened
+ * - errMapSensorLogRing when the file can't be allocated or mapped
+ * - errStartSensorLogSync when the synchronisation thread can't be started
+ * - noError when the function exits successfully.
+ */
+statusErrDef initSensorLogRing(const char *fileName) {
+    struct sensorLogRingHeaderStruct *header = NULL;
+    struct stat fileStat;
+    bool newRing = false;
+
+    // A retried OBDH init starts again from a closed log
+    closeSensorLog();
+    sensorLogRingSize = SENSOR_LOG_RING_HEADER_SIZE +
+        (size_t)SENSOR_LOG_RING_CAPACITY * sizeof(struct sensorLogRecordStruct);
+
+    printf("filename: %s\n", fileName);
+    sensorLogFile = open(fileName, O_RDWR | O_CREAT, 0644);
+    if (sensorLogFile < 0) {
+        perror("File open error");
+        return errOpenSensorsValFile;
+    }
+    if (fstat(sensorLogFile, &fileStat) < 0) {
+        perror("errMapSensorLogRing");
+        close(sensorLogFile);
+        sensorLogFile = -1;
+        return errMapSensorLogRing;
+    }
+    if ((size_t)fileStat.st_size != sensorLogRingSize) {
+        // Allocate every block now, so that no write to the mapping can fail later
+        if (ftruncate(sensorLogFile, 0) < 0 ||
+            posix_fallocate(sensorLogFile, 0, sensorLogRingSize) != 0) {
+            perror("errMapSensorLogRing");
+            close(sensorLogFile);
+            sensorLogFile = -1;
+            return errMapSensorLogRing;
+        }
+        newRing = true;
+    }
+
+    void *mapping = mmap(NULL, sensorLogRingSize, PROT_READ | PROT_WRITE, MAP_SHARED, sensorLogFile, 0);
+    if (mapping == MAP_FAILED) {
+        perror("errMapSensorLogRing");
+        close(sensorLogFile);
+        sensorLogFile = -1;
+        return errMapSensorLogRing;
+    }
+    header = (struct sensorLogRingHeaderStruct*)mapping;
+    sensorLogRingRecords = (struct sensorLogRecordStruct*)((uint8_t*)mapping + SENSOR_LOG_RING_HEADER_SIZE);
+
+    if (!newRing && (memcmp(header->magic, SENSOR_LOG_RING_MAGIC, sizeof(header->magic)) != 0 ||
+                     header->version != SENSOR_LOG_VERSION ||
+                     header->recordSize != sizeof(struct sensorLogRecordStruct) ||
+                     header->capacity != SENSOR_LOG_RING_CAPACITY))
+        newRing = true;
+
+    if (newRing) {
+        memcpy(header->magic, SENSOR_LOG_RING_MAGIC, sizeof(header->magic));
+        header->version = SENSOR_LOG_VERSION;
+        header->recordSize = sizeof(struct sensorLogRecordStruct);
+        header->capacity = SENSOR_LOG_RING_CAPACITY;
+        header->commitIndex.store(0, std::memory_order_relaxed);
+        header->syncIndex.store(0, std::memory_order_relaxed);
+        msync(header, SENSOR_LOG_RING_HEADER_SIZE, MS_SYNC);
+        sensorLogTimeOffset = 0;
+        printf("Sensor ring log: created (%llu readings)\n",
+               (unsigned long long)SENSOR_LOG_RING_CAPACITY);
+    }
+    else {
+        uint64_t commitIndex = recoverSensorLogRing(header, sensorLogRingRecords);
+        sensorLogTimeOffset = (commitIndex == 0) ? 0 :
+            sensorLogRingRecords[(commitIndex - 1) & (SENSOR_LOG_RING_CAPACITY - 1)].timeStamp;
+        printf("Sensor ring log: %llu readings recovered\n",
+               (unsigned long long)(commitIndex < SENSOR_LOG_RING_CAPACITY ? commitIndex : SENSOR_LOG_RING_CAPACITY));
+    }
+
+    sensorLogRingHeader = header;
+    sensorLogStop = false;
+    if (pthread_create(&sensorLogThread, NULL, sensorLogSyncTask, NULL) != 0) {
+        perror("errStartSensorLogSync");
+        munmap(mapping, sensorLogRingSize);
+        close(sensorLogFile);
+        sensorLogFile = -1;
+        sensorLogRingHeader = NULL;
+        sensorLogRingRecords = NULL;
+        return errStartSensorLogSync;
+    }
+    return noError;
+}
+
+/**
+ * \brief function to find the valid tail of a ring log file after
+ * a restart. The readings before the synchronisation index are on the
+ * storage, only the readings written after it are checked: the valid
+ * tail stops at the first slot never written back (zero time stamp, the
+ * readings are timed after the init so never at 0, or a sensor ID out
+ * of the sensor IDs range) or at the first reading older than the one
+ * before it (a reading of the previous turn of the ring).
+ *
+ * \param header the ring log file header
+ * \param records the ring log file readings slots
+ *
+ * \return the recovered commit index.
+ */
+static uint64_t recoverSensorLogRing(struct sensorLogRingHeaderStruct *header,
+                                     const struct sensorLogRecordStruct *records) {
+    const uint64_t mask = SENSOR_LOG_RING_CAPACITY - 1;
+    uint64_t commitIndex = header->commitIndex.load(std::memory_order_acquire);
+    uint64_t syncIndex = header->syncIndex.load(std::memory_order_acquire);
+    uint64_t firstIndex = (commitIndex > SENSOR_LOG_RING_CAPACITY) ? commitIndex - SENSOR_LOG_RING_CAPACITY : 0;
+    uint64_t seq = 0;
+
+    if (syncIndex > commitIndex)
+        syncIndex = commitIndex;
+    if (syncIndex < firstIndex)
+        syncIndex = firstIndex;
+
+    uint64_t previousTime = (syncIndex > firstIndex) ? records[(syncIndex - 1) & mask].timeStamp : 0;
+    for (seq = syncIndex; seq < commitIndex; seq++) {
+        const struct sensorLogRecordStruct *record = &records[seq & mask];
+        if (record->timeStamp == 0 || record->timeStamp < previousTime ||
+            record->sensorId < SENSOR_ID_MIN || record->sensorId > SENSOR_ID_MAX ||
+            record->sensorIndex >= MAX_SENSORS)
+            break;
+        previousTime = record->timeStamp;
+    }
+    if (seq != commitIndex)
+        printf("Sensor ring log: %llu unsynchronised readings dropped\n",
+               (unsigned long long)(commitIndex - seq));
+
+    header->commitIndex.store(seq, std::memory_order_release);
+    header->syncIndex.store(seq, std::memory_order_release);
+    return seq;
+}
+
+/**
+ * \brief function to synchronise the readings committed since the
+ * last call, then the header, to the storage.
+ */
+static void syncSensorLogRing() {
+    const uint64_t mask = SENSOR_LOG_RING_CAPACITY - 1;
+    const uintptr_t pageMask = ~(uintptr_t)(SENSOR_LOG_RING_HEADER_SIZE - 1);
+    uint64_t commitIndex = sensorLogRingHeader->commitIndex.load(std::memory_order_acquire);
+    uint64_t syncIndex = sensorLogRingHeader->syncIndex.load(std::memory_order_relaxed);
+
+    if (commitIndex == syncIndex)
+        return;
+
+    uint64_t firstSlot = syncIndex & mask;
+    uint64_t endSlot = commitIndex & mask;
+    if (commitIndex - syncIndex >= SENSOR_LOG_RING_CAPACITY) {
+        firstSlot = 0;
+        endSlot = SENSOR_LOG_RING_CAPACITY;
+    }
+    else if (endSlot <= firstSlot) {
+        // The readings wrap around the end of the ring
+        uintptr_t start = (uintptr_t)&sensorLogRingRecords[firstSlot] & pageMask;
+        msync((void*)start, (uintptr_t)&sensorLogRingRecords[SENSOR_LOG_RING_CAPACITY] - start, MS_SYNC);
+        firstSlot = 0;
+    }
+    if (endSlot > firstSlot) {
+        uintptr_t start = (uintptr_t)&sensorLogRingRecords[firstSlot] & pageMask;
+        msync((void*)start, (uintptr_t)&sensorLogRingRecords[endSlot] - start, MS_SYNC);
+    }
+
+    // The header only reaches the storage after the readings it covers
+    sensorLogRingHeader->syncIndex.store(commitIndex, std::memory_order_release);
+    msync(sensorLogRingHeader, SENSOR_LOG_RING_HEADER_SIZE, MS_SYNC);
+}
+
+/**
+ * \brief ring log synchronisation thread, synchronises the ring
+ * every SENSOR_LOG_RING_SYNC_PERIOD until closeSensorLog().
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *sensorLogSyncTask(void *arg) {
+    (void)arg;
+    setRTThreadProfile(rtIOThread);
+
+    pthread_mutex_lock(&sensorLogMutex);
+    while (!sensorLogStop) {
+        int ret = waitSensorLogThread(SENSOR_LOG_RING_SYNC_PERIOD);
+        if (ret == ETIMEDOUT && !sensorLogStop) {
+            pthread_mutex_unlock(&sensorLogMutex);
+            syncSensorLogRing();
+            pthread_mutex_lock(&sensorLogMutex);
+        }
+    }
+    pthread_mutex_unlock(&sensorLogMutex);
+    return NULL;
+}
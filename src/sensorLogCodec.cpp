@@ -0,0 +1,87 @@
+/**
+ * \file sensorLogCodec.cpp
+ * \brief sensor log compression functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Every block is encoded independently, so that a damaged block
+ * does not prevent the decoding of the following ones.
+ *
+ */
+#include "sensorLogCodec.h"
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief previous value of every sensor ID in the block
+ * being encoded or decoded.
+ */
+static int32_t previousValue[SENSOR_INDEX_LUT_SIZE];
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to encode a block of readings.
+ *
+ * \param records the readings
+ * \param nbRecords the number of readings (at most SENSOR_LOG_CODEC_BLOCK)
+ * \param data the encoded readings, at least
+ * nbRecords * SENSOR_LOG_CODEC_MAX_RECORD_SIZE bytes
+ *
+ * \return the size of the encoded readings in bytes.
+ */
+size_t encodeSensorLogBlock(const struct sensorLogRecordStruct *records, uint32_t nbRecords, uint8_t *data) {
+    uint8_t *position = data;
+    struct sensorLogRecordStruct previous;
+
+    memset(&previous, 0, sizeof(previous));
+    memset(previousValue, 0, sizeof(previousValue));
+    for (uint32_t i = 0; i < nbRecords; i++) {
+        const struct sensorLogRecordStruct *record = &records[i];
+        position = writeVarint(position, zigzagEncode((int64_t)(record->timeStamp - previous.timeStamp)));
+        position = writeVarint(position, zigzagEncode((int32_t)record->sensorId - (int32_t)previous.sensorId));
+        position = writeVarint(position, zigzagEncode((int32_t)record->sensorIndex - (int32_t)previous.sensorIndex));
+        position = writeVarint(position, zigzagEncode((int64_t)record->value - previousValue[record->sensorId]));
+        previousValue[record->sensorId] = record->value;
+        previous = *record;
+    }
+    return position - data;
+}
+
+/**
+ * \brief function to decode a block of readings.
+ *
+ * \param data the encoded readings
+ * \param nbBytes the size of the encoded readings
+ * \param records the decoded readings
+ * \param nbRecords the number of readings of the block
+ *
+ * \return false when the block is damaged.
+ */
+bool decodeSensorLogBlock(const uint8_t *data, size_t nbBytes,
+                          struct sensorLogRecordStruct *records, uint32_t nbRecords) {
+    const uint8_t *end = data + nbBytes;
+    struct sensorLogRecordStruct previous;
+    uint64_t timeDelta, idDelta, indexDelta, valueDelta;
+
+    memset(&previous, 0, sizeof(previous));
+    memset(previousValue, 0, sizeof(previousValue));
+    for (uint32_t i = 0; i < nbRecords; i++) {
+        struct sensorLogRecordStruct *record = &records[i];
+        if ((data = readVarint(data, end, &timeDelta)) == NULL ||
+            (data = readVarint(data, end, &idDelta)) == NULL ||
+            (data = readVarint(data, end, &indexDelta)) == NULL ||
+            (data = readVarint(data, end, &valueDelta)) == NULL)
+            return false;
+        record->timeStamp = previous.timeStamp + (uint64_t)zigzagDecode(timeDelta);
+        record->sensorId = (uint16_t)(previous.sensorId + zigzagDecode(idDelta));
+        record->sensorIndex = (uint16_t)(previous.sensorIndex + zigzagDecode(indexDelta));
+        record->value = (int32_t)(previousValue[record->sensorId] + zigzagDecode(valueDelta));
+        previousValue[record->sensorId] = record->value;
+        previous = *record;
+    }
+    return data == end;
+}
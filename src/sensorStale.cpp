@@ -0,0 +1,139 @@
+/**
+ * \file sensorStale.cpp
+ * \brief sensor staleness detection functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Sensor staleness detection functions, the deadline of a sensor is
+ * SENSOR_STALE_MISSED_PERIODS times its expected period after its
+ * latest reading, in SENSOR_STALE_TICK ticks. Re-arming the timer of a
+ * sensor at each reading is O(1) and checking the deadlines only visits
+ * the timer wheel slots that are not empty, so the cost doesn't depend
+ * on the number of sensors that are on time.
+ *
+ */
+#include "sensorStale.h"
+#include "timerWheel.h"
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief sensors whose deadline expired since their latest
+ * reading (one bit per sensor index).
+ */
+uint64_t sensorStaleMask[SENSOR_MASK_WORDS];
+
+/**
+ * \brief number of sensors in sensorStaleMask.
+ */
+int nbSensorsStale = 0;
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief timer wheel of the sensor deadlines, the timer index is
+ * the sensor index.
+ */
+static struct timerWheelStruct staleWheel;
+
+/**
+ * \brief delay in ticks between a reading and the deadline of every
+ * sensor, 0 when the sensor has no expected period.
+ */
+static uint32_t staleTimeout[MAX_SENSORS];
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to arm the deadline of every sensor that has
+ * an expected period, counted from the init time.
+ *
+ * \param expectedPeriod the expected period of every sensor in
+ * milliseconds, 0 for no staleness check (NULL for none)
+ * \param nbSensors the number of sensors (at most MAX_SENSORS)
+ * \param timeStamp the time since start in microseconds
+ *
+ * \return statusErrDef that values:
+ * - errAllocTimerWheel when the timer wheel cannot be allocated
+ * - noError when the function exits successfully.
+ */
+statusErrDef initSensorStaleness(const uint32_t *expectedPeriod, int nbSensors, uint64_t timeStamp) {
+    if (nbSensors > MAX_SENSORS)
+        nbSensors = MAX_SENSORS;
+    memset(sensorStaleMask, 0, sizeof(sensorStaleMask));
+    memset(staleTimeout, 0, sizeof(staleTimeout));
+    nbSensorsStale = 0;
+
+    // A retried OBDH init allocates the timer wheel again
+    freeTimerWheel(&staleWheel);
+    uint64_t tick = timeStamp / SENSOR_STALE_TICK;
+    statusErrDef ret = initTimerWheel(&staleWheel, expectedPeriod != NULL ? nbSensors : 0, tick);
+    if (ret != noError || expectedPeriod == NULL)
+        return ret;
+    for (int i = 0; i < nbSensors; i++) {
+        if (expectedPeriod[i] == 0)
+            continue;
+        staleTimeout[i] = (uint32_t)(((uint64_t)expectedPeriod[i] * SENSOR_STALE_MISSED_PERIODS * 1000)
+                                     / SENSOR_STALE_TICK);
+        if (staleTimeout[i] == 0)
+            staleTimeout[i] = 1;
+        armTimer(&staleWheel, i, tick + staleTimeout[i]);
+    }
+    return noError;
+}
+
+/**
+ * \brief function to move the deadline of a sensor after a reading.
+ *
+ * \param index the sensor index
+ * \param timeStamp the reading time since start in microseconds
+ *
+ * \return true when the sensor was stale.
+ */
+bool touchSensorStaleness(int index, uint64_t timeStamp) {
+    if (index >= staleWheel.nbTimers || staleTimeout[index] == 0)
+        return false;
+    armTimer(&staleWheel, index, timeStamp / SENSOR_STALE_TICK + staleTimeout[index]);
+
+    uint64_t bit = (uint64_t)1 << (index & 63);
+    if ((sensorStaleMask[index >> 6] & bit) == 0)
+        return false;
+    sensorStaleMask[index >> 6] &= ~bit;
+    nbSensorsStale--;
+    return true;
+}
+
+/**
+ * \brief function to collect the sensors whose deadline expired
+ * since the previous check, they are added to sensorStaleMask.
+ *
+ * \param timeStamp the time since start in microseconds
+ * \param stale the array filled with the newly stale sensor indexes
+ * \param maxStale the size of the stale array, the remaining sensors
+ * are collected at the next check
+ *
+ * \return the number of newly stale sensors.
+ */
+int checkSensorStaleness(uint64_t timeStamp, uint16_t *stale, int maxStale) {
+    if (staleWheel.nbTimers == 0)
+        return 0;
+    int nbStale = advanceTimerWheel(&staleWheel, timeStamp / SENSOR_STALE_TICK, stale, maxStale);
+    for (int s = 0; s < nbStale; s++) {
+        sensorStaleMask[stale[s] >> 6] |= (uint64_t)1 << (stale[s] & 63);
+        nbSensorsStale++;
+    }
+    return nbStale;
+}
+
+/**
+ * \brief function to free the sensor deadlines.
+ */
+void freeSensorStaleness() {
+    freeTimerWheel(&staleWheel);
+    memset(sensorStaleMask, 0, sizeof(sensorStaleMask));
+    nbSensorsStale = 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * \file sensorStats.cpp
+ * \brief sensor streaming statistics functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * The statistics are updated in O(1) per reading by updateSensorStats()
+ * (see sensorStats.h), this file resets them and formats the
+ * HKSensorStats housekeeping packets.
+ *
+ */
+#include "sensorStats.h"
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief statistics of every sensor in the reporting window.
+ */
+struct sensorStatsStruct sensorStats;
+
+/**
+ * \brief reporting window start in microseconds since program start.
+ */
+uint64_t sensorStatsWindowStart = 0;
+
+/**
+ * \brief number of sensors with statistics.
+ */
+int nbStatsSensors = 0;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void pushUint32(std::vector<uint8_t> *telemOut, uint32_t value);
+static void pushFloat(std::vector<uint8_t> *telemOut, float value);
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to clear the statistics of every sensor,
+ * including the moving averages (called at initialisation).
+ *
+ * \param nbSensors the number of sensors (at most MAX_SENSORS)
+ */
+void initSensorStats(int nbSensors) {
+    if (nbSensors > MAX_SENSORS)
+        nbSensors = MAX_SENSORS;
+    memset(&sensorStats, 0, sizeof(sensorStats));
+    for (int i = 0; i < MAX_SENSORS; i++)
+        sensorStats.ewma[i] = NAN;
+    sensorStatsWindowStart = 0;
+    nbStatsSensors = nbSensors;
+}
+
+/**
+ * \brief function to start a new reporting window, the moving
+ * averages go on from the previous window.
+ *
+ * \param timeStamp the window start in microseconds since program start
+ */
+void resetSensorStats(uint64_t timeStamp) {
+    size_t size = (size_t)nbStatsSensors;
+    memset(sensorStats.count, 0, size * sizeof(sensorStats.count[0]));
+    memset(sensorStats.minValue, 0, size * sizeof(sensorStats.minValue[0]));
+    memset(sensorStats.maxValue, 0, size * sizeof(sensorStats.maxValue[0]));
+    memset(sensorStats.mean, 0, size * sizeof(sensorStats.mean[0]));
+    memset(sensorStats.m2, 0, size * sizeof(sensorStats.m2[0]));
+    sensorStatsWindowStart = timeStamp;
+}
+
+static void pushUint32(std::vector<uint8_t> *telemOut, uint32_t value) {
+    telemOut->push_back((value >> 24) & 0xFF);
+    telemOut->push_back((value >> 16) & 0xFF);
+    telemOut->push_back((value >> 8) & 0xFF);
+    telemOut->push_back(value & 0xFF);
+}
+
+static void pushFloat(std::vector<uint8_t> *telemOut, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    pushUint32(telemOut, bits);
+}
+
+/**
+ * \brief function to format an HKSensorStats housekeeping packet
+ * with the next SENSOR_STATS_PER_PACKET sensors having readings
+ * in the window.
+ *
+ * \param sensorId the ID of every sensor index
+ * \param firstIndex the sensor index to start from (0 for the first packet)
+ * \param timeStamp the current time in microseconds since program start
+ * \param telemOut the packet user data
+ *
+ * \return the sensor index to start the next packet from,
+ * nbStatsSensors when every sensor has been formatted.
+ */
+int fillSensorStatsPacket(const uint16_t *sensorId, int firstIndex, uint64_t timeStamp,
+                          std::vector<uint8_t> *telemOut) {
+    uint8_t nbEntries = 0;
+    int index = firstIndex;
+
+    telemOut->clear();
+    telemOut->reserve(7 + SENSOR_STATS_PER_PACKET * SENSOR_STATS_ENTRY_SIZE);
+    telemOut->push_back((HKSensorStats >> 8) & 0xFF);
+    telemOut->push_back(HKSensorStats & 0xFF);
+    pushUint32(telemOut, (uint32_t)((timeStamp - sensorStatsWindowStart) / 1000));
+    telemOut->push_back(0);
+
+    for (; index < nbStatsSensors && nbEntries < SENSOR_STATS_PER_PACKET; index++) {
+        uint32_t count = sensorStats.count[index];
+        if (count == 0)
+            continue;
+        telemOut->push_back((sensorId[index] >> 8) & 0xFF);
+        telemOut->push_back(sensorId[index] & 0xFF);
+        pushUint32(telemOut, count);
+        pushUint32(telemOut, (uint32_t)sensorStats.minValue[index]);
+        pushUint32(telemOut, (uint32_t)sensorStats.maxValue[index]);
+        pushFloat(telemOut, (float)sensorStats.mean[index]);
+        pushFloat(telemOut, (float)(count > 1 ? sqrt(sensorStats.m2[index] / (count - 1)) : 0.0));
+        pushFloat(telemOut, (float)sensorStats.ewma[index]);
+        nbEntries++;
+    }
+    (*telemOut)[6] = nbEntries;
+    return index;
+}
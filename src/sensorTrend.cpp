@@ -0,0 +1,276 @@
+/**
+ * \file sensorTrend.cpp
+ * \brief sensor trend prediction functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * The least squares line of every sensor is computed from running sums
+ * of the readings of its history ring (count, sum of times, of values,
+ * of squared times and of times by values): each new reading is added
+ * and the reading leaving the ring is removed, so that a sample costs
+ * O(1). The times are taken relative to an origin close to the window,
+ * and the sums are computed again from the ring once per ring depth
+ * readings, so that the rounding errors don't build up (still O(1)
+ * per reading on average).
+ *
+ * updateSensorTrend() must be called before pushSensorHistory(), so
+ * that the reading about to leave the ring is still in it.
+ *
+ */
+#include "sensorTrend.h"
+#include "sensorHistory.h"
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief sensors whose trend predicts a warning bound crossing
+ * within SENSOR_TREND_HORIZON (one bit per sensor index).
+ */
+uint64_t sensorTrendWarnMask[SENSOR_MASK_WORDS];
+
+/**
+ * \brief sensors whose trend predicts a critical bound crossing
+ * within SENSOR_TREND_HORIZON (one bit per sensor index).
+ */
+uint64_t sensorTrendCriticalMask[SENSOR_MASK_WORDS];
+
+/**
+ * \brief predicted time in seconds before the next bound crossing
+ * of every sensor in one of the trend masks.
+ */
+double sensorTrendCrossingTime[MAX_SENSORS];
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief running sums of the readings in the history ring of every
+ * sensor, with the times relative to trendOrigin.
+ */
+static uint32_t trendCount[MAX_SENSORS];
+static double trendSumT[MAX_SENSORS];
+static double trendSumV[MAX_SENSORS];
+static double trendSumTT[MAX_SENSORS];
+static double trendSumTV[MAX_SENSORS];
+static double trendOrigin[MAX_SENSORS];
+
+/**
+ * \brief time of the latest reading of every sensor.
+ */
+static double trendLastTime[MAX_SENSORS];
+
+/**
+ * \brief number of readings added since the sums were computed
+ * from the ring.
+ */
+static uint32_t trendUpdates[MAX_SENSORS];
+
+/**
+ * \brief number of sensors with a trend.
+ */
+static int nbTrendSensors = 0;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void rebuildSensorTrend(int index);
+static double getCrossingTime(double predictedValue, double slope, int32_t minBound, int32_t maxBound);
+static bool setTrendBit(uint64_t *mask, int index, bool set);
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to clear the trend of every sensor.
+ *
+ * \param nbSensors the number of sensors (at most MAX_SENSORS)
+ */
+void initSensorTrend(int nbSensors) {
+    if (nbSensors > MAX_SENSORS)
+        nbSensors = MAX_SENSORS;
+    memset(trendCount, 0, sizeof(trendCount));
+    memset(trendSumT, 0, sizeof(trendSumT));
+    memset(trendSumV, 0, sizeof(trendSumV));
+    memset(trendSumTT, 0, sizeof(trendSumTT));
+    memset(trendSumTV, 0, sizeof(trendSumTV));
+    memset(trendOrigin, 0, sizeof(trendOrigin));
+    memset(trendLastTime, 0, sizeof(trendLastTime));
+    memset(trendUpdates, 0, sizeof(trendUpdates));
+    memset(sensorTrendWarnMask, 0, sizeof(sensorTrendWarnMask));
+    memset(sensorTrendCriticalMask, 0, sizeof(sensorTrendCriticalMask));
+    memset(sensorTrendCrossingTime, 0, sizeof(sensorTrendCrossingTime));
+    nbTrendSensors = nbSensors;
+}
+
+/**
+ * \brief function to compute the running sums of a sensor again
+ * from its history ring, with the oldest reading as time origin.
+ *
+ * \param index the sensor index
+ */
+static void rebuildSensorTrend(int index) {
+    uint32_t count = getSensorHistoryCount(index);
+    double timeStamp = 0;
+    int32_t value = 0;
+
+    trendCount[index] = 0;
+    trendSumT[index] = trendSumV[index] = trendSumTT[index] = trendSumTV[index] = 0;
+    trendUpdates[index] = 0;
+    if (count == 0)
+        return;
+
+    getSensorHistoryReading(index, count - 1, &trendOrigin[index], NULL);
+    for (uint32_t age = 0; age < count; age++) {
+        getSensorHistoryReading(index, age, &timeStamp, &value);
+        double t = timeStamp - trendOrigin[index];
+        trendSumT[index] += t;
+        trendSumV[index] += value;
+        trendSumTT[index] += t * t;
+        trendSumTV[index] += t * value;
+    }
+    trendCount[index] = count;
+}
+
+/**
+ * \brief function to get the time before a predicted value
+ * crosses a bound, following its slope.
+ *
+ * \param predictedValue the predicted current value
+ * \param slope the value slope per second
+ * \param minBound the lower bound
+ * \param maxBound the upper bound
+ *
+ * \return the time in seconds, negative when the value
+ * is not heading towards a bound.
+ */
+static double getCrossingTime(double predictedValue, double slope, int32_t minBound, int32_t maxBound) {
+    if (slope > 0 && predictedValue < maxBound)
+        return (maxBound - predictedValue) / slope;
+    if (slope < 0 && predictedValue > minBound)
+        return (minBound - predictedValue) / slope;
+    return -1.0;
+}
+
+/**
+ * \brief function to set or clear the bit of a sensor in a trend mask.
+ *
+ * \param mask the trend mask
+ * \param index the sensor index
+ * \param set true to set the bit
+ *
+ * \return true when the bit has just been set.
+ */
+static bool setTrendBit(uint64_t *mask, int index, bool set) {
+    uint64_t bit = (uint64_t)1 << (index & 63);
+    bool wasSet = (mask[index >> 6] & bit) != 0;
+    if (set)
+        mask[index >> 6] |= bit;
+    else
+        mask[index >> 6] &= ~bit;
+    return set && !wasSet;
+}
+
+/**
+ * \brief function to get the least squares line of the
+ * history readings of a sensor.
+ *
+ * \param index the sensor index
+ * \param slope the value slope per second
+ * \param predictedValue the line value at the latest reading time
+ *
+ * \return false when there are not enough readings
+ * (SENSOR_TREND_MIN_READINGS) or they all have the same time.
+ */
+bool getSensorTrend(int index, double *slope, double *predictedValue) {
+    if (index < 0 || index >= nbTrendSensors || trendCount[index] < SENSOR_TREND_MIN_READINGS)
+        return false;
+
+    double n = trendCount[index];
+    double denominator = n * trendSumTT[index] - trendSumT[index] * trendSumT[index];
+    if (denominator <= 0)
+        return false;
+    double b = (n * trendSumTV[index] - trendSumT[index] * trendSumV[index]) / denominator;
+    double a = (trendSumV[index] - b * trendSumT[index]) / n;
+    *slope = b;
+    *predictedValue = a + b * (trendLastTime[index] - trendOrigin[index]);
+    return true;
+}
+
+/**
+ * \brief function to add a reading to the trend of a sensor and
+ * predict its next bound crossing (to call before pushSensorHistory()).
+ *
+ * \param param the sensors parameters (bounds)
+ * \param index the sensor index
+ * \param timeStamp the reading time in seconds since program start
+ * \param value the reading value
+ *
+ * \return statusErrDef that values:
+ * - infoSensorTrendCritical when a critical bound crossing is newly
+ * predicted within SENSOR_TREND_HORIZON
+ * - infoSensorTrendWarn when a warning bound crossing is newly
+ * predicted within SENSOR_TREND_HORIZON
+ * - noError otherwise.
+ */
+statusErrDef updateSensorTrend(const struct paramSensorsStruct *param, int index,
+                               double timeStamp, int32_t value) {
+    double oldTime = 0;
+    int32_t oldValue = 0;
+    double slope = 0;
+    double predictedValue = 0;
+
+    if (index < 0 || index >= nbTrendSensors)
+        return noError;
+
+    uint32_t depth = getSensorHistoryDepth(index);
+    if (trendUpdates[index] >= depth || trendCount[index] == 0)
+        rebuildSensorTrend(index);
+    if (trendCount[index] == 0)
+        trendOrigin[index] = timeStamp;
+
+    // Remove the reading that pushSensorHistory() is about to replace
+    if (depth > 0 && getSensorHistoryCount(index) == depth &&
+        getSensorHistoryReading(index, depth - 1, &oldTime, &oldValue)) {
+        double t = oldTime - trendOrigin[index];
+        trendSumT[index] -= t;
+        trendSumV[index] -= oldValue;
+        trendSumTT[index] -= t * t;
+        trendSumTV[index] -= t * oldValue;
+        trendCount[index]--;
+    }
+
+    double t = timeStamp - trendOrigin[index];
+    trendSumT[index] += t;
+    trendSumV[index] += value;
+    trendSumTT[index] += t * t;
+    trendSumTV[index] += t * value;
+    trendCount[index]++;
+    trendUpdates[index]++;
+    trendLastTime[index] = timeStamp;
+
+    bool warn = false;
+    bool critical = false;
+    if (getSensorTrend(index, &slope, &predictedValue)) {
+        double criticalTime = getCrossingTime(predictedValue, slope,
+                                              param->minCriticalValue[index], param->maxCriticalValue[index]);
+        double warnTime = -1.0;
+        // Sensors already out of their warning bounds are regulated, only their critical bounds are predicted
+        // (a value on a bound is out of it, as in computeSensorLimitMasks())
+        if (value > param->minWarnValue[index] && value < param->maxWarnValue[index])
+            warnTime = getCrossingTime(predictedValue, slope,
+                                       param->minWarnValue[index], param->maxWarnValue[index]);
+        critical = criticalTime >= 0 && criticalTime <= SENSOR_TREND_HORIZON;
+        warn = warnTime >= 0 && warnTime <= SENSOR_TREND_HORIZON;
+        sensorTrendCrossingTime[index] = warn ? warnTime : (critical ? criticalTime : 0);
+    }
+
+    bool newCritical = setTrendBit(sensorTrendCriticalMask, index, critical);
+    bool newWarn = setTrendBit(sensorTrendWarnMask, index, warn);
+    if (newCritical)
+        return infoSensorTrendCritical;
+    if (newWarn)
+        return infoSensorTrendWarn;
+    return noError;
+}
@@ -0,0 +1,78 @@
+/**
+ * \file spscRing.cpp
+ * \brief single producer single consumer ring functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Single producer single consumer ring functions, the push and pop
+ * functions are inline in spscRing.h.
+ *
+ */
+#include "spscRing.h"
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to allocate and clear the message slots of a ring,
+ * a slot is rounded up to a cache line so that two messages never
+ * share one.
+ *
+ * \param ring the ring
+ * \param messageSize the size of a message in bytes
+ * \param nbSlots the number of slots, a power of two
+ *
+ * \return statusErrDef that values:
+ * - errAllocPipelineRing when nbSlots is not a power of two
+ * or the slots can't be allocated
+ * - noError when the function exits successfully.
+ */
+statusErrDef initSPSCRing(struct spscRingStruct *ring, size_t messageSize, uint32_t nbSlots) {
+    void *slots = NULL;
+    if (nbSlots == 0 || (nbSlots & (nbSlots - 1)) != 0)
+        return errAllocPipelineRing;
+
+    size_t slotSize = (messageSize + SPSC_RING_CACHE_LINE - 1) & ~(size_t)(SPSC_RING_CACHE_LINE - 1);
+    if (posix_memalign(&slots, SPSC_RING_CACHE_LINE, slotSize * nbSlots) != 0) {
+        perror("errAllocPipelineRing");
+        return errAllocPipelineRing;
+    }
+    // Written once now, the slots are not faulted in by the first messages
+    memset(slots, 0, slotSize * nbSlots);
+    ring->slots = (uint8_t*)slots;
+    ring->slotSize = (uint32_t)slotSize;
+    ring->mask = nbSlots - 1;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tailCopy = 0;
+    ring->nbPushed = 0;
+    ring->nbStalls = 0;
+    ring->stallTime = 0;
+    ring->maxDepth = 0;
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->headCopy = 0;
+    return noError;
+}
+
+/**
+ * \brief function to free the message slots of a ring.
+ *
+ * \param ring the ring
+ */
+void freeSPSCRing(struct spscRingStruct *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+/**
+ * \brief function to print the number of messages and the
+ * backpressure counters of a ring.
+ *
+ * \param ring the ring
+ * \param name the ring name
+ */
+void printSPSCRingStats(const struct spscRingStruct *ring, const char *name) {
+    printf("%s queue: %llu messages, max depth %u/%u, %llu stalls (%llu us waiting for a free slot)\n",
+           name, (unsigned long long)ring->nbPushed, ring->maxDepth, ring->mask + 1,
+           (unsigned long long)ring->nbStalls, (unsigned long long)(ring->stallTime / 1000));
+}
@@ -0,0 +1,558 @@
+/**
+ * \file stateMachine.cpp
+ * \brief main state machine functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Main state machine of the OBDH subsystem: the state handlers, the
+ * state and transition tables and the main loop. The tables are
+ * checked by static_assert and expanded at compile time to the state x
+ * event matrix, a transition is one matrix lookup. The handlers are
+ * called through the state table (an indexed jump), the handler and
+ * transition durations of every state are kept in stateLatency.
+ *
+ */
+#include "stateMachine.h"
+#include "init.h"
+#include "controlMode.h"
+#include "safeMode.h"
+#include "regulate.h"
+#include "restart.h"
+#include "stepGraph.h"
+#include "cyclicExec.h"
+#include "rtProfile.h"
+#include "obdhPipeline.h"
+#include "loopLatency.h"
+#include "trace.h"
+
+#include <signal.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void startInitSteps();
+static void startControlMode();
+static eventDef runCyclicTasks(const struct cyclicTaskStruct *tasks, size_t nbTasks);
+static statusErrDef checkInitTC();
+static eventDef runInitState();
+static eventDef runSafeModeState();
+static eventDef runControlModeState();
+static eventDef runRegulateState();
+static void startFreeSteps();
+static eventDef runRestartState();
+static uint64_t getMonotonicTime();
+static eventDef getStateTCEvent();
+
+//------------------------------------------------------------------------------
+// State machine tables
+//------------------------------------------------------------------------------
+/**
+ * \brief states of the main state machine, the first one is the
+ * initial state and the last one the final state.
+ */
+static constexpr stateStruct mainStates[] = {
+    {init,          "init",         runInitState,           startInitSteps,     NULL,               true,   eventTCInit},
+    {safeMode,      "safe mode",    runSafeModeState,       stopOBDHPipeline,   NULL,               false,  eventTCSafeMode},
+    {controlMode,   "control mode", runControlModeState,    startControlMode,   NULL,               true,   eventTCControlMode},
+    {regulate,      "regulate",     runRegulateState,       NULL,               NULL,               false,  eventTCRegulate},
+    {restart,       "restart",      runRestartState,        startFreeSteps,     NULL,               true,   eventTCRestart},
+    {ending,        "ending",       NULL,                   NULL,               NULL,               false,  eventTCEnding},
+};
+
+/**
+ * \brief transitions of the main state machine.
+ */
+static constexpr transitionStruct mainTransitions[] = {
+    {init,          eventDone,              controlMode,    infoStateToControlMode, armRTAllocationCheck},
+    {controlMode,   eventSensorWarning,     regulate,       infoStateToRegulate,    NULL},
+    {controlMode,   eventSensorCritical,    safeMode,       infoStateToSafeMode,    NULL},
+    {regulate,      eventDone,              controlMode,    noError,                NULL},
+    {regulate,      eventSensorCritical,    safeMode,       infoStateToSafeMode,    NULL},
+    {safeMode,      eventDone,              controlMode,    noError,                NULL},
+    {restart,       eventDone,              ending,         noError,                NULL},
+    {restart,       eventStopSignal,        ending,         noError,                NULL},
+};
+
+/**
+ * \brief transitions from every state, the state telecommands are
+ * accepted in every state, the telecommanded states already send
+ * their own telemetry (the restart state is announced on entry).
+ */
+static constexpr globalTransitionStruct mainGlobalTransitions[] = {
+    {eventStopSignal,       restart,        infoStateToRestart,     NULL},
+    {eventTCInit,           init,           noError,                NULL},
+    {eventTCSafeMode,       safeMode,       noError,                NULL},
+    {eventTCControlMode,    controlMode,    noError,                NULL},
+    {eventTCRegulate,       regulate,       noError,                NULL},
+    {eventTCRestart,        restart,        infoStateToRestart,     NULL},
+    {eventTCEnding,         ending,         noError,                NULL},
+};
+
+static_assert(sizeof(mainStates) / sizeof(mainStates[0]) == NB_MAIN_STATES,
+              "NB_MAIN_STATES must be the number of states of mainStates");
+static_assert(checkStatesUnique(mainStates), "a state is declared twice in mainStates");
+static_assert(checkTransitions(mainStates, mainTransitions),
+              "a transition has an unknown state or event, or is declared twice");
+static_assert(checkGlobalTransitions(mainStates, mainGlobalTransitions),
+              "a global transition has an unknown state or event, or is declared twice");
+static_assert(checkStateTCEvents(mainStates, mainGlobalTransitions),
+              "the telecommand event of a state must be a global transition to this state");
+
+/**
+ * \brief state x event matrix of the main state machine.
+ */
+static constexpr transitionMatrixStruct<NB_MAIN_STATES> mainTransitionMatrix =
+    buildTransitionMatrix(mainStates, mainTransitions, mainGlobalTransitions,
+                          makeIndexList<NB_MAIN_STATES * nbEvents>::type());
+
+static_assert(mainStates[NB_MAIN_STATES - 1].state == ending && mainStates[NB_MAIN_STATES - 1].handler == NULL,
+              "the last state must be the final state, without handler");
+static_assert(mainTransitionMatrix.cell[findStateIndex(mainStates, controlMode) * nbEvents + eventStopSignal].next ==
+              findStateIndex(mainStates, restart), "a signal must free the subsystems before ending");
+
+/**
+ * \brief initialisation steps of the init state, run in parallel
+ * after their dependencies (see stepGraph.h). The TT&C link is
+ * initialised first, its errors cannot be sent. The OBDH parameters
+ * and CAN socket are needed to reach the other subsystems.
+ */
+#define INIT_STEP_TTC   (1u << 0)
+#define INIT_STEP_OBDH  (1u << 1)
+static constexpr retryStepStruct initSteps[] = {
+    {"TT&C",        initTTC,        infoInitTTCSuccess,         false,  0},
+    {"OBDH",        initOBDH,       infoInitOBDHSuccess,        true,   INIT_STEP_TTC},
+    {"EPS",         initEPS,        infoInitEPSSuccess,         true,   INIT_STEP_TTC | INIT_STEP_OBDH},
+    {"AOCS",        initAOCS,       infoInitAOCSSuccess,        true,   INIT_STEP_TTC | INIT_STEP_OBDH},
+    {"Payload",     initPayload,    infoInitPayloadSuccess,     true,   INIT_STEP_TTC | INIT_STEP_OBDH},
+    {"Intersat",    initIntersat,   infoInitIntersatSuccess,    true,   INIT_STEP_TTC | INIT_STEP_OBDH},
+    {"PPU",         initPPU,        infoInitPPUSuccess,         true,   INIT_STEP_TTC | INIT_STEP_OBDH},
+};
+
+/**
+ * \brief freeing steps of the restart state, the reverse of the init
+ * dependencies: the OBDH CAN socket is closed once the other subsystems
+ * are freed, the TT&C link last, without telemetry.
+ */
+#define FREE_STEPS_SUBSYSTEMS   0x1Fu
+#define FREE_STEP_OBDH          (1u << 5)
+static constexpr retryStepStruct freeSteps[] = {
+    {"PPU",         freePPU,        infoFreePPUSuccess,         true,   0},
+    {"Intersat",    freeIntersat,   infoFreeIntersatSuccess,    true,   0},
+    {"Payload",     freePayload,    infoFreePayloadSuccess,     true,   0},
+    {"AOCS",        freeAOCS,       infoFreeAOCSSuccess,        true,   0},
+    {"EPS",         freeEPS,        infoFreeEPSSuccess,         true,   0},
+    {"OBDH",        freeOBDH,       infoFreeOBDHSuccess,        true,   FREE_STEPS_SUBSYSTEMS},
+    {"TT&C",        freeTTC,        noError,                    false,  FREE_STEPS_SUBSYSTEMS | FREE_STEP_OBDH},
+};
+
+/**
+ * \brief tasks of the init state minor frames, once the TT&C link is
+ * initialised: the state telecommands and the telemetry are served
+ * while the other subsystems are initialised, the other OBDH
+ * telecommands once the OBDH initialisation has ended.
+ */
+static constexpr cyclicTaskStruct initTasks[] = {
+    {"check TC backlog",    checkInitTC,        1,                          0,                              phaseTCCheck},
+    {"loop latency report", reportLoopLatency,  MAJOR_FRAME_MINOR_FRAMES,   3 % MAJOR_FRAME_MINOR_FRAMES,   phaseLatencyReport},
+};
+
+/**
+ * \brief tasks of the control mode minor frames.
+ */
+static constexpr cyclicTaskStruct controlModeTasks[] = {
+    {"sensor check",        checkSensors,       1,                          0,                              phaseSensorCheck},
+    {"check TC backlog",    checkTC,            1,                          0,                              phaseTCCheck},
+    {"housekeeping",        runHousekeeping,    HOUSEKEEPING_FRAME_PERIOD,  1 % HOUSEKEEPING_FRAME_PERIOD,  phaseHousekeeping},
+    {"real-time check",     checkRTProfile,     MAJOR_FRAME_MINOR_FRAMES,   2 % MAJOR_FRAME_MINOR_FRAMES,   phaseRTCheck},
+    {"loop latency report", reportLoopLatency,  MAJOR_FRAME_MINOR_FRAMES,   3 % MAJOR_FRAME_MINOR_FRAMES,   phaseLatencyReport},
+};
+
+static_assert(checkCyclicTasks(initTasks), "a task period must divide MAJOR_FRAME_MINOR_FRAMES");
+static_assert(checkCyclicTasks(controlModeTasks), "a task period must divide MAJOR_FRAME_MINOR_FRAMES");
+static_assert(checkStepDependencies(initSteps), "an init step must only depend on the steps before it");
+static_assert(checkStepDependencies(freeSteps), "a free step must only depend on the steps before it");
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief handler and transition durations of every state.
+ */
+struct stateLatencyStruct stateLatency[NB_MAIN_STATES];
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief set by the signal handler, taken by the main loop.
+ */
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * \brief latest state telecommand taken by the main loop.
+ */
+static uint16_t lastStateTC = 0xFFFF;
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief init state entry: stops the OBDH pipeline, its queues are
+ * created again, and starts the OBDH and subsystem connection
+ * initialisation steps.
+ */
+static void startInitSteps() {
+    stopOBDHPipeline();
+    statusErrDef ret = startStepGraph(initSteps, sizeof(initSteps) / sizeof(initSteps[0]), "init");
+    if (ret != noError) {
+        printf("Error start init steps! 0x%04X \n", ret);
+        sendTelemToTTC(ret);
+    }
+}
+
+/**
+ * \brief control mode state entry: starts the OBDH pipeline (see
+ * obdhPipeline.h), the control mode falls back to the single-threaded
+ * acquisition when it can't be started. The pipeline keeps running in
+ * the regulate state, it is stopped on entering the safe mode, init
+ * or restart state. The real-time allocation check starts again once
+ * the stage threads are created.
+ */
+static void startControlMode() {
+#if OBDH_PIPELINE
+    statusErrDef ret = startOBDHPipeline();
+    if (ret != noError) {
+        printf("Error start OBDH pipeline! 0x%04X \n", ret);
+        sendTelemToTTC(ret);
+    }
+    // The stage threads stacks are allocated and locked here, the check starts after them
+    armRTAllocationCheck();
+#endif
+}
+
+/**
+ * \brief function to run the tasks of a state due in the current minor
+ * frame. The duration of every task is recorded in its loop phase
+ * histogram.
+ *
+ * \param tasks the task table
+ * \param nbTasks the number of tasks
+ *
+ * \return eventSensorWarning or eventSensorCritical when a sensor
+ * is out of bounds, eventNone otherwise.
+ */
+static eventDef runCyclicTasks(const struct cyclicTaskStruct *tasks, size_t nbTasks) {
+    eventDef event = eventNone;
+    for (size_t t = 0; t < nbTasks; t++) {
+        const struct cyclicTaskStruct *task = &tasks[t];
+        if (!isCyclicTaskDue(task))
+            continue;
+        uint64_t phaseStart = getLoopPhaseTime();
+        statusErrDef ret = task->function();
+        recordLoopPhase(task->phase, phaseStart, getLoopPhaseTime());
+        if (ret == errSensorWarningValue) {
+            printf("Sensor warning value! 0x%04X \n", ret);
+            if (event != eventSensorCritical)
+                event = eventSensorWarning;
+        }
+        else if (ret == errSensorCriticalValue) {
+            printf("Sensor critical value! 0x%04X \n", ret);
+            event = eventSensorCritical;
+        }
+        else if (ret != noError) {
+            printf("Error %s! 0x%04X \n", task->name, ret);
+            sendTelemToTTC(ret);
+        }
+    }
+    return event;
+}
+
+/**
+ * \brief init state telecommand task: until the OBDH initialisation has
+ * ended (retries included), initOBDH() may free the sensor tables that
+ * the OBDH telecommands read, only the state telecommands are taken.
+ *
+ * \return statusErrDef that values:
+ * - the checkStateTC() errors before the end of the OBDH initialisation,
+ * - the checkTC() errors after it.
+ */
+static statusErrDef checkInitTC() {
+    if (!isStepGraphEnded(INIT_STEP_OBDH))
+        return checkStateTC();
+    return checkTC();
+}
+
+/**
+ * \brief init state: waits for the TT&C and OBDH initialisation, the
+ * other subsystems keep retrying in the background (see pollStepGraph()).
+ * Once the TT&C link is initialised, the telecommands and the telemetry
+ * tasks run (see initTasks).
+ *
+ * \return eventDone once the TT&C and OBDH steps have ended,
+ * eventNone otherwise.
+ */
+static eventDef runInitState() {
+    if (isStepGraphEnded(INIT_STEP_TTC))
+        runCyclicTasks(initTasks, sizeof(initTasks) / sizeof(initTasks[0]));
+    return isStepGraphEnded(INIT_STEP_TTC | INIT_STEP_OBDH) ? eventDone : eventNone;
+}
+
+/**
+ * \brief safe mode state: payload shutdown and every subsystem
+ * to safe mode.
+ *
+ * \return eventDone.
+ */
+static eventDef runSafeModeState() {
+    uint64_t phaseStart = getLoopPhaseTime();
+    // send stop order to the payload subsystem
+    statusErrDef ret = sendTCToSubsystem({0x17,0xFF}, payloadSubsystem);
+    if (ret == noError) {
+        printf("Send stop to payload OK\n");
+        sendTelemToTTC(infoSendStopPayloadSuccess);
+    }
+    else {
+        printf("Error send stop to payload! Ox%04X \n", ret);
+        sendTelemToTTC(ret);
+    }
+
+    ret = broadcastSafeMode();
+    if (ret == noError) {
+        printf("Send safe mode to all subsystems OK\n");
+        sendTelemToTTC(infoBroadcastSafeModeSuccess);
+    }
+    else {
+        printf("Error send safe mode to all subsystems! 0x%04X \n", ret);
+        sendTelemToTTC(ret);
+    }
+    recordLoopPhase(phaseSafeMode, phaseStart, getLoopPhaseTime());
+    return eventDone;
+}
+
+/**
+ * \brief control mode state: runs the tasks of the minor frame, sensor
+ * acquisition, telemetry to and telecommands from the TT&C subsystem.
+ *
+ * \return eventSensorWarning or eventSensorCritical when a sensor
+ * is out of bounds, eventNone otherwise.
+ */
+static eventDef runControlModeState() {
+    return runCyclicTasks(controlModeTasks, sizeof(controlModeTasks) / sizeof(controlModeTasks[0]));
+}
+
+/**
+ * \brief regulate state: regulation of the subsystems with a sensor
+ * out of its warning bounds.
+ *
+ * \return eventSensorCritical when a sensor is out of its critical
+ * bounds, eventDone otherwise.
+ */
+static eventDef runRegulateState() {
+    uint64_t phaseStart = getLoopPhaseTime();
+    statusErrDef ret = regulateSubsystems();
+    recordLoopPhase(phaseRegulate, phaseStart, getLoopPhaseTime());
+    if (ret == noError)
+        printf("Subsystems regulated.\n");
+    else if (ret == errSensorCriticalValue) {
+        printf("Sensor critical value! 0x%04X \n", ret);
+        return eventSensorCritical;
+    }
+    else {
+        printf("Error regulating subsystems! 0x%04X \n", ret);
+        sendTelemToTTC(ret);
+    }
+    return eventDone;
+}
+
+/**
+ * \brief restart state entry: stops the OBDH pipeline and the
+ * initialisation retries and starts freeing every subsystem. When
+ * the step graph can't run (and the steps are not run by the main
+ * loop either), every subsystem is freed here, once, in the table
+ * order.
+ */
+static void startFreeSteps() {
+    stopOBDHPipeline();
+    statusErrDef ret = startStepGraph(freeSteps, sizeof(freeSteps) / sizeof(freeSteps[0]), "free");
+    if (ret == noError)
+        return;
+    printf("Error start free steps! 0x%04X \n", ret);
+    if (!isStepGraphEnded(0xFFFFFFFFu))
+        return;
+    for (size_t i = 0; i < sizeof(freeSteps) / sizeof(freeSteps[0]); i++)
+        reportRetryStep(&freeSteps[i], "free", freeSteps[i].function());
+}
+
+/**
+ * \brief restart state: waits for every subsystem to be freed, systemd
+ * restarts the program when it ends.
+ *
+ * \return eventDone once every free step has ended, eventNone otherwise.
+ */
+static eventDef runRestartState() {
+    if (!isStepGraphEnded(0xFFFFFFFFu))
+        return eventNone;
+    printStateLatency();
+    printCyclicExecStats();
+    printLoopLatency();
+    return eventDone;
+}
+
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getMonotonicTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to convert a new state telecommand (see
+ * recieveTCFromTTC()) to the telecommand event of the state.
+ *
+ * \return the telecommand event, eventNone when there is
+ * no new state telecommand.
+ */
+static eventDef getStateTCEvent() {
+    uint16_t stateTC = mainStateTC;
+    if (stateTC == 0xFFFF || stateTC == lastStateTC)
+        return eventNone;
+    for (int s = 0; s < NB_MAIN_STATES; s++) {
+        if (mainStates[s].state == stateTC) {
+            lastStateTC = stateTC;
+            return mainStates[s].stateTCEvent;
+        }
+    }
+    return eventNone;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to log the result of one try of an initialisation
+ * or freeing step and to send its telemetry.
+ *
+ * \param step the step
+ * \param operation "init" or "free", for the logs
+ * \param status the status returned by the step function
+ */
+void reportRetryStep(const struct retryStepStruct *step, const char *operation, statusErrDef status) {
+    if (status == noError) {
+        printf("%s %s OK\n", operation, step->name);
+        if (step->successTelemetry != noError)
+            sendTelemToTTC(step->successTelemetry);
+    }
+    else {
+        printf("Error %s %s! 0x%04X \n", operation, step->name, status);
+        if (step->sendErrorTelemetry)
+            sendTelemToTTC(status);
+    }
+}
+
+/**
+ * \brief function to stop the program gracefully (freeing every
+ * subsystem), safe to call from a signal handler.
+ */
+void requestStateMachineStop() {
+    stopRequested = 1;
+}
+
+/**
+ * \brief function to print the handler and transition durations
+ * of every state.
+ */
+void printStateLatency() {
+    for (int s = 0; s < NB_MAIN_STATES; s++) {
+        const struct stateLatencyStruct *latency = &stateLatency[s];
+        if (latency->nbRuns == 0)
+            continue;
+        printf("state %s: %llu runs, handler mean %llu us max %llu us, "
+               "%llu transitions, transition mean %llu us max %llu us\n",
+               mainStates[s].name, (unsigned long long)latency->nbRuns,
+               (unsigned long long)(latency->handlerTotal / latency->nbRuns / 1000),
+               (unsigned long long)(latency->handlerMax / 1000),
+               (unsigned long long)latency->nbTransitions,
+               (unsigned long long)(latency->nbTransitions ? latency->transitionTotal / latency->nbTransitions / 1000 : 0),
+               (unsigned long long)(latency->transitionMax / 1000));
+    }
+}
+
+/**
+ * \brief function to run the main state machine from the initial
+ * state until the final state. A signal, then a new state telecommand,
+ * replace the event returned by the state handler. The initialisation
+ * or freeing steps are polled at each loop, in every state.
+ *
+ * \return 0 when the final state is reached.
+ */
+int runStateMachine() {
+    int current = 0;
+    memset(stateLatency, 0, sizeof(stateLatency));
+    resetLoopLatency();
+    initCyclicExec();
+    if (mainStates[current].entry != NULL)
+        mainStates[current].entry();
+
+    while (mainStates[current].handler != NULL) {
+        struct stateLatencyStruct *latency = &stateLatency[current];
+        pollStepGraph();
+        uint64_t handlerStart = getMonotonicTime();
+        eventDef event = mainStates[current].handler();
+        uint64_t handlerEnd = getMonotonicTime();
+        latency->nbRuns++;
+        latency->handlerTotal += handlerEnd - handlerStart;
+        if (handlerEnd - handlerStart > latency->handlerMax)
+            latency->handlerMax = handlerEnd - handlerStart;
+
+        if (stopRequested) {
+            stopRequested = 0;
+            event = eventStopSignal;
+        }
+        else {
+            eventDef stateTCEvent = getStateTCEvent();
+            if (stateTCEvent != eventNone)
+                event = stateTCEvent;
+        }
+
+        const struct transitionCellStruct *cell = &mainTransitionMatrix.cell[current * nbEvents + event];
+        if (cell->next != current || cell->telemetry != noError || cell->action != NULL) {
+            uint64_t phaseStart = getLoopPhaseTime();
+            if (cell->next != current && mainStates[current].exit != NULL)
+                mainStates[current].exit();
+            if (cell->next != current) {
+                printf("State has been changed to %s\n", mainStates[cell->next].name);
+                traceEvent(traceStateChange, (uint32_t)mainStates[current].state << 16 | mainStates[cell->next].state);
+            }
+            if (cell->telemetry != noError)
+                sendTelemToTTC(cell->telemetry);
+            if (cell->action != NULL)
+                cell->action();
+            if (cell->next != current && mainStates[cell->next].entry != NULL)
+                mainStates[cell->next].entry();
+            recordLoopPhase(phaseTransition, phaseStart, getLoopPhaseTime());
+            uint64_t transitionEnd = getMonotonicTime();
+            latency->nbTransitions++;
+            latency->transitionTotal += transitionEnd - handlerEnd;
+            if (transitionEnd - handlerEnd > latency->transitionMax)
+                latency->transitionMax = transitionEnd - handlerEnd;
+        }
+
+        if (mainStates[current].periodic) {
+            statusErrDef ret = waitNextMinorFrame();
+            if (ret != noError) {
+                printf("Minor frame overrun! 0x%04X \n", ret);
+                sendTelemToTTC(ret);
+            }
+        }
+        current = cell->next;
+    }
+    stopOBDHPipeline();
+    stopStepGraph();
+    return 0;
+}
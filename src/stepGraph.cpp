@@ -0,0 +1,346 @@
+/**
+ * \file stepGraph.cpp
+ * \brief initialisation and freeing step graph functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Step graph functions. A step becomes ready when the steps it depends
+ * on have ended, the worker threads take the first ready step and try
+ * it once. The workers queue the result of each try, the main loop logs
+ * them and sends the telemetry (the telemetry socket is only used by one
+ * thread), and arms the retry timer of a failed step: the step becomes
+ * ready again when its timer expires. A step ends when it succeeds or
+ * when it has used its NB_RETRIES tries; the steps that depend on it run
+ * anyway, as when the steps ran in order. Nothing in the main loop
+ * sleeps: while a subsystem waits for its retry, the telecommands and
+ * the telemetry are served.
+ *
+ */
+#include "stepGraph.h"
+#include "timerWheel.h"
+#include "rtProfile.h"
+
+#include <pthread.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Local structure definitions
+//------------------------------------------------------------------------------
+/**
+ * \struct stepReportStruct
+ * \brief result of one try of a step, queued for the main loop
+ *
+ */
+struct stepReportStruct {
+    int step;                               /**< Step index in the table */
+    statusErrDef status;                    /**< Status returned by the step function */
+};
+
+/**
+ * \struct stepGraphStruct
+ * \brief state of the running step table
+ *
+ */
+struct stepGraphStruct {
+    const struct retryStepStruct *steps;    /**< Step table */
+    int nbSteps;                            /**< Number of steps */
+    const char *operation;                  /**< "init" or "free", for the logs */
+    uint32_t allSteps;                      /**< One bit per step */
+    uint64_t beginTime;                     /**< Start of the run in milliseconds */
+    int failures[32];                       /**< Number of failed tries of every step (main loop only) */
+    struct timerWheelStruct retryWheel;     /**< Retry timer of every step in milliseconds (main loop only) */
+    // Shared with the workers, stepGraphLock held
+    uint32_t started;                       /**< Steps whose dependencies have ended */
+    uint32_t ready;                         /**< Steps waiting for a worker */
+    uint32_t ended;                         /**< Steps that succeeded or used all their tries */
+    struct stepReportStruct reports[32 * NB_RETRIES];   /**< Results of the tries in completion order */
+    int nbReports;                          /**< Number of queued results */
+    bool stop;                              /**< Set to end the workers */
+};
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+static struct stepGraphStruct stepGraph;
+static pthread_mutex_t stepGraphLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stepGraphWork = PTHREAD_COND_INITIALIZER;
+static pthread_t stepGraphWorkers[STEP_GRAPH_THREADS];
+static int nbStepGraphWorkers = 0;
+static bool stepGraphActive = false;
+static uint32_t retryJitterState = 1;
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static uint64_t getStepGraphTime();
+static uint64_t getRetryDelay(int failures);
+static void releaseReadySteps();
+static void tryStep(int i);
+static void *stepGraphWorker(void *arg);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in milliseconds.
+ */
+static uint64_t getStepGraphTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * \brief delay before the next try of a failed step: ERROR_RETRY_TIME
+ * doubled after each failure up to RETRY_BACKOFF_MAX_SHIFT times, plus
+ * or minus RETRY_JITTER_PERCENT so that the subsystems failing together
+ * don't retry together.
+ *
+ * \param failures the number of failed tries of the step (1 or above)
+ *
+ * \return the delay in milliseconds.
+ */
+static uint64_t getRetryDelay(int failures) {
+    int shift = (failures - 1 < RETRY_BACKOFF_MAX_SHIFT) ? failures - 1 : RETRY_BACKOFF_MAX_SHIFT;
+    uint64_t delay = ((uint64_t)ERROR_RETRY_TIME * 1000) << shift;
+    uint64_t jitter = delay * RETRY_JITTER_PERCENT / 100;
+
+    // xorshift32, the jitter only has to differ between the steps
+    retryJitterState ^= retryJitterState << 13;
+    retryJitterState ^= retryJitterState >> 17;
+    retryJitterState ^= retryJitterState << 5;
+    return delay - jitter + retryJitterState % (2 * jitter + 1);
+}
+
+/**
+ * \brief function to make ready the steps not started whose
+ * dependencies have ended, stepGraphLock held.
+ */
+static void releaseReadySteps() {
+    uint32_t released = 0;
+    for (int i = 0; i < stepGraph.nbSteps; i++) {
+        uint32_t bit = (uint32_t)1 << i;
+        if ((stepGraph.started & bit) == 0 && (stepGraph.steps[i].dependencies & ~stepGraph.ended) == 0)
+            released |= bit;
+    }
+    if (released != 0) {
+        stepGraph.started |= released;
+        stepGraph.ready |= released;
+        pthread_cond_broadcast(&stepGraphWork);
+    }
+}
+
+/**
+ * \brief function to try a step once and to queue the result,
+ * stepGraphLock not held.
+ *
+ * \param i the step index
+ */
+static void tryStep(int i) {
+    statusErrDef ret = stepGraph.steps[i].function();
+
+    pthread_mutex_lock(&stepGraphLock);
+    stepGraph.reports[stepGraph.nbReports].step = i;
+    stepGraph.reports[stepGraph.nbReports].status = ret;
+    stepGraph.nbReports++;
+    if (ret == noError) {
+        stepGraph.ended |= (uint32_t)1 << i;
+        releaseReadySteps();
+    }
+    pthread_mutex_unlock(&stepGraphLock);
+}
+
+/**
+ * \brief worker thread, tries the ready steps until the graph is stopped.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *stepGraphWorker(void *arg) {
+    (void)arg;
+    setRTThreadProfile(rtIOThread);
+    pthread_mutex_lock(&stepGraphLock);
+    while (!stepGraph.stop) {
+        if (stepGraph.ready == 0) {
+            pthread_cond_wait(&stepGraphWork, &stepGraphLock);
+            continue;
+        }
+        int i = __builtin_ctz(stepGraph.ready);
+        stepGraph.ready &= ~((uint32_t)1 << i);
+        pthread_mutex_unlock(&stepGraphLock);
+        tryStep(i);
+        pthread_mutex_lock(&stepGraphLock);
+    }
+    pthread_mutex_unlock(&stepGraphLock);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to start the initialisation or freeing steps of a
+ * table, the step graph still running is stopped first. The steps run
+ * on the main loop (see pollStepGraph()) when the threads can't be
+ * started.
+ *
+ * \param steps the steps, each one only depends on the ones before it
+ * \param nbSteps the number of steps (32 at most)
+ * \param operation "init" or "free", for the logs
+ *
+ * \return statusErrDef that values:
+ * - errAllocTimerWheel when the retry timers can't be allocated,
+ * - errStartStepGraph when no thread can be started (the steps run on
+ * the main loop), or when the dependencies are invalid (no step runs),
+ * - noError when the function exits successfully.
+ */
+statusErrDef startStepGraph(const struct retryStepStruct *steps, int nbSteps, const char *operation) {
+    stopStepGraph();
+    if (nbSteps <= 0)
+        return noError;
+    for (int i = 0; i < nbSteps; i++) {
+        if (nbSteps > 32 || (steps[i].dependencies >> i) != 0)
+            return errStartStepGraph;
+    }
+
+    uint64_t now = getStepGraphTime();
+    stepGraph.steps = steps;
+    stepGraph.nbSteps = nbSteps;
+    stepGraph.operation = operation;
+    stepGraph.allSteps = (nbSteps == 32) ? 0xFFFFFFFFu : (((uint32_t)1 << nbSteps) - 1);
+    stepGraph.beginTime = now;
+    memset(stepGraph.failures, 0, sizeof(stepGraph.failures));
+    statusErrDef ret = initTimerWheel(&stepGraph.retryWheel, nbSteps, now);
+    if (ret != noError)
+        return ret;
+    retryJitterState = (uint32_t)now | 1;
+
+    pthread_mutex_lock(&stepGraphLock);
+    stepGraph.started = 0;
+    stepGraph.ready = 0;
+    stepGraph.ended = 0;
+    stepGraph.nbReports = 0;
+    stepGraph.stop = false;
+    releaseReadySteps();
+    pthread_mutex_unlock(&stepGraphLock);
+    stepGraphActive = true;
+
+    for (nbStepGraphWorkers = 0; nbStepGraphWorkers < STEP_GRAPH_THREADS && nbStepGraphWorkers < nbSteps;
+         nbStepGraphWorkers++) {
+        if (pthread_create(&stepGraphWorkers[nbStepGraphWorkers], NULL, stepGraphWorker, NULL) != 0) {
+            perror("errStartStepGraph");
+            return (nbStepGraphWorkers == 0) ? errStartStepGraph : noError;
+        }
+    }
+    return noError;
+}
+
+/**
+ * \brief function called at each main loop: reports the tries that
+ * ended since the last call (see reportRetryStep()), schedules the
+ * retries of the failed steps and makes ready the steps whose retry
+ * timer has expired. The graph is stopped once every step has ended.
+ */
+void pollStepGraph() {
+    if (!stepGraphActive)
+        return;
+
+    // Without worker, the ready steps are tried here
+    if (nbStepGraphWorkers == 0) {
+        pthread_mutex_lock(&stepGraphLock);
+        uint32_t ready = stepGraph.ready;
+        stepGraph.ready = 0;
+        pthread_mutex_unlock(&stepGraphLock);
+        for (int i = 0; i < stepGraph.nbSteps; i++) {
+            if (ready & ((uint32_t)1 << i))
+                tryStep(i);
+        }
+    }
+
+    struct stepReportStruct reports[32 * NB_RETRIES];
+    pthread_mutex_lock(&stepGraphLock);
+    int nbReports = stepGraph.nbReports;
+    memcpy(reports, stepGraph.reports, nbReports * sizeof(struct stepReportStruct));
+    stepGraph.nbReports = 0;
+    pthread_mutex_unlock(&stepGraphLock);
+
+    uint64_t now = getStepGraphTime();
+    for (int r = 0; r < nbReports; r++) {
+        int i = reports[r].step;
+        const struct retryStepStruct *step = &stepGraph.steps[i];
+        reportRetryStep(step, stepGraph.operation, reports[r].status);
+        if (reports[r].status == noError)
+            continue;
+        stepGraph.failures[i]++;
+        if (stepGraph.failures[i] < NB_RETRIES) {
+            armTimer(&stepGraph.retryWheel, i, now + getRetryDelay(stepGraph.failures[i]));
+        }
+        else {
+            printf("%s %s: no retry left\n", stepGraph.operation, step->name);
+            pthread_mutex_lock(&stepGraphLock);
+            stepGraph.ended |= (uint32_t)1 << i;
+            releaseReadySteps();
+            pthread_mutex_unlock(&stepGraphLock);
+        }
+    }
+
+    uint16_t expired[32];
+    int nbExpired = advanceTimerWheel(&stepGraph.retryWheel, now, expired, 32);
+    pthread_mutex_lock(&stepGraphLock);
+    for (int e = 0; e < nbExpired; e++)
+        stepGraph.ready |= (uint32_t)1 << expired[e];
+    if (nbExpired > 0)
+        pthread_cond_broadcast(&stepGraphWork);
+    bool done = (stepGraph.ended == stepGraph.allSteps && stepGraph.nbReports == 0);
+    pthread_mutex_unlock(&stepGraphLock);
+
+    if (done) {
+        printf("%s: %d steps in %llu ms\n", stepGraph.operation, stepGraph.nbSteps,
+               (unsigned long long)(getStepGraphTime() - stepGraph.beginTime));
+        stopStepGraph();
+    }
+}
+
+/**
+ * \brief function to know if steps of the running table have ended.
+ *
+ * \param steps the step mask (bit i for the step i)
+ *
+ * \return true when every step of the mask has succeeded or used
+ * all its tries, or when no step graph is running.
+ */
+bool isStepGraphEnded(uint32_t steps) {
+    if (!stepGraphActive)
+        return true;
+    pthread_mutex_lock(&stepGraphLock);
+    bool ended = ((stepGraph.ended & steps & stepGraph.allSteps) == (steps & stepGraph.allSteps));
+    pthread_mutex_unlock(&stepGraphLock);
+    return ended;
+}
+
+/**
+ * \brief function to stop the running step graph: the workers end their
+ * current try and the pending retries are dropped. Does nothing when no
+ * step graph is running.
+ */
+void stopStepGraph() {
+    if (!stepGraphActive)
+        return;
+    pthread_mutex_lock(&stepGraphLock);
+    stepGraph.stop = true;
+    pthread_cond_broadcast(&stepGraphWork);
+    pthread_mutex_unlock(&stepGraphLock);
+    for (int i = 0; i < nbStepGraphWorkers; i++)
+        pthread_join(stepGraphWorkers[i], NULL);
+    nbStepGraphWorkers = 0;
+
+    for (int r = 0; r < stepGraph.nbReports; r++)
+        reportRetryStep(&stepGraph.steps[stepGraph.reports[r].step], stepGraph.operation, stepGraph.reports[r].status);
+    stepGraph.nbReports = 0;
+    freeTimerWheel(&stepGraph.retryWheel);
+    stepGraphActive = false;
+}
@@ -0,0 +1,241 @@
+/**
+ * \file timerWheel.cpp
+ * \brief hierarchical timer wheel functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Hierarchical timer wheel functions, a timer expiring in less than
+ * 2^(6 * (L + 1)) ticks is stored in the level L, in the slot given by
+ * the bits 6L to 6L + 5 of its expiry tick. When the level L - 1
+ * wraps around, the next slot of the level L is cascaded: its timers
+ * are stored again, in the lower levels. The empty slots of the level
+ * 0 are skipped with its occupancy bitmap, so advancing the wheel over
+ * many idle ticks is cheap.
+ *
+ */
+#include "timerWheel.h"
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void linkTimer(struct timerWheelStruct *wheel, int timer);
+static void unlinkTimer(struct timerWheelStruct *wheel, int timer);
+static void cascadeTimerSlot(struct timerWheelStruct *wheel, int level);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to store a timer in the slot of its expiry tick.
+ *
+ * \param wheel the timer wheel
+ * \param timer the timer index, its expiry tick set
+ */
+static void linkTimer(struct timerWheelStruct *wheel, int timer) {
+    uint64_t expiry = wheel->expiry[timer];
+    uint64_t delta = expiry - wheel->currentTick;
+    int level = 0;
+
+    if ((int64_t)delta < 0) {
+        // Already expired, collected at the next tick
+        expiry = wheel->currentTick;
+    } else {
+        while (level < TIMER_WHEEL_LEVELS - 1 &&
+               delta >= ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * (level + 1))))
+            level++;
+        // Beyond the wheel range, kept in the farthest slot until cascaded
+        uint64_t range = (uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS);
+        if (delta >= range)
+            expiry = wheel->currentTick + range - 1;
+    }
+
+    int index = (int)((expiry >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+    int slot = level * TIMER_WHEEL_SLOTS + index;
+    uint16_t head = wheel->head[slot];
+    wheel->next[timer] = head;
+    wheel->prev[timer] = TIMER_WHEEL_NONE;
+    if (head != TIMER_WHEEL_NONE)
+        wheel->prev[head] = (uint16_t)timer;
+    wheel->head[slot] = (uint16_t)timer;
+    wheel->slot[timer] = (uint16_t)slot;
+    wheel->occupied[level] |= (uint64_t)1 << index;
+}
+
+/**
+ * \brief function to remove an armed timer from its slot.
+ *
+ * \param wheel the timer wheel
+ * \param timer the timer index
+ */
+static void unlinkTimer(struct timerWheelStruct *wheel, int timer) {
+    int slot = wheel->slot[timer];
+    uint16_t next = wheel->next[timer];
+    uint16_t prev = wheel->prev[timer];
+    if (prev != TIMER_WHEEL_NONE)
+        wheel->next[prev] = next;
+    else
+        wheel->head[slot] = next;
+    if (next != TIMER_WHEEL_NONE)
+        wheel->prev[next] = prev;
+    if (wheel->head[slot] == TIMER_WHEEL_NONE)
+        wheel->occupied[slot / TIMER_WHEEL_SLOTS] &= ~((uint64_t)1 << (slot % TIMER_WHEEL_SLOTS));
+    wheel->slot[timer] = TIMER_WHEEL_NONE;
+}
+
+/**
+ * \brief function to move the timers of the current slot of a level
+ * to the lower levels, called when the level below wraps around.
+ *
+ * \param wheel the timer wheel
+ * \param level the level to cascade (1 or above)
+ */
+static void cascadeTimerSlot(struct timerWheelStruct *wheel, int level) {
+    int index = (int)((wheel->currentTick >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+    int slot = level * TIMER_WHEEL_SLOTS + index;
+    uint16_t timer = wheel->head[slot];
+    wheel->head[slot] = TIMER_WHEEL_NONE;
+    wheel->occupied[level] &= ~((uint64_t)1 << index);
+    while (timer != TIMER_WHEEL_NONE) {
+        uint16_t next = wheel->next[timer];
+        linkTimer(wheel, timer);
+        timer = next;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to allocate a timer wheel, every timer is disarmed.
+ *
+ * \param wheel the timer wheel
+ * \param nbTimers the number of timers (less than TIMER_WHEEL_NONE)
+ * \param tick the current tick
+ *
+ * \return statusErrDef that values:
+ * - errAllocTimerWheel when the timers cannot be allocated
+ * - noError when the function exits successfully.
+ */
+statusErrDef initTimerWheel(struct timerWheelStruct *wheel, int nbTimers, uint64_t tick) {
+    memset(wheel, 0, sizeof(struct timerWheelStruct));
+    memset(wheel->head, 0xFF, sizeof(wheel->head));
+    wheel->currentTick = tick;
+    if (nbTimers <= 0)
+        return noError;
+    if (nbTimers >= TIMER_WHEEL_NONE)
+        return errAllocTimerWheel;
+
+    wheel->expiry = (uint64_t*)calloc(nbTimers, sizeof(uint64_t));
+    wheel->next = (uint16_t*)malloc(nbTimers * sizeof(uint16_t));
+    wheel->prev = (uint16_t*)malloc(nbTimers * sizeof(uint16_t));
+    wheel->slot = (uint16_t*)malloc(nbTimers * sizeof(uint16_t));
+    if (wheel->expiry == NULL || wheel->next == NULL || wheel->prev == NULL || wheel->slot == NULL) {
+        perror("errAllocTimerWheel");
+        freeTimerWheel(wheel);
+        return errAllocTimerWheel;
+    }
+    memset(wheel->slot, 0xFF, nbTimers * sizeof(uint16_t));
+    wheel->nbTimers = nbTimers;
+    return noError;
+}
+
+/**
+ * \brief function to free the timers of a timer wheel.
+ *
+ * \param wheel the timer wheel
+ */
+void freeTimerWheel(struct timerWheelStruct *wheel) {
+    free(wheel->expiry);
+    free(wheel->next);
+    free(wheel->prev);
+    free(wheel->slot);
+    wheel->expiry = NULL;
+    wheel->next = NULL;
+    wheel->prev = NULL;
+    wheel->slot = NULL;
+    wheel->nbTimers = 0;
+}
+
+/**
+ * \brief function to arm a timer, or to move its expiry
+ * when it is already armed.
+ *
+ * \param wheel the timer wheel
+ * \param timer the timer index
+ * \param expiry the tick at which the timer expires
+ */
+void armTimer(struct timerWheelStruct *wheel, int timer, uint64_t expiry) {
+    if (wheel->slot[timer] != TIMER_WHEEL_NONE)
+        unlinkTimer(wheel, timer);
+    wheel->expiry[timer] = expiry;
+    linkTimer(wheel, timer);
+}
+
+/**
+ * \brief function to disarm a timer.
+ *
+ * \param wheel the timer wheel
+ * \param timer the timer index
+ */
+void cancelTimer(struct timerWheelStruct *wheel, int timer) {
+    if (wheel->slot[timer] != TIMER_WHEEL_NONE)
+        unlinkTimer(wheel, timer);
+}
+
+/**
+ * \brief function to process every tick up to tick included and to
+ * collect the timers that expire, they are disarmed.
+ *
+ * \param wheel the timer wheel
+ * \param tick the current tick
+ * \param expired the array filled with the expired timers
+ * \param maxExpired the size of the expired array, the timers that
+ * don't fit stay armed and are collected at the next call
+ *
+ * \return the number of expired timers.
+ */
+int advanceTimerWheel(struct timerWheelStruct *wheel, uint64_t tick, uint16_t *expired, int maxExpired) {
+    int nbExpired = 0;
+    while (wheel->currentTick <= tick) {
+        int index = (int)(wheel->currentTick & (TIMER_WHEEL_SLOTS - 1));
+        if (index == 0) {
+            // Each level wrapping around cascades the next slot of the level above
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                cascadeTimerSlot(wheel, level);
+                if (((wheel->currentTick >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)) != 0)
+                    break;
+            }
+        }
+
+        // Jump to the next non empty slot of the level 0, or to the next wrap
+        uint64_t pending = wheel->occupied[0] >> index;
+        if (pending == 0) {
+            uint64_t nextWrap = (wheel->currentTick | (TIMER_WHEEL_SLOTS - 1)) + 1;
+            wheel->currentTick = (nextWrap <= tick) ? nextWrap : tick + 1;
+            continue;
+        }
+        int skip = __builtin_ctzll(pending);
+        if (wheel->currentTick + skip > tick) {
+            wheel->currentTick = tick + 1;
+            break;
+        }
+        wheel->currentTick += skip;
+        index += skip;
+
+        int slot = index;
+        while (wheel->head[slot] != TIMER_WHEEL_NONE) {
+            uint16_t timer = wheel->head[slot];
+            if (nbExpired == maxExpired)
+                return nbExpired;
+            unlinkTimer(wheel, timer);
+            // A timer beyond the wheel range goes around again
+            if (wheel->expiry[timer] > wheel->currentTick)
+                linkTimer(wheel, timer);
+            else
+                expired[nbExpired++] = timer;
+        }
+        wheel->currentTick++;
+    }
+    return nbExpired;
+}
@@ -0,0 +1,269 @@
+/**
+ * \file trace.cpp
+ * \brief trace ring functions
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Trace ring functions. The rings are a static pool prefaulted at init,
+ * a thread key gives the ring back when its thread ends (the events stay
+ * until the next owner overwrites them). The dump only uses open(),
+ * write() and close(), so the crash handler can write it.
+ *
+ */
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+//------------------------------------------------------------------------------
+// Global vars initialisation
+//------------------------------------------------------------------------------
+/**
+ * \brief trace ring pool.
+ */
+struct traceRingStruct traceRings[TRACE_MAX_THREADS];
+
+/**
+ * \brief ring of the calling thread, NULL before its first event.
+ */
+__thread struct traceRingStruct *traceThreadRing = NULL;
+
+/**
+ * \brief event names for the logs and the trace export, indexed by traceEventDef.
+ */
+const char *const traceEventNames[NB_TRACE_EVENTS] = {
+    "unknown",
+    "thread start",
+    "state change",
+    "CAN frame",
+    "TC received",
+    "telemetry sent",
+    "phase begin",
+    "phase end",
+};
+
+//------------------------------------------------------------------------------
+// Local vars
+//------------------------------------------------------------------------------
+/**
+ * \brief true in a thread that found every ring taken, it doesn't look again.
+ */
+static __thread bool traceNoRing = false;
+static pthread_key_t traceRingKey;
+static bool traceRingKeyCreated = false;
+static char traceDumpPath[MAX_PATH_LENGHT];
+static char traceCrashPath[MAX_PATH_LENGHT];
+
+/**
+ * \brief stack of the crash handler in the initialising (control)
+ * thread, to dump after a stack overflow.
+ */
+static char traceCrashStack[64 * 1024];
+
+/**
+ * \brief signals that write the crash dump.
+ */
+static const int traceCrashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+//------------------------------------------------------------------------------
+// Local function definitions
+//------------------------------------------------------------------------------
+static void releaseTraceRing(void *ring);
+static bool writeTraceData(int fd, const void *data, size_t size);
+static bool writeTraceDump(const char *filePath);
+static void handleTraceCrash(int sig);
+
+//------------------------------------------------------------------------------
+// Local functions
+//------------------------------------------------------------------------------
+/**
+ * \brief thread key destructor, gives the ring of an ending thread back.
+ *
+ * \param ring the ring of the thread
+ */
+static void releaseTraceRing(void *ring) {
+    ((struct traceRingStruct*)ring)->inUse.store(false, std::memory_order_release);
+}
+
+/**
+ * \brief function to write a whole buffer to a file, async-signal-safe.
+ *
+ * \param fd the file
+ * \param data the buffer
+ * \param size the number of bytes
+ *
+ * \return false when the file can't be written.
+ */
+static bool writeTraceData(int fd, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t*)data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * \brief function to write every ring to a dump file (see trace.h),
+ * async-signal-safe. The rings keep being written during the dump.
+ *
+ * \param filePath the dump file
+ *
+ * \return false when the file can't be written.
+ */
+static bool writeTraceDump(const char *filePath) {
+    int fd = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    struct traceDumpHeaderStruct header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic));
+    header.version = TRACE_DUMP_VERSION;
+    header.nbRings = TRACE_MAX_THREADS;
+    header.eventsPerRing = TRACE_RING_EVENTS;
+    header.dumpTime = getTraceTime();
+    bool ok = writeTraceData(fd, &header, sizeof(header));
+
+    for (uint32_t r = 0; ok && r < TRACE_MAX_THREADS; r++) {
+        struct traceRingStruct *ring = &traceRings[r];
+        struct traceDumpRingStruct ringHeader;
+        memset(&ringHeader, 0, sizeof(ringHeader));
+        ringHeader.ring = r;
+        ringHeader.tid = ring->tid;
+        memcpy(ringHeader.name, ring->name, sizeof(ringHeader.name));
+        ringHeader.head = ring->head.load(std::memory_order_acquire);
+        ringHeader.first = ringHeader.head > TRACE_RING_EVENTS ? ringHeader.head - TRACE_RING_EVENTS : 0;
+        ok = writeTraceData(fd, &ringHeader, sizeof(ringHeader));
+
+        // Oldest events first, in two parts when the ring has wrapped
+        uint64_t firstSlot = ringHeader.first & (TRACE_RING_EVENTS - 1);
+        uint64_t nbEvents = ringHeader.head - ringHeader.first;
+        uint64_t nbFirstPart = nbEvents < TRACE_RING_EVENTS - firstSlot ? nbEvents : TRACE_RING_EVENTS - firstSlot;
+        if (ok)
+            ok = writeTraceData(fd, &ring->events[firstSlot], nbFirstPart * sizeof(struct traceEventStruct));
+        if (ok)
+            ok = writeTraceData(fd, &ring->events[0], (nbEvents - nbFirstPart) * sizeof(struct traceEventStruct));
+        uint64_t headAfter = ring->head.load(std::memory_order_acquire);
+        if (ok)
+            ok = writeTraceData(fd, &headAfter, sizeof(headAfter));
+    }
+    if (close(fd) != 0)
+        ok = false;
+    return ok;
+}
+
+/**
+ * \brief crash signal handler: writes the crash dump then lets the
+ * default action of the signal end the program.
+ *
+ * \param sig the signal
+ */
+static void handleTraceCrash(int sig) {
+    static const char message[] = "Crash, trace rings written to " TRACE_CRASH_FILENAME "\n";
+    if (writeTraceDump(traceCrashPath))
+        writeTraceData(STDERR_FILENO, message, sizeof(message) - 1);
+    raise(sig);
+}
+
+//------------------------------------------------------------------------------
+// Functions
+//------------------------------------------------------------------------------
+/**
+ * \brief function to prefault the trace rings and to install the crash
+ * dump, called before the first thread.
+ *
+ * \return statusErrDef that values:
+ * - errDumpTrace when the crash dump or the ring release can't be installed,
+ * - noError when the function exits successfully.
+ */
+statusErrDef initTrace() {
+    statusErrDef ret = noError;
+    memset((void*)traceRings, 0, sizeof(traceRings));
+    snprintf(traceDumpPath, sizeof(traceDumpPath), "%s%s", OUTPUT_FILES_DIR, TRACE_DUMP_FILENAME);
+    snprintf(traceCrashPath, sizeof(traceCrashPath), "%s%s", OUTPUT_FILES_DIR, TRACE_CRASH_FILENAME);
+
+    if (!traceRingKeyCreated) {
+        if (pthread_key_create(&traceRingKey, releaseTraceRing) != 0) {
+            perror("errDumpTrace key");
+            ret = errDumpTrace;
+        }
+        else
+            traceRingKeyCreated = true;
+    }
+
+    stack_t crashStack;
+    memset(&crashStack, 0, sizeof(crashStack));
+    crashStack.ss_sp = traceCrashStack;
+    crashStack.ss_size = sizeof(traceCrashStack);
+    if (sigaltstack(&crashStack, NULL) != 0)
+        perror("errDumpTrace sigaltstack");
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleTraceCrash;
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (size_t s = 0; s < sizeof(traceCrashSignals) / sizeof(traceCrashSignals[0]); s++) {
+        if (sigaction(traceCrashSignals[s], &action, NULL) != 0) {
+            perror("errDumpTrace sigaction");
+            ret = errDumpTrace;
+        }
+    }
+    return ret;
+}
+
+/**
+ * \brief function to give a free ring to the calling thread, called
+ * on its first event (see traceEventAt()).
+ *
+ * \return the ring, NULL when every ring is taken.
+ */
+struct traceRingStruct *claimTraceRing() {
+    if (traceNoRing)
+        return NULL;
+    for (int r = 0; r < TRACE_MAX_THREADS; r++) {
+        struct traceRingStruct *ring = &traceRings[r];
+        bool expected = false;
+        if (ring->inUse.load(std::memory_order_relaxed) ||
+            !ring->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            continue;
+        ring->tid = (uint32_t)syscall(SYS_gettid);
+        memset(ring->name, 0, sizeof(ring->name));
+        prctl(PR_GET_NAME, ring->name, 0, 0, 0);
+        if (traceRingKeyCreated)
+            pthread_setspecific(traceRingKey, ring);
+        traceThreadRing = ring;
+        traceEvent(traceThreadStart, ring->tid);
+        return ring;
+    }
+    traceNoRing = true;
+    return NULL;
+}
+
+/**
+ * \brief function to write every ring to TRACE_DUMP_FILENAME, on
+ * TCDumpTrace.
+ *
+ * \return statusErrDef that values:
+ * - errDumpTrace when the dump file can't be written,
+ * - noError when the function exits successfully.
+ */
+statusErrDef dumpTrace() {
+    if (!writeTraceDump(traceDumpPath)) {
+        perror("errDumpTrace");
+        return errDumpTrace;
+    }
+    return noError;
+}
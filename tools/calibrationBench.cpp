@@ -0,0 +1,250 @@
+/**
+ * \file calibrationBench.cpp
+ * \brief sensor calibration kernel benchmark
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Measures the calibration of raw sensor samples by the batches of
+ * queueSensorCalibration() and calibrateSensorBatch() for MAX_SENSORS
+ * sensors: 7 in 8 sensors have a polynomial of degree 1 to 3 (evaluated
+ * 4 samples at a time with AVX2, 2 with SSE2 or NEON, see
+ * OBDH_NATIVE_ARCH), the others an 8 points lookup table. The raw samples
+ * are random 12 bits counts, 1 M samples by default (a second of the
+ * sensor acquisition rate). Every calibrated value is compared with a
+ * scalar reference, one count apart at most (a fused multiply-add rounds
+ * once). Build it with CMAKE_BUILD_TYPE=Release, the default build is
+ * not optimised.
+ *
+ * usage: calibrationBench [-n samples]
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <vector>
+#include "configDefine.h"
+#include "sensorCalibration.h"
+
+/**
+ * \brief one sensor in TABLE_SENSOR_RATIO has a lookup table.
+ */
+#define TABLE_SENSOR_RATIO 8
+
+/**
+ * \brief number of points of the lookup tables.
+ */
+#define TABLE_POINTS 8
+
+/**
+ * \brief sensor ID to sensor index lookup table, required by the
+ * derived parameters linked with the calibrations.
+ */
+int16_t sensorIndexLUT[SENSOR_INDEX_LUT_SIZE];
+
+/**
+ * \struct benchCalibrationStruct
+ * \brief a sensor calibration, as written in its text
+ *
+ */
+struct benchCalibrationStruct {
+    bool table;                                             /**< Lookup table, else polynomial */
+    double coefficients[SENSOR_CALIBRATION_MAX_DEGREE + 1]; /**< Polynomial coefficients, from degree 0 */
+    double x[TABLE_POINTS];                                 /**< Raw values of the table points */
+    double y[TABLE_POINTS];                                 /**< Values of the table points */
+};
+
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getBenchTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to round a value to the int32_t range like the
+ * calibration kernel.
+ *
+ * \param value the calibrated value
+ *
+ * \return the rounded value.
+ */
+static int32_t roundReferenceValue(double value) {
+    if (!(value > (double)INT32_MIN))
+        return INT32_MIN;
+    if (value > (double)INT32_MAX)
+        return INT32_MAX;
+    return (int32_t)lrint(value);
+}
+
+/**
+ * \brief function to calibrate a raw sample one at a time, the
+ * reference of calibrateSensorBatch().
+ *
+ * \param calibration the sensor calibration
+ * \param rawValue the raw sensor value
+ *
+ * \return the calibrated value.
+ */
+static int32_t __attribute__((noinline))
+calibrateReference(const struct benchCalibrationStruct *calibration, int32_t rawValue) {
+    double raw = (double)rawValue;
+    if (!calibration->table) {
+        double result = calibration->coefficients[SENSOR_CALIBRATION_MAX_DEGREE];
+        for (int k = SENSOR_CALIBRATION_MAX_DEGREE - 1; k >= 0; k--)
+            result = result * raw + calibration->coefficients[k];
+        return roundReferenceValue(result);
+    }
+    const double *x = calibration->x;
+    const double *y = calibration->y;
+    if (raw <= x[0])
+        return roundReferenceValue(y[0]);
+    for (int p = 1; p < TABLE_POINTS; p++) {
+        if (raw < x[p])
+            return roundReferenceValue(y[p - 1] + (raw - x[p - 1]) / (x[p] - x[p - 1]) * (y[p] - y[p - 1]));
+    }
+    return roundReferenceValue(y[TABLE_POINTS - 1]);
+}
+
+/**
+ * \brief function to draw a random number in [low, high].
+ *
+ * \param low the lowest value
+ * \param high the highest value
+ *
+ * \return the number.
+ */
+static double drawNumber(double low, double high) {
+    return low + (high - low) * rand() / RAND_MAX;
+}
+
+int main(int argc, char **argv) {
+    int option;
+    long nbSamples = 1000000;
+    while ((option = getopt(argc, argv, "n:")) != -1) {
+        switch (option) {
+        case 'n': nbSamples = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nbSamples <= 0) {
+        fprintf(stderr, "usage: %s [-n samples]\n", argv[0]);
+        return 1;
+    }
+
+    // Every calibration is written as in paramSensors.csv, %.17g gives the same doubles back
+    std::vector<struct benchCalibrationStruct> calibrations(MAX_SENSORS);
+    std::vector<uint16_t> ids(MAX_SENSORS);
+    struct paramSensorsStruct param;
+    memset(&param, 0, sizeof(param));
+    param.id = ids.data();
+    memset(sensorIndexLUT, 0xFF, sizeof(sensorIndexLUT));
+    srand(1);
+    for (int i = 0; i < MAX_SENSORS; i++) {
+        struct benchCalibrationStruct *calibration = &calibrations[i];
+        char text[SENSOR_CALIBRATION_MAX_LENGTH];
+        int length;
+        memset(calibration, 0, sizeof(*calibration));
+        ids[i] = (uint16_t)(SENSOR_ID_MIN + i);
+        calibration->table = (i % TABLE_SENSOR_RATIO == 0);
+        if (calibration->table) {
+            length = snprintf(text, sizeof(text), "lut:");
+            for (int p = 0; p < TABLE_POINTS; p++) {
+                calibration->x[p] = -2048 + p * 512 + rand() % 256;
+                calibration->y[p] = drawNumber(-100000, 100000);
+                length += snprintf(text + length, sizeof(text) - length, "%s%.17g:%.17g",
+                                   p > 0 ? "," : "", calibration->x[p], calibration->y[p]);
+            }
+        } else {
+            int degree = 1 + rand() % 3;
+            calibration->coefficients[0] = drawNumber(-1000, 1000);
+            calibration->coefficients[1] = drawNumber(0.5, 20);
+            if (degree >= 2)
+                calibration->coefficients[2] = drawNumber(-1e-3, 1e-3);
+            if (degree >= 3)
+                calibration->coefficients[3] = drawNumber(-1e-7, 1e-7);
+            length = snprintf(text, sizeof(text), "poly:");
+            for (int k = 0; k <= degree; k++)
+                length += snprintf(text + length, sizeof(text) - length, "%s%.17g",
+                                   k > 0 ? "," : "", calibration->coefficients[k]);
+        }
+        if (setSensorCalibration(i, text, length) != noError)
+            return 1;
+    }
+    if (compileSensorCalibrations(&param, MAX_SENSORS) != noError)
+        return 1;
+
+    std::vector<uint16_t> sampleSensor(nbSamples);
+    std::vector<int32_t> sampleRaw(nbSamples);
+    for (long s = 0; s < nbSamples; s++) {
+        sampleSensor[s] = (uint16_t)(rand() % MAX_SENSORS);
+        sampleRaw[s] = rand() % 4096 - 2048;
+    }
+
+    // The samples come out polynomials first, the order of each sensor is kept
+    std::vector<uint16_t> batchIndex(nbSamples + SENSOR_CALIBRATION_BATCH_SIZE);
+    std::vector<int32_t> batchValue(nbSamples + SENSOR_CALIBRATION_BATCH_SIZE);
+    long nbCalibrated = 0;
+    uint64_t batchStart = getBenchTime();
+    for (long s = 0; s < nbSamples; s++) {
+        if (queueSensorCalibration(sampleSensor[s], sampleRaw[s]))
+            nbCalibrated += calibrateSensorBatch(&batchIndex[nbCalibrated], &batchValue[nbCalibrated]);
+    }
+    nbCalibrated += calibrateSensorBatch(&batchIndex[nbCalibrated], &batchValue[nbCalibrated]);
+    uint64_t batchTime = getBenchTime() - batchStart;
+
+    std::vector<int32_t> referenceValue(nbSamples);
+    uint64_t referenceStart = getBenchTime();
+    for (long s = 0; s < nbSamples; s++)
+        referenceValue[s] = calibrateReference(&calibrations[sampleSensor[s]], sampleRaw[s]);
+    uint64_t referenceTime = getBenchTime() - referenceStart;
+
+    // Each batch holds the samples of SENSOR_CALIBRATION_BATCH_SIZE queued ones
+    long nbMismatches = 0;
+    long out = 0;
+    for (long first = 0; first < nbSamples; first += SENSOR_CALIBRATION_BATCH_SIZE) {
+        long last = first + SENSOR_CALIBRATION_BATCH_SIZE < nbSamples ? first + SENSOR_CALIBRATION_BATCH_SIZE : nbSamples;
+        for (int pass = 0; pass < 2; pass++) {
+            for (long s = first; s < last; s++) {
+                if (calibrations[sampleSensor[s]].table != (pass == 1))
+                    continue;
+                if (out >= nbCalibrated || batchIndex[out] != sampleSensor[s] ||
+                    llabs((long long)batchValue[out] - referenceValue[s]) > 1)
+                    nbMismatches++;
+                out++;
+            }
+        }
+    }
+    freeSensorCalibrations();
+
+#if defined(__AVX2__)
+    const char *vectorPath = "AVX2";
+#elif defined(__SSE2__)
+    const char *vectorPath = "SSE2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const char *vectorPath = "NEON";
+#else
+    const char *vectorPath = "scalar";
+#endif
+    printf("%d sensors (%d lookup tables), %ld samples, %ld calibrated\n",
+           MAX_SENSORS, MAX_SENSORS / TABLE_SENSOR_RATIO, nbSamples, nbCalibrated);
+    printf("batches (%s): %8.2f ns/sample (%.1f M samples/s)\n", vectorPath,
+           (double)batchTime / nbSamples, nbSamples / (batchTime / 1e3));
+    printf("scalar reference: %8.2f ns/sample (%.1f M samples/s)\n",
+           (double)referenceTime / nbSamples, nbSamples / (referenceTime / 1e3));
+    if (nbCalibrated != nbSamples || nbMismatches > 0) {
+        printf("%ld samples different from the reference\n", nbMismatches);
+        return 1;
+    }
+    return 0;
+}
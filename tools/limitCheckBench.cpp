@@ -0,0 +1,169 @@
+/**
+ * \file limitCheckBench.cpp
+ * \brief sensor limit check benchmark
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Measures the limit check of compareSensorValuesWithParam() for
+ * MAX_SENSORS sensors: the scalar comparison loop, the full pass of
+ * computeSensorLimitMasks() (AVX2, SSE2 or NEON depending on the
+ * compile options, see OBDH_NATIVE_ARCH) and the incremental check of
+ * the dirty sensors (updateDirtySensorLimits()). The values are random,
+ * some sensors are out of their bounds, and change between the passes.
+ * The masks of the scalar loop and of the full pass must be the same.
+ * Build it with CMAKE_BUILD_TYPE=Release, the default build is not
+ * optimised.
+ *
+ * usage: limitCheckBench [-l loops] [-d dirty sensors per loop]
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "configDefine.h"
+#include "limitCheck.h"
+
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getBenchTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to compare every sensor with its bounds one at a
+ * time, the reference of computeSensorLimitMasks().
+ *
+ * \param param the sensors parameters (structure of arrays)
+ * \param nbSensors the number of sensors in param
+ * \param warnMask filled with one bit per sensor out of its warning bounds
+ * \param criticalMask filled with one bit per sensor out of its critical bounds
+ */
+static void __attribute__((noinline))
+computeSensorLimitMasksScalar(const struct paramSensorsStruct *param, int nbSensors,
+                              uint64_t *warnMask, uint64_t *criticalMask) {
+    memset(warnMask, 0, SENSOR_MASK_WORDS * sizeof(uint64_t));
+    memset(criticalMask, 0, SENSOR_MASK_WORDS * sizeof(uint64_t));
+    for (int i = 0; i < nbSensors; i++) {
+        int32_t value = param->currentValue[i];
+        if (value <= param->minWarnValue[i] || value >= param->maxWarnValue[i])
+            warnMask[i >> 6] |= (uint64_t)1 << (i & 63);
+        if (value <= param->minCriticalValue[i] || value >= param->maxCriticalValue[i])
+            criticalMask[i >> 6] |= (uint64_t)1 << (i & 63);
+    }
+}
+
+/**
+ * \brief function to draw a new value for a sensor, out of its
+ * warning bounds one time in 32.
+ *
+ * \param param the sensors parameters
+ * \param i the sensor index
+ */
+static void drawSensorValue(struct paramSensorsStruct *param, int i) {
+    int32_t range = param->maxWarnValue[i] - param->minWarnValue[i];
+    if (rand() % 32 == 0)
+        param->currentValue[i] = param->maxWarnValue[i] + rand() % range;
+    else
+        param->currentValue[i] = param->minWarnValue[i] + 1 + rand() % (range - 1);
+}
+
+int main(int argc, char **argv) {
+    int option;
+    long nbLoops = 10000;
+    int nbDirty = 64;
+    while ((option = getopt(argc, argv, "l:d:")) != -1) {
+        switch (option) {
+        case 'l': nbLoops = atol(optarg); break;
+        case 'd': nbDirty = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-l loops] [-d dirty sensors per loop]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nbLoops <= 0 || nbDirty <= 0 || nbDirty > MAX_SENSORS) {
+        fprintf(stderr, "usage: %s [-l loops] [-d dirty sensors per loop]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<int32_t> values(5 * MAX_SENSORS);
+    struct paramSensorsStruct param;
+    memset(&param, 0, sizeof(param));
+    param.minCriticalValue = &values[0];
+    param.minWarnValue = &values[MAX_SENSORS];
+    param.currentValue = &values[2 * MAX_SENSORS];
+    param.maxWarnValue = &values[3 * MAX_SENSORS];
+    param.maxCriticalValue = &values[4 * MAX_SENSORS];
+    srand(1);
+    for (int i = 0; i < MAX_SENSORS; i++) {
+        param.minCriticalValue[i] = -1000 - rand() % 1000;
+        param.minWarnValue[i] = param.minCriticalValue[i] + 100;
+        param.maxCriticalValue[i] = 1000 + rand() % 1000;
+        param.maxWarnValue[i] = param.maxCriticalValue[i] - 100;
+        drawSensorValue(&param, i);
+    }
+
+    uint64_t scalarWarn[SENSOR_MASK_WORDS], scalarCritical[SENSOR_MASK_WORDS];
+    uint64_t fullWarn[SENSOR_MASK_WORDS], fullCritical[SENSOR_MASK_WORDS];
+    uint64_t scalarTime = 0, fullTime = 0, dirtyTime = 0;
+    long nbMismatches = 0;
+    resetSensorLimitState(&param, MAX_SENSORS);
+
+    for (long l = 0; l < nbLoops; l++) {
+        for (int d = 0; d < nbDirty; d++) {
+            int i = rand() % MAX_SENSORS;
+            drawSensorValue(&param, i);
+            markSensorDirty(i);
+        }
+
+        uint64_t start = getBenchTime();
+        updateDirtySensorLimits(&param);
+        uint64_t end = getBenchTime();
+        dirtyTime += end - start;
+
+        start = getBenchTime();
+        computeSensorLimitMasksScalar(&param, MAX_SENSORS, scalarWarn, scalarCritical);
+        end = getBenchTime();
+        scalarTime += end - start;
+
+        start = getBenchTime();
+        computeSensorLimitMasks(&param, MAX_SENSORS, fullWarn, fullCritical);
+        end = getBenchTime();
+        fullTime += end - start;
+
+        if (memcmp(scalarWarn, fullWarn, sizeof(fullWarn)) != 0 ||
+            memcmp(scalarCritical, fullCritical, sizeof(fullCritical)) != 0 ||
+            memcmp(sensorWarnMask, fullWarn, sizeof(fullWarn)) != 0 ||
+            memcmp(sensorCriticalMask, fullCritical, sizeof(fullCritical)) != 0)
+            nbMismatches++;
+    }
+
+#if defined(__AVX2__)
+    const char *vectorPath = "AVX2";
+#elif defined(__SSE2__)
+    const char *vectorPath = "SSE2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const char *vectorPath = "NEON";
+#else
+    const char *vectorPath = "scalar";
+#endif
+    printf("%d sensors, %ld loops, %d dirty sensors per loop, %d warning, %d critical\n",
+           MAX_SENSORS, nbLoops, nbDirty, nbSensorsWarn, nbSensorsCritical);
+    printf("scalar loop:      %10.1f ns/pass\n", (double)scalarTime / nbLoops);
+    printf("full pass (%s): %8.1f ns/pass\n", vectorPath, (double)fullTime / nbLoops);
+    printf("dirty sensors:    %10.1f ns/pass\n", (double)dirtyTime / nbLoops);
+    if (nbMismatches > 0) {
+        printf("%ld passes with different masks\n", nbMismatches);
+        return 1;
+    }
+    return 0;
+}
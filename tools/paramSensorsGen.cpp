@@ -0,0 +1,225 @@
+/**
+ * \file paramSensorsGen.cpp
+ * \brief parameter database generator
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Converts paramSensors.csv at build time to a C++ header of constexpr
+ * tables (one array per paramSensorsStruct column, the derived
+ * parameters expressions, the calibrations and the sensor IDs sorted
+ * with their index),
+ * compiled in the OBDH program by paramTable.cpp. The CSV is read with
+ * the OBDH parser, the sensor IDs, the derived parameters and the
+ * calibrations are checked like at init, so that an invalid file fails the build.
+ *
+ * usage: paramSensorsGen <paramSensors.csv> <output header>
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "configDefine.h"
+#include "statesDefine.h"
+#include "init.h"
+#include "paramCSV.h"
+#include "derivedParam.h"
+#include "sensorCalibration.h"
+
+/**
+ * \brief sensor ID to sensor index lookup table, needed by the
+ * derived parameters compilation.
+ */
+int16_t sensorIndexLUT[SENSOR_INDEX_LUT_SIZE];
+
+/**
+ * \brief sensor IDs and indexes of the sorted ID index.
+ */
+static uint32_t sortedSensors[MAX_SENSORS];
+
+/**
+ * \brief function to write one constexpr table of the header.
+ *
+ * \param file the output header
+ * \param type the C++ type of the table elements
+ * \param name the table name
+ * \param values the table values
+ * \param nbSensors the number of values
+ * \param hexadecimal true to write the values in hexadecimal
+ */
+static void writeTable(FILE *file, const char *type, const char *name, const int64_t *values,
+                       int nbSensors, bool hexadecimal) {
+    fprintf(file, "static constexpr %s %s[PARAM_SENSORS_TABLE_SIZE] = {", type, name);
+    for (int i = 0; i < nbSensors; i++) {
+        if (i % 8 == 0)
+            fprintf(file, "\n   ");
+        if (hexadecimal)
+            fprintf(file, " 0x%04llX,", (unsigned long long)values[i]);
+        else if (values[i] == INT32_MIN)
+            fprintf(file, " (-2147483647 - 1),");
+        else
+            fprintf(file, " %lld,", (long long)values[i]);
+    }
+    if (nbSensors == 0)
+        fprintf(file, " 0");
+    fprintf(file, "\n};\n\n");
+}
+
+/**
+ * \brief function to write one table of strings of the header.
+ *
+ * \param file the output header
+ * \param name the table name
+ * \param text the strings (NULL for none)
+ * \param nbSensors the number of strings
+ */
+static void writeTextTable(FILE *file, const char *name, char *const *text, int nbSensors) {
+    fprintf(file, "static const char *const %s[PARAM_SENSORS_TABLE_SIZE] = {", name);
+    for (int i = 0; i < nbSensors; i++) {
+        if (text[i] == NULL) {
+            fprintf(file, "\n    NULL,");
+            continue;
+        }
+        fprintf(file, "\n    \"");
+        for (const char *c = text[i]; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\')
+                fputc('\\', file);
+            fputc(*c, file);
+        }
+        fprintf(file, "\",");
+    }
+    if (nbSensors == 0)
+        fprintf(file, " NULL");
+    fprintf(file, "\n};\n\n");
+}
+
+/**
+ * \brief function to write the generated header.
+ *
+ * \param fileName the output header file name
+ * \param csvName the source CSV file name
+ * \param param the sensors parameters
+ * \param nbSensors the number of sensors
+ * \param expression the derived parameters expressions (NULL for the sensors)
+ * \param calibration the calibrations (NULL for the raw sensors)
+ *
+ * \return 0 on success, 1 when the header can't be written.
+ */
+static int writeHeader(const char *fileName, const char *csvName, const struct paramSensorsStruct *param,
+                       int nbSensors, char *const *expression, char *const *calibration) {
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL) {
+        perror(fileName);
+        return 1;
+    }
+    int64_t *values = (int64_t*)malloc((nbSensors + 1) * sizeof(int64_t));
+    if (values == NULL) {
+        fclose(file);
+        return 1;
+    }
+
+    fprintf(file, "/**\n * \\file paramSensorsTable.h\n * \\brief parameter database generated from %s\n"
+                  " * by paramSensorsGen, do not edit.\n */\n\n", csvName);
+    fprintf(file, "#ifndef PARAMSENSORSTABLE_H\n#define PARAMSENSORSTABLE_H\n\n#include <stddef.h>\n#include <stdint.h>\n\n");
+    fprintf(file, "#define PARAM_SENSORS_TABLE_COUNT %d\n", nbSensors);
+    fprintf(file, "#define PARAM_SENSORS_TABLE_SIZE %d\n\n", nbSensors > 0 ? nbSensors : 1);
+
+    for (int i = 0; i < nbSensors; i++) values[i] = param->id[i];
+    writeTable(file, "uint16_t", "paramSensorsTableId", values, nbSensors, true);
+    for (int i = 0; i < nbSensors; i++) values[i] = param->minCriticalValue[i];
+    writeTable(file, "int32_t", "paramSensorsTableMinCritical", values, nbSensors, false);
+    for (int i = 0; i < nbSensors; i++) values[i] = param->minWarnValue[i];
+    writeTable(file, "int32_t", "paramSensorsTableMinWarn", values, nbSensors, false);
+    for (int i = 0; i < nbSensors; i++) values[i] = param->currentValue[i];
+    writeTable(file, "int32_t", "paramSensorsTableCurrentValue", values, nbSensors, false);
+    for (int i = 0; i < nbSensors; i++) values[i] = param->maxWarnValue[i];
+    writeTable(file, "int32_t", "paramSensorsTableMaxWarn", values, nbSensors, false);
+    for (int i = 0; i < nbSensors; i++) values[i] = param->maxCriticalValue[i];
+    writeTable(file, "int32_t", "paramSensorsTableMaxCritical", values, nbSensors, false);
+    for (int i = 0; i < nbSensors; i++) values[i] = param->historyDepth[i];
+    writeTable(file, "uint32_t", "paramSensorsTableHistoryDepth", values, nbSensors, false);
+    for (int i = 0; i < nbSensors; i++) values[i] = param->expectedPeriod[i];
+    writeTable(file, "uint32_t", "paramSensorsTableExpectedPeriod", values, nbSensors, false);
+
+    // Sorted ID index, for the binary search of a sensor ID
+    for (int i = 0; i < nbSensors; i++)
+        sortedSensors[i] = ((uint32_t)param->id[i] << 16) | (uint32_t)i;
+    std::sort(sortedSensors, sortedSensors + nbSensors);
+    for (int i = 0; i < nbSensors; i++) values[i] = sortedSensors[i] >> 16;
+    writeTable(file, "uint16_t", "paramSensorsTableSortedId", values, nbSensors, true);
+    for (int i = 0; i < nbSensors; i++) values[i] = sortedSensors[i] & 0xFFFF;
+    writeTable(file, "uint16_t", "paramSensorsTableSortedIndex", values, nbSensors, false);
+
+    writeTextTable(file, "paramSensorsTableExpression", expression, nbSensors);
+    writeTextTable(file, "paramSensorsTableCalibration", calibration, nbSensors);
+    fprintf(file, "#endif\n");
+
+    free(values);
+    if (fclose(file) != 0) {
+        perror(fileName);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief main function of the parameter database generator.
+ *
+ * \param argc number of arguments
+ * \param argv the CSV file and the output header
+ *
+ * \return 0 on success, 1 on error.
+ */
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <paramSensors.csv> <output header>\n", argv[0]);
+        return 1;
+    }
+
+    struct paramSensorsStruct param;
+    int nbSensors = 0;
+    if (parseParamSensorsCSV(argv[1], &param, &nbSensors, true) != noError)
+        return 1;
+
+    // Same checks as the OBDH init
+    memset(sensorIndexLUT, 0xFF, sizeof(sensorIndexLUT));
+    for (int i = 0; i < nbSensors; i++) {
+        if (sensorIndexLUT[param.id[i]] != -1) {
+            fprintf(stderr, "%s: sensor %d: id=0x%04X already declared by sensor %d\n",
+                    argv[1], i, param.id[i], sensorIndexLUT[param.id[i]]);
+            return 1;
+        }
+        sensorIndexLUT[param.id[i]] = (int16_t)i;
+    }
+    if (compileDerivedParameters(&param, nbSensors) != noError)
+        return 1;
+
+    char **expression = (char**)calloc(nbSensors + 1, sizeof(char*));
+    char **calibration = (char**)calloc(nbSensors + 1, sizeof(char*));
+    if (expression == NULL || calibration == NULL)
+        return 1;
+    for (int i = 0; i < nbSensors; i++) {
+        expression[i] = takeDerivedExpression(i);
+        calibration[i] = takeSensorCalibration(i);
+        if (calibration[i] != NULL && expression[i] != NULL) {
+            fprintf(stderr, "%s: sensor 0x%04X: a derived parameter can't have a calibration\n",
+                    argv[1], param.id[i]);
+            return 1;
+        }
+    }
+
+    int ret = writeHeader(argv[2], argv[1], &param, nbSensors, expression, calibration);
+    printf("%s: %d sensors, %d derived parameters\n", argv[2], nbSensors, nbDerivedParameters);
+
+    for (int i = 0; i < nbSensors; i++) {
+        free(expression[i]);
+        free(calibration[i]);
+    }
+    free(expression);
+    free(calibration);
+    freeDerivedParameters();
+    freeParamSensorsArrays(&param);
+    return ret;
+}
@@ -0,0 +1,250 @@
+/**
+ * \file pipelineBench.cpp
+ * \brief OBDH pipeline throughput benchmark
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Measures the sensor acquisition throughput of the control mode, in
+ * the single-threaded mode (checkSensors() in a loop, without the minor
+ * frame wait, with the housekeeping and latency reports every
+ * PIPELINE_BATCH_SIZE checks) then with the OBDH pipeline (see
+ * obdhPipeline.h). With RT_PROFILE, the allocations of the
+ * single-threaded loop are counted as checkRTProfile() does. The CAN
+ * socket is replaced by a local socket pair fed by a producer thread
+ * with in-bounds sensor frames, the telemetry goes to the TT&C address
+ * as in the program. Run it from the build directory, as the program,
+ * to find the parameters file. The projected throughput is the rate of
+ * the slowest stage, reached when every stage has its own CPU.
+ *
+ * usage: pipelineBench [-n frames]
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include "configDefine.h"
+#include "init.h"
+#include "restart.h"
+#include "controlMode.h"
+#include "canFilter.h"
+#include "sensorLog.h"
+#include "obdhPipeline.h"
+#include "rtProfile.h"
+
+/**
+ * \brief sensors of the frames, in paramSensors.csv.
+ */
+static const uint16_t benchSensorIds[] = {0x0900, 0x0902, 0x0903};
+
+/**
+ * \brief number of frames written by the producer thread.
+ */
+static long nbBenchFrames = 0;
+
+/**
+ * \brief producer end of the socket pair.
+ */
+static int benchProducerSocket = -1;
+
+/**
+ * \brief function to read a clock.
+ *
+ * \param clock CLOCK_MONOTONIC or CLOCK_THREAD_CPUTIME_ID
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getBenchTime(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief producer thread: writes nbBenchFrames sensor frames, blocking
+ * while the socket buffer is full, as a CAN bus faster than the OBDH.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *benchProducerTask(void *arg) {
+    struct can_frame frame;
+    (void)arg;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = CAN_ID_OBDH;
+    frame.can_dlc = 8;
+    frame.data[0] = 0xFF;
+    for (long f = 0; f < nbBenchFrames; f++) {
+        uint16_t sensorId = benchSensorIds[f % (sizeof(benchSensorIds) / sizeof(benchSensorIds[0]))];
+        frame.data[1] = (uint8_t)(sensorId >> 8);
+        frame.data[2] = (uint8_t)(sensorId & 0xFF);
+        frame.data[6] = (uint8_t)(10 + f % 8);
+        if (write(benchProducerSocket, &frame, sizeof(frame)) != (ssize_t)sizeof(frame)) {
+            perror("pipelineBench producer");
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief function to replace the CAN socket by a socket pair and to
+ * start the producer thread.
+ *
+ * \param producer the producer thread
+ *
+ * \return true when the producer is started.
+ */
+static bool startBenchProducer(pthread_t *producer) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) != 0) {
+        perror("pipelineBench socketpair");
+        return false;
+    }
+    if (socket_can >= 0)
+        close(socket_can);
+    socket_can = sockets[0];
+    fcntl(socket_can, F_SETFL, fcntl(socket_can, F_GETFL, 0) | O_NONBLOCK);
+    benchProducerSocket = sockets[1];
+    if (pthread_create(producer, NULL, benchProducerTask, NULL) != 0) {
+        perror("pipelineBench producer");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief function to join the producer thread and to close its socket.
+ *
+ * \param producer the producer thread
+ */
+static void joinBenchProducer(pthread_t producer) {
+    pthread_join(producer, NULL);
+    close(benchProducerSocket);
+    benchProducerSocket = -1;
+}
+
+/**
+ * \brief function to get the number of sensor frames dispatched.
+ *
+ * \return the hits of every CAN filter.
+ */
+static uint64_t getDispatchedFrames() {
+    uint64_t total = 0;
+    for (int f = 0; f < nbCANFilters; f++)
+        total += canFilterHits[f];
+    return total;
+}
+
+int main(int argc, char **argv) {
+    int option;
+    nbBenchFrames = 100000;
+    while ((option = getopt(argc, argv, "n:")) != -1) {
+        switch (option) {
+        case 'n': nbBenchFrames = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nbBenchFrames <= 0) {
+        fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+        return 1;
+    }
+
+    // No CAN interface is needed, the CAN socket error is expected
+    if (initTTC() != noError)
+        return 1;
+    initOBDH();
+    if (paramSensors == NULL || initOBDHPipeline() != noError) {
+        fprintf(stderr, "pipelineBench: OBDH not initialised\n");
+        return 1;
+    }
+
+    // Single-threaded: the control thread does every step
+    pthread_t producer;
+    if (!startBenchProducer(&producer))
+        return 1;
+    uint64_t singleStart = getBenchTime(CLOCK_MONOTONIC);
+    uint64_t singleCPUStart = getBenchTime(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t dispatchedStart = getDispatchedFrames();
+    uint64_t nbChecks = 0;
+#if RT_PROFILE
+    // Only the allocation counting of the real-time profile, the bench keeps SCHED_OTHER
+    rtProfileEnabled = true;
+    armRTAllocationCheck();
+#endif
+    while (getDispatchedFrames() - dispatchedStart < (uint64_t)nbBenchFrames) {
+        checkSensors();
+        if (++nbChecks % PIPELINE_BATCH_SIZE == 0) {
+            runHousekeeping();
+            reportLoopLatency();
+        }
+    }
+    pollSensorLog(getTimeSinceStart());
+    uint64_t singleTime = getBenchTime(CLOCK_MONOTONIC) - singleStart;
+    uint64_t singleCPU = getBenchTime(CLOCK_THREAD_CPUTIME_ID) - singleCPUStart;
+#if RT_PROFILE
+    statusErrDef rtRet = checkRTProfile();
+    rtProfileEnabled = false;
+#endif
+    joinBenchProducer(producer);
+
+    // Pipeline: the same frames through the four stages
+    uint64_t stageMessages[NB_PIPELINE_STAGES];
+    uint64_t stageBusy[NB_PIPELINE_STAGES];
+    for (int s = 0; s < NB_PIPELINE_STAGES; s++) {
+        stageMessages[s] = pipelineStages[s].nbMessages;
+        stageBusy[s] = pipelineStages[s].busyTime;
+    }
+    if (!startBenchProducer(&producer))
+        return 1;
+    uint64_t pipelineStart = getBenchTime(CLOCK_MONOTONIC);
+    if (startOBDHPipeline() != noError) {
+        fprintf(stderr, "pipelineBench: pipeline not started\n");
+        return 1;
+    }
+    struct timespec poll = {0, 100000};
+    while (pipelineStages[pipelineProcessing].nbMessages - stageMessages[pipelineProcessing] < (uint64_t)nbBenchFrames)
+        nanosleep(&poll, NULL);
+    while (!isSPSCRingEmpty(&pipelineLogQueue) || !isSPSCRingEmpty(&pipelineTelemQueue))
+        nanosleep(&poll, NULL);
+    uint64_t pipelineTime = getBenchTime(CLOCK_MONOTONIC) - pipelineStart;
+    stopOBDHPipeline();
+    joinBenchProducer(producer);
+
+    double singleRate = nbBenchFrames * 1e9 / singleTime;
+    double pipelineRate = nbBenchFrames * 1e9 / pipelineTime;
+    printf("pipelineBench: %ld frames, %ld CPU\n", nbBenchFrames, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("single-threaded: %.0f frames/s, %.2f us CPU per frame\n",
+           singleRate, singleCPU / 1000.0 / nbBenchFrames);
+#if RT_PROFILE
+    printf("single-threaded control thread: %s\n",
+           rtRet == errRTAllocation ? "allocations in the sensor data path" : "no allocation");
+#endif
+    printf("pipeline: %.0f frames/s, speedup %.2f\n", pipelineRate, pipelineRate / singleRate);
+    uint64_t slowestStage = 1;
+    for (int s = 0; s < NB_PIPELINE_STAGES; s++) {
+        uint64_t busy = pipelineStages[s].busyTime - stageBusy[s];
+        printf("  %-10s %8llu messages, %.2f us CPU per frame\n", pipelineStages[s].name,
+               (unsigned long long)(pipelineStages[s].nbMessages - stageMessages[s]),
+               busy / 1000.0 / nbBenchFrames);
+        if (busy > slowestStage)
+            slowestStage = busy;
+    }
+    printf("projected with one CPU per stage: %.0f frames/s, speedup %.2f\n",
+           nbBenchFrames * 1e9 / slowestStage, nbBenchFrames * 1e9 / slowestStage / singleRate);
+
+    // Prints the pipeline counters
+    freeOBDH();
+    freeTTC();
+    return 0;
+}
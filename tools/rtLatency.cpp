@@ -0,0 +1,147 @@
+/**
+ * \file rtLatency.cpp
+ * \brief real-time latency measurement tool
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Measures the wake up latency of a periodic thread, as cyclictest does:
+ * the thread sleeps until absolute deadlines (clock_nanosleep(TIMER_ABSTIME))
+ * and records how late it wakes up, while load threads allocate, touch
+ * memory and compute. With -r the measuring thread gets the OBDH
+ * real-time profile (see rtProfile.h): SCHED_FIFO at RT_CONTROL_PRIORITY
+ * on RT_CONTROL_CPU, locked and prefaulted memory. Compare the report
+ * with and without -r on the target.
+ *
+ * usage: rtLatency [-r] [-i interval us] [-l loops] [-t load threads]
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "configDefine.h"
+#include "histogram.h"
+#include "rtProfile.h"
+
+/**
+ * \brief bytes allocated and written by a load thread at each round.
+ */
+#define LOAD_BLOCK_SIZE (4 * 1024 * 1024)
+
+/**
+ * \brief set to stop the load threads.
+ */
+static volatile bool loadStop = false;
+
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getLatencyTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief load thread: allocates a block, writes every byte, computes
+ * over it and frees it, until loadStop.
+ *
+ * \param arg unused
+ *
+ * \return NULL.
+ */
+static void *loadTask(void *arg) {
+    volatile uint64_t sum = 0;
+    (void)arg;
+    while (!loadStop) {
+        uint8_t *block = (uint8_t*)malloc(LOAD_BLOCK_SIZE);
+        if (block == NULL)
+            continue;
+        memset(block, (int)sum, LOAD_BLOCK_SIZE);
+        for (size_t i = 0; i < LOAD_BLOCK_SIZE; i += 64)
+            sum += block[i] * 2654435761u;
+        free(block);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    bool realTime = false;
+    long interval = 1000;
+    long loops = 10000;
+    long nbLoads = sysconf(_SC_NPROCESSORS_ONLN);
+    int option;
+
+    while ((option = getopt(argc, argv, "ri:l:t:")) != -1) {
+        switch (option) {
+        case 'r': realTime = true; break;
+        case 'i': interval = atol(optarg); break;
+        case 'l': loops = atol(optarg); break;
+        case 't': nbLoads = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-r] [-i interval us] [-l loops] [-t load threads]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (interval <= 0 || loops <= 0 || nbLoads < 0) {
+        fprintf(stderr, "usage: %s [-r] [-i interval us] [-l loops] [-t load threads]\n", argv[0]);
+        return 1;
+    }
+
+    // The histogram is allocated before the profile to be locked with the rest
+    struct histogramStruct *latency = (struct histogramStruct*)calloc(1, sizeof(struct histogramStruct));
+    pthread_t *loads = (pthread_t*)calloc(nbLoads + 1, sizeof(pthread_t));
+    if (latency == NULL || loads == NULL) {
+        perror("rtLatency");
+        return 1;
+    }
+    // The load threads are started first, to keep the normal scheduling
+    long nbStarted = 0;
+    while (nbStarted < nbLoads && pthread_create(&loads[nbStarted], NULL, loadTask, NULL) == 0)
+        nbStarted++;
+    if (initRTProfile(realTime) != noError)
+        fprintf(stderr, "real-time profile not fully applied, see above\n");
+
+    printf("rtLatency: interval %ld us, %ld loops, %ld load threads, real-time profile %s\n",
+           interval, loops, nbStarted, realTime ? "on" : "off");
+    uint64_t deadline = getLatencyTime();
+    uint64_t minLatency = UINT64_MAX;
+    long overruns = 0;
+    for (long l = 0; l < loops; l++) {
+        deadline += (uint64_t)interval * 1000;
+        struct timespec wakeUp;
+        wakeUp.tv_sec = (time_t)(deadline / 1000000000ULL);
+        wakeUp.tv_nsec = (long)(deadline % 1000000000ULL);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, NULL);
+        uint64_t late = getLatencyTime() - deadline;
+        recordHistogram(latency, late);
+        if (late < minLatency)
+            minLatency = late;
+        // Woken up after the next deadline, cyclictest counts it too
+        if (late >= (uint64_t)interval * 1000)
+            overruns++;
+    }
+
+    loadStop = true;
+    for (long t = 0; t < nbStarted; t++)
+        pthread_join(loads[t], NULL);
+
+    printf("latency (us): min %llu, avg %llu, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n",
+           (unsigned long long)(minLatency / 1000),
+           (unsigned long long)(latency->total / latency->nbValues / 1000),
+           (unsigned long long)(getHistogramPercentile(latency, 500) / 1000),
+           (unsigned long long)(getHistogramPercentile(latency, 900) / 1000),
+           (unsigned long long)(getHistogramPercentile(latency, 990) / 1000),
+           (unsigned long long)(getHistogramPercentile(latency, 999) / 1000),
+           (unsigned long long)(latency->max / 1000));
+    printf("wake ups after the next deadline: %ld\n", overruns);
+    free(loads);
+    free(latency);
+    return 0;
+}
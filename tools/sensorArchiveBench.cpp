@@ -0,0 +1,190 @@
+/**
+ * \file sensorArchiveBench.cpp
+ * \brief sensor archive benchmark
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Archives a period of readings of every sensor (by default a day of
+ * MAX_SENSORS sensors read every 10 seconds, random walk values), then
+ * measures the queries of querySensorArchive(): one hour of a random
+ * sensor, then a whole period of a random sensor above a value bound,
+ * which skips the blocks out of the value range. The archive is then
+ * closed and opened again, the index is rebuilt from the block headers
+ * and the hour queries must return the same readings.
+ *
+ * usage: sensorArchiveBench [-s sensors] [-p period ms] [-H hours]
+ * [-q queries] <archive file>
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "configDefine.h"
+#include "sensorArchive.h"
+
+/**
+ * \brief length in microseconds of the time window queries.
+ */
+#define BENCH_QUERY_WINDOW 3600000000ULL
+
+/**
+ * \brief value bound of the value range queries.
+ */
+#define BENCH_VALUE_BOUND 200
+
+/**
+ * \struct benchQueryStruct
+ * \brief one time window query and its result
+ *
+ */
+struct benchQueryStruct {
+    int index;                              /**< Sensor index */
+    uint64_t fromTime;                      /**< First time of the window */
+    size_t nbReadings;                      /**< Readings returned before the reopening */
+};
+
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getBenchTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to print the usage of the benchmark.
+ *
+ * \param name the program name
+ */
+static void printUsage(const char *name) {
+    fprintf(stderr, "usage: %s [-s sensors] [-p period ms] [-H hours] [-q queries] <archive file>\n", name);
+}
+
+int main(int argc, char **argv) {
+    int option;
+    int nbSensors = MAX_SENSORS;
+    long period = 10000;
+    long nbHours = 24;
+    int nbQueries = 1000;
+    while ((option = getopt(argc, argv, "s:p:H:q:")) != -1) {
+        switch (option) {
+        case 's': nbSensors = atoi(optarg); break;
+        case 'p': period = atol(optarg); break;
+        case 'H': nbHours = atol(optarg); break;
+        case 'q': nbQueries = atoi(optarg); break;
+        default:
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || nbSensors <= 0 || nbSensors > MAX_SENSORS ||
+        period <= 0 || nbHours <= 0 || nbQueries <= 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const char *fileName = argv[optind];
+    const uint64_t duration = (uint64_t)nbHours * 3600000000ULL;
+    const uint64_t periodTime = (uint64_t)period * 1000;
+
+    std::vector<uint16_t> ids(nbSensors);
+    std::vector<int32_t> values(nbSensors, 0);
+    for (int i = 0; i < nbSensors; i++)
+        ids[i] = (uint16_t)(SENSOR_ID_MIN + i);
+    char previousName[MAX_PATH_LENGHT];
+    snprintf(previousName, sizeof(previousName), "%s%s", fileName, SENSOR_ARCHIVE_PREVIOUS_SUFFIX);
+    unlink(fileName);
+    unlink(previousName);
+    if (initSensorArchive(fileName, ids.data(), nbSensors) != noError)
+        return 1;
+
+    // Every sensor is read once per period, a few microseconds apart
+    srand(1);
+    uint64_t nbReadings = 0;
+    uint64_t writeStart = getBenchTime();
+    for (uint64_t time = 0; time < duration; time += periodTime) {
+        for (int i = 0; i < nbSensors; i++) {
+            values[i] += rand() % 5 - 2;
+            if (pushSensorArchive(i, time + i, values[i]) != noError) {
+                fprintf(stderr, "sensorArchiveBench: archive write failed\n");
+                return 1;
+            }
+            nbReadings++;
+        }
+    }
+    if (closeSensorArchive() != noError ||
+        initSensorArchive(fileName, ids.data(), nbSensors) != noError)
+        return 1;
+    uint64_t writeTime = getBenchTime() - writeStart;
+    printf("%d sensors, %ld ms period, %ld hours: %llu readings archived in %.2f s (%.0f readings/s)\n",
+           nbSensors, period, nbHours, (unsigned long long)nbReadings, writeTime / 1e9,
+           nbReadings / (writeTime / 1e9));
+    printSensorArchiveStats();
+
+    // One hour of a random sensor
+    std::vector<struct benchQueryStruct> queries(nbQueries);
+    std::vector<struct sensorArchiveReadingStruct> readings;
+    uint64_t windowReadings = 0;
+    uint64_t windowStart = getBenchTime();
+    for (int q = 0; q < nbQueries; q++) {
+        queries[q].index = rand() % nbSensors;
+        queries[q].fromTime = duration > BENCH_QUERY_WINDOW ?
+            (uint64_t)((double)rand() / RAND_MAX * (duration - BENCH_QUERY_WINDOW)) : 0;
+        readings.clear();
+        if (querySensorArchive(queries[q].index, queries[q].fromTime, queries[q].fromTime + BENCH_QUERY_WINDOW,
+                               INT32_MIN, INT32_MAX, &readings) != noError) {
+            fprintf(stderr, "sensorArchiveBench: query failed\n");
+            return 1;
+        }
+        queries[q].nbReadings = readings.size();
+        windowReadings += readings.size();
+    }
+    uint64_t windowTime = getBenchTime() - windowStart;
+    printf("hour queries:  %8.1f us/query, %.0f readings/query\n",
+           windowTime / 1e3 / nbQueries, (double)windowReadings / nbQueries);
+
+    // A whole period above a value bound
+    uint64_t boundReadings = 0;
+    uint64_t boundStart = getBenchTime();
+    for (int q = 0; q < nbQueries; q++) {
+        readings.clear();
+        if (querySensorArchive(rand() % nbSensors, 0, duration, BENCH_VALUE_BOUND, INT32_MAX, &readings) != noError) {
+            fprintf(stderr, "sensorArchiveBench: query failed\n");
+            return 1;
+        }
+        boundReadings += readings.size();
+    }
+    uint64_t boundTime = getBenchTime() - boundStart;
+    printf("value queries: %8.1f us/query, %.1f readings/query\n",
+           boundTime / 1e3 / nbQueries, (double)boundReadings / nbQueries);
+    printSensorArchiveStats();
+
+    // Reopening: the index is rebuilt from the block headers
+    closeSensorArchive();
+    uint64_t reopenStart = getBenchTime();
+    if (initSensorArchive(fileName, ids.data(), nbSensors) != noError)
+        return 1;
+    uint64_t reopenTime = getBenchTime() - reopenStart;
+    int nbMismatches = 0;
+    for (int q = 0; q < nbQueries; q++) {
+        readings.clear();
+        if (querySensorArchive(queries[q].index, queries[q].fromTime, queries[q].fromTime + BENCH_QUERY_WINDOW,
+                               INT32_MIN, INT32_MAX, &readings) != noError ||
+            readings.size() != queries[q].nbReadings)
+            nbMismatches++;
+    }
+    printf("reopening:     %8.1f ms\n", reopenTime / 1e6);
+    closeSensorArchive();
+    if (nbMismatches > 0) {
+        printf("%d hour queries different after the reopening\n", nbMismatches);
+        return 1;
+    }
+    return 0;
+}
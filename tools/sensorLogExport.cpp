@@ -0,0 +1,235 @@
+/**
+ * \file sensorLogExport.cpp
+ * \brief sensor log export tool
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Converts sensor log segments (sensorLog.NNNNNN.bin or compressed
+ * sensorLog.NNNNNN.dz) or a sensor ring log file (sensorLog.ring)
+ * written by the OBDH program to one "sensorId".csv file per sensor,
+ * with the same format as the former per sensor files:
+ * Timestamp since program start (sec);Value
+ * The readings of several files are appended in the order of the
+ * arguments.
+ *
+ * usage: sensorLogExport <log file>... <outputDir>
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "configDefine.h"
+#include "sensorLog.h"
+#include "sensorLogCodec.h"
+
+/**
+ * \brief number of records read from the log at once.
+ */
+#define EXPORT_RECORDS_PER_READ 4096
+
+/**
+ * \brief output file of every sensor ID, opened on its first reading.
+ */
+static FILE *sensorFiles[SENSOR_INDEX_LUT_SIZE];
+
+/**
+ * \brief output directory and number of output files.
+ */
+static const char *outputDir = NULL;
+static int nbFiles = 0;
+
+/**
+ * \brief function to write one reading to its sensor CSV file.
+ *
+ * \param record the sensor reading
+ *
+ * \return false when the sensor file can't be created.
+ */
+static bool exportRecord(const struct sensorLogRecordStruct *record) {
+    char filePath[MAX_PATH_LENGHT];
+    uint16_t id = record->sensorId;
+
+    if (sensorFiles[id] == NULL) {
+        snprintf(filePath, sizeof(filePath), "%s/0x%04X.csv", outputDir, id);
+        sensorFiles[id] = fopen(filePath, "w");
+        if (sensorFiles[id] == NULL) {
+            perror("File open error");
+            return false;
+        }
+        fprintf(sensorFiles[id], "Timestamp since program start (sec);Value\n");
+        nbFiles++;
+    }
+    fprintf(sensorFiles[id], "%f;%d\n",
+            record->timeStamp / 1e6,
+            record->value);
+    return true;
+}
+
+/**
+ * \brief function to export a buffered sensor log file.
+ *
+ * \param logFile the log file, positioned after its header
+ * \param nbRecords the number of exported readings
+ *
+ * \return false when a sensor file can't be created.
+ */
+static bool exportLogFile(FILE *logFile, size_t *nbRecords) {
+    static struct sensorLogRecordStruct records[EXPORT_RECORDS_PER_READ];
+    size_t nbRead = 0;
+
+    while ((nbRead = fread(records, sizeof(records[0]), EXPORT_RECORDS_PER_READ, logFile)) > 0) {
+        for (size_t i = 0; i < nbRead; i++) {
+            if (!exportRecord(&records[i]))
+                return false;
+        }
+        *nbRecords += nbRead;
+    }
+    return true;
+}
+
+/**
+ * \brief function to export a compressed sensor log segment.
+ *
+ * \param logFile the log file, positioned after its header
+ * \param nbRecords the number of exported readings
+ *
+ * \return false when a block is damaged or a sensor file
+ * can't be created.
+ */
+static bool exportCompressedFile(FILE *logFile, size_t *nbRecords) {
+    static struct sensorLogRecordStruct records[SENSOR_LOG_CODEC_BLOCK];
+    static uint8_t data[SENSOR_LOG_CODEC_BLOCK * SENSOR_LOG_CODEC_MAX_RECORD_SIZE];
+    struct sensorLogBlockHeaderStruct block;
+
+    while (fread(&block, sizeof(block), 1, logFile) == 1) {
+        if (block.nbRecords > SENSOR_LOG_CODEC_BLOCK || block.nbBytes > sizeof(data) ||
+            fread(data, 1, block.nbBytes, logFile) != block.nbBytes ||
+            !decodeSensorLogBlock(data, block.nbBytes, records, block.nbRecords)) {
+            fprintf(stderr, "damaged compressed block after %zu readings\n", *nbRecords);
+            return false;
+        }
+        for (uint32_t i = 0; i < block.nbRecords; i++) {
+            if (!exportRecord(&records[i]))
+                return false;
+        }
+        *nbRecords += block.nbRecords;
+    }
+    return true;
+}
+
+/**
+ * \brief function to export the committed readings of a sensor
+ * ring log file, from the oldest one to the latest one.
+ *
+ * \param fileName the ring log file
+ * \param nbRecords the number of exported readings
+ *
+ * \return false when the file is not a valid ring log file or
+ * a sensor file can't be created.
+ */
+static bool exportRingFile(const char *fileName, size_t *nbRecords) {
+    struct stat fileStat;
+    bool ret = true;
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0 || fstat(fd, &fileStat) < 0) {
+        perror("File open error");
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    void *mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+
+    const struct sensorLogRingHeaderStruct *header = (const struct sensorLogRingHeaderStruct*)mapping;
+    const struct sensorLogRecordStruct *records =
+        (const struct sensorLogRecordStruct*)((const uint8_t*)mapping + SENSOR_LOG_RING_HEADER_SIZE);
+    uint64_t capacity = header->capacity;
+    if (header->version != SENSOR_LOG_VERSION ||
+        header->recordSize != sizeof(struct sensorLogRecordStruct) ||
+        capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        (size_t)fileStat.st_size < SENSOR_LOG_RING_HEADER_SIZE + capacity * sizeof(struct sensorLogRecordStruct)) {
+        fprintf(stderr, "%s is not a sensor ring log file (version %d)\n", fileName, SENSOR_LOG_VERSION);
+        munmap(mapping, fileStat.st_size);
+        return false;
+    }
+
+    uint64_t commitIndex = header->commitIndex.load(std::memory_order_acquire);
+    uint64_t firstIndex = (commitIndex > capacity) ? commitIndex - capacity : 0;
+    for (uint64_t seq = firstIndex; seq < commitIndex && ret; seq++) {
+        ret = exportRecord(&records[seq & (capacity - 1)]);
+        (*nbRecords)++;
+    }
+    munmap(mapping, fileStat.st_size);
+    return ret;
+}
+
+/**
+ * \brief function to export one sensor log file of any kind.
+ *
+ * \param fileName the log file
+ * \param nbRecords the number of exported readings
+ *
+ * \return false when the file can't be exported.
+ */
+static bool exportFile(const char *fileName, size_t *nbRecords) {
+    struct sensorLogHeaderStruct header;
+    bool exported = false;
+
+    FILE *logFile = fopen(fileName, "rb");
+    if (logFile == NULL) {
+        perror("File open error");
+        return false;
+    }
+    if (fread(&header, sizeof(header), 1, logFile) != 1) {
+        fprintf(stderr, "%s is not a sensor log file\n", fileName);
+        fclose(logFile);
+        return false;
+    }
+
+    if (memcmp(header.magic, SENSOR_LOG_RING_MAGIC, sizeof(header.magic)) == 0) {
+        fclose(logFile);
+        return exportRingFile(fileName, nbRecords);
+    }
+    if (header.version != SENSOR_LOG_VERSION || header.recordSize != sizeof(struct sensorLogRecordStruct))
+        fprintf(stderr, "%s is not a sensor log file (version %d)\n", fileName, SENSOR_LOG_VERSION);
+    else if (memcmp(header.magic, SENSOR_LOG_MAGIC, sizeof(header.magic)) == 0)
+        exported = exportLogFile(logFile, nbRecords);
+    else if (memcmp(header.magic, SENSOR_LOG_COMPRESSED_MAGIC, sizeof(header.magic)) == 0)
+        exported = exportCompressedFile(logFile, nbRecords);
+    else
+        fprintf(stderr, "%s is not a sensor log file\n", fileName);
+    fclose(logFile);
+    return exported;
+}
+
+int main(int argc, char **argv) {
+    size_t nbRecords = 0;
+    bool exported = true;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <log file>... <outputDir>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    outputDir = argv[argc - 1];
+
+    for (int i = 1; i < argc - 1 && exported; i++)
+        exported = exportFile(argv[i], &nbRecords);
+
+    for (int id = 0; id < SENSOR_INDEX_LUT_SIZE; id++) {
+        if (sensorFiles[id] != NULL)
+            fclose(sensorFiles[id]);
+    }
+    printf("%zu readings exported to %d sensor files\n", nbRecords, nbFiles);
+    return exported ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,132 @@
+/**
+ * \file sensorLookupBench.cpp
+ * \brief sensor ID lookup benchmark
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Measures the sensor ID to sensor index lookup of manageSensorData()
+ * for MAX_SENSORS sensors: the linear scan of the parameters done before
+ * the lookup table, then getSensorIndex() on the table filled by
+ * buildSensorIndexLUT(). The recieved IDs are random, one in
+ * UNKNOWN_SENSOR_RATIO is not in the parameters. Both lookups must find
+ * the same index for every frame.
+ *
+ * usage: sensorLookupBench [-n frames]
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "configDefine.h"
+#include "init.h"
+
+/**
+ * \brief one recieved ID in UNKNOWN_SENSOR_RATIO is not a sensor.
+ */
+#define UNKNOWN_SENSOR_RATIO 16
+
+/**
+ * \brief function to read the monotonic clock.
+ *
+ * \return the time in nanoseconds.
+ */
+static uint64_t getBenchTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * \brief function to find a sensor index as before the lookup table,
+ * every line of the parameters is compared.
+ *
+ * \param sensorId the recieved sensor ID
+ *
+ * \return the sensor index, or -1 when the sensor ID is not a sensor.
+ */
+static int findSensorIndexLinear(uint16_t sensorId) {
+    int index = -1;
+    for (int i = 0; i < lineCountSensorParamCSV; i++) {
+        if (paramSensors->id[i] == sensorId)
+            index = i;
+    }
+    return index;
+}
+
+int main(int argc, char **argv) {
+    int option;
+    long nbFrames = 200000;
+    while ((option = getopt(argc, argv, "n:")) != -1) {
+        switch (option) {
+        case 'n': nbFrames = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nbFrames <= 0) {
+        fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+        return 1;
+    }
+
+    // MAX_SENSORS IDs spread over the sensor ID range
+    std::vector<uint16_t> ids(MAX_SENSORS);
+    struct paramSensorsStruct table;
+    memset(&table, 0, sizeof(table));
+    table.id = ids.data();
+    uint32_t idStep = (SENSOR_ID_MAX - SENSOR_ID_MIN + 1) / MAX_SENSORS;
+    for (int i = 0; i < MAX_SENSORS; i++)
+        ids[i] = (uint16_t)(SENSOR_ID_MIN + i * idStep);
+    paramSensors = &table;
+    lineCountSensorParamCSV = MAX_SENSORS;
+    memset(sensorIndexLUT, 0xFF, sizeof(sensorIndexLUT));
+    if (buildSensorIndexLUT() != noError) {
+        fprintf(stderr, "sensorLookupBench: lookup table not built\n");
+        return 1;
+    }
+
+    std::vector<uint16_t> frames(nbFrames);
+    srand(1);
+    for (long f = 0; f < nbFrames; f++) {
+        if (f % UNKNOWN_SENSOR_RATIO == 0)
+            frames[f] = (uint16_t)(ids[rand() % MAX_SENSORS] + 1);
+        else
+            frames[f] = ids[rand() % MAX_SENSORS];
+    }
+
+    std::vector<int> linearIndex(nbFrames);
+    uint64_t linearStart = getBenchTime();
+    for (long f = 0; f < nbFrames; f++)
+        linearIndex[f] = findSensorIndexLinear(frames[f]);
+    uint64_t linearTime = getBenchTime() - linearStart;
+
+    std::vector<int> tableIndex(nbFrames);
+    uint64_t tableStart = getBenchTime();
+    for (long f = 0; f < nbFrames; f++)
+        tableIndex[f] = getSensorIndex(frames[f]);
+    uint64_t tableTime = getBenchTime() - tableStart;
+
+    long nbMismatches = 0;
+    long nbUnknown = 0;
+    for (long f = 0; f < nbFrames; f++) {
+        if (linearIndex[f] != tableIndex[f])
+            nbMismatches++;
+        if (tableIndex[f] < 0)
+            nbUnknown++;
+    }
+    paramSensors = NULL;
+
+    printf("%d sensors, %ld frames (%ld unknown IDs)\n", MAX_SENSORS, nbFrames, nbUnknown);
+    printf("linear scan:  %10.2f ns/frame\n", (double)linearTime / nbFrames);
+    printf("lookup table: %10.2f ns/frame\n", (double)tableTime / nbFrames);
+    if (nbMismatches > 0) {
+        printf("%ld frames with a different index\n", nbMismatches);
+        return 1;
+    }
+    return 0;
+}
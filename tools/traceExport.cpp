@@ -0,0 +1,185 @@
+/**
+ * \file traceExport.cpp
+ * \brief trace dump export tool
+ * \author Mael Parot
+ * \version 1.0
+ * \date 16/02/2025
+ *
+ * Converts a trace dump (traceDump.bin or traceCrash.bin, see trace.h)
+ * written by the OBDH program to the Chrome trace event JSON format,
+ * opened by chrome://tracing and ui.perfetto.dev. Every ring is a
+ * thread track, the loop phases are duration events and the other
+ * events are instant events with their decoded argument. The times
+ * are in microseconds from the oldest event of the dump.
+ *
+ * usage: traceExport <trace dump> <output JSON file>
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "configDefine.h"
+#include "trace.h"
+#include "loopLatency.h"
+
+/**
+ * \struct exportRingStruct
+ * \brief one ring read from the dump
+ *
+ */
+struct exportRingStruct {
+    struct traceDumpRingStruct header;      /**< Ring header of the dump */
+    std::vector<struct traceEventStruct> events; /**< Events not overwritten during the dump, oldest first */
+};
+
+/**
+ * \brief function to read the rings of a dump file.
+ *
+ * \param file the dump file
+ * \param rings the rings read
+ *
+ * \return false when the file is not a complete trace dump.
+ */
+static bool readTraceDump(FILE *file, std::vector<struct exportRingStruct> *rings) {
+    struct traceDumpHeaderStruct header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_DUMP_VERSION) {
+        fprintf(stderr, "not a trace dump\n");
+        return false;
+    }
+    for (uint32_t r = 0; r < header.nbRings; r++) {
+        struct exportRingStruct ring;
+        if (fread(&ring.header, sizeof(ring.header), 1, file) != 1 ||
+            ring.header.head < ring.header.first || ring.header.head - ring.header.first > header.eventsPerRing) {
+            fprintf(stderr, "truncated or corrupted ring %u\n", r);
+            return false;
+        }
+        ring.events.resize(ring.header.head - ring.header.first);
+        uint64_t headAfter;
+        if ((!ring.events.empty() &&
+             fread(ring.events.data(), sizeof(struct traceEventStruct), ring.events.size(), file) != ring.events.size()) ||
+            fread(&headAfter, sizeof(headAfter), 1, file) != 1) {
+            fprintf(stderr, "truncated ring %u\n", r);
+            return false;
+        }
+        // Events overwritten by the thread while the dump was written
+        uint64_t firstValid = headAfter > header.eventsPerRing ? headAfter - header.eventsPerRing : 0;
+        if (firstValid > ring.header.first) {
+            uint64_t nbOverwritten = firstValid - ring.header.first;
+            if (nbOverwritten > ring.events.size())
+                nbOverwritten = ring.events.size();
+            ring.events.erase(ring.events.begin(), ring.events.begin() + nbOverwritten);
+        }
+        if (!ring.events.empty())
+            rings->push_back(ring);
+    }
+    return true;
+}
+
+/**
+ * \brief function to write the arguments of an instant event.
+ *
+ * \param output the JSON file
+ * \param event the event
+ */
+static void writeEventArgs(FILE *output, const struct traceEventStruct *event) {
+    switch (event->event) {
+    case traceThreadStart:
+        fprintf(output, "{\"tid\":%u}", event->arg);
+        break;
+    case traceStateChange:
+        fprintf(output, "{\"from\":\"0x%04X\",\"to\":\"0x%04X\"}", event->arg >> 16, event->arg & 0xFFFF);
+        break;
+    case traceCANFrame:
+        fprintf(output, "{\"canId\":\"0x%X\"}", event->arg);
+        break;
+    case traceTCReceived:
+        fprintf(output, "{\"tc\":\"0x%04X\"}", event->arg);
+        break;
+    case traceTelemSent:
+        fprintf(output, "{\"id\":\"0x%04X\",\"length\":%u}", event->arg >> 16, event->arg & 0xFFFF);
+        break;
+    default:
+        fprintf(output, "{\"arg\":%u}", event->arg);
+        break;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <trace dump> <output JSON file>\n", argv[0]);
+        return 1;
+    }
+    FILE *file = fopen(argv[1], "rb");
+    if (file == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    std::vector<struct exportRingStruct> rings;
+    bool ok = readTraceDump(file, &rings);
+    fclose(file);
+    if (!ok)
+        return 1;
+
+    FILE *output = fopen(argv[2], "w");
+    if (output == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    uint64_t origin = UINT64_MAX;
+    for (size_t r = 0; r < rings.size(); r++) {
+        if (rings[r].events[0].time < origin)
+            origin = rings[r].events[0].time;
+    }
+
+    size_t nbEvents = 0;
+    bool first = true;
+    fprintf(output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (size_t r = 0; r < rings.size(); r++) {
+        const struct exportRingStruct *ring = &rings[r];
+        char name[TRACE_THREAD_NAME_SIZE + 1];
+        memcpy(name, ring->header.name, TRACE_THREAD_NAME_SIZE);
+        name[TRACE_THREAD_NAME_SIZE] = '\0';
+        for (char *c = name; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20)
+                *c = '_';
+        }
+        fprintf(output, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"name\":\"ring %u %s (tid %u)\"}}",
+                first ? "" : ",\n", ring->header.ring, ring->header.ring, name, ring->header.tid);
+        first = false;
+
+        // A phase end without its start has been overwritten
+        int openPhases = 0;
+        for (size_t e = 0; e < ring->events.size(); e++) {
+            const struct traceEventStruct *event = &ring->events[e];
+            double timeStamp = (event->time - origin) / 1000.0;
+            if (event->event == tracePhaseBegin || event->event == tracePhaseEnd) {
+                if (event->event == tracePhaseEnd && openPhases == 0)
+                    continue;
+                openPhases += event->event == tracePhaseBegin ? 1 : -1;
+                fprintf(output, ",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                        event->arg < NB_LOOP_PHASES ? loopPhaseNames[event->arg] : "unknown phase",
+                        event->event == tracePhaseBegin ? "B" : "E", timeStamp, ring->header.ring);
+            }
+            else {
+                fprintf(output, ",\n{\"name\":\"%s\",\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":",
+                        event->event < NB_TRACE_EVENTS ? traceEventNames[event->event] : "unknown",
+                        timeStamp, ring->header.ring);
+                writeEventArgs(output, event);
+                fprintf(output, "}");
+            }
+            nbEvents++;
+        }
+    }
+    fprintf(output, "\n]}\n");
+    if (fclose(output) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    printf("%zu events of %zu threads written to %s\n", nbEvents, rings.size(), argv[2]);
+    return 0;
+}